@@ -0,0 +1,72 @@
+#include "pch.h"
+#include "AssetLoader.h"
+#include "Parallel.h"
+
+AssetLoader::AssetLoader(unsigned int threadCount) :
+	threadCount(threadCount ? threadCount : GetWorkerCount())
+{
+}
+
+AssetLoader::~AssetLoader()
+{
+	// Jobs that have not started are dropped; their handles stay Pending.
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		busy -= jobs.size();
+		jobs.clear();
+	}
+	wake.notify_all();
+	for (std::thread& thread : threads) thread.join();
+}
+
+LoadHandle<Mesh> AssetLoader::LoadMesh(std::string const& fileName, std::function<void(Mesh&)> prepare,
+	std::pmr::memory_resource* resource)
+{
+	return Load<Mesh>([fileName, prepare, resource]() {
+		auto mesh = std::make_unique<Mesh>(fileName, resource);
+		if (mesh->GetVertexCount() == 0) return std::unique_ptr<Mesh>();
+		if (prepare) prepare(*mesh);
+		return mesh;
+	});
+}
+
+void AssetLoader::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return busy == 0; });
+}
+
+void AssetLoader::Enqueue(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (threads.empty())
+			for (unsigned int i = 0; i < threadCount; i++)
+				threads.emplace_back([this]() { WorkerMain(); });
+		jobs.push_back(std::move(job));
+		busy++;
+	}
+	wake.notify_one();
+}
+
+void AssetLoader::WorkerMain()
+{
+	for (;;)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+		}
+		idle.notify_all();
+	}
+}
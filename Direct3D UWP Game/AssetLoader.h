@@ -0,0 +1,123 @@
+#pragma once
+#include "pch.h"
+#include "Mesh.h"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// Background asset loading.
+//
+// Load() queues a job on a small pool of worker threads and returns at once with a
+// handle. The handle can be polled every frame (GetState, Get) without blocking, so
+// the game loop keeps running while files are read and parsed; Wait() is there for
+// tools that would rather block. Jobs never wait for each other: work that needs two
+// assets is queued by the caller once both handles are ready.
+
+enum class LoadState {
+	Pending,	// queued or running
+	Ready,
+	Failed,		// the job returned nothing or threw
+};
+
+template <typename T>
+struct LoadSlot {
+	std::atomic<LoadState> state{ LoadState::Pending };
+	std::unique_ptr<T> asset;
+	std::mutex mutex;
+	std::condition_variable done;
+
+	void Finish(std::unique_ptr<T> result)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			asset = std::move(result);
+			state.store(asset ? LoadState::Ready : LoadState::Failed, std::memory_order_release);
+		}
+		done.notify_all();
+	}
+};
+
+template <typename T>
+class LoadHandle
+{
+public:
+	bool IsValid() const { return slot != nullptr; }
+	LoadState GetState() const { return slot ? slot->state.load(std::memory_order_acquire) : LoadState::Failed; }
+	bool IsReady() const { return GetState() == LoadState::Ready; }
+	bool IsDone() const { return GetState() != LoadState::Pending; }
+
+	// The asset once Ready, nullptr before that or on failure. It lives as long as a handle does.
+	T* Get() const { return IsReady() ? slot->asset.get() : nullptr; }
+
+	LoadState Wait() const
+	{
+		if (!slot) return LoadState::Failed;
+		std::unique_lock<std::mutex> lock(slot->mutex);
+		slot->done.wait(lock, [this]() { return slot->state.load() != LoadState::Pending; });
+		return slot->state.load();
+	}
+
+	void Reset() { slot.reset(); }
+
+private:
+	friend class AssetLoader;
+	std::shared_ptr<LoadSlot<T>> slot;
+};
+
+class AssetLoader
+{
+public:
+	// 0 threads picks GetWorkerCount(). The threads start with the first job.
+	explicit AssetLoader(unsigned int threadCount = 0);
+	~AssetLoader();
+
+	AssetLoader(AssetLoader const&) = delete;
+	AssetLoader& operator=(AssetLoader const&) = delete;
+
+	// Runs load on a worker: the asset is Ready when load returns it, Failed when it
+	// returns nullptr or throws (DX::ThrowIfFailed included).
+	template <typename T>
+	LoadHandle<T> Load(std::function<std::unique_ptr<T>()> load)
+	{
+		LoadHandle<T> handle;
+		handle.slot = std::make_shared<LoadSlot<T>>();
+		std::shared_ptr<LoadSlot<T>> slot = handle.slot;
+		Enqueue([slot, load]() {
+			std::unique_ptr<T> asset;
+			try
+			{
+				asset = load();
+			}
+			catch (...)
+			{
+				asset.reset();
+			}
+			slot->Finish(std::move(asset));
+		});
+		return handle;
+	}
+
+	// Reads a mesh (text or cooked, see Mesh::Mesh) and runs prepare on it in the
+	// same job; fails when the file gives no vertices. The geometry is allocated from
+	// resource (see GeometryArena.h).
+	LoadHandle<Mesh> LoadMesh(std::string const& fileName, std::function<void(Mesh&)> prepare = nullptr,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	// Blocks until every queued job has finished.
+	void WaitIdle();
+
+private:
+	void Enqueue(std::function<void()> job);
+	void WorkerMain();
+
+	unsigned int threadCount;
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	size_t busy = 0;	// jobs queued or running
+	bool stopping = false;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+};
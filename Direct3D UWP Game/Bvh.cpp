@@ -0,0 +1,435 @@
+#include "pch.h"
+#include "Bvh.h"
+#include "Parallel.h"
+#include <cassert>
+
+namespace
+{
+	const unsigned int c_binCount = 16;
+
+	// Nodes with more triangles bin in parallel blocks; subtrees with more go to a task,
+	// as long as they are near enough the root (see Builder::taskDepth).
+	const unsigned int c_parallelBinThreshold = 256 * 1024;
+	const unsigned int c_taskThreshold = 16 * 1024;
+
+	// Depth below which subtrees get tasks of their own: one level more than log2 of the
+	// workers, so there are about two tasks per worker to balance uneven splits, and
+	// never more threads than that however large the mesh is.
+	unsigned int GetTaskDepth()
+	{
+		unsigned int workers = GetWorkerCount(), depth = 0;
+		while ((1u << depth) < workers) depth++;
+		return workers > 1 ? depth + 1 : 0;
+	}
+
+	struct Bounds {
+		XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		void Grow(XMFLOAT3 const& p)
+		{
+			XMStoreFloat3(&min, XMVectorMin(XMLoadFloat3(&min), XMLoadFloat3(&p)));
+			XMStoreFloat3(&max, XMVectorMax(XMLoadFloat3(&max), XMLoadFloat3(&p)));
+		}
+		void Grow(Bounds const& b)
+		{
+			XMStoreFloat3(&min, XMVectorMin(XMLoadFloat3(&min), XMLoadFloat3(&b.min)));
+			XMStoreFloat3(&max, XMVectorMax(XMLoadFloat3(&max), XMLoadFloat3(&b.max)));
+		}
+		float HalfArea() const
+		{
+			if (min.x > max.x) return 0.0f;
+			float dx = max.x - min.x, dy = max.y - min.y, dz = max.z - min.z;
+			return dx * dy + dy * dz + dz * dx;
+		}
+	};
+
+	inline float Axis(XMFLOAT3 const& v, int axis) { return axis == 0 ? v.x : axis == 1 ? v.y : v.z; }
+
+	struct Bin {
+		Bounds bounds;
+		unsigned int count = 0;
+	};
+
+	// Triangles are partitioned by value rather than through an index list, so every
+	// pass over a node reads memory sequentially.
+	struct BuildTriangle {
+		Bounds bounds;
+		XMFLOAT3 centroid;
+		unsigned int triangle;
+	};
+
+	struct BuildNode {
+		Bounds bounds;
+		unsigned int first;
+		unsigned int count;
+		unsigned int left;	// children are left and left + 1; unused for leaves
+		bool leaf;
+	};
+
+	struct Builder {
+		std::vector<BuildTriangle> triangles;
+		std::vector<BuildNode> nodes;
+		std::atomic<unsigned int> nodeCount{ 0 };
+		unsigned int maxLeafSize;
+		unsigned int taskDepth;
+
+		// Runs func(begin, end, partial) over [first, first + count) and merges the partial
+		// results; large ranges are split into blocks processed in parallel.
+		template <typename T, typename Func>
+		void Reduce(unsigned int first, unsigned int count, T& result, Func&& func)
+		{
+			if (count <= c_parallelBinThreshold)
+			{
+				func(first, first + count, result);
+				return;
+			}
+			size_t blocks = GetWorkerCount() * 4;
+			std::vector<T> partial(blocks);
+			ParallelFor(blocks, [&](size_t b) {
+				func(first + (unsigned int)(count * b / blocks), first + (unsigned int)(count * (b + 1) / blocks), partial[b]);
+			});
+			for (T const& p : partial) result.Merge(p);
+		}
+
+		void Build(unsigned int nodeIndex, unsigned int first, unsigned int count, unsigned int depth = 0)
+		{
+			// Node bounds and centroid bounds.
+			struct NodeBounds {
+				Bounds bounds, centroids;
+				void Merge(NodeBounds const& other) { bounds.Grow(other.bounds); centroids.Grow(other.centroids); }
+			} nodeBounds;
+			Reduce(first, count, nodeBounds, [&](unsigned int begin, unsigned int end, NodeBounds& result) {
+				for (unsigned int i = begin; i < end; i++)
+				{
+					result.bounds.Grow(triangles[i].bounds);
+					result.centroids.Grow(triangles[i].centroid);
+				}
+			});
+			Bounds const& bounds = nodeBounds.bounds;
+			Bounds const& centroidBounds = nodeBounds.centroids;
+
+			BuildNode& node = nodes[nodeIndex];
+			node.bounds = bounds;
+			node.first = first;
+			node.count = count;
+			node.leaf = true;
+			if (count <= maxLeafSize) return;
+
+			// Bin the centroids along every axis; small nodes use fewer bins.
+			unsigned int binCount = std::min(c_binCount, count);
+			float scale[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float extent = Axis(centroidBounds.max, axis) - Axis(centroidBounds.min, axis);
+				scale[axis] = extent > 0.0f ? binCount * (1.0f - 1e-5f) / extent : 0.0f;
+			}
+			auto binOf = [&](BuildTriangle const& triangle, int axis) {
+				unsigned int bin = (unsigned int)((Axis(triangle.centroid, axis) - Axis(centroidBounds.min, axis)) * scale[axis]);
+				return std::min(bin, binCount - 1);
+			};
+
+			struct Bins {
+				Bin bins[3][c_binCount];
+				void Merge(Bins const& other)
+				{
+					for (int axis = 0; axis < 3; axis++)
+						for (unsigned int k = 0; k < c_binCount; k++)
+						{
+							bins[axis][k].bounds.Grow(other.bins[axis][k].bounds);
+							bins[axis][k].count += other.bins[axis][k].count;
+						}
+				}
+			} binned;
+			Reduce(first, count, binned, [&](unsigned int begin, unsigned int end, Bins& result) {
+				for (unsigned int i = begin; i < end; i++)
+					for (int axis = 0; axis < 3; axis++)
+					{
+						if (scale[axis] == 0.0f) continue;
+						Bin& bin = result.bins[axis][binOf(triangles[i], axis)];
+						bin.bounds.Grow(triangles[i].bounds);
+						bin.count++;
+					}
+			});
+			auto& bins = binned.bins;
+
+			// Sweep the split planes between bins.
+			float bestCost = FLT_MAX;
+			int bestAxis = -1;
+			unsigned int bestSplit = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (scale[axis] == 0.0f) continue;
+				float rightArea[c_binCount];
+				unsigned int rightCount[c_binCount];
+				Bounds right;
+				unsigned int n = 0;
+				for (unsigned int k = binCount - 1; k > 0; k--)
+				{
+					right.Grow(bins[axis][k].bounds);
+					n += bins[axis][k].count;
+					rightArea[k] = right.HalfArea();
+					rightCount[k] = n;
+				}
+				Bounds left;
+				n = 0;
+				for (unsigned int k = 1; k < binCount; k++)
+				{
+					left.Grow(bins[axis][k - 1].bounds);
+					n += bins[axis][k - 1].count;
+					if (n == 0 || rightCount[k] == 0) continue;
+					float cost = left.HalfArea() * n + rightArea[k] * rightCount[k];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestSplit = k;
+					}
+				}
+			}
+
+			float area = bounds.HalfArea();
+			float leafCost = c_bvhIntersectionCost * area * count;
+			float splitCost = c_bvhTraversalCost * area + c_bvhIntersectionCost * bestCost;
+			if (bestAxis >= 0 && leafCost <= splitCost && count <= maxLeafSize * 4) return;
+
+			unsigned int leftCount;
+			if (bestAxis >= 0)
+			{
+				auto begin = triangles.begin() + first;
+				auto middle = std::partition(begin, begin + count,
+					[&](BuildTriangle const& triangle) { return binOf(triangle, bestAxis) < bestSplit; });
+				leftCount = (unsigned int)(middle - begin);
+			}
+			else
+				leftCount = count / 2;	// every centroid in the same place: split the list
+
+			unsigned int left = nodeCount.fetch_add(2);
+			node.leaf = false;
+			node.left = left;
+
+			if (count > c_taskThreshold && depth < taskDepth)
+			{
+				auto task = std::async(std::launch::async, [&]() { Build(left, first, leftCount, depth + 1); });
+				Build(left + 1, first + leftCount, count - leftCount, depth + 1);
+				task.get();
+			}
+			else
+			{
+				Build(left, first, leftCount, depth + 1);
+				Build(left + 1, first + leftCount, count - leftCount, depth + 1);
+			}
+		}
+
+		// Depth first copy; the two children of a node are written next to each other.
+		void Flatten(std::vector<BvhNode>& out, unsigned int source, unsigned int target) const
+		{
+			BuildNode const& node = nodes[source];
+			out[target].boundsMin = node.bounds.min;
+			out[target].boundsMax = node.bounds.max;
+			if (node.leaf)
+			{
+				out[target].first = node.first;
+				out[target].count = node.count;
+				return;
+			}
+			unsigned int pair = (unsigned int)out.size();
+			out.resize(out.size() + 2);
+			out[target].first = pair;
+			out[target].count = 0;
+			Flatten(out, node.left, pair);
+			Flatten(out, node.left + 1, pair + 1);
+		}
+	};
+
+	struct Refitter {
+		Bvh& bvh;
+		const unsigned int* indices;
+		const float* positions;
+		size_t positionStride;
+
+		static float HalfArea(BvhNode const& node)
+		{
+			float dx = node.boundsMax.x - node.boundsMin.x, dy = node.boundsMax.y - node.boundsMin.y, dz = node.boundsMax.z - node.boundsMin.z;
+			return dx * dy + dy * dz + dz * dx;
+		}
+
+		// Bounds of an interior node from its (already refitted) children; returns the
+		// node's share of the SAH cost, not yet divided by the root area.
+		double Merge(unsigned int index)
+		{
+			BvhNode& node = bvh.nodes[index];
+			BvhNode const& left = bvh.nodes[node.first];
+			BvhNode const& right = bvh.nodes[node.first + 1];
+			XMStoreFloat3(&node.boundsMin, XMVectorMin(XMLoadFloat3(&left.boundsMin), XMLoadFloat3(&right.boundsMin)));
+			XMStoreFloat3(&node.boundsMax, XMVectorMax(XMLoadFloat3(&left.boundsMax), XMLoadFloat3(&right.boundsMax)));
+			return double(HalfArea(node)) * c_bvhTraversalCost;
+		}
+
+		// Refits the subtree below index, the node itself included; returns its SAH cost share.
+		double Refit(unsigned int index)
+		{
+			BvhNode& node = bvh.nodes[index];
+			if (!node.IsLeaf())
+				return Refit(node.first) + Refit(node.first + 1) + Merge(index);
+
+			auto position = [&](unsigned int vertex) {
+				return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride));
+			};
+			XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+			for (unsigned int i = node.first; i < node.first + node.count; i++)
+				for (size_t k = 0; k < 3; k++)
+				{
+					XMVECTOR p = position(indices[bvh.triangles[i] * 3 + k]);
+					boundsMin = XMVectorMin(boundsMin, p);
+					boundsMax = XMVectorMax(boundsMax, p);
+				}
+			XMStoreFloat3(&node.boundsMin, boundsMin);
+			XMStoreFloat3(&node.boundsMax, boundsMax);
+			return double(HalfArea(node)) * c_bvhIntersectionCost * node.count;
+		}
+	};
+}
+
+void BuildBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride, unsigned int maxLeafSize)
+{
+	unsigned int triangleCount = (unsigned int)(indexCount / 3);
+	bvh.nodes.clear();
+	bvh.triangles.resize(triangleCount);
+	bvh.buildSahCost = 0.0f;
+	if (triangleCount == 0) return;
+
+	Builder builder;
+	builder.maxLeafSize = std::max(maxLeafSize, 1u);
+	builder.taskDepth = GetTaskDepth();
+	builder.triangles.resize(triangleCount);
+
+	auto position = [&](unsigned int vertex) {
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+	};
+	const size_t blockSize = 64 * 1024;
+	ParallelFor((triangleCount + blockSize - 1) / blockSize, [&](size_t block) {
+		unsigned int end = (unsigned int)(std::min<size_t>(triangleCount, (block + 1) * blockSize));
+		for (unsigned int t = (unsigned int)(block * blockSize); t < end; t++)
+		{
+			BuildTriangle& triangle = builder.triangles[t];
+			triangle.bounds = Bounds();
+			for (size_t k = 0; k < 3; k++) triangle.bounds.Grow(position(indices[t * 3 + k]));
+			XMStoreFloat3(&triangle.centroid, XMVectorScale(XMVectorAdd(XMLoadFloat3(&triangle.bounds.min), XMLoadFloat3(&triangle.bounds.max)), 0.5f));
+			triangle.triangle = t;
+		}
+	});
+
+	// A binary tree with n leaves has at most 2n - 1 nodes.
+	builder.nodes.resize(size_t(triangleCount) * 2);
+	builder.nodeCount = 1;
+	builder.Build(0, 0, triangleCount);
+	for (unsigned int i = 0; i < triangleCount; i++)
+		bvh.triangles[i] = builder.triangles[i].triangle;
+
+	bvh.nodes.reserve(builder.nodeCount);
+	bvh.nodes.resize(1);
+	builder.Flatten(bvh.nodes, 0, 0);
+	bvh.buildSahCost = GetBvhStats(bvh).sahCost;
+}
+
+void BuildBvh(Bvh& bvh, std::vector<unsigned int> const& indices,
+	const float* positions, size_t positionStride, unsigned int maxLeafSize)
+{
+	BuildBvh(bvh, indices.data(), indices.size(), positions, positionStride, maxLeafSize);
+}
+
+BvhStats GetBvhStats(Bvh const& bvh)
+{
+	BvhStats stats = {};
+	stats.nodeCount = bvh.nodes.size();
+	if (bvh.nodes.empty()) return stats;
+
+	auto halfArea = [](BvhNode const& node) {
+		float dx = node.boundsMax.x - node.boundsMin.x, dy = node.boundsMax.y - node.boundsMin.y, dz = node.boundsMax.z - node.boundsMin.z;
+		return dx * dy + dy * dz + dz * dx;
+	};
+	float rootArea = halfArea(bvh.nodes[0]);
+	double cost = 0.0;
+	size_t leafTriangles = 0;
+
+	std::vector<std::pair<unsigned int, unsigned int>> stack = { { 0, 1 } };
+	while (!stack.empty())
+	{
+		unsigned int index = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+		BvhNode const& node = bvh.nodes[index];
+		float area = rootArea > 0.0f ? halfArea(node) / rootArea : 1.0f;
+		stats.maxDepth = std::max(stats.maxDepth, depth);
+		if (node.IsLeaf())
+		{
+			stats.leafCount++;
+			leafTriangles += node.count;
+			cost += area * c_bvhIntersectionCost * node.count;
+		}
+		else
+		{
+			cost += area * c_bvhTraversalCost;
+			stack.push_back({ node.first, depth + 1 });
+			stack.push_back({ node.first + 1, depth + 1 });
+		}
+	}
+	stats.averageLeafSize = stats.leafCount ? float(leafTriangles) / stats.leafCount : 0.0f;
+	stats.sahCost = float(cost);
+	return stats;
+}
+
+float RefitBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride)
+{
+	if (bvh.nodes.empty()) return 0.0f;
+	assert(bvh.triangles.size() == indexCount / 3);
+	(void)indexCount;
+	Refitter refitter = { bvh, indices, positions, positionStride };
+
+	// Open the tree breadth first until there are enough subtrees to go round the workers;
+	// the opened nodes are merged afterwards, deepest level first.
+	std::vector<unsigned int> subtrees = { 0 }, opened;
+	size_t subtreeTarget = GetWorkerCount() * 8;
+	while (subtrees.size() < subtreeTarget)
+	{
+		std::vector<unsigned int> next;
+		for (unsigned int index : subtrees)
+		{
+			if (bvh.nodes[index].IsLeaf())
+				next.push_back(index);
+			else
+			{
+				opened.push_back(index);
+				next.push_back(bvh.nodes[index].first);
+				next.push_back(bvh.nodes[index].first + 1);
+			}
+		}
+		if (next.size() == subtrees.size()) break;
+		subtrees.swap(next);
+	}
+
+	std::vector<double> costs(subtrees.size());
+	ParallelFor(subtrees.size(), [&](size_t i) { costs[i] = refitter.Refit(subtrees[i]); });
+	double cost = 0.0;
+	for (double c : costs) cost += c;
+	for (auto it = opened.rbegin(); it != opened.rend(); ++it) cost += refitter.Merge(*it);
+
+	// A flat mesh has a root without area; fall back to the walk that handles it.
+	float rootArea = Refitter::HalfArea(bvh.nodes[0]);
+	return rootArea > 0.0f ? float(cost / rootArea) : GetBvhStats(bvh).sahCost;
+}
+
+bool UpdateBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride, float maxCostRatio, unsigned int maxLeafSize)
+{
+	if (bvh.nodes.empty() || bvh.triangles.size() != indexCount / 3 ||
+		RefitBvh(bvh, indices, indexCount, positions, positionStride) > bvh.buildSahCost * maxCostRatio)
+	{
+		BuildBvh(bvh, indices, indexCount, positions, positionStride, maxLeafSize);
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "pch.h"
+
+using namespace DirectX;
+
+// Bounding volume hierarchy over the triangles of an indexed mesh.
+//
+// Built top-down with binned SAH (Wald 2007): at every node the triangle centroids are
+// binned along the three axes and the split with the lowest surface area cost wins,
+// unless keeping the node as a leaf is cheaper. Large nodes bin in parallel and large
+// subtrees near the root are built as tasks of their own, about two per worker. The result is flattened depth first into
+// 32 byte nodes whose two children are always adjacent.
+//
+// When the positions move but the indices stay, RefitBvh recomputes the bounds bottom-up
+// and keeps the tree. Refitted trees lose quality as the mesh deforms, and UpdateBvh
+// rebuilds once the SAH cost has grown too far past the cost of the last full build.
+
+struct BvhNode {
+	XMFLOAT3 boundsMin;
+	unsigned int first;		// interior: left child, the right one follows it; leaf: first entry in Bvh::triangles
+	XMFLOAT3 boundsMax;
+	unsigned int count;		// triangles in the leaf, 0 for interior nodes
+
+	bool IsLeaf() const { return count != 0; }
+};
+
+static_assert(sizeof(BvhNode) == 32, "BvhNode must stay 32 bytes, two per cache line");
+
+struct Bvh {
+	std::vector<BvhNode> nodes;				// nodes[0] is the root
+	std::vector<unsigned int> triangles;	// triangle numbers (first index / 3) in leaf order
+	float buildSahCost = 0.0f;				// GetBvhStats(*this).sahCost right after BuildBvh
+};
+
+// SAH cost model: one traversal step and one triangle test both cost 1.
+static const float c_bvhTraversalCost = 1.0f;
+static const float c_bvhIntersectionCost = 1.0f;
+
+// UpdateBvh rebuilds when the refitted SAH cost exceeds the build cost by this factor.
+static const float c_bvhRebuildCostRatio = 1.3f;
+
+void BuildBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride, unsigned int maxLeafSize = 4);
+void BuildBvh(Bvh& bvh, std::vector<unsigned int> const& indices,
+	const float* positions, size_t positionStride, unsigned int maxLeafSize = 4);
+
+// Tree quality: sahCost is the expected cost of a ray that hits the root box,
+// in triangle tests.
+struct BvhStats {
+	size_t nodeCount;
+	size_t leafCount;
+	unsigned int maxDepth;
+	float averageLeafSize;
+	float sahCost;
+};
+
+BvhStats GetBvhStats(Bvh const& bvh);
+
+// Recomputes every node's bounds from the current positions. The indices must be the ones
+// the tree was built from. Subtrees are refitted in parallel, then the nodes above them.
+// Returns the SAH cost of the refitted tree (same measure as BvhStats::sahCost).
+float RefitBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride);
+
+// Refits, and rebuilds instead when the tree does not match the indices or when the refitted
+// cost exceeds maxCostRatio times bvh.buildSahCost. Returns true when it rebuilt.
+bool UpdateBvh(Bvh& bvh, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride,
+	float maxCostRatio = c_bvhRebuildCostRatio, unsigned int maxLeafSize = 4);
@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "UploadEngine.h"
+#include <deque>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	class D3D12UploadQueue : public UploadQueue
+	{
+	public:
+		D3D12UploadQueue(ID3D12Device* device, uint64_t stagingSize) : device(device), stagingSize(stagingSize)
+		{
+			D3D12_COMMAND_QUEUE_DESC queueDescription = {};
+			queueDescription.Type = D3D12_COMMAND_LIST_TYPE_COPY;
+			DX::ThrowIfFailed(device->CreateCommandQueue(&queueDescription, IID_PPV_ARGS(queue.GetAddressOf())));
+			DX::ThrowIfFailed(device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(fence.GetAddressOf())));
+			fenceEvent.Attach(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+			if (!fenceEvent.IsValid())
+				throw std::exception("CreateEvent");
+
+			CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_UPLOAD);
+			CD3DX12_RESOURCE_DESC bufferDescription = CD3DX12_RESOURCE_DESC::Buffer(stagingSize);
+			DX::ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDescription,
+				D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(staging.GetAddressOf())));
+			CD3DX12_RANGE readRange(0, 0); // never read back
+			DX::ThrowIfFailed(staging->Map(0, &readRange, reinterpret_cast<void**>(&stagingData)));
+		}
+
+		uint8_t* GetStagingData() override { return stagingData; }
+		uint64_t GetStagingSize() const override { return stagingSize; }
+
+		void RecordCopy(ID3D12Resource* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override
+		{
+			if (!commandList || !recording)
+				BeginBatch();
+			commandList->CopyBufferRegion(destination, destinationOffset, staging.Get(), stagingOffset, size);
+		}
+
+		void Submit(uint64_t fenceValue) override
+		{
+			if (recording)
+			{
+				DX::ThrowIfFailed(commandList->Close());
+				queue->ExecuteCommandLists(1, CommandListCast(commandList.GetAddressOf()));
+				allocators.push_back({ currentAllocator, fenceValue });
+				currentAllocator.Reset();
+				recording = false;
+			}
+			DX::ThrowIfFailed(queue->Signal(fence.Get(), fenceValue));
+		}
+
+		uint64_t GetCompletedValue() override { return fence->GetCompletedValue(); }
+
+		void WaitForValue(uint64_t fenceValue) override
+		{
+			if (fence->GetCompletedValue() >= fenceValue)
+				return;
+			DX::ThrowIfFailed(fence->SetEventOnCompletion(fenceValue, fenceEvent.Get()));
+			WaitForSingleObjectEx(fenceEvent.Get(), INFINITE, FALSE);
+		}
+
+		void GpuWait(ID3D12CommandQueue* other, uint64_t fenceValue) override
+		{
+			DX::ThrowIfFailed(other->Wait(fence.Get(), fenceValue));
+		}
+
+	private:
+		// Every batch records with its own allocator, reused once its fence value completes
+		void BeginBatch()
+		{
+			if (!allocators.empty() && allocators.front().fenceValue <= fence->GetCompletedValue())
+			{
+				currentAllocator = allocators.front().allocator;
+				allocators.pop_front();
+				DX::ThrowIfFailed(currentAllocator->Reset());
+			}
+			else
+				DX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_COPY, IID_PPV_ARGS(currentAllocator.GetAddressOf())));
+
+			if (!commandList)
+				DX::ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_COPY, currentAllocator.Get(), nullptr, IID_PPV_ARGS(commandList.GetAddressOf())));
+			else
+				DX::ThrowIfFailed(commandList->Reset(currentAllocator.Get(), nullptr));
+			recording = true;
+		}
+
+		struct BatchAllocator {
+			ComPtr<ID3D12CommandAllocator> allocator;
+			uint64_t fenceValue;
+		};
+
+		ComPtr<ID3D12Device> device;
+		ComPtr<ID3D12CommandQueue> queue;
+		ComPtr<ID3D12Fence> fence;
+		Microsoft::WRL::Wrappers::Event fenceEvent;
+		ComPtr<ID3D12Resource> staging;
+		uint8_t* stagingData = nullptr;
+		uint64_t stagingSize;
+		ComPtr<ID3D12GraphicsCommandList> commandList;
+		ComPtr<ID3D12CommandAllocator> currentAllocator;
+		std::deque<BatchAllocator> allocators;	// in submission order
+		bool recording = false;
+	};
+}
+
+std::unique_ptr<UploadQueue> CreateD3D12UploadQueue(ID3D12Device* device, uint64_t stagingSize)
+{
+	return std::make_unique<D3D12UploadQueue>(device, stagingSize);
+}
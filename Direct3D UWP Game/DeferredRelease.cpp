@@ -0,0 +1,54 @@
+#include "pch.h"
+#include "DeferredRelease.h"
+
+DeferredReleaseQueue::~DeferredReleaseQueue()
+{
+	Flush();
+}
+
+void DeferredReleaseQueue::Push(Entry* entry)
+{
+	pendingCount.fetch_add(1, std::memory_order_relaxed);
+	entry->next = incoming.load(std::memory_order_relaxed);
+	while (!incoming.compare_exchange_weak(entry->next, entry, std::memory_order_release, std::memory_order_relaxed))
+	{
+	}
+}
+
+void DeferredReleaseQueue::TakeIncoming()
+{
+	Entry* list = incoming.exchange(nullptr, std::memory_order_acquire);
+
+	// The list is newest first: append it reversed to keep the release order
+	size_t first = pending.size();
+	for (; list; list = list->next)
+		pending.push_back(list);
+	std::reverse(pending.begin() + first, pending.end());
+}
+
+size_t DeferredReleaseQueue::Collect(uint64_t completedValue)
+{
+	TakeIncoming();
+
+	// Fence values from different threads need not be in order: check every entry
+	size_t kept = 0;
+	size_t destroyed = 0;
+	for (Entry* entry : pending)
+	{
+		if (entry->fenceValue <= completedValue)
+		{
+			delete entry;
+			destroyed++;
+		}
+		else
+			pending[kept++] = entry;
+	}
+	pending.resize(kept);
+	pendingCount.fetch_sub(destroyed, std::memory_order_relaxed);
+	return destroyed;
+}
+
+void DeferredReleaseQueue::Flush()
+{
+	Collect(UINT64_MAX);
+}
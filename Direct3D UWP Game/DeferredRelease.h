@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Destruction of GPU objects the GPU may still be reading.
+//
+// Release() hands over anything movable (a ComPtr, a PlacedBuffer, a struct of them)
+// together with the fence value of the last submission that uses it; Collect()
+// destroys what the completed fence value has reached. Fence values are plain
+// integers, so the queue runs the same against an ID3D12Fence or a fake timeline.
+//
+// Release() is lock-free and can be called from any thread: entries are pushed on an
+// atomic list. Collect(), Flush() and destruction belong to one thread (the one that
+// owns the fence, once per frame), which takes the whole list in one exchange.
+
+class DeferredReleaseQueue
+{
+public:
+	DeferredReleaseQueue() = default;
+	~DeferredReleaseQueue();
+
+	DeferredReleaseQueue(DeferredReleaseQueue const&) = delete;
+	DeferredReleaseQueue& operator=(DeferredReleaseQueue const&) = delete;
+
+	template <typename T>
+	void Release(T&& object, uint64_t fenceValue)
+	{
+		Push(new TypedEntry<std::decay_t<T>>(std::forward<T>(object), fenceValue));
+	}
+
+	// Destroys the objects whose fence value is at most completedValue; returns how many.
+	size_t Collect(uint64_t completedValue);
+
+	// Destroys everything: the GPU is idle or gone (device lost).
+	void Flush();
+
+	// Released and not destroyed yet, on any thread.
+	size_t GetPendingCount() const { return pendingCount.load(std::memory_order_relaxed); }
+
+private:
+	struct Entry {
+		Entry* next = nullptr;
+		uint64_t fenceValue;
+
+		explicit Entry(uint64_t fenceValue) : fenceValue(fenceValue) {}
+		virtual ~Entry() = default;
+	};
+
+	template <typename T>
+	struct TypedEntry : Entry {
+		T object;
+
+		TypedEntry(T&& object, uint64_t fenceValue) : Entry(fenceValue), object(std::move(object)) {}
+		TypedEntry(T const& object, uint64_t fenceValue) : Entry(fenceValue), object(object) {}
+	};
+
+	void Push(Entry* entry);
+	void TakeIncoming();
+
+	std::atomic<Entry*> incoming{ nullptr };	// pushed by Release, newest first
+	std::vector<Entry*> pending;	// owner thread only, in release order
+	std::atomic<size_t> pendingCount{ 0 };
+};
@@ -0,0 +1,87 @@
+#include "pch.h"
+#include "DescriptorAllocator.h"
+
+void DescriptorAllocator::Initialize(ID3D12Device* newDevice, D3D12_DESCRIPTOR_HEAP_TYPE newType, uint32_t newPersistentCount,
+	uint32_t transientCount, bool shaderVisible)
+{
+	device = newDevice;
+	type = newType;
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDescription = {};
+	heapDescription.Type = type;
+	heapDescription.NumDescriptors = newPersistentCount + transientCount;
+	heapDescription.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+	DX::ThrowIfFailed(device->CreateDescriptorHeap(&heapDescription, IID_PPV_ARGS(heap.ReleaseAndGetAddressOf())));
+
+	cpuStart = heap->GetCPUDescriptorHandleForHeapStart();
+	gpuStart = shaderVisible ? heap->GetGPUDescriptorHandleForHeapStart() : D3D12_GPU_DESCRIPTOR_HANDLE{};
+	increment = device->GetDescriptorHandleIncrementSize(type);
+	regions.Reset(newPersistentCount, transientCount);
+}
+
+void DescriptorAllocator::Release()
+{
+	heap.Reset();
+	device.Reset();
+	cpuStart = {};
+	gpuStart = {};
+	regions.Reset(0, 0);
+}
+
+bool DescriptorAllocator::AllocatePersistent(uint32_t count, DescriptorRange& range)
+{
+	range = DescriptorRange();
+	uint32_t index;
+	TlsfAllocation allocation;
+	if (!regions.AllocatePersistent(count, index, allocation))
+		return false;
+	range = MakeRange(index, count);
+	range.allocation = allocation;
+	return true;
+}
+
+void DescriptorAllocator::FreePersistent(DescriptorRange& range)
+{
+	regions.FreePersistent(range.allocation);
+	range = DescriptorRange();
+}
+
+bool DescriptorAllocator::AllocateTransient(uint32_t count, DescriptorRange& range)
+{
+	range = DescriptorRange();
+	uint32_t index;
+	if (!regions.AllocateTransient(count, index))
+		return false;
+	range = MakeRange(index, count);
+	return true;
+}
+
+bool DescriptorAllocator::CopyToTransient(D3D12_CPU_DESCRIPTOR_HANDLE source, uint32_t count, DescriptorRange& range)
+{
+	if (!AllocateTransient(count, range))
+		return false;
+	device->CopyDescriptorsSimple(count, range.cpu, source, type);
+	return true;
+}
+
+void DescriptorAllocator::FinishFrame(uint64_t fenceValue)
+{
+	regions.FinishFrame(fenceValue);
+}
+
+void DescriptorAllocator::Retire(uint64_t completedValue)
+{
+	regions.Retire(completedValue);
+}
+
+DescriptorRange DescriptorAllocator::MakeRange(uint32_t index, uint32_t count) const
+{
+	DescriptorRange range;
+	range.index = index;
+	range.count = count;
+	range.increment = increment;
+	range.cpu.ptr = cpuStart.ptr + SIZE_T(index) * increment;
+	if (gpuStart.ptr != 0)
+		range.gpu.ptr = gpuStart.ptr + UINT64(index) * increment;
+	return range;
+}
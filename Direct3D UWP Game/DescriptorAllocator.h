@@ -0,0 +1,78 @@
+#pragma once
+#include "pch.h"
+#include "DescriptorRegions.h"
+
+// Descriptors of one D3D12 descriptor heap, split in two regions: a persistent one for
+// descriptors that live as long as their resource and a transient ring for the tables
+// of each frame. DescriptorRegions places the ranges; this class owns the heap and
+// turns their indices into handles.
+//
+// Shader-visible heaps (CBV_SRV_UAV, SAMPLER) are the ones bound with SetDescriptorHeaps
+// and hand out GPU handles. CPU-only heaps are staging: descriptors are created there
+// once and CopyToTransient() copies them into a table of a shader-visible heap, since
+// shader-visible heaps must not be read by the CPU. Handles advance by the device's
+// GetDescriptorHandleIncrementSize for the heap type.
+//
+// Allocating, freeing and retiring are thread-safe (DescriptorRegions takes a mutex):
+// workers create descriptors while the frame is recorded. Initialize and Release are not.
+
+static const uint32_t c_descriptorPersistentCount = 4096;
+static const uint32_t c_descriptorTransientCount = 4096;
+
+struct DescriptorRange {
+	D3D12_CPU_DESCRIPTOR_HANDLE cpu = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE gpu = {};	// 0 in CPU-only heaps
+	uint32_t index = 0;	// of the first descriptor in the heap
+	uint32_t count = 0;	// 0: no range
+	uint32_t increment = 0;
+	TlsfAllocation allocation;	// persistent ranges only
+
+	bool IsValid() const { return count != 0; }
+	D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t i) const { return { cpu.ptr + SIZE_T(i) * increment }; }
+	D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t i) const { return { gpu.ptr + UINT64(i) * increment }; }
+};
+
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator() = default;
+
+	DescriptorAllocator(DescriptorAllocator const&) = delete;
+	DescriptorAllocator& operator=(DescriptorAllocator const&) = delete;
+
+	// Creates the heap on device with persistentCount + transientCount descriptors.
+	void Initialize(ID3D12Device* device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t persistentCount,
+		uint32_t transientCount, bool shaderVisible);
+	// Drops the heap; every range handed out becomes invalid.
+	void Release();
+
+	// False when the region has no free range of count descriptors.
+	bool AllocatePersistent(uint32_t count, DescriptorRange& range);
+	// The GPU must be done with the descriptors: free after the fence of their last frame.
+	void FreePersistent(DescriptorRange& range);
+
+	// Contiguous descriptors valid until the frame they are allocated in has finished on
+	// the GPU. False when frames in flight hold the ring; Retire() and try again.
+	bool AllocateTransient(uint32_t count, DescriptorRange& range);
+	// Allocates a transient table and copies count descriptors of a CPU-only heap into it.
+	bool CopyToTransient(D3D12_CPU_DESCRIPTOR_HANDLE source, uint32_t count, DescriptorRange& range);
+
+	// Closes the frame: its transient descriptors are freed once the fence reaches fenceValue.
+	void FinishFrame(uint64_t fenceValue);
+	void Retire(uint64_t completedValue);
+
+	ID3D12DescriptorHeap* GetHeap() const { return heap.Get(); }
+	uint32_t GetIncrement() const { return increment; }
+	DescriptorStats GetStats() { return regions.GetStats(); }
+
+private:
+	DescriptorRange MakeRange(uint32_t index, uint32_t count) const;
+
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> heap;
+	D3D12_DESCRIPTOR_HEAP_TYPE type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+	D3D12_CPU_DESCRIPTOR_HANDLE cpuStart = {};
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuStart = {};
+	uint32_t increment = 0;
+	DescriptorRegions regions;
+};
@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "DescriptorRegions.h"
+
+void DescriptorRegions::Reset(uint32_t newPersistentCount, uint32_t transientCount)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	persistentCount = newPersistentCount;
+	persistent.Reset(persistentCount);
+	transient.Reset(transientCount);
+}
+
+bool DescriptorRegions::AllocatePersistent(uint32_t count, uint32_t& index, TlsfAllocation& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!persistent.Allocate(count, allocation))
+		return false;
+	index = (uint32_t)(allocation.offset);
+	return true;
+}
+
+void DescriptorRegions::FreePersistent(TlsfAllocation const& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	persistent.Free(allocation);
+}
+
+bool DescriptorRegions::AllocateTransient(uint32_t count, uint32_t& index)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	uint64_t offset;
+	if (count == 0 || !transient.Allocate(count, 1, offset))
+		return false;
+	index = persistentCount + (uint32_t)(offset);
+	return true;
+}
+
+void DescriptorRegions::FinishFrame(uint64_t fenceValue)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	transient.FinishFrame(fenceValue);
+}
+
+void DescriptorRegions::Retire(uint64_t completedValue)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	transient.Retire(completedValue);
+}
+
+DescriptorStats DescriptorRegions::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	TlsfStats persistentStats = persistent.GetStats();
+	DescriptorStats stats = {};
+	stats.persistentCapacity = persistentCount;
+	stats.persistentUsed = (uint32_t)(persistentStats.usedBytes);
+	stats.transientCapacity = (uint32_t)(transient.GetCapacity());
+	stats.transientUsed = (uint32_t)(transient.GetUsedBytes());
+	stats.framesInFlight = transient.GetFramesInFlight();
+	stats.fragmentation = persistentStats.fragmentation;
+	return stats;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "TlsfAllocator.h"
+#include "UploadRing.h"
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Index bookkeeping of a descriptor heap split in two regions, with no D3D in sight:
+// DescriptorAllocator turns the indices into handles of its heap.
+//
+// The persistent region [0, persistentCount) holds descriptors that live as long as
+// their resource: ranges are placed by a TlsfAllocator, so allocating and freeing are
+// O(1) and freed ranges merge again. The transient region behind it is a ring
+// (UploadRing) for descriptor tables built every frame: FinishFrame() tags what the
+// frame allocated with the fence value it signals and Retire() gives it back once the
+// fence reaches it, exactly like the constant ring.
+//
+// Every method takes a mutex: workers create descriptors while the frame is recorded.
+
+struct DescriptorStats {
+	uint32_t persistentCapacity;
+	uint32_t persistentUsed;
+	uint32_t transientCapacity;
+	uint32_t transientUsed;	// ring space skipped at the end included
+	size_t framesInFlight;
+	float fragmentation;	// of the persistent region, as in TlsfStats
+};
+
+class DescriptorRegions
+{
+public:
+	DescriptorRegions() = default;
+
+	DescriptorRegions(DescriptorRegions const&) = delete;
+	DescriptorRegions& operator=(DescriptorRegions const&) = delete;
+
+	// Forgets every range and lays out persistentCount + transientCount descriptors.
+	void Reset(uint32_t persistentCount, uint32_t transientCount);
+
+	// index is that of the first descriptor in the heap; allocation is for FreePersistent.
+	// False when the region has no free range of count descriptors.
+	bool AllocatePersistent(uint32_t count, uint32_t& index, TlsfAllocation& allocation);
+	void FreePersistent(TlsfAllocation const& allocation);
+
+	// False when count is 0 or frames in flight hold the ring; Retire() and try again.
+	bool AllocateTransient(uint32_t count, uint32_t& index);
+
+	void FinishFrame(uint64_t fenceValue);
+	void Retire(uint64_t completedValue);
+
+	DescriptorStats GetStats();
+
+private:
+	std::mutex mutex;
+	uint32_t persistentCount = 0;
+	TlsfAllocator persistent;	// in descriptors
+	UploadRing transient;	// in descriptors, from persistentCount on
+};
@@ -0,0 +1,61 @@
+#include "pch.h"
+#include "FileWatcher.h"
+
+FileWatcher::FileWatcher(FileWatchClock::duration pollInterval, FileWatchClock::duration settleTime) :
+	pollInterval(pollInterval),
+	settleTime(settleTime)
+{
+}
+
+unsigned int FileWatcher::Watch(std::filesystem::path const& fileName)
+{
+	WatchedFile file;
+	file.path = fileName;
+	file.reported = Stat(fileName);
+	file.seen = file.reported;
+	files.push_back(file);
+	return (unsigned int)(files.size() - 1);
+}
+
+size_t FileWatcher::Poll(std::vector<unsigned int>& changed, FileWatchClock::time_point now)
+{
+	if (now < nextPoll)
+		return 0;
+	nextPoll = now + pollInterval;
+
+	size_t count = 0;
+	for (unsigned int id = 0; id < files.size(); id++)
+	{
+		WatchedFile& file = files[id];
+		FileStamp stamp = Stat(file.path);
+		if (stamp != file.seen)
+		{
+			// Still being written (or just touched): wait for it to settle
+			file.seen = stamp;
+			file.seenSince = now;
+			continue;
+		}
+		if (stamp == file.reported || !stamp.exists || now - file.seenSince < settleTime)
+			continue;
+
+		file.reported = stamp;
+		changed.push_back(id);
+		count++;
+	}
+	return count;
+}
+
+FileWatcher::FileStamp FileWatcher::Stat(std::filesystem::path const& path)
+{
+	// error_code overloads: a missing or locked file is a state, not an error
+	std::error_code error;
+	FileStamp stamp;
+	stamp.writeTime = std::filesystem::last_write_time(path, error);
+	if (error)
+		return FileStamp();
+	stamp.size = std::filesystem::file_size(path, error);
+	if (error)
+		return FileStamp();
+	stamp.exists = true;
+	return stamp;
+}
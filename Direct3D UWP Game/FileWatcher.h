@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+#include <chrono>
+#include <filesystem>
+
+// Change detection for hot reload.
+//
+// Poll() stats every watched file and compares its write time and size with the last
+// ones seen. A change is reported once the file has stayed the same for settleTime, so
+// a tool still writing it is not read half-way; a file that disappears is reported
+// when it comes back. Polls closer together than pollInterval return at once without
+// touching the disk, so Poll() can be called every frame.
+//
+// Time is passed in by the caller: the scheduling can be driven by a fake clock.
+
+using FileWatchClock = std::chrono::steady_clock;
+
+class FileWatcher
+{
+public:
+	explicit FileWatcher(FileWatchClock::duration pollInterval = std::chrono::milliseconds(250),
+		FileWatchClock::duration settleTime = std::chrono::milliseconds(200));
+
+	// Returns the id Poll() reports for this file. The current state is the baseline:
+	// a file is not reported just for existing.
+	unsigned int Watch(std::filesystem::path const& fileName);
+
+	// Appends the ids of the files whose change has settled since the last report.
+	// Returns the number appended.
+	size_t Poll(std::vector<unsigned int>& changed, FileWatchClock::time_point now);
+	size_t Poll(std::vector<unsigned int>& changed) { return Poll(changed, FileWatchClock::now()); }
+
+	std::filesystem::path const& GetPath(unsigned int id) const { return files[id].path; }
+
+private:
+	struct FileStamp {
+		bool exists = false;
+		std::filesystem::file_time_type writeTime;
+		uintmax_t size = 0;
+
+		bool operator==(FileStamp const& other) const
+		{
+			return exists == other.exists && (!exists || (writeTime == other.writeTime && size == other.size));
+		}
+		bool operator!=(FileStamp const& other) const { return !(*this == other); }
+	};
+	struct WatchedFile {
+		std::filesystem::path path;
+		FileStamp reported;		// state at the last report (or at Watch)
+		FileStamp seen;			// state at the last poll
+		FileWatchClock::time_point seenSince;
+	};
+
+	static FileStamp Stat(std::filesystem::path const& path);
+
+	FileWatchClock::duration pollInterval;
+	FileWatchClock::duration settleTime;
+	FileWatchClock::time_point nextPoll;
+	std::vector<WatchedFile> files;
+};
@@ -11,6 +11,30 @@ using namespace DirectX;
 
 using Microsoft::WRL::ComPtr;
 
+namespace
+{
+	DXGI_FORMAT ToDxgiFormat(VertexElementFormat format)
+	{
+		switch (format)
+		{
+		case VertexElementFormat::Float3: return DXGI_FORMAT_R32G32B32_FLOAT;
+		case VertexElementFormat::Float4: return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		case VertexElementFormat::Unorm16x4: return DXGI_FORMAT_R16G16B16A16_UNORM;
+		case VertexElementFormat::Snorm16x2: return DXGI_FORMAT_R16G16_SNORM;
+		case VertexElementFormat::Unorm8x4: return DXGI_FORMAT_R8G8B8A8_UNORM;
+		}
+		return DXGI_FORMAT_UNKNOWN;
+	}
+
+	// Formato comprimido (16 bytes por vrtice en lugar de 40), con las posiciones en un
+	// stream propio (slot 0) para que las pasadas de profundidad no lean el resto
+	const VertexFormat c_vertexFormat = VertexFormat::PackedSplit;
+
+	// Ficheros que se vigilan para la recarga en caliente
+	const char* const c_meshFile = "mesh.dat";
+	const char* const c_shaderFiles[] = { "vertex.cso", "vertex_packed.cso", "pixel.cso" };
+}
+
 Game::Game() noexcept :
     m_window(nullptr),
     m_outputWidth(800),
@@ -33,11 +57,16 @@ void Game::Initialize(::IUnknown* window, int width, int height, DXGI_MODE_ROTAT
 
 	CreateDevice(); // Creamos el dispotivo
 	CreateResources(); // Creamos recursos que dependen del tamao de la ventana de visualizacin
-	
-	CreateMainInputFlowResources(m_mesh); //Creamos recursos y objetos D3D12 que permiten el flujo de entrada de datos al pipeline
-	LoadPrecompiledShaders(); // Cargamos shaders precompilados
+	DX::ThrowIfFailed(m_commandList->Close()); // Se crea abierta; Clear la reinicia en cada frame
+	CreatePipelineResources(); // Buffer de constantes y root signature: no dependen de la malla
 
-	PSO(); // Creamos un estado del pipeline bsico.
+	// La malla y los shaders se cargan en segundo plano; UpdateAssets sigue su estado
+	// en cada frame y el bucle del juego empieza ya, sin esperarlos
+	m_meshWatch = m_watcher.Watch(c_meshFile);
+	for (const char* shaderFile : c_shaderFiles)
+		m_watcher.Watch(shaderFile);
+	LoadMeshAsset();
+	LoadShaderAsset();
 
 	// Inicializamos matrices de transformacin
 	XMStoreFloat4x4(&m_world, XMMatrixIdentity());
@@ -48,6 +77,8 @@ void Game::Initialize(::IUnknown* window, int width, int height, DXGI_MODE_ROTAT
 // Executes the basic game loop.
 void Game::Tick()
 {
+    UpdateAssets();
+
     m_timer.Tick([&]()
     {
         Update(m_timer);
@@ -91,18 +122,61 @@ void Game::Update(DX::StepTimer const& timer)
 	XMMATRIX worldview = world * view;
 	XMMATRIX transform = worldview * projection;
 	XMMATRIX normaltransform = XMMatrixTranspose(XMMatrixInverse(nullptr, worldview));
+
+	// Lo que sigue necesita la malla y el buffer de constantes
+	if (!m_meshResident)
+		return;
+	Mesh const& mesh = *m_residentMesh.Get();
+
 	XMStoreFloat4x4(&m_vConstants.GNormalTransform, XMMatrixTranspose(normaltransform));
 	XMStoreFloat4x4(&m_vConstants.GTransform, XMMatrixTranspose(transform));
 
-	// Actualizacin del buffer de constantes
-
-	//void* data=nullptr;
-	void* data;
+	// Culling por meshlet en espacio objeto: planos del frustum y posicin de la cmara
+	XMFLOAT4X4 worldViewProjection;
+	XMStoreFloat4x4(&worldViewProjection, transform);
+	XMFLOAT3 camera;
+	XMStoreFloat3(&camera, XMVector3TransformCoord(location, XMMatrixInverse(nullptr, world)));
+	// Primero la esfera de toda la malla: si queda fuera no hace falta mirar los meshlets
+	MeshletView meshletView = GetMeshletView(worldViewProjection, camera);
+	MeshBounds const& bounds = mesh.GetBounds();
+	if (IsSphereVisible(bounds.sphereCenter, bounds.sphereRadius, meshletView))
+		CullMeshlets(m_meshletDraws, mesh.GetMeshlets().data(), mesh.GetMeshletBounds().data(), mesh.GetMeshlets().size(),
+			meshletView, mesh.GetIndexRanges());
+	else
+		m_meshletDraws.clear();
+
+	// Picking: deshacemos la proyeccin del pxel en los planos near y far para obtener
+	// el rayo en espacio objeto, donde est construido m_rayBvh
+	if (m_pickPending)
+	{
+		m_pickPending = false;
+		float ndcX = 2.0f * (m_pickX + 0.5f) / m_outputWidth - 1.0f;
+		float ndcY = 1.0f - 2.0f * (m_pickY + 0.5f) / m_outputHeight;
+		XMMATRIX inverseTransform = XMMatrixInverse(nullptr, transform);
+		XMVECTOR nearPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 0.0f, 1.0f), inverseTransform);
+		XMVECTOR farPoint = XMVector3TransformCoord(XMVectorSet(ndcX, ndcY, 1.0f, 1.0f), inverseTransform);
+
+		Ray ray;
+		XMStoreFloat3(&ray.origin, nearPoint);
+		XMStoreFloat3(&ray.direction, XMVectorSubtract(farPoint, nearPoint));
+		ray.tMin = 0.0f;
+		ray.tMax = 1.0f;
+		RayHit hit;
+		IntersectClosest(m_rayBvh, ray, hit);
+		m_pickedTriangle = hit.triangle;
+
+		// Todava sin resaltado en pantalla: el tringulo elegido sale por la depuracin
+		wchar_t message[64] = {};
+		if (m_pickedTriangle == c_noHit)
+			swprintf_s(message, L"Picked nothing\n");
+		else
+			swprintf_s(message, L"Picked triangle %u at t = %.3f\n", m_pickedTriangle, hit.t);
+		OutputDebugStringW(message);
+	}
 
-	m_vConstantBuffer->Map(0, nullptr, reinterpret_cast<void**>(&data)); // realizamos el mapeo
-	memcpy(data, reinterpret_cast<const void*>(&m_vConstants), sizeof(vConstants)); //Copia de la transformacin
-	if (m_vConstantBuffer != nullptr)
-		m_vConstantBuffer->Unmap(0, nullptr);
+	// Actualizacin del buffer de constantes: cada frame escribe en su propio trozo del
+	// anillo, as no pisa las constantes que leen los frames que siguen en vuelo
+	m_constantAddress = WriteConstants(&m_vConstants, sizeof(vConstants));
 	elapsedTime;
 }
 
@@ -118,8 +192,16 @@ void Game::Render()
 	// Prepare the command list to render a new frame.
 	Clear();
 
-	// TODO: Add your rendering code here.
-	m_commandList->DrawIndexedInstanced(m_mesh.GetISize(), 1, 0, 0, 0);
+	// Nivel 0: un draw por tramo de meshlets visibles (calculados en Update).
+	// Resto de niveles: un draw por rango del buffer de ndices
+	// Mientras la malla se carga solo se limpia la pantalla.
+	if (m_meshResident)
+	{
+		for (IndexRange const& range : m_lod == 0 ? m_meshletDraws : m_residentMesh.Get()->GetIndexRanges(m_lod))
+		{
+			m_commandList->DrawIndexedInstanced(range.indexCount, 1, range.startIndex, range.baseVertex, 0);
+		}
+	}
 	// Show the new frame.
 	Present();
 }
@@ -129,7 +211,8 @@ void Game::Clear()
 {
 	// Reset command list and allocator.
 	DX::ThrowIfFailed(m_commandAllocators[m_backBufferIndex]->Reset());
-	DX::ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), m_pso.Get())); // Nota: establecer el PSO.
+	m_descriptors.Retire(m_fence->GetCompletedValue()); // Tablas de los frames que la GPU ya ha terminado
+	DX::ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), m_meshResident ? m_pso.Get() : nullptr)); // Nota: establecer el PSO.
 
 	// Transition the render target into the correct state to allow for drawing into it.
 	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_backBufferIndex].Get(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -148,35 +231,29 @@ void Game::Clear()
 	m_commandList->RSSetViewports(1, &viewport);
 	m_commandList->RSSetScissorRects(1, &scissorRect);
 
+	// Sin malla residente todava no hay root signature ni buffers que establecer
+	if (!m_meshResident)
+		return;
+
 	/*  Establecemos en el pipeline la root signauture:
-	La utilizacin de la root signature lleva tres acciones en la lista de comandos:
+	La utilizacin de la root signature lleva dos acciones en la lista de comandos:
 	a) Establecer la root signature
-	b) Establecer un array de heaps de descriptores: en este caso el root parameter 0, es un descriptor table.
-	Esto es un rango de descriptores, procedentes de un heap de descriptores.
-	c) Establecer el punto de comienzo del rango de descriptores a usar (se referencia a partir del heap anterior)
+	b) Establecer el root parameter 0, un CBV raz: la direccin GPU del trozo del anillo
+	de constantes que escribi Update para este frame. No hace falta heap de descriptores.
 
 	La lista de comandos que haga el Draw debe establecer la root signature
 	*/
 	// Subtarea a: Establecer la root signature
 	m_commandList->SetGraphicsRootSignature(m_rootSignature.Get());
 
-	// Subtarea b: b Establecer un array de descriptor heaps
-	ID3D12DescriptorHeap* arrayHeaps[] = { m_cDescriptorHeap.Get() };
-	m_commandList->SetDescriptorHeaps(_countof(arrayHeaps), arrayHeaps);
-
-	// Subtarea c Establece el punto de comienzo del rango de descriptores.
-
-	CD3DX12_GPU_DESCRIPTOR_HANDLE cHandle(m_cDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-	//cHandle.Offset(0, m_cDescriptorSize);
-
-	m_commandList->SetGraphicsRootDescriptorTable(0, // nmero de root parameter
-		cHandle //manejador a la posicin del heap donde comenzara el rango de descriptores
+	// Subtarea b: Establecer el buffer de constantes del frame
+	m_commandList->SetGraphicsRootConstantBufferView(0, // nmero de root parameter
+		m_constantAddress // direccin del trozo, alineada a 256 bytes
 	);
 
 	// Todo: Establecemos la vista para el buffer de indices
-	D3D12_VERTEX_BUFFER_VIEW aVBufferView[1] = { m_vBufferView }; // Es necesario pasar un array de buffer views
-	m_commandList->IASetVertexBuffers(0, 1, aVBufferView);
-	D3D12_INDEX_BUFFER_VIEW aIBufferView[1] = { m_iBufferView }; // Es necesario pasar un array de buffer views
+	m_commandList->IASetVertexBuffers(0, m_meshBuffers.vBufferViewCount, m_meshBuffers.vBufferViews); // Una vista por slot
+	D3D12_INDEX_BUFFER_VIEW aIBufferView[1] = { m_meshBuffers.iBufferView }; // Es necesario pasar un array de buffer views
 	m_commandList->IASetIndexBuffer(aIBufferView);
 
 	/* Establecemos la topologa: es obligatorio*/
@@ -208,6 +285,9 @@ void Game::Present()
     {
         DX::ThrowIfFailed(hr);
 
+        // Las constantes escritas en este frame se liberan cuando la GPU alcance su fence
+        m_constantRing.FinishFrame(m_fenceValues[m_backBufferIndex]);
+        m_descriptors.FinishFrame(m_fenceValues[m_backBufferIndex]);
         MoveToNextFrame();
     }
 }
@@ -246,6 +326,14 @@ void Game::OnWindowSizeChanged(int width, int height, DXGI_MODE_ROTATION rotatio
     // TODO: Game window is being resized.
 }
 
+void Game::OnPointerPressed(int x, int y)
+{
+	// Se resuelve en el siguiente Update, con las matrices de ese frame
+	m_pickX = x;
+	m_pickY = y;
+	m_pickPending = true;
+}
+
 void Game::ValidateDevice()
 {
     // The D3D Device is no longer valid if the default adapter changed since the device
@@ -587,6 +675,21 @@ void Game::OnDeviceLost()
 {
     // TODO: Perform Direct3D resource cleanup.
 
+    // Ningn trabajo en segundo plano puede seguir usando el dispositivo perdido; la
+    // subida de la malla se vuelve a grabar con el nuevo (ver UpdateAssets)
+    m_loader.WaitIdle();
+    m_uploads.Release(); // Espera a las copias pendientes antes de destruir sus destinos
+    m_meshUpload.Reset();
+    m_residentMesh.Reset();
+    m_residentShaders.Reset();
+    m_meshResident = false;
+    m_meshBuffers = MeshBuffers();
+    m_pso.Reset();
+    m_releaseQueue.Flush();
+    m_gpuMemory.Release(); // Sus heaps son del dispositivo perdido
+    m_descriptors.Release();
+    m_stagingDescriptors.Release();
+
     for (UINT n = 0; n < c_swapBufferCount; n++)
     {
         m_commandAllocators[n].Reset();
@@ -605,123 +708,208 @@ void Game::OnDeviceLost()
 
     CreateDevice();
     CreateResources();
+    DX::ThrowIfFailed(m_commandList->Close());
+    CreatePipelineResources();
 }
 
-void Game::CreateMainInputFlowResources(const Mesh& mesh) {
+// Avanza la carga y la recarga de la malla sin bloquear nunca: se llama una vez por frame.
+void Game::UpdateAssets()
+{
+	// 0. Lo que otra recarga sustituy y la GPU ya ha terminado de usar. Los heaps que los
+	// buffers de la malla anterior dejan vacos se devuelven, salvo si un worker est
+	// colocando los de una malla nueva y los podra volver a ocupar
+	if (m_releaseQueue.Collect(m_fence->GetCompletedValue()) > 0 && !m_meshUpload.IsValid())
+		m_gpuMemory.TrimEmptyHeaps(D3D12_HEAP_TYPE_DEFAULT);
+
+	// Ficheros cambiados en disco: solo se vuelve a leer el que ha cambiado
+	m_changedFiles.clear();
+	if (m_watcher.Poll(m_changedFiles))
+	{
+		bool shadersChanged = false;
+		for (unsigned int id : m_changedFiles)
+		{
+			if (id == m_meshWatch)
+				LoadMeshAsset();
+			else
+				shadersChanged = true;
+		}
+		if (shadersChanged)
+			LoadShaderAsset();
+	}
 
-	/*
-	Objetivo 1.
-	Comenzamos por preparar los buffers de vrtices y de ndices. Estos buffers se van a cargar
-	con datos al principio, y luego no se van a actualizar por cada frame. Por eso es mejor
-	crearlos en un heap de tipo DEFAULT al que accede con mayor eficiencia la GPU. Por contra
-	la CPU no puede cargar datos en un DEFAULT. Entonces hay que crear un segundo buffer en un heap
-	de tipo UPLOAD y transferir del UPLOAD al DEFAULT. Los buffer de vrtices e ndices no requieren
-	un heap de descriptores, se conectan al pipeline directamente con una vista.
+	// 1. Hay una malla o unos shaders ledos que no son los de la GPU: un worker crea los
+	// recursos nuevos y graba la copia. Si una recarga falla se sigue con lo que haba
+	if (!m_meshUpload.IsValid())
+	{
+		bool meshChanged = m_meshAsset.IsReady() && m_meshAsset.Get() != m_residentMesh.Get();
+		bool shadersChanged = m_shaderAsset.IsReady() && m_shaderAsset.Get() != m_residentShaders.Get();
+		bool complete = (meshChanged || m_residentMesh.IsValid()) && (shadersChanged || m_residentShaders.IsValid());
+		if ((meshChanged || shadersChanged) && complete)
+		{
+			LoadHandle<Mesh> mesh = meshChanged ? m_meshAsset : LoadHandle<Mesh>();
+			LoadHandle<ShaderBytecode> shaders = shadersChanged ? m_shaderAsset : LoadHandle<ShaderBytecode>();
+			m_meshUpload = m_loader.Load<MeshUpload>([this, mesh, shaders]() { return RecordMeshUpload(mesh, shaders); });
+		}
+	}
 
-	*/
+	// Las copias que los workers han aadido desde el ltimo frame van juntas a la cola de copia
+	m_uploads.Flush();
 
-	/*Tarea 1: Creacin de los buffers.*/
+	// 2. Recursos creados y copia enviada: la cola grfica espera a la de copia en la GPU, as
+	// que se cambian ya y el primer frame que los dibuja no empieza hasta que la copia acaba.
+	// Los sustituidos quedan retenidos hasta que acaben los frames que ya los usan
+	if (m_meshUpload.IsReady())
+	{
+		MeshUpload& upload = *m_meshUpload.Get();
+		m_uploads.Wait(m_commandQueue.Get(), upload.ticket);
+		UINT64 lastUse = m_fenceValues[m_backBufferIndex]; // Fence del ltimo frame que puede usar lo sustituido
+		if (upload.mesh.IsValid())
+		{
+			m_releaseQueue.Release(std::move(m_meshBuffers), lastUse);
+			m_meshBuffers = std::move(upload.buffers);
+			m_rayBvh = std::move(upload.rayBvh);
+			m_residentMesh = upload.mesh;
+
+			PositionQuantization const& quantization = m_residentMesh.Get()->GetPositionQuantization();
+			m_vConstants.GPositionOffset = XMFLOAT4(quantization.offset.x, quantization.offset.y, quantization.offset.z, 0.0f);
+			m_vConstants.GPositionScale = XMFLOAT4(quantization.scale.x, quantization.scale.y, quantization.scale.z, 0.0f);
+		}
+		if (upload.shaders.IsValid())
+		{
+			m_releaseQueue.Release(std::move(m_pso), lastUse);
+			m_pso = upload.pso;
+			m_residentShaders = upload.shaders;
+		}
+		m_meshUpload.Reset();
+		m_meshResident = true;
+	}
+	else if (m_meshUpload.GetState() == LoadState::Failed && m_meshUpload.IsValid())
+	{
+		// No se pudieron crear los recursos: se descarta la versin y se sigue con la actual
+		OutputDebugStringW(L"Asset upload failed, keeping the resident mesh and shaders\n");
+		if (m_meshAsset.Get() != m_residentMesh.Get())
+			m_meshAsset = m_residentMesh;
+		if (m_shaderAsset.Get() != m_residentShaders.Get())
+			m_shaderAsset = m_residentShaders;
+		m_meshUpload.Reset();
+	}
+}
 
-	// Creacin de los buffers default y upload para los vrtices
-	DX::ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(mesh.GetVSize()),
-		D3D12_RESOURCE_STATE_COMMON,
-		nullptr,
-		IID_PPV_ARGS(m_vBufferDefault.GetAddressOf())));
+void Game::LoadMeshAsset()
+{
+	m_meshAsset = m_loader.LoadMesh(c_meshFile, [](Mesh& mesh) {
+		// Niveles de detalle: comparten el buffer de vrtices y van detrs del nivel 0 en el de ndices
+		mesh.GenerateLods({ { 0.5f, 0.01f }, { 0.25f, 0.02f }, { 0.125f, 0.05f } });
+		mesh.SetVertexFormat(c_vertexFormat);
+	});
+}
 
-	// Ahora un buffer upload, de esta forma tenemos un puente upload para pasar a default.
+void Game::LoadShaderAsset()
+{
+	m_shaderAsset = m_loader.Load<ShaderBytecode>([]() { return LoadPrecompiledShaders(c_vertexFormat); }); // Shaders precompilados
+}
 
-	DX::ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(mesh.GetVSize()),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_vBufferUpload.GetAddressOf())));
+// Se ejecuta en un worker: el dispositivo y m_uploads admiten llamadas desde varios hilos.
+// Todo lo que crea va en upload y no toca ningn miembro; el hilo principal lo cambia por lo
+// actual en UpdateAssets. Un HRESULT fallido lanza y la carga queda en Failed.
+std::unique_ptr<Game::MeshUpload> Game::RecordMeshUpload(LoadHandle<Mesh> mesh, LoadHandle<ShaderBytecode> shaders)
+{
+	auto upload = std::make_unique<MeshUpload>();
+	upload->mesh = mesh;
+	upload->shaders = shaders;
 
-	// Creacin de los buffers default y upload para los ndices
-	DX::ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(mesh.GetISize()),
-		D3D12_RESOURCE_STATE_COMMON,
-		nullptr,
-		IID_PPV_ARGS(m_iBufferDefault.GetAddressOf())));
+	// El PSO primero: si falla no queda ninguna copia en vuelo hacia buffers que se destruyen
+	if (shaders.IsValid())
+	{
+		DX::ThrowIfFailed(PSO(c_vertexFormat, *shaders.Get(), upload->pso.GetAddressOf())); // Creamos un estado del pipeline bsico.
+	}
 
-	// Ahora un buffer upload, de esta forma tenemos un puente upload para pasar a default.
+	if (mesh.IsValid())
+	{
+		CreateMainInputFlowResources(*mesh.Get(), *upload); //Creamos recursos y objetos D3D12 que permiten el flujo de entrada de datos al pipeline
 
-	DX::ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(mesh.GetISize()),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_iBufferUpload.GetAddressOf())));
+		// Estructura para el picking con el ratn, sobre las posiciones en float del nivel 0
+		Mesh const& source = *mesh.Get();
+		BuildRayBvh(upload->rayBvh, source.GetIndexData(), source.GetIndexCount(), &source.GetVertexData()->pos.x, sizeof(Vertex));
+	}
+	return upload;
+}
 
-	/*Tarea 2: Preparamos el origen de los datos de vrtices e ndices.*/
+void Game::CreateMainInputFlowResources(const Mesh& mesh, MeshUpload& upload) {
 
-	// Preparamos el  origen_vertices
-	D3D12_SUBRESOURCE_DATA origen_vertices = {};
-	origen_vertices.pData = &mesh.vertices[0];
-	origen_vertices.RowPitch = mesh.GetVSize();
-	origen_vertices.SlicePitch = origen_vertices.RowPitch;
+	MeshBuffers& buffers = upload.buffers;
 
-	D3D12_SUBRESOURCE_DATA origen_indices = {};
-	origen_indices.pData = &mesh.indices[0];
-	origen_indices.RowPitch = mesh.GetISize();
-	origen_indices.SlicePitch = origen_indices.RowPitch;
+	/*
+	Objetivo 1.
+	Comenzamos por preparar los buffers de vrtices y de ndices. Estos buffers se van a cargar
+	con datos al principio, y luego no se van a actualizar por cada frame. Por eso es mejor
+	crearlos en un heap de tipo DEFAULT al que accede con mayor eficiencia la GPU. Por contra
+	la CPU no puede cargar datos en un DEFAULT. Entonces los datos pasan por un buffer de tipo
+	UPLOAD: el anillo de staging de m_uploads, que los copia al DEFAULT en su cola de copia.
+	Los buffer de vrtices e ndices no requieren un heap de descriptores, se conectan al
+	pipeline directamente con una vista.
+
+	*/
 
-	/*Tarea 3: Realizamos la transferencia desde el origen hasta el buffer DEFAULT pasando por el buffer UPLOAD*/
-	/*Vrtices*/
-	// Cambio de estado en el recurso de destino
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-		m_vBufferDefault.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	/*Tarea 1: Creacin de los buffers.
+	En vez de un recurso committed (con su propio heap implcito) por buffer, m_gpuMemory los
+	coloca en heaps grandes que comparten todas las mallas. Se crean en COMMON: la cola de copia
+	los promueve a COPY_DEST y la grfica a lectura sin barreras.*/
 
-	// Ordenamos la transferencia vertices
-	UpdateSubresources<1>(m_commandList.Get(), m_vBufferDefault.Get(), m_vBufferUpload.Get(), 0, 0, 1, &origen_vertices);
-	// Cambio de estado en el recurso de destino
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-		m_vBufferDefault.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+	// Creacin de los buffers default para los vrtices y los ndices
+	DX::ThrowIfFailed(m_gpuMemory.CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, mesh.GetVSize(),
+		D3D12_RESOURCE_STATE_COMMON, buffers.vBufferDefault));
+	DX::ThrowIfFailed(m_gpuMemory.CreateBuffer(D3D12_HEAP_TYPE_DEFAULT, mesh.GetISize(),
+		D3D12_RESOURCE_STATE_COMMON, buffers.iBufferDefault));
 
-	/*ndices*/
-	// Cambio de estado en el recurso de destino
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-		m_iBufferDefault.Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST));
+	/*Tarea 2: Realizamos la transferencia desde el origen hasta el buffer DEFAULT. m_uploads
+	copia los datos a su anillo de staging al momento, as el origen no tiene que seguir vivo*/
 
-	// Ordenamos la transferencia vertices
-	UpdateSubresources<1>(m_commandList.Get(), m_iBufferDefault.Get(), m_iBufferUpload.Get(), 0, 0, 1, &origen_indices);
-	// Cambio de estado en el recurso de destino
-	m_commandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(
-		m_iBufferDefault.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_GENERIC_READ));
+	// Vrtices: pueden apuntar directamente al fichero mapeado
+	m_uploads.Upload(buffers.vBufferDefault.Get(), 0, mesh.GetVertexBufferData(), mesh.GetVSize());
+	// ndices: 16 o 32 bits segn el nmero de vrtices. Van en el mismo lote o en uno
+	// posterior, as que su ticket cubre tambin la copia de los vrtices
+	upload.ticket = m_uploads.Upload(buffers.iBufferDefault.Get(), 0, mesh.GetIndexBuffer().data, mesh.GetISize());
 
 
 	/* Tarea 3: Establecemos una vista para vrtices e ndices*/
 	// Establecemos la vista (descriptor) para el buffer de vrtices
 	/* Vrtices*/
 
-	m_vBufferView.BufferLocation = m_vBufferDefault->GetGPUVirtualAddress();
-	m_vBufferView.StrideInBytes = sizeof(Vertex);
-	m_vBufferView.SizeInBytes = mesh.GetVSize();
-
-	D3D12_VERTEX_BUFFER_VIEW aVBufferView[1] = { m_vBufferView }; // Es necesario pasar un array de buffer views
-
-	m_commandList->IASetVertexBuffers(0, 1, aVBufferView);
+	// Todos los streams comparten el buffer; cada slot tiene su propia vista
+	buffers.vBufferViewCount = mesh.GetVertexSlotCount();
+	for (unsigned int slot = 0; slot < buffers.vBufferViewCount; slot++)
+	{
+		buffers.vBufferViews[slot].BufferLocation = buffers.vBufferDefault->GetGPUVirtualAddress() + mesh.GetVertexStreamOffset(slot);
+		buffers.vBufferViews[slot].StrideInBytes = mesh.GetVertexStride(slot);
+		buffers.vBufferViews[slot].SizeInBytes = mesh.GetVertexStreamSize(slot);
+	}
 
 	/* ndices*/
 
-	m_iBufferView.BufferLocation = m_iBufferDefault->GetGPUVirtualAddress();
-	m_iBufferView.Format = DXGI_FORMAT_R32_UINT;
-	m_iBufferView.SizeInBytes = mesh.GetISize();
+	buffers.iBufferView.BufferLocation = buffers.iBufferDefault->GetGPUVirtualAddress();
+	buffers.iBufferView.Format = mesh.GetIndexFormat() == IndexFormat::Uint16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	buffers.iBufferView.SizeInBytes = mesh.GetISize();
 
-	// Todo: Establecemos la vista para el buffer de indices
+	/*------------------------- Fin Objetivo 1  ----------------------------------------------------------------------------*/
+}
 
-	D3D12_INDEX_BUFFER_VIEW aIBufferView[1] = { m_iBufferView }; // Es necesario pasar un array de buffer views
+// Recursos del pipeline que no dependen de la malla: se crean una vez por dispositivo.
+void Game::CreatePipelineResources() {
 
-	m_commandList->IASetIndexBuffer(aIBufferView);
-	/*------------------------- Fin Objetivo 1  ----------------------------------------------------------------------------*/
+	// Los buffers de las mallas se colocan en heaps de este dispositivo
+	m_gpuMemory.Initialize(m_d3dDevice.Get());
+	// Y se suben desde su propia cola de copia, sin pasar por la lista de comandos del frame
+	m_uploads.Initialize(CreateD3D12UploadQueue(m_d3dDevice.Get()));
 
+	// Descriptores: una regin persistente para los de cada recurso y un anillo para las
+	// tablas de cada frame. Se crean en el heap de staging y se copian al visible.
+	// Ningn shader lee todava SRVs, as que Clear no enlaza m_descriptors: hacerlo
+	// sin tablas que usar solo cuesta el cambio de heap en cada frame
+	m_descriptors.Initialize(m_d3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		c_descriptorPersistentCount, c_descriptorTransientCount, true);
+	m_stagingDescriptors.Initialize(m_d3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+		c_descriptorPersistentCount, 0, false);
 
 	/*
 	Objetivo 2: Configurar un buffer de constantes para el shader de vrtices
@@ -730,38 +918,23 @@ void Game::CreateMainInputFlowResources(const Mesh& mesh) {
 	*/
 	// El buffer de constantes para el shader de vrtices
 
-	/* Tarea 1: Crear el buffer en un heap upload*/
-	unsigned int elementSize = CalcConstantBufferByteSize(sizeof(m_vConstants));
-
-	m_d3dDevice->CreateCommittedResource(
+	/* Tarea 1: Crear el buffer en un heap upload. Es un anillo del que cada frame toma
+	trozos de 256 bytes (ver WriteConstants), as caben los frames en vuelo*/
+	DX::ThrowIfFailed(m_d3dDevice->CreateCommittedResource(
 		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(elementSize),
+		&CD3DX12_RESOURCE_DESC::Buffer(c_constantRingSize),
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
 		IID_PPV_ARGS(&m_vConstantBuffer)
-	);
-
-	/* Tarea 2: crear un heap de descriptores*/
+	));
 
-	// El heap de descriptores para los buffers de constantes
-	D3D12_DESCRIPTOR_HEAP_DESC cHeapDescriptor;
-	cHeapDescriptor.NumDescriptors = 1;
-	cHeapDescriptor.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-	cHeapDescriptor.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-	cHeapDescriptor.NodeMask = 0;
-
-	m_d3dDevice->CreateDescriptorHeap(&cHeapDescriptor, IID_PPV_ARGS(&m_cDescriptorHeap));
-
-	/* Tarea 3: crear un descriptor para el buffer*/
-	// Ahora el descriptor de la vista buffer de constantes
-	D3D12_GPU_VIRTUAL_ADDRESS cAddress = m_vConstantBuffer->GetGPUVirtualAddress();
-	D3D12_CONSTANT_BUFFER_VIEW_DESC cDescriptor;
-	cDescriptor.BufferLocation = cAddress;
-	cDescriptor.SizeInBytes = CalcConstantBufferByteSize(sizeof(vConstants));
-	m_cDescriptorSize = sizeof(cDescriptor);
-	// Creamos el descriptor y lo colocamos al principio del heap de descriptores.
-	m_d3dDevice->CreateConstantBufferView(&cDescriptor, m_cDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+	/* Tarea 2: mapear el buffer una sola vez. Un heap upload puede quedar mapeado mientras
+	la GPU lo usa: basta con no escribir en los trozos de los frames en vuelo*/
+	CD3DX12_RANGE readRange(0, 0); // La CPU no lee del buffer
+	DX::ThrowIfFailed(m_vConstantBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_constantData)));
+	m_constantRing.Reset(c_constantRingSize);
+	m_constantAddress = 0;
 
 
 	/*
@@ -773,12 +946,8 @@ void Game::CreateMainInputFlowResources(const Mesh& mesh) {
 /* Tarea 1: Crear un array de root parameters*/
 
 	CD3DX12_ROOT_PARAMETER rootParameters[1]; //Array de root parameters
-	// Creamos un rango de tablas de descriptores
-	CD3DX12_DESCRIPTOR_RANGE cTable;
-	cTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0);
-
-	rootParameters[0].InitAsDescriptorTable(1, // Nmero de rangos 
-		&cTable); // Puntero a un array de rangos.
+	// Un CBV raz en b0: cada frame pasa la direccin de su trozo sin tocar descriptores
+	rootParameters[0].InitAsConstantBufferView(0);
 
 /* Tarea 2: Creamos una descripcin de la root signature y la serializamos */
 	// Descripcin de la root signature
@@ -796,67 +965,76 @@ void Game::CreateMainInputFlowResources(const Mesh& mesh) {
 		serializado->GetBufferPointer(),
 		serializado->GetBufferSize(),
 		IID_PPV_ARGS(&m_rootSignature)));
+}
 
-	// Cerramos la lista de comandos, lanzamos la ejeucin de los mismos
-	m_commandList->Close();
-	m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_commandList.GetAddressOf()));
-	DX::ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), 1));
+// Copia las constantes en un trozo nuevo del anillo y devuelve su direccin GPU.
+D3D12_GPU_VIRTUAL_ADDRESS Game::WriteConstants(const void* data, unsigned int size) {
 
-	// Wait until the Signal has been processed.
-	DX::ThrowIfFailed(m_fence->SetEventOnCompletion(1, m_fenceEvent.Get()));
-	WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-}
+	// Recuperamos los trozos de los frames que la GPU ya ha terminado
+	m_constantRing.Retire(m_fence->GetCompletedValue());
 
-void Game::LoadPrecompiledShaders() {
+	uint64_t offset;
+	if (!m_constantRing.Allocate(CalcConstantBufferByteSize(size), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, offset))
+	{
+		// Anillo lleno: esperamos a que la GPU termine todos los frames en vuelo
+		WaitForGpu();
+		m_constantRing.Retire(m_fence->GetCompletedValue());
+		if (!m_constantRing.Allocate(CalcConstantBufferByteSize(size), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT, offset))
+			DX::ThrowIfFailed(E_OUTOFMEMORY); // Un frame pide ms que todo el anillo
+	}
 
-	DX::ThrowIfFailed(
-		D3DReadFileToBlob(L"vertex.cso", m_vsByteCode.GetAddressOf()));
+	memcpy(m_constantData + offset, data, size);
+	return m_vConstantBuffer->GetGPUVirtualAddress() + offset;
+}
 
-	DX::ThrowIfFailed(
-		D3DReadFileToBlob(L"pixel.cso", m_psByteCode.GetAddressOf()));
+// Se ejecuta en un worker del AssetLoader: solo lee ficheros, no toca el estado del juego.
+std::unique_ptr<Game::ShaderBytecode> Game::LoadPrecompiledShaders(VertexFormat format) {
 
+	auto shaders = std::make_unique<ShaderBytecode>();
 
-	m_vs = { reinterpret_cast<char*>(m_vsByteCode->GetBufferPointer()),
-			m_vsByteCode->GetBufferSize() };
+	DX::ThrowIfFailed(
+		D3DReadFileToBlob(GetInterleavedFormat(format) == VertexFormat::Packed ? L"vertex_packed.cso" : L"vertex.cso", shaders->vs.GetAddressOf()));
 
-	m_ps = { reinterpret_cast<char*>(m_psByteCode->GetBufferPointer()),
-			m_psByteCode->GetBufferSize() };
+	DX::ThrowIfFailed(
+		D3DReadFileToBlob(L"pixel.cso", shaders->ps.GetAddressOf()));
 
+	return shaders;
 }
 
-void Game::PSO()
+HRESULT Game::PSO(VertexFormat format, ShaderBytecode const& shaders, ID3D12PipelineState** pso)
 {
-	// Input Layout
-	m_inputLayout = {
-
-		{"POSITION",0,DXGI_FORMAT_R32G32B32_FLOAT,0,0,D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,0},
-		{"COLOR",0,DXGI_FORMAT_R32G32B32A32_FLOAT,0,12,D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,0},
-		{"NORMAL",0,DXGI_FORMAT_R32G32B32_FLOAT,0,28,D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,0}
-	};
+	// Todo local: se llama desde los workers de carga, que no deben tocar miembros
+	// Input Layout, generado a partir del formato de vrtices de la malla
+	std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+	for (auto const& element : GetVertexLayout(format))
+	{
+		inputLayout.push_back({ element.semantic,0,ToDxgiFormat(element.format),element.slot,element.offset,D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA,0 });
+	}
 
 	// Rasterizer state
 	CD3DX12_RASTERIZER_DESC rasterizer(D3D12_DEFAULT);
 	rasterizer.FillMode = D3D12_FILL_MODE_WIREFRAME;
 	rasterizer.CullMode = D3D12_CULL_MODE_NONE;
 
-	ZeroMemory(&m_psoDescriptor, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
-
-	m_psoDescriptor.InputLayout = { m_inputLayout.data(), (unsigned int)m_inputLayout.size() };
-	m_psoDescriptor.pRootSignature = m_rootSignature.Get();
-	m_psoDescriptor.VS = { m_vs.pShaderBytecode,m_vs.BytecodeLength };
-	m_psoDescriptor.PS = { m_ps.pShaderBytecode,m_ps.BytecodeLength };
-	m_psoDescriptor.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
-	//m_psoDescriptor.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-	//m_psoDescriptor.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	m_psoDescriptor.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
-	m_psoDescriptor.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
-	m_psoDescriptor.SampleMask = UINT_MAX;
-	m_psoDescriptor.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-	m_psoDescriptor.NumRenderTargets = 1;
-	m_psoDescriptor.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM;
-	m_psoDescriptor.DSVFormat = DXGI_FORMAT_D32_FLOAT;
-	m_psoDescriptor.SampleDesc.Count = 1;
-	m_psoDescriptor.SampleDesc.Quality = 0;
-
-	m_d3dDevice->CreateGraphicsPipelineState(&m_psoDescriptor, IID_PPV_ARGS(&m_pso));
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDescriptor;
+	ZeroMemory(&psoDescriptor, sizeof(D3D12_GRAPHICS_PIPELINE_STATE_DESC));
+
+	psoDescriptor.InputLayout = { inputLayout.data(), (unsigned int)inputLayout.size() };
+	psoDescriptor.pRootSignature = m_rootSignature.Get();
+	psoDescriptor.VS = { shaders.vs->GetBufferPointer(), shaders.vs->GetBufferSize() };
+	psoDescriptor.PS = { shaders.ps->GetBufferPointer(), shaders.ps->GetBufferSize() };
+	psoDescriptor.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+	//psoDescriptor.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
+	//psoDescriptor.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
+	psoDescriptor.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+	psoDescriptor.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+	psoDescriptor.SampleMask = UINT_MAX;
+	psoDescriptor.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+	psoDescriptor.NumRenderTargets = 1;
+	psoDescriptor.RTVFormats[0] = DXGI_FORMAT_B8G8R8A8_UNORM;
+	psoDescriptor.DSVFormat = DXGI_FORMAT_D32_FLOAT;
+	psoDescriptor.SampleDesc.Count = 1;
+	psoDescriptor.SampleDesc.Quality = 0;
+
+	return m_d3dDevice->CreateGraphicsPipelineState(&psoDescriptor, IID_PPV_ARGS(pso));
 }
@@ -6,7 +6,15 @@
 
 #include "HelperFunctions.h"
 #include "Mesh.h"
+#include "AssetLoader.h"
+#include "DeferredRelease.h"
+#include "DescriptorAllocator.h"
+#include "FileWatcher.h"
+#include "GpuMemory.h"
+#include "RayQuery.h"
 #include "StepTimer.h"
+#include "UploadEngine.h"
+#include "UploadRing.h"
 
 
 // A basic game implementation that creates a D3D12 device and
@@ -29,6 +37,7 @@ public:
     void OnSuspending();
     void OnResuming();
     void OnWindowSizeChanged(int width, int height, DXGI_MODE_ROTATION rotation);
+    void OnPointerPressed(int x, int y);
     void ValidateDevice();
 
     // Properties
@@ -81,42 +90,89 @@ private:
     // Game state
     DX::StepTimer                                       m_timer;
 
-	void CreateMainInputFlowResources(const Mesh& mesh);
-	Mesh												m_mesh { std::string("mesh.dat") };
-
-	D3D12_VERTEX_BUFFER_VIEW							m_vBufferView;
-	D3D12_INDEX_BUFFER_VIEW								m_iBufferView;
+	// Carga asncrona: la malla y los shaders se leen en segundo plano y el bucle del juego
+	// empieza sin esperarlos. La malla se dibuja cuando su subida a la GPU ha terminado.
+	// Recarga en caliente: si mesh.dat o un .cso cambian en disco se vuelve a leer solo ese
+	// fichero y los nuevos buffers o el nuevo PSO sustituyen a los actuales entre dos frames
+	struct ShaderBytecode {
+		Microsoft::WRL::ComPtr<ID3DBlob> vs;
+		Microsoft::WRL::ComPtr<ID3DBlob> ps;
+	};
+	struct MeshBuffers {
+		PlacedBuffer vBufferDefault; // Buffer para vrtices, colocado en un heap de m_gpuMemory
+		PlacedBuffer iBufferDefault; // Buffer para ndices
+		D3D12_VERTEX_BUFFER_VIEW vBufferViews[c_maxVertexSlots]; // Una vista por slot de entrada
+		unsigned int vBufferViewCount = 0;
+		D3D12_INDEX_BUFFER_VIEW iBufferView;
+	};
+	struct MeshUpload {
+		LoadHandle<Mesh> mesh; // Invlido si la malla no cambia
+		LoadHandle<ShaderBytecode> shaders; // Invlido si los shaders no cambian
+		MeshBuffers buffers;
+		RayBvh rayBvh;
+		Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
+		UploadTicket ticket; // Copia de los buffers en la cola de copia de m_uploads
+	};
+	void UpdateAssets();
+	void LoadMeshAsset();
+	void LoadShaderAsset();
+	std::unique_ptr<MeshUpload> RecordMeshUpload(LoadHandle<Mesh> mesh, LoadHandle<ShaderBytecode> shaders);
+	GpuHeapAllocator									m_gpuMemory; // Heaps grandes donde se colocan los buffers de las mallas
+	LoadHandle<Mesh>									m_meshAsset; // ltima versin pedida de mesh.dat
+	LoadHandle<ShaderBytecode>							m_shaderAsset;
+	LoadHandle<MeshUpload>								m_meshUpload;
+	UploadEngine										m_uploads; // Cola de copia; se destruye antes que los buffers de m_meshUpload
+	LoadHandle<Mesh>									m_residentMesh; // La que est en la GPU y se dibuja
+	LoadHandle<ShaderBytecode>							m_residentShaders;
+	bool												m_meshResident = false; // Buffers, root signature y PSO listos
+	DeferredReleaseQueue								m_releaseQueue; // Lo sustituido por una recarga, hasta que acaben los frames que lo usan
+	FileWatcher											m_watcher;
+	unsigned int										m_meshWatch = 0; // Id de mesh.dat; el resto son shaders
+	std::vector<unsigned int>							m_changedFiles;
+
+	void CreatePipelineResources();
+	void CreateMainInputFlowResources(const Mesh& mesh, MeshUpload& upload);
+	unsigned int										m_lod = 0; // Nivel de detalle que se dibuja
+	std::vector<IndexRange>								m_meshletDraws; // Draws de los meshlets visibles
+
+	// Picking: el clic se guarda y se resuelve en Update contra la malla ya rotada
+	RayBvh												m_rayBvh; // BVH de rayos del nivel 0, en espacio objeto
+	bool												m_pickPending = false;
+	int													m_pickX = 0, m_pickY = 0; // En pxeles
+	unsigned int										m_pickedTriangle = c_noHit; // ltimo tringulo elegido
+
+	MeshBuffers											m_meshBuffers;
 	Microsoft::WRL::ComPtr<ID3D12RootSignature>         m_rootSignature;
-	Microsoft::WRL::ComPtr<ID3D12Resource>              m_vBufferDefault; // Buffer para vrtices
-	Microsoft::WRL::ComPtr<ID3D12Resource>              m_vBufferUpload; // Buffer para vrtices
-	Microsoft::WRL::ComPtr<ID3D12Resource>              m_iBufferDefault; // Buffer para vrtices
-	Microsoft::WRL::ComPtr<ID3D12Resource>              m_iBufferUpload; // Buffer para vrtices
-	Microsoft::WRL::ComPtr<ID3D12Resource>				m_vConstantBuffer; // Buffer de constantes
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>		m_cDescriptorHeap;
-	unsigned int m_cDescriptorSize;
+	Microsoft::WRL::ComPtr<ID3D12Resource>				m_vConstantBuffer; // Buffer de constantes, mapeado siempre
+	static const UINT									c_constantRingSize = 64 * 1024; // 256 trozos de 256 bytes
+	uint8_t*											m_constantData = nullptr; // m_vConstantBuffer mapeado
+	UploadRing											m_constantRing; // Trozos de m_vConstantBuffer por frame
+	D3D12_GPU_VIRTUAL_ADDRESS							m_constantAddress = 0; // Trozo del frame actual
+	D3D12_GPU_VIRTUAL_ADDRESS WriteConstants(const void* data, unsigned int size);
+	DescriptorAllocator									m_descriptors; // Heap CBV/SRV/UAV visible para los shaders; sin enlazar hasta que alguno lea SRVs
+	DescriptorAllocator									m_stagingDescriptors; // Solo CPU: se copian a m_descriptors
 
 	struct vConstants {
 
 		//DirectX::XMFLOAT4X4 GTransform;
 		DirectX::XMFLOAT4X4 GTransform = { 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 };
 		DirectX::XMFLOAT4X4 GNormalTransform = { 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0, 1.0 };
+		// Decodificacin de posiciones cuantizadas (VertexFormat::Packed): pos = offset + unorm * scale
+		DirectX::XMFLOAT4 GPositionOffset = { 0.0, 0.0, 0.0, 0.0 };
+		DirectX::XMFLOAT4 GPositionScale = { 1.0, 1.0, 1.0, 1.0 };
 
 	} m_vConstants;
 
-	void LoadPrecompiledShaders();
-
-	Microsoft::WRL::ComPtr<ID3DBlob>					m_vsByteCode;
-	Microsoft::WRL::ComPtr<ID3DBlob>					m_psByteCode;
-	D3D12_SHADER_BYTECODE								m_vs;
-	D3D12_SHADER_BYTECODE								m_ps;
+	static std::unique_ptr<ShaderBytecode> LoadPrecompiledShaders(VertexFormat format);
 
-	void PSO();
-	std::vector<D3D12_INPUT_ELEMENT_DESC>				m_inputLayout;
-	D3D12_GRAPHICS_PIPELINE_STATE_DESC					m_psoDescriptor;
+	HRESULT PSO(VertexFormat format, ShaderBytecode const& shaders, ID3D12PipelineState** pso);
 	Microsoft::WRL::ComPtr<ID3D12PipelineState>			m_pso;
 
 	XMFLOAT4X4											m_world;
 	XMFLOAT4X4											m_view;
 	XMFLOAT4X4											m_projection;
 	float count = 0.0f;
+
+	// El ltimo miembro: se destruye el primero, esperando a los trabajos que usan el resto
+	AssetLoader											m_loader;
 };
@@ -0,0 +1,95 @@
+#include "pch.h"
+#include "GeometryArena.h"
+
+GeometryArena::GeometryArena(size_t chunkSize, std::pmr::memory_resource* upstream) :
+	chunkSize(chunkSize),
+	upstream(upstream)
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+	Release();
+}
+
+void GeometryArena::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	current = 0;
+	offset = 0;
+	lastStart = SIZE_MAX;
+	stats.allocationCount = 0;
+	stats.bytesAllocated = 0;
+}
+
+void GeometryArena::Release()
+{
+	Reset();
+	std::lock_guard<std::mutex> lock(mutex);
+	for (Chunk const& chunk : chunks)
+		upstream->deallocate(chunk.data, chunk.size, alignof(std::max_align_t));
+	chunks.clear();
+}
+
+GeometryArenaStats GeometryArena::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	GeometryArenaStats result = stats;
+	result.chunkCount = chunks.size();
+	result.bytesReserved = 0;
+	for (Chunk const& chunk : chunks)
+		result.bytesReserved += chunk.size;
+	return result;
+}
+
+void* GeometryArena::do_allocate(size_t bytes, size_t alignment)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	for (;;)
+	{
+		if (current < chunks.size())
+		{
+			// Aligned on the address: chunks are only max_align_t aligned
+			Chunk const& chunk = chunks[current];
+			uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+			size_t start = size_t(((base + offset + alignment - 1) & ~uintptr_t(alignment - 1)) - base);
+			if (start <= chunk.size && bytes <= chunk.size - start)
+			{
+				stats.allocationCount++;
+				stats.bytesAllocated += start + bytes - offset;
+				lastStart = start;
+				offset = start + bytes;
+				return chunk.data + start;
+			}
+
+			// The rest of this chunk is left unused until the next Reset
+			current++;
+			offset = 0;
+			lastStart = SIZE_MAX;
+			continue;
+		}
+
+		size_t size = std::max(chunkSize, bytes + alignment);
+		chunks.push_back({ static_cast<uint8_t*>(upstream->allocate(size, alignof(std::max_align_t))), size });
+		stats.upstreamAllocations++;
+		current = chunks.size() - 1;
+		offset = 0;
+	}
+}
+
+void GeometryArena::do_deallocate(void* pointer, size_t bytes, size_t)
+{
+	// Only the most recent allocation can be given back; the rest waits for Reset
+	std::lock_guard<std::mutex> lock(mutex);
+	if (lastStart != SIZE_MAX && current < chunks.size() && pointer == chunks[current].data + lastStart && lastStart + bytes == offset)
+	{
+		stats.bytesAllocated -= bytes;
+		offset = lastStart;
+		lastStart = SIZE_MAX;
+	}
+}
+
+bool GeometryArena::do_is_equal(std::pmr::memory_resource const& other) const noexcept
+{
+	return this == &other;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "pch.h"
+#include <memory_resource>
+#include <mutex>
+
+// Region allocator for mesh geometry, usable wherever a std::pmr::memory_resource is.
+//
+// Allocations are carved out of large chunks one after the other and are never freed
+// on their own: the whole region goes at once with Reset(), which is how a level's
+// meshes are dropped together. Reset() keeps the chunks, so loading the next level
+// reuses the same memory without going back to the heap. Freeing the most recent
+// allocation gives its space back, which covers the usual build-then-replace pattern
+// of a vector growing at the end of the region.
+//
+// Everything allocated from the arena must be destroyed before Reset() or the arena's
+// destruction. Allocation takes a lock, so meshes can be loaded into one arena from
+// several AssetLoader workers.
+
+struct GeometryArenaStats {
+	size_t allocationCount;		// since the last Reset
+	size_t bytesAllocated;		// live in the region, alignment padding included
+	size_t bytesReserved;		// chunks held, used or not
+	size_t chunkCount;
+	size_t upstreamAllocations;	// chunks ever requested from the upstream resource
+};
+
+class GeometryArena : public std::pmr::memory_resource
+{
+public:
+	// Chunks are chunkSize bytes, or as large as a bigger single allocation needs.
+	explicit GeometryArena(size_t chunkSize = size_t(16) << 20, std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+	~GeometryArena();
+
+	GeometryArena(GeometryArena const&) = delete;
+	GeometryArena& operator=(GeometryArena const&) = delete;
+
+	// Frees every allocation at once and keeps the chunks for reuse.
+	void Reset();
+	// Frees every allocation and returns the chunks to the upstream resource.
+	void Release();
+
+	GeometryArenaStats GetStats() const;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override;
+	bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+	struct Chunk {
+		uint8_t* data;
+		size_t size;
+	};
+
+	size_t chunkSize;
+	std::pmr::memory_resource* upstream;
+	std::vector<Chunk> chunks;
+	size_t current = 0;		// chunk being carved
+	size_t offset = 0;		// first free byte in it
+	size_t lastStart = SIZE_MAX;	// where the most recent allocation started, if it can be given back
+	GeometryArenaStats stats = {};
+	mutable std::mutex mutex;
+};
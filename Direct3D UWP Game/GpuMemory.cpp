@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "GpuMemory.h"
+
+PlacedBuffer::~PlacedBuffer()
+{
+	Reset();
+}
+
+PlacedBuffer::PlacedBuffer(PlacedBuffer&& other) noexcept :
+	resource(std::move(other.resource)), owner(other.owner), type(other.type), heap(other.heap), allocation(other.allocation)
+{
+	other.owner = nullptr;
+}
+
+PlacedBuffer& PlacedBuffer::operator=(PlacedBuffer&& other) noexcept
+{
+	if (this != &other)
+	{
+		Reset();
+		resource = std::move(other.resource);
+		owner = other.owner;
+		type = other.type;
+		heap = other.heap;
+		allocation = other.allocation;
+		other.owner = nullptr;
+	}
+	return *this;
+}
+
+void PlacedBuffer::Reset()
+{
+	// The resource goes first: the range must not be handed out while it still exists
+	resource.Reset();
+	if (owner)
+		owner->Free(type, heap, allocation);
+	owner = nullptr;
+	heap = UINT32_MAX;
+	allocation = TlsfAllocation();
+}
+
+GpuHeapAllocator::GpuHeapAllocator(uint64_t heapSize) : heapSize(heapSize)
+{
+}
+
+void GpuHeapAllocator::Initialize(ID3D12Device* newDevice)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	heaps.clear();
+	for (size_t& count : committedCount)
+		count = 0;
+	device = newDevice;
+}
+
+void GpuHeapAllocator::Release()
+{
+	Initialize(nullptr);
+}
+
+HRESULT GpuHeapAllocator::CreateBuffer(D3D12_HEAP_TYPE type, uint64_t size, D3D12_RESOURCE_STATES initialState, PlacedBuffer& buffer)
+{
+	buffer.Reset();
+	CD3DX12_RESOURCE_DESC description = CD3DX12_RESOURCE_DESC::Buffer(size);
+
+	if (size > heapSize)
+	{
+		CD3DX12_HEAP_PROPERTIES properties(type);
+		HRESULT hr = device->CreateCommittedResource(&properties, D3D12_HEAP_FLAG_NONE, &description,
+			initialState, nullptr, IID_PPV_ARGS(buffer.resource.GetAddressOf()));
+		if (FAILED(hr))
+			return hr;
+		std::lock_guard<std::mutex> lock(mutex);
+		committedCount[type]++;
+		buffer.owner = this;
+		buffer.type = type;
+		buffer.heap = UINT32_MAX;
+		buffer.allocation.size = size;
+		return S_OK;
+	}
+
+	// A range in the first heap of the type with room, or in a new heap
+	uint32_t heapIndex = UINT32_MAX;
+	TlsfAllocation allocation;
+	ID3D12Heap* heap = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (size_t i = 0; i < heaps.size() && heapIndex == UINT32_MAX; i++)
+			if (heaps[i] && heaps[i]->type == type && heaps[i]->allocator.Allocate(size, allocation))
+				heapIndex = (uint32_t)(i);
+
+		if (heapIndex == UINT32_MAX)
+		{
+			auto newHeap = std::make_unique<Heap>();
+			CD3DX12_HEAP_DESC heapDescription(heapSize, type, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT, D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+			HRESULT hr = device->CreateHeap(&heapDescription, IID_PPV_ARGS(newHeap->heap.GetAddressOf()));
+			if (FAILED(hr))
+				return hr;
+			newHeap->type = type;
+			newHeap->allocator.Reset(heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+			newHeap->allocator.Allocate(size, allocation);
+			heapIndex = (uint32_t)(std::find(heaps.begin(), heaps.end(), nullptr) - heaps.begin());
+			if (heapIndex == heaps.size())
+				heaps.push_back(std::move(newHeap));
+			else
+				heaps[heapIndex] = std::move(newHeap);
+		}
+		heap = heaps[heapIndex]->heap.Get();
+	}
+
+	HRESULT hr = device->CreatePlacedResource(heap, allocation.offset, &description, initialState, nullptr,
+		IID_PPV_ARGS(buffer.resource.GetAddressOf()));
+	if (FAILED(hr))
+	{
+		Free(type, heapIndex, allocation);
+		return hr;
+	}
+	buffer.owner = this;
+	buffer.type = type;
+	buffer.heap = heapIndex;
+	buffer.allocation = allocation;
+	return S_OK;
+}
+
+GpuMemoryStats GpuHeapAllocator::GetStats(D3D12_HEAP_TYPE type) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	GpuMemoryStats stats = {};
+	uint64_t largestBlocks = 0;
+	stats.committedCount = committedCount[type];
+	for (auto const& heap : heaps)
+	{
+		if (!heap || heap->type != type)
+			continue;
+		TlsfStats heapStats = heap->allocator.GetStats();
+		stats.heapCount++;
+		stats.heapBytes += heapStats.capacity;
+		stats.usedBytes += heapStats.usedBytes;
+		stats.largestFreeBlock = std::max(stats.largestFreeBlock, heapStats.largestFreeBlock);
+		largestBlocks += heapStats.largestFreeBlock;
+		stats.freeBlockCount += heapStats.freeBlockCount;
+		stats.bufferCount += heapStats.allocationCount;
+	}
+	uint64_t freeBytes = stats.heapBytes - stats.usedBytes;
+	stats.fragmentation = freeBytes > 0 ? 1.0f - float(double(largestBlocks) / double(freeBytes)) : 0.0f;
+	return stats;
+}
+
+size_t GpuHeapAllocator::TrimEmptyHeaps(D3D12_HEAP_TYPE type)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t count = 0;
+	for (auto& heap : heaps)
+	{
+		if (heap && heap->type == type && heap->allocator.IsEmpty())
+		{
+			heap.reset();
+			count++;
+		}
+	}
+	return count;
+}
+
+void GpuHeapAllocator::Free(D3D12_HEAP_TYPE type, uint32_t heap, TlsfAllocation const& allocation)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (heap == UINT32_MAX)
+	{
+		// Committed: the resource was its own memory, only the count is left
+		committedCount[type]--;
+		return;
+	}
+	heaps[heap]->allocator.Free(allocation);
+}
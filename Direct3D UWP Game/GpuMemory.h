@@ -0,0 +1,96 @@
+#pragma once
+#include "pch.h"
+#include "TlsfAllocator.h"
+#include <mutex>
+
+// Buffers placed in a few large ID3D12Heaps instead of one committed resource (and one
+// implicit heap) each.
+//
+// Heaps are created on demand, c_gpuHeapSize bytes each and one kind per heap type
+// (DEFAULT for geometry, UPLOAD for staging), and TlsfAllocator places buffers inside
+// them on the 64 KB placement alignment. A buffer larger than a heap gets a committed
+// resource of its own. Heaps are kept when they empty, so loading the next set of
+// meshes reuses them; TrimEmptyHeaps gives back the ones of a type that hold nothing,
+// which Game::UpdateAssets does once the buffers of a replaced mesh are released.
+//
+// Creating and freeing buffers is thread-safe: uploads are recorded on AssetLoader
+// workers while the main thread retires old buffers.
+
+static const uint64_t c_gpuHeapSize = uint64_t(64) << 20;
+
+struct GpuMemoryStats {
+	size_t heapCount;
+	size_t committedCount;	// buffers too large for a heap
+	uint64_t heapBytes;	// reserved in heaps
+	uint64_t usedBytes;	// placed buffers, rounded up to the placement alignment
+	uint64_t largestFreeBlock;
+	size_t freeBlockCount;
+	size_t bufferCount;	// placed buffers
+	// 0 when every heap's free space is in one piece, towards 1 as it breaks up:
+	// 1 - (sum of each heap's largest free block) / free bytes
+	float fragmentation;
+};
+
+class GpuHeapAllocator;
+
+// A buffer and the heap range it sits in, given back when the buffer is destroyed or
+// Reset. Like a ComPtr it must outlive the frames that use it (see Game::m_releaseQueue).
+class PlacedBuffer
+{
+public:
+	PlacedBuffer() = default;
+	~PlacedBuffer();
+	PlacedBuffer(PlacedBuffer&& other) noexcept;
+	PlacedBuffer& operator=(PlacedBuffer&& other) noexcept;
+	PlacedBuffer(PlacedBuffer const&) = delete;
+	PlacedBuffer& operator=(PlacedBuffer const&) = delete;
+
+	void Reset();
+
+	ID3D12Resource* Get() const { return resource.Get(); }
+	ID3D12Resource* operator->() const { return resource.Get(); }
+	explicit operator bool() const { return resource != nullptr; }
+
+private:
+	friend class GpuHeapAllocator;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+	GpuHeapAllocator* owner = nullptr;
+	D3D12_HEAP_TYPE type = D3D12_HEAP_TYPE_DEFAULT;
+	uint32_t heap = UINT32_MAX;	// UINT32_MAX: committed
+	TlsfAllocation allocation;
+};
+
+class GpuHeapAllocator
+{
+public:
+	explicit GpuHeapAllocator(uint64_t heapSize = c_gpuHeapSize);
+
+	// Starts over with a new device, dropping the heaps of the old one: every buffer
+	// created before must be gone.
+	void Initialize(ID3D12Device* device);
+	void Release();
+
+	HRESULT CreateBuffer(D3D12_HEAP_TYPE type, uint64_t size, D3D12_RESOURCE_STATES initialState, PlacedBuffer& buffer);
+
+	// Destroys the heaps of the type that hold no buffer; returns how many.
+	size_t TrimEmptyHeaps(D3D12_HEAP_TYPE type);
+
+	GpuMemoryStats GetStats(D3D12_HEAP_TYPE type) const;
+
+private:
+	friend class PlacedBuffer;
+	void Free(D3D12_HEAP_TYPE type, uint32_t heap, TlsfAllocation const& allocation);
+
+	struct Heap {
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+		D3D12_HEAP_TYPE type;
+		TlsfAllocator allocator;
+	};
+
+	uint64_t heapSize;
+	Microsoft::WRL::ComPtr<ID3D12Device> device;
+	std::vector<std::unique_ptr<Heap>> heaps;	// null where a heap was trimmed: buffers keep their index
+	size_t committedCount[D3D12_HEAP_TYPE_CUSTOM + 1] = {};
+	mutable std::mutex mutex;
+};
@@ -15,12 +15,15 @@ unsigned  int CalcConstantBufferByteSize(unsigned int bytesize) {
 void readfile(char const* fn, std::vector<char> &vbytes)
 {
 	std::ifstream inputstream(fn, std::ios::binary);
+	vbytes.clear();
+	if (!inputstream.good()) return;
 	std::ios_base::iostate state = inputstream.rdstate();
 	bool isbad = inputstream.bad();
 	bool isgood = inputstream.good();
 	bool isfail = inputstream.fail();
 	inputstream.seekg(0, std::ios::end);
 	std::ifstream::pos_type pos = inputstream.tellg();
+	if (pos <= 0) return;
 	vbytes.resize(pos);
 
 	inputstream.seekg(0, std::ios::beg);
@@ -0,0 +1,85 @@
+#include "pch.h"
+#include "IndexBuffer.h"
+
+IndexFormat BuildIndexBuffer(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	std::pmr::vector<uint16_t>& indices16, std::vector<IndexRange>& ranges)
+{
+	const unsigned int window = 65536;
+
+	indices16.clear();
+	ranges.clear();
+
+	auto fallback = [&]() {
+		indices16.clear();
+		ranges.assign(1, { 0, (unsigned int)indexCount, 0 });
+		return IndexFormat::Uint32;
+	};
+
+	if (vertexCount <= window)
+	{
+		indices16.assign(indices, indices + indexCount);
+		ranges.push_back({ 0, (unsigned int)indexCount, 0 });
+		return IndexFormat::Uint16;
+	}
+	if (indexCount % 3 != 0) return fallback();
+
+	// Greedy split: a range grows while its triangles fit in [base, base + window).
+	indices16.resize(indexCount);
+	size_t start = 0;
+	unsigned int base = 0;
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		unsigned int low = std::min(std::min(indices[i], indices[i + 1]), indices[i + 2]);
+		unsigned int high = std::max(std::max(indices[i], indices[i + 1]), indices[i + 2]);
+		if (high - low >= window) return fallback();
+
+		if (i == start)
+			base = low;
+		else if (low < base || high - base >= window)
+		{
+			ranges.push_back({ (unsigned int)start, (unsigned int)(i - start), (int)base });
+			if (ranges.size() >= c_maxIndexRanges) return fallback();
+			start = i;
+			base = low;
+		}
+
+		for (size_t k = 0; k < 3; k++)
+			indices16[i + k] = (uint16_t)(indices[i + k] - base);
+	}
+	if (start < indexCount)
+		ranges.push_back({ (unsigned int)start, (unsigned int)(indexCount - start), (int)base });
+	return IndexFormat::Uint16;
+}
+
+IndexFormat BuildIndexBuffer(const IndexList* lists, size_t listCount, size_t vertexCount,
+	std::pmr::vector<uint16_t>& indices16, std::pmr::vector<unsigned int>& indices32, std::vector<std::vector<IndexRange>>& ranges)
+{
+	indices16.clear();
+	indices32.clear();
+	ranges.assign(listCount, {});
+
+	// Sized once: the buffers may live in an arena, where growing leaves the old block behind
+	size_t totalCount = 0;
+	for (size_t i = 0; i < listCount; i++)
+		totalCount += lists[i].count;
+
+	std::pmr::vector<uint16_t> list16;
+	indices16.reserve(totalCount);
+	bool wide = false;
+	for (size_t i = 0; i < listCount && !wide; i++)
+	{
+		wide = BuildIndexBuffer(lists[i].indices, lists[i].count, vertexCount, list16, ranges[i]) == IndexFormat::Uint32;
+		for (auto& range : ranges[i]) range.startIndex += (unsigned int)indices16.size();
+		indices16.insert(indices16.end(), list16.begin(), list16.end());
+	}
+	if (!wide) return IndexFormat::Uint16;
+
+	indices16.clear();
+	indices32.reserve(totalCount);
+	for (size_t i = 0; i < listCount; i++)
+	{
+		ranges[i].assign(1, { (unsigned int)indices32.size(), (unsigned int)lists[i].count, 0 });
+		indices32.insert(indices32.end(), lists[i].indices, lists[i].indices + lists[i].count);
+	}
+	return IndexFormat::Uint32;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include "pch.h"
+#include <cassert>
+#include <memory_resource>
+
+// GPU index buffer width selection.
+//
+// Meshes with up to 65536 vertices get a 16-bit buffer drawn as a single range.
+// Larger meshes are split into consecutive triangle ranges whose indices all fall in
+// a 65536 vertex window; every range stores indices relative to its window start and
+// is drawn with that start as BaseVertexLocation. Meshes that cannot be split into a
+// reasonable number of ranges keep 32-bit indices.
+
+enum class IndexFormat {
+	Uint16,
+	Uint32,
+};
+
+// One draw: DrawIndexedInstanced(indexCount, 1, startIndex, baseVertex, 0).
+struct IndexRange {
+	unsigned int startIndex;
+	unsigned int indexCount;
+	int baseVertex;
+};
+
+// Typed, read-only view over whichever width was chosen.
+struct IndexBufferView {
+	const void* data;
+	unsigned int count;
+	IndexFormat format;
+
+	unsigned int GetStride() const { return format == IndexFormat::Uint16 ? 2 : 4; }
+	unsigned int GetSizeInBytes() const { return count * GetStride(); }
+
+	// Raw pointer of the stored width; T must match format.
+	template <typename T>
+	const T* As() const
+	{
+		assert(sizeof(T) == GetStride());
+		return static_cast<const T*>(data);
+	}
+
+	// Index as stored (relative to the range's baseVertex for 16-bit buffers).
+	unsigned int operator[](size_t i) const
+	{
+		return format == IndexFormat::Uint16 ? As<uint16_t>()[i] : As<unsigned int>()[i];
+	}
+};
+
+// Split limit before falling back to 32-bit indices: past this the extra draws cost
+// more than the halved index bandwidth saves.
+static const size_t c_maxIndexRanges = 256;
+
+// Chooses the width for a triangle list and fills the 16-bit copy and the draw ranges.
+// When Uint32 is returned indices16 is left empty and ranges holds a single range.
+IndexFormat BuildIndexBuffer(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+	std::pmr::vector<uint16_t>& indices16, std::vector<IndexRange>& ranges);
+
+struct IndexList {
+	const unsigned int* indices;
+	size_t count;
+};
+
+// Several triangle lists over the same vertices (levels of detail) stored back to back
+// in one buffer, in order; ranges[i] holds the draws of list i. Either every list gets
+// 16-bit indices in indices16, or all of them are copied to indices32.
+IndexFormat BuildIndexBuffer(const IndexList* lists, size_t listCount, size_t vertexCount,
+	std::pmr::vector<uint16_t>& indices16, std::pmr::vector<unsigned int>& indices32, std::vector<std::vector<IndexRange>>& ranges);
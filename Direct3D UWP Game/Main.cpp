@@ -69,6 +69,12 @@ public:
 
         window.Closed([this](auto&&, auto&&) { m_exit = true; });
 
+        window.PointerPressed([this](auto&&, PointerEventArgs const & args)
+        {
+            auto position = args.CurrentPoint().Position();
+            m_game->OnPointerPressed(ConvertDipsToPixels(position.X), ConvertDipsToPixels(position.Y));
+        });
+
         auto dispatcher = CoreWindow::GetForCurrentThread().Dispatcher();
 
         dispatcher.AcceleratorKeyActivated({ this, &ViewProvider::OnAcceleratorKeyActivated });
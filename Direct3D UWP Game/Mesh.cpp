@@ -1,5 +1,9 @@
 #include "pch.h"
 #include "Mesh.h"
+#include "MeshImport.h"
+#include "Parallel.h"
+#include "HelperFunctions.h"
+#include "VertexWeld.h"
 
 Mesh::Mesh()
 {
@@ -44,60 +48,226 @@ Mesh::Mesh()
 		8,2,0
 	};
 
-	unsigned int sv = sizeof(Vertex);
 	unsigned int nvertices = vertices.size();
-	vsize = nvertices * sv;
-	unsigned int sind = sizeof(unsigned int);
-	unsigned int nindices = indices.size();
-	isize = nindices * sind;
+	updateGpuBuffers();
 	std::cout << nvertices << std::endl;
 }
 
-Mesh::Mesh(std::string const fileName) : defaultColor(XMFLOAT4(Colors::Coral))
+Mesh::Mesh(std::string const fileName, std::pmr::memory_resource* resource) :
+	vertices(resource), indices(resource), vsize(0), isize(0), defaultColor(XMFLOAT4(Colors::Coral)),
+	packedVertices(resource), vertexStreams(resource), meshletVertices(resource), meshletTriangles(resource),
+	lodIndices(resource), indices16(resource), indices32(resource)
 {
-	readFile(fileName);
+	// Cooked meshes are recognised by their magic, so callers can keep passing mesh.dat.
+	// One that cannot be used in place (another version or vertex layout, truncated)
+	// is an error rather than an empty mesh: the loader marks it Failed.
+	if (IsBinaryMeshFile(fileName))
+	{
+		if (!readBinaryFile(fileName))
+			throw std::runtime_error("Unusable binary mesh file: " + fileName);
+	}
+	else
+	{
+		// The GPU side copies are built once, after the last step, instead of after each one
+		deferGpuBuffers = true;
+		readFile(fileName);
+		WeldVertices();
+		OptimizeIndices();
+		OptimizeVertexFetch();
+		deferGpuBuffers = false;
+		updateGpuBuffers();
+	}
 }
 
 void Mesh::readFile(std::string const fileName)
 {
-	std::ifstream file(fileName, std::fstream::in);
-	if (!file.good()) return;
-	unsigned int nvertices;
+	// Mapped rather than read: the parsers only need [begin, end)
+	MappedFile file;
+	bool opened = file.Open(fileName);
 	vertices.clear();
 	indices.clear();
-	file >> nvertices;
-	float vec[3]{};
-	for (auto i = 0; i < nvertices; i++)
+	mapping.reset();
+	lods.clear();
+	lodIndices.clear();
+	vsize = 0;
+	isize = 0;
+	if (!opened || file.GetSize() == 0) return;
+
+	const char* begin = reinterpret_cast<const char*>(file.GetData());
+	const char* end = begin + file.GetSize();
+
+	// OBJ and PLY go through MeshImport.h. For mesh.dat the line oriented parser handles
+	// files as we export them; anything laid out differently (several vertices per line,
+	// blank lines...) goes through the token parser.
+	bool hasNormals = true;
+	bool parsed;
+	switch (GetMeshFileType(fileName))
+	{
+	case MeshFileType::Obj: parsed = ImportObj(begin, end, defaultColor, vertices, indices, hasNormals); break;
+	case MeshFileType::Ply: parsed = ImportPly(begin, end, defaultColor, vertices, indices, hasNormals); break;
+	default: parsed = ImportTextLines(begin, end, defaultColor, vertices, indices, hasNormals) ||
+		ImportTextTokens(begin, end, defaultColor, vertices, indices, hasNormals); break;
+	}
+	if (!parsed)
 	{
-		file >> vec[0] >> vec[1] >> vec[2];
-		Vertex v;
-		v.pos = XMFLOAT3(vec[0], vec[1], vec[2]);
-		v.col = defaultColor;
-		vertices.push_back(v);
+		vertices.clear();
+		indices.clear();
+		return;
 	}
 
-	auto cont = 0;
-	for (auto i = 0; i < nvertices; i++)
+	// Files may leave the normals block out: positions are followed by the index count.
+	if (!hasNormals && !vertices.empty())
+		GenerateVertexNormals(&vertices[0].normal.x, sizeof(Vertex), indices.data(), indices.size(),
+			&vertices[0].pos.x, sizeof(Vertex), vertices.size());
+
+	updateGpuBuffers();
+}
+
+// Called whenever the geometry changes: keeps the GPU side copies and the sizes in step.
+void Mesh::updateGpuBuffers()
+{
+	if (deferGpuBuffers)
+		return;
+
+	// Mapped meshes cannot change; readBinaryFile sets their bounds.
+	if (!mapping)
+		bounds = GetVertexCount() > 0 ? ComputeMeshBounds(&GetVertexData()->pos.x, sizeof(Vertex), GetVertexCount()) : MeshBounds{};
+
+	VertexFormat interleavedFormat = GetInterleavedFormat(vertexFormat);
+	if (interleavedFormat == VertexFormat::Packed)
+		packVertices();
+	else
+		packedVertices.clear();
+
+	if (GetVertexSlotCount() > 1)
 	{
-		file >> vec[0] >> vec[1] >> vec[2];
-		vertices[cont++].normal = XMFLOAT3(vec[0], vec[1], vec[2]);
+		const void* interleaved = interleavedFormat == VertexFormat::Packed ? (const void*)packedVertices.data() : (const void*)GetVertexData();
+		SplitVertexStreams(interleaved, GetVertexCount(), vertexFormat, vertexStreams, vertexStreamOffsets);
+		vsize = (unsigned int)vertexStreams.size();
 	}
+	else
+	{
+		vertexStreams.clear();
+		vsize = GetVertexCount() * GetVertexStride();
+	}
+
+	if (lods.empty())
+	{
+		indices32.clear();
+		indexRanges.resize(1);
+		indexFormat = BuildIndexBuffer(GetIndexData(), GetIndexCount(), GetVertexCount(), indices16, indexRanges[0]);
+	}
+	else
+	{
+		std::vector<IndexList> lists;
+		for (unsigned int level = 0; level < GetLodCount(); level++)
+			lists.push_back({ GetLodIndexData(level), GetLod(level).indexCount });
+		indexFormat = BuildIndexBuffer(lists.data(), lists.size(), GetVertexCount(), indices16, indices32, indexRanges);
+	}
+	isize = GetIndexBuffer().GetSizeInBytes();
+
+	meshlets.clear();
+	meshletVertices.clear();
+	meshletTriangles.clear();
+	meshletBounds.clear();
+	if (GetVertexCount() > 0 && HasValidIndices())
+	{
+		BuildMeshlets(meshlets, meshletVertices, meshletTriangles, GetIndexData(), GetIndexCount(), GetVertexCount());
+		meshletBounds.resize(meshlets.size());
+		ComputeMeshletBounds(meshletBounds.data(), meshlets.data(), meshlets.size(), meshletVertices.data(), meshletTriangles.data(), &GetVertexData()->pos.x, sizeof(Vertex));
+	}
+}
+
+void Mesh::packVertices()
+{
+	const Vertex* source = GetVertexData();
+	unsigned int count = GetVertexCount();
+
+	positionQuantization = ::GetPositionQuantization(bounds.boundsMin, bounds.boundsMax);
 
-	unsigned int nindices;
-	file >> nindices;
-	for (auto i = 0; i < nindices; i++)
+	packingReport = {};
+	packingReport.vertexCount = count;
+	packingReport.floatBytes = size_t(count) * sizeof(Vertex);
+	packingReport.packedBytes = size_t(count) * sizeof(PackedVertex);
+
+	packedVertices.resize(count);
+	for (unsigned int i = 0; i < count; i++)
 	{
-		unsigned int ind;
-		file >> ind;
-		indices.push_back(ind);
+		Vertex const& v = source[i];
+		packedVertices[i] = PackVertex(v.pos, v.normal, v.col, positionQuantization);
+
+		// Measure what actually comes back out of the encoding.
+		XMFLOAT3 pos, normal;
+		XMFLOAT4 col;
+		UnpackVertex(packedVertices[i], positionQuantization, pos, normal, col);
+		XMFLOAT3& e = packingReport.maxPositionError;
+		e = XMFLOAT3(std::max(e.x, fabsf(pos.x - v.pos.x)), std::max(e.y, fabsf(pos.y - v.pos.y)), std::max(e.z, fabsf(pos.z - v.pos.z)));
+
+		// atan2 of |cross| and dot keeps small angles accurate where acos would not.
+		XMVECTOR original = XMLoadFloat3(&v.normal);
+		XMVECTOR decoded = XMLoadFloat3(&normal);
+		if (XMVectorGetX(XMVector3LengthSq(original)) > 0.0f)
+		{
+			float angle = atan2f(XMVectorGetX(XMVector3Length(XMVector3Cross(original, decoded))), XMVectorGetX(XMVector3Dot(original, decoded)));
+			packingReport.maxNormalError = std::max(packingReport.maxNormalError, angle);
+		}
+
+		float colorError = std::max(std::max(fabsf(col.x - v.col.x), fabsf(col.y - v.col.y)), std::max(fabsf(col.z - v.col.z), fabsf(col.w - v.col.w)));
+		packingReport.maxColorError = std::max(packingReport.maxColorError, colorError);
 	}
+}
+
+bool Mesh::readBinaryFile(std::string const fileName)
+{
+	auto file = std::make_shared<MappedFile>();
+	if (!file->Open(fileName)) return false;
 
-	unsigned int sv = sizeof(Vertex);
-	vsize = nvertices * sv;
-	unsigned int sind = sizeof(unsigned int);
-	isize = nindices * sind;
+	const MeshFileHeader* header = GetMeshFileHeader(*file, sizeof(Vertex));
+	if (header == nullptr) return false;
 
-	file.close();
+	vertices.clear();
+	indices.clear();
+	lods.clear();
+	lodIndices.clear();
+	mapping = file;
+	mappedVertices = reinterpret_cast<const Vertex*>(file->GetData() + header->vertexOffset);
+	mappedIndices = reinterpret_cast<const unsigned int*>(file->GetData() + header->indexOffset);
+	mappedVertexCount = header->vertexCount;
+	mappedIndexCount = header->indexCount;
+	if (header->version >= 2)
+		bounds = header->bounds;
+	else
+		bounds = ComputeMeshBounds(&mappedVertices->pos.x, sizeof(Vertex), mappedVertexCount);
+
+	updateGpuBuffers();
+	return true;
+}
+
+bool Mesh::writeBinaryFile(std::string const fileName) const
+{
+	auto alignUp = [](uint64_t value) { return (value + c_meshFileAlignment - 1) & ~uint64_t(c_meshFileAlignment - 1); };
+
+	MeshFileHeader header = {};
+	header.magic = c_meshFileMagic;
+	header.version = c_meshFileVersion;
+	header.vertexStride = sizeof(Vertex);
+	header.indexStride = sizeof(unsigned int);
+	header.vertexCount = GetVertexCount();
+	header.indexCount = GetIndexCount();
+	header.vertexOffset = alignUp(sizeof(MeshFileHeader));
+	header.indexOffset = alignUp(header.vertexOffset + uint64_t(header.vertexCount) * sizeof(Vertex));
+	header.bounds = bounds;
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.good()) return false;
+
+	const char padding[c_meshFileAlignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(padding, header.vertexOffset - sizeof(header));
+	file.write(reinterpret_cast<const char*>(GetVertexData()), uint64_t(header.vertexCount) * sizeof(Vertex));
+	file.write(padding, header.indexOffset - (header.vertexOffset + uint64_t(header.vertexCount) * sizeof(Vertex)));
+	file.write(reinterpret_cast<const char*>(GetIndexData()), uint64_t(header.indexCount) * sizeof(unsigned int));
+	return file.good();
 }
 
 Mesh::~Mesh()
@@ -110,4 +280,187 @@ unsigned int Mesh::GetVSize() const {
 
 unsigned int Mesh::GetISize() const {
 	return isize;
-}
\ No newline at end of file
+}
+
+const Vertex* Mesh::GetVertexData() const {
+	return mapping ? mappedVertices : vertices.data();
+}
+
+const unsigned int* Mesh::GetIndexData() const {
+	return mapping ? mappedIndices : indices.data();
+}
+
+unsigned int Mesh::GetVertexCount() const {
+	return mapping ? mappedVertexCount : (unsigned int)vertices.size();
+}
+
+unsigned int Mesh::GetIndexCount() const {
+	return mapping ? mappedIndexCount : (unsigned int)indices.size();
+}
+
+MeshBounds const& Mesh::GetBounds() const {
+	return bounds;
+}
+
+bool Mesh::IsMapped() const {
+	return mapping != nullptr;
+}
+
+void Mesh::SetVertexFormat(VertexFormat format) {
+	vertexFormat = format;
+	updateGpuBuffers();
+}
+
+VertexFormat Mesh::GetVertexFormat() const {
+	return vertexFormat;
+}
+
+const void* Mesh::GetVertexBufferData() const {
+	if (GetVertexSlotCount() > 1) return vertexStreams.data();
+	if (vertexFormat == VertexFormat::Packed) return packedVertices.data();
+	return GetVertexData();
+}
+
+unsigned int Mesh::GetVertexStride(unsigned int slot) const {
+	return ::GetVertexStride(vertexFormat, slot);
+}
+
+unsigned int Mesh::GetVertexSlotCount() const {
+	return ::GetVertexSlotCount(vertexFormat);
+}
+
+unsigned int Mesh::GetVertexStreamOffset(unsigned int slot) const {
+	return GetVertexSlotCount() > 1 ? vertexStreamOffsets[slot] : 0;
+}
+
+unsigned int Mesh::GetVertexStreamSize(unsigned int slot) const {
+	return GetVertexCount() * GetVertexStride(slot);
+}
+
+PositionQuantization const& Mesh::GetPositionQuantization() const {
+	return positionQuantization;
+}
+
+VertexPackingReport const& Mesh::GetPackingReport() const {
+	return packingReport;
+}
+
+IndexFormat Mesh::GetIndexFormat() const {
+	return indexFormat;
+}
+
+IndexBufferView Mesh::GetIndexBuffer() const {
+	if (indexFormat == IndexFormat::Uint16) return { indices16.data(), (unsigned int)indices16.size(), IndexFormat::Uint16 };
+	if (!indices32.empty()) return { indices32.data(), (unsigned int)indices32.size(), IndexFormat::Uint32 };
+	return { GetIndexData(), GetIndexCount(), IndexFormat::Uint32 };
+}
+
+std::vector<IndexRange> const& Mesh::GetIndexRanges(unsigned int level) const {
+	static const std::vector<IndexRange> none;
+	return level < indexRanges.size() ? indexRanges[level] : none;
+}
+
+void Mesh::GenerateLods(std::vector<LodTarget> const& targets) {
+	lods.clear();
+	lodIndices.clear();
+	if (HasValidIndices() && GetVertexCount() > 0)
+	{
+		BuildLodChain(lodIndices, lods, GetIndexData(), GetIndexCount(), &GetVertexData()->pos.x, GetVertexCount(), sizeof(Vertex), targets.data(), targets.size());
+
+		// Every level gets its own vertex cache order.
+		ParallelFor(lods.size(), [&](size_t i) {
+			unsigned int* levelIndices = lodIndices.data() + lods[i].indexOffset;
+			OptimizeVertexCache(levelIndices, levelIndices, lods[i].indexCount, GetVertexCount());
+		});
+		for (auto& lod : lods) lod.indexOffset += GetIndexCount();
+	}
+	updateGpuBuffers();
+}
+
+std::vector<Meshlet> const& Mesh::GetMeshlets() const {
+	return meshlets;
+}
+
+std::vector<MeshletBounds> const& Mesh::GetMeshletBounds() const {
+	return meshletBounds;
+}
+
+std::pmr::vector<unsigned int> const& Mesh::GetMeshletVertices() const {
+	return meshletVertices;
+}
+
+std::pmr::vector<uint8_t> const& Mesh::GetMeshletTriangles() const {
+	return meshletTriangles;
+}
+
+unsigned int Mesh::GetLodCount() const {
+	return 1 + (unsigned int)lods.size();
+}
+
+LodLevel Mesh::GetLod(unsigned int level) const {
+	if (level == 0) return { 1.0f, 0.0f, 0.0f, 0, GetIndexCount() };
+	return lods[level - 1];
+}
+
+const unsigned int* Mesh::GetLodIndexData(unsigned int level) const {
+	if (level == 0) return GetIndexData();
+	return lodIndices.data() + (lods[level - 1].indexOffset - GetIndexCount());
+}
+
+bool Mesh::HasValidIndices() const {
+	unsigned int count = GetVertexCount();
+	const unsigned int* data = GetIndexData();
+	return std::all_of(data, data + GetIndexCount(), [count](unsigned int index) { return index < count; });
+}
+
+Mesh::VertexCacheReport Mesh::OptimizeIndices() {
+	VertexCacheReport report = {};
+	report.before = AnalyzeVertexCache(GetIndexData(), GetIndexCount(), GetVertexCount());
+	report.after = report.before;
+	if (IsMapped() || indices.size() % 3 != 0 || !HasValidIndices()) return report;
+
+	OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertices.size());
+	report.after = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size());
+	updateGpuBuffers();
+	return report;
+}
+
+std::vector<unsigned int> Mesh::WeldVertices(float positionEpsilon, float normalEpsilon) {
+	if (IsMapped() || !HasValidIndices()) return {};
+
+	// Colours are stored as floats but only 8 bits of them survive to the screen.
+	WeldStream streams[] = {
+		{ &vertices.data()->pos, sizeof(Vertex), 3, positionEpsilon },
+		{ &vertices.data()->normal, sizeof(Vertex), 3, normalEpsilon },
+		{ &vertices.data()->col, sizeof(Vertex), 4, 1.0f / 512.0f },
+	};
+	std::vector<unsigned int> remap(vertices.size());
+	size_t count = BuildWeldRemap(remap.data(), streams, std::size(streams), vertices.size());
+	RemapIndices(indices.data(), indices.data(), indices.size(), remap.data());
+	RemapVertices(vertices, remap, count);
+	lods.clear();
+	lodIndices.clear();
+	updateGpuBuffers();
+	return remap;
+}
+
+void Mesh::GenerateNormals(NormalWeighting weighting) {
+	if (IsMapped() || vertices.empty()) return;
+
+	GenerateVertexNormals(&vertices[0].normal.x, sizeof(Vertex), indices.data(), indices.size(),
+		&vertices[0].pos.x, sizeof(Vertex), vertices.size(), weighting);
+	updateGpuBuffers();
+}
+
+std::vector<unsigned int> Mesh::OptimizeVertexFetch() {
+	if (IsMapped() || !HasValidIndices()) return {};
+
+	std::vector<unsigned int> remap(vertices.size());
+	size_t count = BuildVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertices.size());
+	RemapIndices(indices.data(), indices.data(), indices.size(), remap.data());
+	RemapVertices(vertices, remap, count);
+	lods.clear();
+	lodIndices.clear();
+	updateGpuBuffers();
+	return remap;
+}
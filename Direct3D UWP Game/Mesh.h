@@ -1,7 +1,18 @@
 #pragma once
 #include "pch.h"
+#include "MeshFile.h"
+#include "VertexCache.h"
+#include "VertexRemap.h"
+#include "VertexLayout.h"
+#include "VertexPacking.h"
+#include "IndexBuffer.h"
+#include "Simplify.h"
+#include "Meshlet.h"
+#include "VertexNormals.h"
+#include "MeshBounds.h"
 #include <iostream>
 #include <filesystem>
+#include <memory_resource>
 
 using namespace DirectX;
 
@@ -15,18 +26,121 @@ class Mesh
 {
 public:
 	Mesh();
-	Mesh(std::string const fileName);
+	// The geometry (vertices, indices and the GPU side copies built from them) is
+	// allocated from resource, e.g. a GeometryArena holding every mesh of a level.
+	Mesh(std::string const fileName, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 	~Mesh();
 
 	unsigned int GetVSize() const;
 	unsigned int GetISize() const;
 	void readFile(std::string fileName);
 
-	std::vector<Vertex> vertices;
-	std::vector<unsigned int> indices;
+	// Binary container (see MeshFile.h). readBinaryFile maps the file and serves the
+	// geometry straight from the mapping; vertices/indices stay empty in that case.
+	bool readBinaryFile(std::string fileName);
+	bool writeBinaryFile(std::string fileName) const;
+
+	// Geometry views, valid for both the text and the mapped path.
+	const Vertex* GetVertexData() const;
+	const unsigned int* GetIndexData() const;
+	unsigned int GetVertexCount() const;
+	unsigned int GetIndexCount() const;
+	bool IsMapped() const;
+
+	// Object space box and sphere (see MeshBounds.h), kept in step with the vertices.
+	// Cooked files carry them, so mapping a mesh does not touch its vertices.
+	MeshBounds const& GetBounds() const;
+
+	// Format of the vertex buffer handed to the GPU. The float vertices stay available
+	// for CPU side processing; Packed keeps an encoded copy in step with them. Split
+	// formats keep one stream per slot, back to back in a single buffer: the position
+	// stream at GetVertexStreamOffset(0), the attributes at GetVertexStreamOffset(1).
+	void SetVertexFormat(VertexFormat format);
+	VertexFormat GetVertexFormat() const;
+	const void* GetVertexBufferData() const;
+	unsigned int GetVertexStride(unsigned int slot = 0) const;
+	unsigned int GetVertexSlotCount() const;
+	unsigned int GetVertexStreamOffset(unsigned int slot) const;
+	unsigned int GetVertexStreamSize(unsigned int slot) const;
+	PositionQuantization const& GetPositionQuantization() const;
+	VertexPackingReport const& GetPackingReport() const;
+
+	// Index buffer handed to the GPU: 16-bit whenever the vertex count allows it (see
+	// IndexBuffer.h), drawn as one DrawIndexedInstanced per range. It holds every level
+	// of detail, level 0 first. A level the mesh does not have has no ranges.
+	IndexFormat GetIndexFormat() const;
+	IndexBufferView GetIndexBuffer() const;
+	std::vector<IndexRange> const& GetIndexRanges(unsigned int level = 0) const;
+
+	// Levels of detail sharing the vertex buffer (see Simplify.h). Level 0 is the full
+	// mesh; GenerateLods replaces the other levels with one per target. Any change to
+	// the vertices drops them.
+	void GenerateLods(std::vector<LodTarget> const& targets);
+	unsigned int GetLodCount() const;
+	LodLevel GetLod(unsigned int level) const;	// indexOffset counts from the start of level 0
+	const unsigned int* GetLodIndexData(unsigned int level) const;
+
+	// Meshlets of level 0 (see Meshlet.h), rebuilt together with the GPU buffers. Each
+	// one is a contiguous triangle run of the index buffer.
+	std::vector<Meshlet> const& GetMeshlets() const;
+	std::vector<MeshletBounds> const& GetMeshletBounds() const;
+	std::pmr::vector<unsigned int> const& GetMeshletVertices() const;
+	std::pmr::vector<uint8_t> const& GetMeshletTriangles() const;
+
+	// Index processing, applied at load time to meshes read from text (cooked meshes
+	// already went through it). Mapped meshes are read-only and are left untouched.
+	struct VertexCacheReport {
+		VertexCacheStats before;
+		VertexCacheStats after;
+	};
+	VertexCacheReport OptimizeIndices();
+	// Merges vertices whose position, normal and colour match within the given
+	// quantization steps (see VertexWeld.h) and rewrites the indices. Returns the remap table.
+	std::vector<unsigned int> WeldVertices(float positionEpsilon = 1e-5f, float normalEpsilon = 1e-3f);
+	// Puts vertices in first-use order and drops unreferenced ones. Returns the remap
+	// table (see VertexRemap.h) so other per-vertex streams can follow.
+	std::vector<unsigned int> OptimizeVertexFetch();
+	// Replaces the normals with ones computed from the triangles (see VertexNormals.h).
+	// readFile does this on its own for files without a normals block.
+	void GenerateNormals(NormalWeighting weighting = NormalWeighting::Angle);
+	bool HasValidIndices() const;
+
+	std::pmr::vector<Vertex> vertices;
+	std::pmr::vector<unsigned int> indices;
 
 private:
+	void updateGpuBuffers();
+	void packVertices();
+
 	unsigned int vsize;
 	unsigned int isize;
+	bool deferGpuBuffers = false;	// set while the constructor chains processing steps
 	XMFLOAT4 defaultColor;
+
+	std::shared_ptr<MappedFile> mapping;
+	const Vertex* mappedVertices = nullptr;
+	const unsigned int* mappedIndices = nullptr;
+	unsigned int mappedVertexCount = 0;
+	unsigned int mappedIndexCount = 0;
+	MeshBounds bounds = {};
+
+	VertexFormat vertexFormat = VertexFormat::Float;
+	std::pmr::vector<PackedVertex> packedVertices;
+	std::pmr::vector<uint8_t> vertexStreams;
+	unsigned int vertexStreamOffsets[c_maxVertexSlots] = {};
+	PositionQuantization positionQuantization = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f) };
+	VertexPackingReport packingReport = {};
+
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> meshletBounds;
+	std::pmr::vector<unsigned int> meshletVertices;
+	std::pmr::vector<uint8_t> meshletTriangles;
+
+	std::vector<LodLevel> lods;
+	std::pmr::vector<unsigned int> lodIndices;
+
+	IndexFormat indexFormat = IndexFormat::Uint32;
+	std::pmr::vector<uint16_t> indices16;
+	std::pmr::vector<unsigned int> indices32;	// only used to put LODs next to 32-bit level 0
+	std::vector<std::vector<IndexRange>> indexRanges;
 };
@@ -0,0 +1,172 @@
+#include "pch.h"
+#include "MeshBounds.h"
+#include "Parallel.h"
+
+namespace
+{
+	const size_t c_boundsBlockSize = 64 * 1024;
+
+	inline XMVECTOR LoadPosition(const float* positions, size_t positionStride, size_t i)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + i * positionStride));
+	}
+
+	size_t GetBlockCount(size_t count)
+	{
+		return (count + c_boundsBlockSize - 1) / c_boundsBlockSize;
+	}
+
+	// Largest distance from center to any position, in parallel.
+	float GetMaxDistance(XMVECTOR center, const float* positions, size_t positionStride, size_t count)
+	{
+		std::vector<float> partial(GetBlockCount(count), 0.0f);
+		ParallelFor(partial.size(), [&](size_t block) {
+			size_t end = std::min(count, (block + 1) * c_boundsBlockSize);
+			XMVECTOR maxSq = XMVectorZero();
+			for (size_t i = block * c_boundsBlockSize; i < end; i++)
+				maxSq = XMVectorMax(maxSq, XMVector3LengthSq(XMVectorSubtract(LoadPosition(positions, positionStride, i), center)));
+			partial[block] = XMVectorGetX(maxSq);
+		});
+		float maxSq = 0.0f;
+		for (float p : partial) maxSq = std::max(maxSq, p);
+		return sqrtf(maxSq);
+	}
+}
+
+void ComputeAabb(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const float* positions, size_t positionStride, size_t count)
+{
+	std::vector<XMFLOAT3> partialMin(GetBlockCount(count)), partialMax(GetBlockCount(count));
+	ParallelFor(partialMin.size(), [&](size_t block) {
+		size_t begin = block * c_boundsBlockSize, end = std::min(count, begin + c_boundsBlockSize);
+
+		// Four accumulator pairs, so consecutive min/max do not wait on each other.
+		XMVECTOR min0 = XMVectorReplicate(FLT_MAX), min1 = min0, min2 = min0, min3 = min0;
+		XMVECTOR max0 = XMVectorReplicate(-FLT_MAX), max1 = max0, max2 = max0, max3 = max0;
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			XMVECTOR p0 = LoadPosition(positions, positionStride, i);
+			XMVECTOR p1 = LoadPosition(positions, positionStride, i + 1);
+			XMVECTOR p2 = LoadPosition(positions, positionStride, i + 2);
+			XMVECTOR p3 = LoadPosition(positions, positionStride, i + 3);
+			min0 = XMVectorMin(min0, p0); max0 = XMVectorMax(max0, p0);
+			min1 = XMVectorMin(min1, p1); max1 = XMVectorMax(max1, p1);
+			min2 = XMVectorMin(min2, p2); max2 = XMVectorMax(max2, p2);
+			min3 = XMVectorMin(min3, p3); max3 = XMVectorMax(max3, p3);
+		}
+		for (; i < end; i++)
+		{
+			XMVECTOR p = LoadPosition(positions, positionStride, i);
+			min0 = XMVectorMin(min0, p);
+			max0 = XMVectorMax(max0, p);
+		}
+		XMStoreFloat3(&partialMin[block], XMVectorMin(XMVectorMin(min0, min1), XMVectorMin(min2, min3)));
+		XMStoreFloat3(&partialMax[block], XMVectorMax(XMVectorMax(max0, max1), XMVectorMax(max2, max3)));
+	});
+
+	XMVECTOR resultMin = XMVectorReplicate(FLT_MAX), resultMax = XMVectorReplicate(-FLT_MAX);
+	for (size_t block = 0; block < partialMin.size(); block++)
+	{
+		resultMin = XMVectorMin(resultMin, XMLoadFloat3(&partialMin[block]));
+		resultMax = XMVectorMax(resultMax, XMLoadFloat3(&partialMax[block]));
+	}
+	XMStoreFloat3(&boundsMin, resultMin);
+	XMStoreFloat3(&boundsMax, resultMax);
+}
+
+void ComputeAabbScalar(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const float* positions, size_t positionStride, size_t count)
+{
+	boundsMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	boundsMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMFLOAT3 const& p = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + i * positionStride);
+		boundsMin = XMFLOAT3(std::min(boundsMin.x, p.x), std::min(boundsMin.y, p.y), std::min(boundsMin.z, p.z));
+		boundsMax = XMFLOAT3(std::max(boundsMax.x, p.x), std::max(boundsMax.y, p.y), std::max(boundsMax.z, p.z));
+	}
+}
+
+MeshBounds ComputeMeshBounds(const float* positions, size_t positionStride, size_t count)
+{
+	MeshBounds bounds = {};
+	if (count == 0) return bounds;
+
+	ComputeAabb(bounds.boundsMin, bounds.boundsMax, positions, positionStride, count);
+
+	// Extreme points along the axes and the four cube diagonals, per block.
+	const size_t directionCount = 7;
+	struct Extremes {
+		float low[directionCount], high[directionCount];
+		size_t lowPoint[directionCount], highPoint[directionCount];
+	};
+	std::vector<Extremes> partial(GetBlockCount(count));
+	ParallelFor(partial.size(), [&](size_t block) {
+		Extremes& e = partial[block];
+		size_t begin = block * c_boundsBlockSize, end = std::min(count, begin + c_boundsBlockSize);
+		for (size_t d = 0; d < directionCount; d++)
+		{
+			e.low[d] = FLT_MAX;
+			e.high[d] = -FLT_MAX;
+			e.lowPoint[d] = e.highPoint[d] = begin;
+		}
+		for (size_t i = begin; i < end; i++)
+		{
+			XMFLOAT3 const& p = *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + i * positionStride);
+			const float projections[directionCount] = { p.x, p.y, p.z, p.x + p.y + p.z, p.x + p.y - p.z, p.x - p.y + p.z, p.x - p.y - p.z };
+			for (size_t d = 0; d < directionCount; d++)
+			{
+				float projection = projections[d];
+				if (projection < e.low[d]) { e.low[d] = projection; e.lowPoint[d] = i; }
+				if (projection > e.high[d]) { e.high[d] = projection; e.highPoint[d] = i; }
+			}
+		}
+	});
+	Extremes extremes = partial[0];
+	for (Extremes const& e : partial)
+		for (size_t d = 0; d < directionCount; d++)
+		{
+			if (e.low[d] < extremes.low[d]) { extremes.low[d] = e.low[d]; extremes.lowPoint[d] = e.lowPoint[d]; }
+			if (e.high[d] > extremes.high[d]) { extremes.high[d] = e.high[d]; extremes.highPoint[d] = e.highPoint[d]; }
+		}
+
+	// Initial sphere on the most distant extreme pair, grown over every position (Ritter).
+	XMVECTOR a = XMVectorZero(), b = XMVectorZero();
+	float longestSq = -1.0f;
+	for (size_t d = 0; d < directionCount; d++)
+	{
+		XMVECTOR low = LoadPosition(positions, positionStride, extremes.lowPoint[d]);
+		XMVECTOR high = LoadPosition(positions, positionStride, extremes.highPoint[d]);
+		float lengthSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(high, low)));
+		if (lengthSq > longestSq)
+		{
+			longestSq = lengthSq;
+			a = low;
+			b = high;
+		}
+	}
+	XMVECTOR center = XMVectorScale(XMVectorAdd(a, b), 0.5f);
+	float radius = 0.5f * sqrtf(longestSq);
+	for (size_t i = 0; i < count; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(LoadPosition(positions, positionStride, i), center);
+		float distanceSq = XMVectorGetX(XMVector3LengthSq(offset));
+		if (distanceSq <= radius * radius) continue;
+		float distance = sqrtf(distanceSq);
+		float grown = 0.5f * (radius + distance);
+		center = XMVectorAdd(center, XMVectorScale(offset, (grown - radius) / distance));
+		radius = grown;
+	}
+
+	// Exact radii around both candidates; rounding in the growth pass cannot leave a point out.
+	radius = GetMaxDistance(center, positions, positionStride, count);
+	XMVECTOR boxCenter = XMVectorScale(XMVectorAdd(XMLoadFloat3(&bounds.boundsMin), XMLoadFloat3(&bounds.boundsMax)), 0.5f);
+	float boxRadius = GetMaxDistance(boxCenter, positions, positionStride, count);
+	if (boxRadius < radius)
+	{
+		center = boxCenter;
+		radius = boxRadius;
+	}
+	XMStoreFloat3(&bounds.sphereCenter, center);
+	bounds.sphereRadius = radius;
+	return bounds;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include "pch.h"
+
+using namespace DirectX;
+
+// Object space bounds of a whole mesh, for culling and placement.
+//
+// The box is a parallel min/max reduction: every task keeps four independent DirectXMath
+// accumulators (SSE on x86/x64, NEON on ARM, plain floats under _XM_NO_INTRINSICS_) so
+// the loop is limited by memory rather than by the min/max latency. The sphere starts
+// from the farthest pair among the extreme points along seven directions, grows with
+// Ritter's pass, and then gets the exact radius around its centre; the sphere around
+// the box centre is kept instead when it comes out smaller.
+
+struct MeshBounds {
+	XMFLOAT3 boundsMin;
+	XMFLOAT3 boundsMax;
+	XMFLOAT3 sphereCenter;
+	float sphereRadius;
+};
+
+// Box and sphere of count positions; all zero for an empty mesh.
+MeshBounds ComputeMeshBounds(const float* positions, size_t positionStride, size_t count);
+
+void ComputeAabb(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const float* positions, size_t positionStride, size_t count);
+// Reference: one position at a time with std::min/std::max. Same result as ComputeAabb.
+void ComputeAabbScalar(XMFLOAT3& boundsMin, XMFLOAT3& boundsMax, const float* positions, size_t positionStride, size_t count);
@@ -0,0 +1,109 @@
+#include "pch.h"
+#include "MeshFile.h"
+#include "Mesh.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : data(nullptr), size(0), file(INVALID_HANDLE_VALUE), mapping(nullptr)
+{
+}
+#else
+MappedFile::MappedFile() : data(nullptr), size(0), file(-1)
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(std::string const& fileName)
+{
+	Close();
+#ifdef _WIN32
+	// CreateFile2/MapViewOfFileFromApp are the variants available to UWP apps.
+	std::wstring wideName = std::filesystem::path(fileName).wstring();
+	file = CreateFile2(wideName.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { Close(); return false; }
+
+	mapping = CreateFileMappingFromApp(file, nullptr, PAGE_READONLY, 0, nullptr);
+	if (mapping == nullptr) { Close(); return false; }
+
+	data = static_cast<const uint8_t*>(MapViewOfFileFromApp(mapping, FILE_MAP_READ, 0, 0));
+	if (data == nullptr) { Close(); return false; }
+	size = static_cast<size_t>(fileSize.QuadPart);
+#else
+	file = open(fileName.c_str(), O_RDONLY);
+	if (file < 0) return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) { Close(); return false; }
+
+	void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	if (view == MAP_FAILED) { Close(); return false; }
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(info.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (data != nullptr) UnmapViewOfFile(data);
+	if (mapping != nullptr) CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+	mapping = nullptr;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data != nullptr) munmap(const_cast<uint8_t*>(data), size);
+	if (file >= 0) close(file);
+	file = -1;
+#endif
+	data = nullptr;
+	size = 0;
+}
+
+bool IsBinaryMeshFile(std::string const& fileName)
+{
+	std::ifstream file(fileName, std::ios::binary);
+	uint32_t magic = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	return file.good() && magic == c_meshFileMagic;
+}
+
+const MeshFileHeader* GetMeshFileHeader(MappedFile const& file, uint32_t vertexStride)
+{
+	if (file.GetSize() < c_meshFileHeaderSizeV1) return nullptr;
+
+	const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(file.GetData());
+	if (header->magic != c_meshFileMagic || header->version < 1 || header->version > c_meshFileVersion) return nullptr;
+	if (header->version >= 2 && file.GetSize() < sizeof(MeshFileHeader)) return nullptr;
+	if (header->vertexStride != vertexStride || header->indexStride != sizeof(unsigned int)) return nullptr;
+	if (header->vertexOffset % c_meshFileAlignment != 0 || header->indexOffset % c_meshFileAlignment != 0) return nullptr;
+
+	// Both arrays must lie completely inside the mapping.
+	uint64_t vertexBytes = uint64_t(header->vertexCount) * header->vertexStride;
+	uint64_t indexBytes = uint64_t(header->indexCount) * header->indexStride;
+	if (header->vertexOffset > file.GetSize() || vertexBytes > file.GetSize() - header->vertexOffset) return nullptr;
+	if (header->indexOffset > file.GetSize() || indexBytes > file.GetSize() - header->indexOffset) return nullptr;
+
+	return header;
+}
+
+bool ConvertTextMeshToBinary(std::string const& textFileName, std::string const& binaryFileName)
+{
+	Mesh mesh(textFileName);
+	if (mesh.GetVertexCount() == 0) return false;
+	return mesh.writeBinaryFile(binaryFileName);
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "pch.h"
+#include "MeshBounds.h"
+
+// Binary mesh container (.mshb).
+//
+// The file is laid out so it can be mapped and used in place, without parsing:
+//
+//   MeshFileHeader | padding | Vertex[vertexCount] | padding | index[indexCount]
+//
+// Both arrays start at offsets aligned to c_meshFileAlignment. Data is stored in
+// the native (little endian) byte order of every platform we ship on.
+//
+// Version 2 appended the mesh bounds to the header. Version 1 files still load; their
+// bounds are computed from the mapped vertices instead.
+
+static const uint32_t c_meshFileMagic = 0x4248534D; // "MSHB"
+static const uint32_t c_meshFileVersion = 2;
+static const uint32_t c_meshFileAlignment = 16;
+
+struct MeshFileHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexStride;	// sizeof(Vertex) when the file was cooked
+	uint32_t indexStride;	// bytes per index
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint64_t vertexOffset;	// from the start of the file
+	uint64_t indexOffset;
+	MeshBounds bounds;		// version 2 and later
+};
+
+static const size_t c_meshFileHeaderSizeV1 = offsetof(MeshFileHeader, bounds);
+
+// Read-only memory mapping of a whole file. The view stays valid for the
+// lifetime of the object.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	bool Open(std::string const& fileName);
+	void Close();
+
+	const uint8_t* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	const uint8_t* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+};
+
+// True when the file starts with the binary mesh magic.
+bool IsBinaryMeshFile(std::string const& fileName);
+
+// Validates the header of a mapped binary mesh and returns it, or nullptr when
+// the mapping does not hold a mesh this build can use in place.
+const MeshFileHeader* GetMeshFileHeader(MappedFile const& file, uint32_t vertexStride);
+
+// Cooks a text mesh.dat into the binary container.
+bool ConvertTextMeshToBinary(std::string const& textFileName, std::string const& binaryFileName);
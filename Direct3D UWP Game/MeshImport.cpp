@@ -0,0 +1,778 @@
+#include "pch.h"
+#include "MeshImport.h"
+#include "Parallel.h"
+#include "TextParsing.h"
+#include <atomic>
+#include <cctype>
+#include <climits>
+#include <cstring>
+
+namespace
+{
+	const unsigned int c_noIndex = UINT_MAX;
+
+	// Vertices are assembled in blocks, so ParallelFor does not pay a call per vertex.
+	const size_t c_importBlock = 16 * 1024;
+
+	template <typename Func>
+	void ParallelForBlocks(size_t count, Func&& func)
+	{
+		ParallelFor((count + c_importBlock - 1) / c_importBlock, [&](size_t block) {
+			size_t first = block * c_importBlock;
+			func(first, std::min(first + c_importBlock, count));
+		});
+	}
+
+	inline bool ParseInt(const char*& p, const char* end, long long& value)
+	{
+		auto result = std::from_chars(p, end, value);
+		if (result.ec != std::errc()) return false;
+		p = result.ptr;
+		return true;
+	}
+
+	// True when the line at p starts with the given keyword followed by a space.
+	inline bool IsRecord(const char* p, const char* end, const char* keyword, size_t length)
+	{
+		return size_t(end - p) > length && memcmp(p, keyword, length) == 0 && IsLineSpace(p[length]);
+	}
+
+	// --- OBJ ---
+
+	struct ObjCounts {
+		size_t positions;
+		size_t normals;
+		size_t corners;	// three per triangle, after fanning
+	};
+
+	// Number of corners (tokens) of the face record whose first corner starts at p.
+	size_t CountFaceCorners(const char* p, const char* end)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+		return CountTokens(p, lineEnd ? lineEnd : end);
+	}
+
+	ObjCounts CountObjChunk(TextChunk const& chunk)
+	{
+		ObjCounts counts = {};
+		for (const char* p = chunk.begin; p < chunk.end; p = NextLine(p, chunk.end))
+		{
+			p = SkipLineSpaces(p, chunk.end);
+			if (IsRecord(p, chunk.end, "v", 1)) counts.positions++;
+			else if (IsRecord(p, chunk.end, "vn", 2)) counts.normals++;
+			else if (IsRecord(p, chunk.end, "f", 1))
+			{
+				size_t corners = CountFaceCorners(p + 2, chunk.end);
+				if (corners >= 3) counts.corners += (corners - 2) * 3;
+			}
+		}
+		return counts;
+	}
+
+	// Turns an OBJ reference (1-based, or negative from the last element defined so far)
+	// into a zero-based index; c_noIndex when it points outside.
+	inline unsigned int ResolveObjIndex(long long reference, size_t defined)
+	{
+		long long index = reference > 0 ? reference - 1 : (long long)(defined) + reference;
+		return index >= 0 && index < (long long)(defined) ? (unsigned int)(index) : c_noIndex;
+	}
+
+	struct ObjOutput {
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> colors;
+		std::vector<XMFLOAT3> normals;
+		std::vector<unsigned int> cornerPositions;
+		std::vector<unsigned int> cornerNormals;	// c_noIndex where the corner has none
+		std::atomic<bool> hasColors{ false };
+	};
+
+	// Parses a chunk whose records land at the given offsets.
+	bool ParseObjChunk(TextChunk const& chunk, ObjCounts start, ObjOutput& out)
+	{
+		const char* end = chunk.end;
+		size_t position = start.positions;
+		size_t normal = start.normals;
+		size_t corner = start.corners;
+		bool colors = false;
+
+		for (const char* p = chunk.begin; p < end; p = NextLine(p, end))
+		{
+			p = SkipLineSpaces(p, end);
+			if (IsRecord(p, end, "v", 1))
+			{
+				const char* q = p + 2;
+				XMFLOAT3& pos = out.positions[position];
+				if (!ParseFloat(q, end, pos.x) || !ParseFloat(q, end, pos.y) || !ParseFloat(q, end, pos.z)) return false;
+				// Optional vertex colour after the position (a widespread extension)
+				XMFLOAT3& col = out.colors[position];
+				q = SkipLineSpaces(q, end);
+				if (!AtLineEnd(q, end) && ParseFloat(q, end, col.x) && ParseFloat(q, end, col.y) && ParseFloat(q, end, col.z))
+					colors = true;
+				else
+					col = XMFLOAT3(-1.0f, -1.0f, -1.0f);
+				position++;
+			}
+			else if (IsRecord(p, end, "vn", 2))
+			{
+				const char* q = p + 3;
+				XMFLOAT3& n = out.normals[normal++];
+				if (!ParseFloat(q, end, n.x) || !ParseFloat(q, end, n.y) || !ParseFloat(q, end, n.z)) return false;
+			}
+			else if (IsRecord(p, end, "f", 1))
+			{
+				// Corners are v, v/vt, v//vn or v/vt/vn; fanned around the first one
+				const char* q = p + 2;
+				unsigned int firstPos = 0, firstNormal = 0, prevPos = 0, prevNormal = 0;
+				for (size_t k = 0; !AtLineEnd(q, end); k++)
+				{
+					q = SkipLineSpaces(q, end);
+					long long reference;
+					if (!ParseInt(q, end, reference)) return false;
+					unsigned int pos = ResolveObjIndex(reference, position);
+					unsigned int n = c_noIndex;
+					if (q < end && *q == '/')
+					{
+						q++;
+						if (q < end && *q != '/' && !ParseInt(q, end, reference)) return false;
+						if (q < end && *q == '/')
+						{
+							q++;
+							if (!ParseInt(q, end, reference)) return false;
+							n = ResolveObjIndex(reference, normal);
+							if (n == c_noIndex) return false;
+						}
+					}
+					if (pos == c_noIndex) return false;
+
+					if (k == 0) { firstPos = pos; firstNormal = n; }
+					else if (k >= 2)
+					{
+						out.cornerPositions[corner] = firstPos;
+						out.cornerNormals[corner++] = firstNormal;
+						out.cornerPositions[corner] = prevPos;
+						out.cornerNormals[corner++] = prevNormal;
+						out.cornerPositions[corner] = pos;
+						out.cornerNormals[corner++] = n;
+					}
+					prevPos = pos;
+					prevNormal = n;
+				}
+			}
+		}
+		if (colors) out.hasColors = true;
+		return true;
+	}
+
+	// --- PLY ---
+
+	enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+	PlyType ParsePlyType(std::string const& name)
+	{
+		if (name == "char" || name == "int8") return PlyType::Int8;
+		if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+		if (name == "short" || name == "int16") return PlyType::Int16;
+		if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+		if (name == "int" || name == "int32") return PlyType::Int32;
+		if (name == "uint" || name == "uint32") return PlyType::UInt32;
+		if (name == "float" || name == "float32") return PlyType::Float32;
+		if (name == "double" || name == "float64") return PlyType::Float64;
+		return PlyType::Invalid;
+	}
+
+	unsigned int GetPlyTypeSize(PlyType type)
+	{
+		static const unsigned int sizes[] = { 1, 1, 2, 2, 4, 4, 4, 8 };
+		return sizes[unsigned(type)];
+	}
+
+	// Largest value of an integer colour type, which maps to 1.0.
+	float GetPlyColorScale(PlyType type)
+	{
+		switch (type)
+		{
+		case PlyType::UInt8: case PlyType::Int8: return 1.0f / 255.0f;
+		case PlyType::UInt16: case PlyType::Int16: return 1.0f / 65535.0f;
+		case PlyType::UInt32: case PlyType::Int32: return 1.0f / 4294967295.0f;
+		default: return 1.0f;
+		}
+	}
+
+	enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+	// Where a vertex property goes: position, colour and normal components in Vertex order.
+	enum PlyRole { RoleX, RoleY, RoleZ, RoleRed, RoleGreen, RoleBlue, RoleAlpha, RoleNx, RoleNy, RoleNz, RoleNone };
+
+	struct PlyProperty {
+		PlyType type;
+		PlyType countType;	// Invalid unless the property is a list
+		PlyRole role;
+		bool isIndexList;
+	};
+
+	struct PlyElement {
+		std::string name;
+		size_t count;
+		std::vector<PlyProperty> properties;
+		unsigned int stride;	// in bytes, 0 when the element holds a list
+	};
+
+	struct PlyHeader {
+		PlyFormat format;
+		std::vector<PlyElement> elements;
+		const char* body;
+	};
+
+	PlyRole GetPlyRole(std::string const& name)
+	{
+		static const char* names[] = { "x", "y", "z", "red", "green", "blue", "alpha", "nx", "ny", "nz" };
+		for (unsigned int role = 0; role < RoleNone; role++)
+			if (name == names[role]) return PlyRole(role);
+		if (name == "r" || name == "diffuse_red") return RoleRed;
+		if (name == "g" || name == "diffuse_green") return RoleGreen;
+		if (name == "b" || name == "diffuse_blue") return RoleBlue;
+		return RoleNone;
+	}
+
+	// Reads the header; the body starts after the end_header line.
+	bool ParsePlyHeader(const char* begin, const char* end, PlyHeader& header)
+	{
+		const char* p = begin;
+		auto nextWord = [&](const char* lineEnd) {
+			p = SkipLineSpaces(p, lineEnd);
+			const char* start = p;
+			while (p < lineEnd && !IsLineSpace(*p)) p++;
+			return std::string(start, p);
+		};
+
+		bool first = true;
+		bool hasFormat = false;
+		while (p < end)
+		{
+			const char* lineEnd = static_cast<const char*>(memchr(p, '\n', end - p));
+			if (!lineEnd) return false;
+			std::string keyword = nextWord(lineEnd);
+			if (first)
+			{
+				if (keyword != "ply") return false;
+				first = false;
+			}
+			else if (keyword == "format")
+			{
+				std::string format = nextWord(lineEnd);
+				if (format == "ascii") header.format = PlyFormat::Ascii;
+				else if (format == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+				else if (format == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+				else return false;
+				hasFormat = true;
+			}
+			else if (keyword == "element")
+			{
+				PlyElement element;
+				element.name = nextWord(lineEnd);
+				std::string count = nextWord(lineEnd);
+				auto result = std::from_chars(count.data(), count.data() + count.size(), element.count);
+				if (result.ec != std::errc()) return false;
+				element.stride = 0;
+				header.elements.push_back(element);
+			}
+			else if (keyword == "property")
+			{
+				if (header.elements.empty()) return false;
+				PlyProperty property = {};
+				std::string type = nextWord(lineEnd);
+				property.countType = PlyType::Invalid;
+				if (type == "list")
+				{
+					property.countType = ParsePlyType(nextWord(lineEnd));
+					if (property.countType == PlyType::Invalid || property.countType == PlyType::Float32 || property.countType == PlyType::Float64) return false;
+					type = nextWord(lineEnd);
+				}
+				property.type = ParsePlyType(type);
+				if (property.type == PlyType::Invalid) return false;
+				std::string name = nextWord(lineEnd);
+				property.role = property.countType == PlyType::Invalid ? GetPlyRole(name) : RoleNone;
+				property.isIndexList = property.countType != PlyType::Invalid && (name == "vertex_indices" || name == "vertex_index");
+				header.elements.back().properties.push_back(property);
+			}
+			else if (keyword == "end_header")
+			{
+				header.body = lineEnd + 1;
+				break;
+			}
+			// comment, obj_info and blank lines are skipped
+			p = lineEnd + 1;
+		}
+		if (!hasFormat || header.body == nullptr) return false;
+
+		for (PlyElement& element : header.elements)
+		{
+			unsigned int stride = 0;
+			for (PlyProperty const& property : element.properties)
+			{
+				if (property.countType != PlyType::Invalid) { stride = 0; break; }
+				stride += GetPlyTypeSize(property.type);
+			}
+			element.stride = stride;
+		}
+		return true;
+	}
+
+	// Binary scalar reader; big endian files are swapped on the way.
+	struct PlyReader {
+		bool swap;
+
+		template <typename T>
+		T Load(const uint8_t* p) const
+		{
+			uint8_t bytes[sizeof(T)];
+			memcpy(bytes, p, sizeof(T));
+			if (swap) std::reverse(bytes, bytes + sizeof(T));
+			T value;
+			memcpy(&value, bytes, sizeof(T));
+			return value;
+		}
+
+		double Read(PlyType type, const uint8_t* p) const
+		{
+			switch (type)
+			{
+			case PlyType::Int8: return Load<int8_t>(p);
+			case PlyType::UInt8: return Load<uint8_t>(p);
+			case PlyType::Int16: return Load<int16_t>(p);
+			case PlyType::UInt16: return Load<uint16_t>(p);
+			case PlyType::Int32: return Load<int32_t>(p);
+			case PlyType::UInt32: return Load<uint32_t>(p);
+			case PlyType::Float32: return Load<float>(p);
+			default: return Load<double>(p);
+			}
+		}
+
+		// Integer list entries; negative values come back as c_noIndex.
+		unsigned int ReadIndex(PlyType type, const uint8_t* p) const
+		{
+			double value = Read(type, p);
+			return value >= 0.0 && value < double(c_noIndex) ? (unsigned int)(value) : c_noIndex;
+		}
+	};
+
+	// Writes one vertex property into the vertex, colours scaled to [0, 1].
+	inline void SetPlyVertexProperty(Vertex& vertex, PlyProperty const& property, double value)
+	{
+		float* fields[RoleNone] = {
+			&vertex.pos.x, &vertex.pos.y, &vertex.pos.z,
+			&vertex.col.x, &vertex.col.y, &vertex.col.z, &vertex.col.w,
+			&vertex.normal.x, &vertex.normal.y, &vertex.normal.z };
+		if (property.role == RoleNone) return;
+		float scale = property.role >= RoleRed && property.role <= RoleAlpha ? GetPlyColorScale(property.type) : 1.0f;
+		*fields[property.role] = float(value) * scale;
+	}
+
+	// Appends the fanned triangles of one polygon.
+	inline void AddPolygon(std::vector<unsigned int>& triangles, const unsigned int* corners, size_t count)
+	{
+		for (size_t k = 2; k < count; k++)
+		{
+			triangles.push_back(corners[0]);
+			triangles.push_back(corners[k - 1]);
+			triangles.push_back(corners[k]);
+		}
+	}
+
+	bool ImportPlyBinary(PlyHeader const& header, const char* end, std::pmr::vector<Vertex>& vertices, std::vector<unsigned int>& triangles)
+	{
+		PlyReader reader = { header.format == PlyFormat::BinaryBigEndian };
+		const uint8_t* p = reinterpret_cast<const uint8_t*>(header.body);
+		const uint8_t* stop = reinterpret_cast<const uint8_t*>(end);
+		std::vector<unsigned int> polygon;
+
+		for (PlyElement const& element : header.elements)
+		{
+			bool isVertex = element.name == "vertex";
+			bool isFace = element.name == "face";
+
+			// Fixed size elements: the vertices are decoded in parallel, anything else skipped
+			if (element.stride != 0)
+			{
+				if (element.count > size_t(stop - p) / element.stride) return false;
+				if (isVertex)
+				{
+					ParallelForBlocks(element.count, [&](size_t first, size_t last) {
+						for (size_t i = first; i < last; i++)
+						{
+							const uint8_t* q = p + i * element.stride;
+							for (PlyProperty const& property : element.properties)
+							{
+								SetPlyVertexProperty(vertices[i], property, reader.Read(property.type, q));
+								q += GetPlyTypeSize(property.type);
+							}
+						}
+					});
+				}
+				p += element.count * element.stride;
+				continue;
+			}
+
+			// Elements holding lists are walked one by one
+			for (size_t i = 0; i < element.count; i++)
+			{
+				for (PlyProperty const& property : element.properties)
+				{
+					unsigned int size = GetPlyTypeSize(property.type);
+					if (property.countType == PlyType::Invalid)
+					{
+						if (size_t(stop - p) < size) return false;
+						if (isVertex) SetPlyVertexProperty(vertices[i], property, reader.Read(property.type, p));
+						p += size;
+						continue;
+					}
+
+					unsigned int countSize = GetPlyTypeSize(property.countType);
+					if (size_t(stop - p) < countSize) return false;
+					unsigned int count = reader.ReadIndex(property.countType, p);
+					p += countSize;
+					if (count == c_noIndex || count > size_t(stop - p) / size) return false;
+					if (isFace && property.isIndexList)
+					{
+						polygon.resize(count);
+						for (unsigned int k = 0; k < count; k++)
+							polygon[k] = reader.ReadIndex(property.type, p + size_t(k) * size);
+						AddPolygon(triangles, polygon.data(), count);
+					}
+					p += size_t(count) * size;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Parses one ASCII element instance (one line) starting at p.
+	bool ParsePlyAsciiLine(const char*& p, const char* end, PlyElement const& element, Vertex* vertex,
+		std::vector<unsigned int>* triangles, std::vector<unsigned int>& polygon)
+	{
+		for (PlyProperty const& property : element.properties)
+		{
+			if (property.countType == PlyType::Invalid)
+			{
+				float value;
+				if (!ParseFloat(p, end, value)) return false;
+				if (vertex) SetPlyVertexProperty(*vertex, property, value);
+				continue;
+			}
+
+			unsigned int count;
+			if (!ParseUInt(p, end, count)) return false;
+			polygon.resize(count);
+			for (unsigned int k = 0; k < count; k++)
+			{
+				long long value;
+				p = SkipLineSpaces(p, end);
+				if (!ParseInt(p, end, value)) return false;
+				polygon[k] = value >= 0 && value < c_noIndex ? (unsigned int)(value) : c_noIndex;
+			}
+			if (triangles && property.isIndexList)
+				AddPolygon(*triangles, polygon.data(), count);
+		}
+		return AtLineEnd(p, end);
+	}
+
+	// One element instance per line: line numbers give every vertex its slot, and faces are
+	// parsed per chunk into their own lists, joined in order afterwards.
+	bool ImportPlyAscii(PlyHeader const& header, const char* end, std::pmr::vector<Vertex>& vertices, std::vector<unsigned int>& triangles)
+	{
+		std::vector<TextChunk> chunks = SplitTextIntoChunks(header.body, end, GetTextChunkCount(end - header.body));
+		std::vector<std::vector<unsigned int>> chunkTriangles(chunks.size());
+
+		std::atomic<bool> ok{ true };
+		ParallelFor(chunks.size(), [&](size_t c) {
+			std::vector<unsigned int> polygon;
+			const char* p = chunks[c].begin;
+			size_t line = chunks[c].firstLine;
+			size_t elementStart = 0;
+			size_t e = 0;
+			for (; p < chunks[c].end && ok; line++)
+			{
+				while (e < header.elements.size() && line >= elementStart + header.elements[e].count)
+					elementStart += header.elements[e++].count;
+				if (e == header.elements.size()) break;
+
+				PlyElement const& element = header.elements[e];
+				Vertex* vertex = element.name == "vertex" ? &vertices[line - elementStart] : nullptr;
+				std::vector<unsigned int>* faces = element.name == "face" ? &chunkTriangles[c] : nullptr;
+				const char* lineEnd = NextLine(p, chunks[c].end);
+				if (!ParsePlyAsciiLine(p, lineEnd, element, vertex, faces, polygon)) ok = false;
+				p = lineEnd;
+			}
+		});
+		if (!ok) return false;
+
+		size_t total = 0;
+		for (auto const& list : chunkTriangles) total += list.size();
+		triangles.reserve(total);
+		for (auto const& list : chunkTriangles) triangles.insert(triangles.end(), list.begin(), list.end());
+		return true;
+	}
+}
+
+bool ImportObj(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals)
+{
+	vertices.clear();
+	indices.clear();
+	hasNormals = false;
+
+	// Count the records of every chunk, then give each chunk its place in the output
+	std::vector<TextChunk> chunks = SplitTextIntoChunks(begin, end, GetTextChunkCount(end - begin));
+	std::vector<ObjCounts> offsets(chunks.size() + 1, ObjCounts{});
+	ParallelFor(chunks.size(), [&](size_t c) { offsets[c + 1] = CountObjChunk(chunks[c]); });
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		offsets[c + 1].positions += offsets[c].positions;
+		offsets[c + 1].normals += offsets[c].normals;
+		offsets[c + 1].corners += offsets[c].corners;
+	}
+	ObjCounts total = offsets.back();
+	if (total.positions == 0 || total.corners == 0 || total.positions >= c_noIndex || total.corners >= c_noIndex) return false;
+
+	ObjOutput out;
+	out.positions.resize(total.positions);
+	out.colors.resize(total.positions);
+	out.normals.resize(total.normals);
+	out.cornerPositions.resize(total.corners);
+	out.cornerNormals.resize(total.corners);
+
+	std::atomic<bool> ok{ true };
+	ParallelFor(chunks.size(), [&](size_t c) {
+		if (!ParseObjChunk(chunks[c], offsets[c], out)) ok = false;
+	});
+	if (!ok) return false;
+
+	// Normals are used only when every corner has one. When they are indexed like the
+	// positions (v//vn with equal numbers, the common export) each position is a vertex;
+	// otherwise every corner becomes a vertex and welding merges the repeats.
+	std::atomic<bool> allNormals{ total.normals > 0 };
+	std::atomic<bool> shared{ total.normals == total.positions };
+	ParallelForBlocks(total.corners, [&](size_t first, size_t last) {
+		for (size_t k = first; k < last; k++)
+		{
+			if (out.cornerNormals[k] == c_noIndex) { allNormals = false; break; }
+			if (out.cornerNormals[k] != out.cornerPositions[k]) shared = false;
+		}
+	});
+	hasNormals = allNormals;
+	bool perPosition = !hasNormals || shared;
+	bool hasColors = out.hasColors;
+
+	auto makeVertex = [&](unsigned int position, unsigned int normal) {
+		Vertex vertex;
+		vertex.pos = out.positions[position];
+		XMFLOAT3 const& col = out.colors[position];
+		vertex.col = hasColors && col.x >= 0.0f ? XMFLOAT4(col.x, col.y, col.z, 1.0f) : defaultColor;
+		vertex.normal = hasNormals ? out.normals[normal] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return vertex;
+	};
+
+	if (perPosition)
+	{
+		vertices.resize(total.positions);
+		indices.assign(out.cornerPositions.begin(), out.cornerPositions.end());
+		ParallelForBlocks(total.positions, [&](size_t first, size_t last) {
+			for (size_t i = first; i < last; i++)
+				vertices[i] = makeVertex((unsigned int)(i), (unsigned int)(i));
+		});
+	}
+	else
+	{
+		vertices.resize(total.corners);
+		indices.resize(total.corners);
+		ParallelForBlocks(total.corners, [&](size_t first, size_t last) {
+			for (size_t k = first; k < last; k++)
+			{
+				vertices[k] = makeVertex(out.cornerPositions[k], out.cornerNormals[k]);
+				indices[k] = (unsigned int)(k);
+			}
+		});
+	}
+	return true;
+}
+
+bool ImportPly(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals)
+{
+	vertices.clear();
+	indices.clear();
+	hasNormals = false;
+
+	PlyHeader header = {};
+	if (!ParsePlyHeader(begin, end, header)) return false;
+
+	const PlyElement* vertexElement = nullptr;
+	for (PlyElement const& element : header.elements)
+		if (element.name == "vertex") vertexElement = &element;
+	if (!vertexElement || vertexElement->count == 0 || vertexElement->count >= c_noIndex) return false;
+
+	bool roles[RoleNone + 1] = {};
+	for (PlyProperty const& property : vertexElement->properties)
+		roles[property.role] = true;
+	if (!roles[RoleX] || !roles[RoleY] || !roles[RoleZ]) return false;
+	hasNormals = roles[RoleNx] && roles[RoleNy] && roles[RoleNz];
+
+	// Colours the file leaves out keep the default; a file without alpha is opaque
+	Vertex blank = {};
+	blank.col = defaultColor;
+	if (roles[RoleRed] || roles[RoleGreen] || roles[RoleBlue])
+		blank.col.w = 1.0f;
+	vertices.assign(vertexElement->count, blank);
+
+	std::vector<unsigned int> triangles;
+	bool ok = header.format == PlyFormat::Ascii
+		? ImportPlyAscii(header, end, vertices, triangles)
+		: ImportPlyBinary(header, end, vertices, triangles);
+
+	// Every index must name a vertex
+	std::atomic<bool> valid{ ok && !triangles.empty() };
+	if (valid)
+		ParallelForBlocks(triangles.size(), [&](size_t first, size_t last) {
+			for (size_t k = first; k < last; k++)
+				if (triangles[k] >= vertices.size()) { valid = false; break; }
+		});
+	if (!valid)
+	{
+		vertices.clear();
+		hasNormals = false;
+		return false;
+	}
+	indices.assign(triangles.begin(), triangles.end());
+	return true;
+}
+
+/*
+	mesh.dat layout, one record per line:
+		line 0					vertex count n
+		lines 1 .. n			positions (3 floats)
+		lines n+1 .. 2n			normals (3 floats)
+		line 2n+1				index count m
+		remaining lines			m indices
+	Line numbers give the destination of every position and normal, so the file is
+	split into chunks on line boundaries and each chunk is parsed on its own thread.
+	Index chunks first count their tokens to find where their output starts.
+*/
+bool ImportTextLines(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals, size_t chunkCount)
+{
+	const char* p = begin;
+	unsigned int nvertices;
+	if (!ParseUInt(p, end, nvertices)) return false;
+
+	std::vector<TextChunk> chunks = SplitTextIntoChunks(begin, end, chunkCount ? chunkCount : GetTextChunkCount(end - begin));
+
+	// Locate lines from the chunk line numbers.
+	auto lineStart = [&](size_t target) {
+		size_t c = 0;
+		while (c + 1 < chunks.size() && chunks[c + 1].firstLine <= target) c++;
+		const char* start = chunks[c].begin;
+		for (size_t line = chunks[c].firstLine; line < target && start < end; line++)
+			start = NextLine(start, end);
+		return start;
+	};
+
+	// The line after the positions holds a normal (three numbers) or, when the file has
+	// no normals block, the index count on its own.
+	unsigned int nindices;
+	p = lineStart(size_t(nvertices) + 1);
+	hasNormals = !(ParseUInt(p, end, nindices) && AtLineEnd(p, end));
+
+	size_t countLine = (hasNormals ? 2 : 1) * size_t(nvertices) + 1;
+	const char* countStart = lineStart(countLine);
+
+	p = countStart;
+	if (!ParseUInt(p, end, nindices)) return false;
+	if (!AtLineEnd(p, end)) return false;
+	const char* indexStart = NextLine(p, end);
+
+	std::vector<TextChunk> indexChunks = SplitTextIntoChunks(indexStart, end, chunkCount ? chunkCount : GetTextChunkCount(end - indexStart));
+	std::vector<size_t> indexOffsets(indexChunks.size() + 1, 0);
+	ParallelFor(indexChunks.size(), [&](size_t i) {
+		indexOffsets[i + 1] = CountTokens(indexChunks[i].begin, indexChunks[i].end);
+	});
+	for (size_t i = 0; i < indexChunks.size(); i++) indexOffsets[i + 1] += indexOffsets[i];
+	if (indexOffsets.back() != nindices) return false;
+
+	Vertex blank = {};
+	blank.col = defaultColor;
+	vertices.assign(nvertices, blank);
+	indices.resize(nindices);
+
+	// Vertex chunks (those overlapping lines 1..2n) and index chunks run as one batch.
+	size_t vertexChunkCount = 0;
+	while (vertexChunkCount < chunks.size() && chunks[vertexChunkCount].begin < countStart) vertexChunkCount++;
+
+	std::atomic<bool> ok{ true };
+	ParallelFor(vertexChunkCount + indexChunks.size(), [&](size_t job) {
+		if (job < vertexChunkCount)
+		{
+			const char* q = chunks[job].begin;
+			const char* stop = std::min(chunks[job].end, countStart);
+			for (size_t line = chunks[job].firstLine; q < stop; line++)
+			{
+				if (line >= 1)
+				{
+					float vec[3];
+					if (!ParseFloat(q, stop, vec[0]) || !ParseFloat(q, stop, vec[1]) || !ParseFloat(q, stop, vec[2])) { ok = false; return; }
+					if (line <= nvertices)
+						vertices[line - 1].pos = XMFLOAT3(vec[0], vec[1], vec[2]);
+					else
+						vertices[line - 1 - nvertices].normal = XMFLOAT3(vec[0], vec[1], vec[2]);
+					if (!AtLineEnd(q, stop)) { ok = false; return; }
+				}
+				q = NextLine(q, stop);
+			}
+		}
+		else
+		{
+			size_t i = job - vertexChunkCount;
+			const char* q = indexChunks[i].begin;
+			for (size_t k = indexOffsets[i]; k < indexOffsets[i + 1]; k++)
+				if (!ParseUInt(q, indexChunks[i].end, indices[k])) { ok = false; return; }
+		}
+	});
+	return ok;
+}
+
+// Serial fallback: the same record order, read as a flat token stream.
+bool ImportTextTokens(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals)
+{
+	const char* p = begin;
+	unsigned int nvertices;
+	if (!ParseUInt(p, end, nvertices)) return false;
+
+	Vertex blank = {};
+	blank.col = defaultColor;
+	vertices.assign(nvertices, blank);
+	for (auto& v : vertices)
+		if (!ParseFloat(p, end, v.pos.x) || !ParseFloat(p, end, v.pos.y) || !ParseFloat(p, end, v.pos.z)) return false;
+
+	// Without normals the rest of the file is exactly the index count and the indices.
+	unsigned int nindices;
+	const char* q = p;
+	hasNormals = !(ParseUInt(q, end, nindices) && CountTokens(p, end) == size_t(nindices) + 1);
+	if (hasNormals)
+		for (auto& v : vertices)
+			if (!ParseFloat(p, end, v.normal.x) || !ParseFloat(p, end, v.normal.y) || !ParseFloat(p, end, v.normal.z)) return false;
+
+	if (!ParseUInt(p, end, nindices)) return false;
+	indices.resize(nindices);
+	for (auto& index : indices)
+		if (!ParseUInt(p, end, index)) return false;
+	return true;
+}
+
+MeshFileType GetMeshFileType(std::string const& fileName)
+{
+	std::string extension = std::filesystem::path(fileName).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return char(tolower(c)); });
+	if (extension == ".obj") return MeshFileType::Obj;
+	if (extension == ".ply") return MeshFileType::Ply;
+	return MeshFileType::Text;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "pch.h"
+#include "Mesh.h"
+
+// Importers for the formats meshes are exported in: our mesh.dat text, Wavefront OBJ
+// and PLY (ASCII, binary little and big endian). Mesh::readFile picks them by file
+// extension, so Mesh("rock.obj") and ConvertTextMeshToBinary("rock.ply", ...) work like
+// mesh.dat.
+//
+// They work on the whole file in memory (Mesh maps it): text is split into chunks on
+// line boundaries and parsed in parallel, counting first so every chunk knows where
+// its output goes; binary PLY vertices are decoded in place. Polygons are triangulated
+// as fans. The importers only translate: Mesh welds the result (see VertexWeld.h) and
+// generates normals when the file has none.
+//
+// OBJ: v (with optional r g b), vn and f records, 1-based or negative indices;
+// texture coordinates, groups and materials are skipped. Corners whose normal index
+// differs from their position index get a vertex of their own, for Mesh to weld.
+//
+// PLY: the vertex element's x y z, nx ny nz and red green blue alpha properties, of
+// any scalar type, and the face element's vertex_indices (or vertex_index) list.
+// Other elements and properties are skipped.
+
+// mesh.dat (layout in MeshImport.cpp). ImportTextLines parses files as we export them,
+// one record per line, in parallel; chunkCount 0 picks one from the file size.
+// ImportTextTokens is the serial fallback that reads the same records as a flat token
+// stream, for files laid out any other way. hasNormals is false when the normals block
+// is left out.
+bool ImportTextLines(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals, size_t chunkCount = 0);
+
+bool ImportTextTokens(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals);
+
+bool ImportObj(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals);
+
+bool ImportPly(const char* begin, const char* end, XMFLOAT4 const& defaultColor,
+	std::pmr::vector<Vertex>& vertices, std::pmr::vector<unsigned int>& indices, bool& hasNormals);
+
+enum class MeshFileType {
+	Text,	// mesh.dat layout
+	Obj,
+	Ply,
+};
+
+// By extension, case insensitive; anything else is read as mesh.dat text.
+MeshFileType GetMeshFileType(std::string const& fileName);
@@ -0,0 +1,212 @@
+#include "pch.h"
+#include "MeshPack.h"
+#include "Parallel.h"
+#include <climits>
+
+namespace
+{
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// Copies one mesh into the buffers laid out by PackMeshes.
+	void CopyMesh(MeshPack& pack, PackedMesh const& packed, Mesh const& mesh)
+	{
+		const uint8_t* source = static_cast<const uint8_t*>(mesh.GetVertexBufferData());
+		for (unsigned int slot = 0; slot < pack.GetVertexSlotCount(); slot++)
+		{
+			unsigned int stride = pack.GetVertexStride(slot);
+			memcpy(pack.vertexData.data() + pack.vertexStreamOffsets[slot] + size_t(packed.baseVertex) * stride,
+				source + mesh.GetVertexStreamOffset(slot), size_t(packed.vertexCount) * stride);
+		}
+
+		IndexBufferView indices = mesh.GetIndexBuffer();
+		if (pack.indexFormat == IndexFormat::Uint16)
+			memcpy(pack.indices16.data() + packed.startIndex, indices.data, indices.GetSizeInBytes());
+		else if (indices.format == IndexFormat::Uint32)
+			memcpy(pack.indices32.data() + packed.startIndex, indices.data, indices.GetSizeInBytes());
+		else
+			std::copy(indices.As<uint16_t>(), indices.As<uint16_t>() + indices.count, pack.indices32.begin() + packed.startIndex);
+	}
+
+	// Copies a table out of a mapped pack; false when it is not completely inside the mapping.
+	template <typename T>
+	bool ReadTable(std::vector<T>& table, MappedFile const& file, uint64_t offset, uint64_t count)
+	{
+		if (offset % c_meshFileAlignment != 0 || offset > file.GetSize() || count > (file.GetSize() - offset) / sizeof(T))
+			return false;
+		const T* data = reinterpret_cast<const T*>(file.GetData() + offset);
+		table.assign(data, data + count);
+		return true;
+	}
+}
+
+bool PackMeshes(MeshPack& pack, const Mesh* const* meshes, size_t meshCount, MeshPackOptions const& options)
+{
+	pack = MeshPack();
+	if (meshCount == 0)
+		return true;
+
+	// Shared formats: the vertex format must match, the index width is the widest one
+	pack.vertexFormat = meshes[0]->GetVertexFormat();
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		if (meshes[i]->GetVertexFormat() != pack.vertexFormat)
+			return false;
+		if (meshes[i]->GetIndexFormat() == IndexFormat::Uint32)
+			pack.indexFormat = IndexFormat::Uint32;
+	}
+	unsigned int indexStride = pack.indexFormat == IndexFormat::Uint16 ? 2 : 4;
+	uint64_t vertexAlignment = std::max(options.vertexAlignment, 1u);
+	uint64_t indexAlignment = std::max(options.indexAlignment / indexStride, 1u);
+
+	// Layout: where every mesh goes, and its draws moved there
+	uint64_t vertexCount = 0;
+	uint64_t indexCount = 0;
+	pack.meshes.resize(meshCount);
+	for (size_t i = 0; i < meshCount; i++)
+	{
+		Mesh const& mesh = *meshes[i];
+		PackedMesh& packed = pack.meshes[i];
+		vertexCount = AlignUp(vertexCount, vertexAlignment);
+		indexCount = AlignUp(indexCount, indexAlignment);
+		if (vertexCount > INT_MAX || indexCount > UINT_MAX)
+			break;
+
+		packed.baseVertex = (unsigned int)(vertexCount);
+		packed.vertexCount = mesh.GetVertexCount();
+		packed.startIndex = (unsigned int)(indexCount);
+		packed.indexCount = mesh.GetIndexBuffer().count;
+		packed.firstLevel = (unsigned int)(pack.levels.size());
+		packed.levelCount = mesh.GetLodCount();
+		packed.bounds = mesh.GetBounds();
+		packed.quantization = mesh.GetPositionQuantization();
+		vertexCount += packed.vertexCount;
+		indexCount += packed.indexCount;
+
+		for (unsigned int level = 0; level < packed.levelCount; level++)
+		{
+			std::vector<IndexRange> const& ranges = mesh.GetIndexRanges(level);
+			pack.levels.push_back({ (unsigned int)(pack.ranges.size()), (unsigned int)(ranges.size()) });
+			for (IndexRange const& range : ranges)
+				pack.ranges.push_back({ range.startIndex + packed.startIndex, range.indexCount, range.baseVertex + int(packed.baseVertex) });
+		}
+	}
+
+	uint64_t vertexBytes = 0;
+	for (unsigned int slot = 0; slot < pack.GetVertexSlotCount(); slot++)
+	{
+		vertexBytes = AlignUp(vertexBytes, c_vertexStreamAlignment);
+		pack.vertexStreamOffsets[slot] = (unsigned int)(vertexBytes);
+		vertexBytes += vertexCount * pack.GetVertexStride(slot);
+	}
+	if (vertexCount > INT_MAX || indexCount > UINT_MAX || vertexBytes > UINT_MAX || indexCount * indexStride > UINT_MAX)
+	{
+		pack = MeshPack();
+		return false;
+	}
+	pack.vertexCount = (unsigned int)(vertexCount);
+
+	// Copy: alignment gaps stay zero, every mesh writes only its own part
+	pack.vertexData.resize(size_t(vertexBytes));
+	if (pack.indexFormat == IndexFormat::Uint16)
+		pack.indices16.resize(size_t(indexCount));
+	else
+		pack.indices32.resize(size_t(indexCount));
+	ParallelFor(meshCount, [&](size_t i) { CopyMesh(pack, pack.meshes[i], *meshes[i]); });
+	return true;
+}
+
+bool PackMeshes(MeshPack& pack, std::vector<Mesh const*> const& meshes, MeshPackOptions const& options)
+{
+	return PackMeshes(pack, meshes.data(), meshes.size(), options);
+}
+
+bool WriteMeshPack(MeshPack const& pack, std::string const& fileName)
+{
+	auto alignUp = [](uint64_t value) { return AlignUp(value, c_meshFileAlignment); };
+	IndexBufferView indices = pack.GetIndexBuffer();
+
+	MeshPackHeader header = {};
+	header.magic = c_meshPackMagic;
+	header.version = c_meshPackVersion;
+	header.vertexFormat = uint32_t(pack.vertexFormat);
+	header.indexFormat = uint32_t(pack.indexFormat);
+	header.vertexCount = pack.vertexCount;
+	for (unsigned int slot = 0; slot < c_maxVertexSlots; slot++)
+		header.vertexStreamOffsets[slot] = pack.vertexStreamOffsets[slot];
+	header.meshCount = (uint32_t)(pack.meshes.size());
+	header.levelCount = (uint32_t)(pack.levels.size());
+	header.rangeCount = (uint32_t)(pack.ranges.size());
+	header.indexCount = indices.count;
+	header.vertexBytes = pack.vertexData.size();
+	header.meshOffset = alignUp(sizeof(MeshPackHeader));
+	header.levelOffset = alignUp(header.meshOffset + pack.meshes.size() * sizeof(PackedMesh));
+	header.rangeOffset = alignUp(header.levelOffset + pack.levels.size() * sizeof(PackedLevel));
+	header.vertexOffset = alignUp(header.rangeOffset + pack.ranges.size() * sizeof(IndexRange));
+	header.indexOffset = alignUp(header.vertexOffset + header.vertexBytes);
+
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file.good()) return false;
+
+	// Every section is written after padding up to its offset
+	const char padding[c_meshFileAlignment] = {};
+	uint64_t position = 0;
+	auto write = [&](uint64_t offset, const void* data, uint64_t size) {
+		file.write(padding, offset - position);
+		file.write(static_cast<const char*>(data), size);
+		position = offset + size;
+	};
+	write(0, &header, sizeof(header));
+	write(header.meshOffset, pack.meshes.data(), pack.meshes.size() * sizeof(PackedMesh));
+	write(header.levelOffset, pack.levels.data(), pack.levels.size() * sizeof(PackedLevel));
+	write(header.rangeOffset, pack.ranges.data(), pack.ranges.size() * sizeof(IndexRange));
+	write(header.vertexOffset, pack.vertexData.data(), header.vertexBytes);
+	write(header.indexOffset, indices.data, indices.GetSizeInBytes());
+	return file.good();
+}
+
+bool ReadMeshPack(MeshPack& pack, std::string const& fileName)
+{
+	pack = MeshPack();
+	MappedFile file;
+	if (!file.Open(fileName) || file.GetSize() < sizeof(MeshPackHeader)) return false;
+
+	const MeshPackHeader* header = reinterpret_cast<const MeshPackHeader*>(file.GetData());
+	if (header->magic != c_meshPackMagic || header->version != c_meshPackVersion) return false;
+	if (header->vertexFormat > uint32_t(VertexFormat::PackedSplit) || header->indexFormat > uint32_t(IndexFormat::Uint32)) return false;
+
+	pack.vertexFormat = VertexFormat(header->vertexFormat);
+	pack.indexFormat = IndexFormat(header->indexFormat);
+	pack.vertexCount = header->vertexCount;
+	for (unsigned int slot = 0; slot < c_maxVertexSlots; slot++)
+		pack.vertexStreamOffsets[slot] = header->vertexStreamOffsets[slot];
+
+	bool valid = ReadTable(pack.meshes, file, header->meshOffset, header->meshCount)
+		&& ReadTable(pack.levels, file, header->levelOffset, header->levelCount)
+		&& ReadTable(pack.ranges, file, header->rangeOffset, header->rangeCount)
+		&& ReadTable(pack.vertexData, file, header->vertexOffset, header->vertexBytes)
+		&& (pack.indexFormat == IndexFormat::Uint16
+			? ReadTable(pack.indices16, file, header->indexOffset, header->indexCount)
+			: ReadTable(pack.indices32, file, header->indexOffset, header->indexCount));
+
+	// The tables must point inside each other and the streams inside the vertex data
+	for (unsigned int slot = 0; valid && slot < pack.GetVertexSlotCount(); slot++)
+		valid = uint64_t(pack.vertexStreamOffsets[slot]) + pack.GetVertexStreamSize(slot) <= pack.vertexData.size();
+	for (size_t i = 0; valid && i < pack.meshes.size(); i++)
+	{
+		PackedMesh const& packed = pack.meshes[i];
+		valid = uint64_t(packed.firstLevel) + packed.levelCount <= pack.levels.size()
+			&& uint64_t(packed.baseVertex) + packed.vertexCount <= pack.vertexCount
+			&& uint64_t(packed.startIndex) + packed.indexCount <= header->indexCount;
+	}
+	for (size_t i = 0; valid && i < pack.levels.size(); i++)
+		valid = uint64_t(pack.levels[i].firstRange) + pack.levels[i].rangeCount <= pack.ranges.size();
+	for (size_t i = 0; valid && i < pack.ranges.size(); i++)
+		valid = uint64_t(pack.ranges[i].startIndex) + pack.ranges[i].indexCount <= header->indexCount;
+
+	if (!valid)
+		pack = MeshPack();
+	return valid;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include "pch.h"
+#include "Mesh.h"
+
+// Many meshes sharing one vertex buffer and one index buffer.
+//
+// Every mesh keeps its own vertices and indices, placed one after the other: its
+// draws are the mesh's own ranges with baseVertex and startIndex moved to where it
+// landed, so a whole scene is drawn with a single IASetVertexBuffers/IASetIndexBuffer
+// binding. Split formats keep one stream per slot as in Mesh (stream s of every mesh,
+// then stream s + 1), so baseVertex addresses the same vertex in all of them.
+//
+// The index width is shared as well: 16-bit when every mesh chose it, otherwise all
+// indices are widened. 16-bit indices are relative to their range's baseVertex, so
+// they are copied unchanged either way and only the ranges move.
+//
+// Meshes keep their own bounds and position quantization: with packed formats each
+// mesh needs its own decode constants when it is drawn.
+
+struct MeshPackOptions {
+	unsigned int vertexAlignment = 1;	// first vertex of every mesh, in vertices
+	unsigned int indexAlignment = 4;	// first index of every mesh, in bytes
+};
+
+// One mesh of the pack. Its levels of detail are levels[firstLevel, firstLevel + levelCount).
+struct PackedMesh {
+	unsigned int baseVertex;	// first vertex, in every stream
+	unsigned int vertexCount;
+	unsigned int startIndex;	// first index of level 0
+	unsigned int indexCount;	// every level
+	unsigned int firstLevel;
+	unsigned int levelCount;
+	MeshBounds bounds;
+	PositionQuantization quantization;
+};
+
+// Draws of one level: ranges[firstRange, firstRange + rangeCount).
+struct PackedLevel {
+	unsigned int firstRange;
+	unsigned int rangeCount;
+};
+
+// Read-only run of draws, usable in a range-based for.
+struct IndexRangeList {
+	const IndexRange* ranges;
+	size_t count;
+
+	const IndexRange* begin() const { return ranges; }
+	const IndexRange* end() const { return ranges + count; }
+};
+
+struct MeshPack {
+	VertexFormat vertexFormat = VertexFormat::Float;
+	IndexFormat indexFormat = IndexFormat::Uint16;
+
+	// Slot streams back to back, each on c_vertexStreamAlignment, vertexCount vertices long
+	// (alignment gaps included).
+	std::vector<uint8_t> vertexData;
+	unsigned int vertexStreamOffsets[c_maxVertexSlots] = {};
+	unsigned int vertexCount = 0;
+
+	std::vector<uint16_t> indices16;
+	std::vector<unsigned int> indices32;
+
+	std::vector<PackedMesh> meshes;
+	std::vector<PackedLevel> levels;
+	std::vector<IndexRange> ranges;	// already moved to the pack's buffers
+
+	unsigned int GetVertexSlotCount() const { return ::GetVertexSlotCount(vertexFormat); }
+	unsigned int GetVertexStride(unsigned int slot = 0) const { return ::GetVertexStride(vertexFormat, slot); }
+	unsigned int GetVertexStreamSize(unsigned int slot) const { return vertexCount * GetVertexStride(slot); }
+	unsigned int GetVSize() const { return (unsigned int)vertexData.size(); }
+
+	IndexBufferView GetIndexBuffer() const
+	{
+		if (indexFormat == IndexFormat::Uint16) return { indices16.data(), (unsigned int)indices16.size(), IndexFormat::Uint16 };
+		return { indices32.data(), (unsigned int)indices32.size(), IndexFormat::Uint32 };
+	}
+	unsigned int GetISize() const { return GetIndexBuffer().GetSizeInBytes(); }
+
+	IndexRangeList GetIndexRanges(size_t mesh, unsigned int level = 0) const
+	{
+		PackedLevel const& packed = levels[meshes[mesh].firstLevel + level];
+		return { ranges.data() + packed.firstRange, packed.rangeCount };
+	}
+};
+
+// Packs the GPU buffers of the meshes (after SetVertexFormat) into pack, in order.
+// Fails, leaving pack empty, when the meshes do not share a vertex format or the
+// result would not fit 32-bit offsets.
+bool PackMeshes(MeshPack& pack, const Mesh* const* meshes, size_t meshCount, MeshPackOptions const& options = {});
+bool PackMeshes(MeshPack& pack, std::vector<Mesh const*> const& meshes, MeshPackOptions const& options = {});
+
+// Binary pack container (.mpak), laid out like MeshFile.h: a header followed by the
+// tables and buffers above, each on c_meshFileAlignment.
+static const uint32_t c_meshPackMagic = 0x4B41504D; // "MPAK"
+static const uint32_t c_meshPackVersion = 1;
+
+struct MeshPackHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexFormat;
+	uint32_t indexFormat;
+	uint32_t vertexCount;
+	uint32_t vertexStreamOffsets[c_maxVertexSlots];
+	uint32_t meshCount;
+	uint32_t levelCount;
+	uint32_t rangeCount;
+	uint32_t indexCount;
+	uint32_t reserved;
+	uint64_t vertexBytes;
+	uint64_t meshOffset;	// from the start of the file
+	uint64_t levelOffset;
+	uint64_t rangeOffset;
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+bool WriteMeshPack(MeshPack const& pack, std::string const& fileName);
+bool ReadMeshPack(MeshPack& pack, std::string const& fileName);
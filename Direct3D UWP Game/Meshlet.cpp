@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "Meshlet.h"
+#include "Parallel.h"
+
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::pmr::vector<unsigned int>& meshletVertices, std::pmr::vector<uint8_t>& meshletTriangles,
+	const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	const unsigned int unassigned = ~0u;
+	size_t triangleCount = indexCount / 3;
+
+	meshlets.clear();
+	meshletVertices.clear();
+	meshletTriangles.resize(triangleCount * 3);
+
+	// Local index of every mesh vertex in the meshlet being filled.
+	std::vector<unsigned int> local(vertexCount, unassigned);
+	Meshlet current = { 0, 0, 0, 0 };
+
+	auto finish = [&]() {
+		for (unsigned int i = 0; i < current.vertexCount; i++)
+			local[meshletVertices[current.vertexOffset + i]] = unassigned;
+		meshlets.push_back(current);
+	};
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+		unsigned int added = (local[a] == unassigned) + (local[b] == unassigned && b != a) + (local[c] == unassigned && c != a && c != b);
+		if (current.vertexCount + added > c_meshletMaxVertices || current.triangleCount == c_meshletMaxTriangles)
+		{
+			finish();
+			current = { (unsigned int)meshletVertices.size(), (unsigned int)t, 0, 0 };
+		}
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int v = indices[t * 3 + k];
+			if (local[v] == unassigned)
+			{
+				local[v] = current.vertexCount++;
+				meshletVertices.push_back(v);
+			}
+			meshletTriangles[t * 3 + k] = (uint8_t)local[v];
+		}
+		current.triangleCount++;
+	}
+	if (current.triangleCount > 0) finish();
+}
+
+void ComputeMeshletBounds(MeshletBounds* bounds, const Meshlet* meshlets, size_t meshletCount,
+	const unsigned int* meshletVertices, const uint8_t* meshletTriangles, const float* positions, size_t positionStride)
+{
+	auto position = [&](unsigned int vertex) {
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride));
+	};
+
+	ParallelFor(meshletCount, [&](size_t m) {
+		Meshlet const& meshlet = meshlets[m];
+		const unsigned int* vertices = meshletVertices + meshlet.vertexOffset;
+		MeshletBounds& result = bounds[m];
+
+		// Sphere around the box centre: not minimal, but cheap and stable.
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+		{
+			boundsMin = XMVectorMin(boundsMin, position(vertices[i]));
+			boundsMax = XMVectorMax(boundsMax, position(vertices[i]));
+		}
+		XMVECTOR center = XMVectorScale(XMVectorAdd(boundsMin, boundsMax), 0.5f);
+		float radiusSq = 0.0f;
+		for (unsigned int i = 0; i < meshlet.vertexCount; i++)
+			radiusSq = std::max(radiusSq, XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(position(vertices[i]), center))));
+		XMStoreFloat3(&result.center, center);
+		result.radius = sqrtf(radiusSq);
+
+		// Cone axis: mean of the unit face normals; the widest normal sets the cutoff.
+		const uint8_t* triangles = meshletTriangles + size_t(meshlet.triangleOffset) * 3;
+		std::vector<XMVECTOR> normals;
+		normals.reserve(meshlet.triangleCount);
+		XMVECTOR axis = XMVectorZero();
+		for (unsigned int t = 0; t < meshlet.triangleCount; t++)
+		{
+			XMVECTOR p0 = position(vertices[triangles[t * 3]]);
+			XMVECTOR p1 = position(vertices[triangles[t * 3 + 1]]);
+			XMVECTOR p2 = position(vertices[triangles[t * 3 + 2]]);
+			XMVECTOR n = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float length = XMVectorGetX(XMVector3Length(n));
+			if (length == 0.0f) continue;
+			n = XMVectorScale(n, 1.0f / length);
+			normals.push_back(n);
+			axis = XMVectorAdd(axis, n);
+		}
+
+		result.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		result.coneCutoff = 1.0f;
+		float axisLength = XMVectorGetX(XMVector3Length(axis));
+		if (axisLength == 0.0f) return;
+		axis = XMVectorScale(axis, 1.0f / axisLength);
+		XMStoreFloat3(&result.coneAxis, axis);
+
+		float minDot = 1.0f;
+		for (XMVECTOR const& n : normals)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+		if (minDot > 0.0f)
+			result.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	});
+}
+
+MeshletView GetMeshletView(XMFLOAT4X4 const& worldViewProjection, XMFLOAT3 const& cameraPosition)
+{
+	// Gribb & Hartmann: clip = p * M, so the planes are sums of the matrix columns
+	// (D3D clip space, 0 <= z <= w).
+	XMFLOAT4X4 const& m = worldViewProjection;
+	auto column = [&m](int j) { return XMFLOAT4(m.m[0][j], m.m[1][j], m.m[2][j], m.m[3][j]); };
+	auto add = [](XMFLOAT4 const& a, XMFLOAT4 const& b, float sign) { return XMFLOAT4(a.x + sign * b.x, a.y + sign * b.y, a.z + sign * b.z, a.w + sign * b.w); };
+
+	XMFLOAT4 c0 = column(0), c1 = column(1), c2 = column(2), c3 = column(3);
+	MeshletView view;
+	view.planes[0] = add(c3, c0, 1.0f);		// left
+	view.planes[1] = add(c3, c0, -1.0f);	// right
+	view.planes[2] = add(c3, c1, 1.0f);		// bottom
+	view.planes[3] = add(c3, c1, -1.0f);	// top
+	view.planes[4] = c2;					// near
+	view.planes[5] = add(c3, c2, -1.0f);	// far
+	for (XMFLOAT4& plane : view.planes)
+	{
+		float length = sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		if (length > 0.0f)
+			plane = XMFLOAT4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+	view.cameraPosition = cameraPosition;
+	return view;
+}
+
+bool IsSphereVisible(XMFLOAT3 const& c, float radius, MeshletView const& view)
+{
+	for (XMFLOAT4 const& plane : view.planes)
+		if (plane.x * c.x + plane.y * c.y + plane.z * c.z + plane.w < -radius)
+			return false;
+	return true;
+}
+
+bool IsMeshletVisible(MeshletBounds const& bounds, MeshletView const& view)
+{
+	XMFLOAT3 const& c = bounds.center;
+	if (!IsSphereVisible(c, bounds.radius, view))
+		return false;
+
+	// Every triangle faces away when the view direction towards the sphere stays inside
+	// the cone widened by 90 degrees.
+	XMFLOAT3 d(c.x - view.cameraPosition.x, c.y - view.cameraPosition.y, c.z - view.cameraPosition.z);
+	float distance = sqrtf(d.x * d.x + d.y * d.y + d.z * d.z);
+	float along = d.x * bounds.coneAxis.x + d.y * bounds.coneAxis.y + d.z * bounds.coneAxis.z;
+	return along < bounds.coneCutoff * distance + bounds.radius;
+}
+
+void CullMeshlets(std::vector<IndexRange>& draws, const Meshlet* meshlets, const MeshletBounds* bounds, size_t meshletCount,
+	MeshletView const& view, std::vector<IndexRange> const& ranges)
+{
+	draws.clear();
+
+	// Current run of visible triangles, [first, last).
+	unsigned int first = 0, last = 0;
+	auto flush = [&]() {
+		for (IndexRange const& range : ranges)
+		{
+			unsigned int begin = std::max(first * 3, range.startIndex);
+			unsigned int end = std::min(last * 3, range.startIndex + range.indexCount);
+			if (begin < end) draws.push_back({ begin, end - begin, range.baseVertex });
+		}
+	};
+
+	for (size_t m = 0; m < meshletCount; m++)
+	{
+		if (!IsMeshletVisible(bounds[m], view)) continue;
+		if (first < last && meshlets[m].triangleOffset == last)
+			last += meshlets[m].triangleCount;
+		else
+		{
+			if (first < last) flush();
+			first = meshlets[m].triangleOffset;
+			last = first + meshlets[m].triangleCount;
+		}
+	}
+	if (first < last) flush();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+#include "IndexBuffer.h"
+
+using namespace DirectX;
+
+// Meshlets: small clusters of triangles with their own vertex list, bounding sphere
+// and normal cone, for per-cluster culling.
+//
+// Triangles are grouped in index buffer order, which the vertex cache pass already
+// made spatially coherent, so every meshlet is a contiguous run of the index buffer:
+// visible meshlets are drawn with plain DrawIndexedInstanced calls today, and the
+// local vertex/triangle lists are ready for mesh shaders later.
+
+static const unsigned int c_meshletMaxVertices = 64;
+static const unsigned int c_meshletMaxTriangles = 124;
+
+struct Meshlet {
+	unsigned int vertexOffset;		// first entry in the meshlet vertex list
+	unsigned int triangleOffset;	// first triangle in the index buffer and in the local triangle list
+	unsigned int vertexCount;
+	unsigned int triangleCount;
+};
+
+// Object space bounds. The cone holds the normals of every triangle in the meshlet:
+// coneCutoff is the sine of its half angle, 1 or more when the cone is too wide to cull.
+struct MeshletBounds {
+	XMFLOAT3 center;
+	float radius;
+	XMFLOAT3 coneAxis;
+	float coneCutoff;
+};
+
+// Splits a triangle list into meshlets. meshletVertices receives the mesh vertex of
+// every local vertex; meshletTriangles three local indices per triangle, in the same
+// triangle order as indices.
+void BuildMeshlets(std::vector<Meshlet>& meshlets, std::pmr::vector<unsigned int>& meshletVertices, std::pmr::vector<uint8_t>& meshletTriangles,
+	const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+void ComputeMeshletBounds(MeshletBounds* bounds, const Meshlet* meshlets, size_t meshletCount,
+	const unsigned int* meshletVertices, const uint8_t* meshletTriangles, const float* positions, size_t positionStride);
+
+// Camera in the mesh's object space: frustum planes (inside when dot(xyz, p) + w >= 0)
+// extracted from world * view * projection, and the camera position.
+struct MeshletView {
+	XMFLOAT4 planes[6];
+	XMFLOAT3 cameraPosition;
+};
+
+MeshletView GetMeshletView(XMFLOAT4X4 const& worldViewProjection, XMFLOAT3 const& cameraPosition);
+
+// False when the sphere is completely outside one of the frustum planes.
+bool IsSphereVisible(XMFLOAT3 const& center, float radius, MeshletView const& view);
+
+// False when the bounding sphere is outside the frustum or every triangle faces away.
+bool IsMeshletVisible(MeshletBounds const& bounds, MeshletView const& view);
+
+// Draw list for the visible meshlets: consecutive visible meshlets are merged, and the
+// runs are clipped against the index buffer ranges so each draw keeps its baseVertex.
+void CullMeshlets(std::vector<IndexRange>& draws, const Meshlet* meshlets, const MeshletBounds* bounds, size_t meshletCount,
+	MeshletView const& view, std::vector<IndexRange> const& ranges);
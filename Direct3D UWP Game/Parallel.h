@@ -0,0 +1,36 @@
+#pragma once
+#include "pch.h"
+#include <atomic>
+#include <thread>
+
+// Number of worker tasks the CPU side processing stages split their work into.
+inline unsigned int GetWorkerCount()
+{
+	// Queried once: hardware_concurrency can cost a system call, and ParallelFor asks often.
+	static const unsigned int count = std::max(std::thread::hardware_concurrency(), 1u);
+	return count;
+}
+
+// Runs func(i) for every i in [0, count) on up to GetWorkerCount() tasks. Items are
+// handed out dynamically, so uneven items balance themselves. Blocks until done.
+template <typename Func>
+void ParallelFor(size_t count, Func&& func)
+{
+	size_t workers = std::min<size_t>(count, GetWorkerCount());
+	if (workers <= 1)
+	{
+		for (size_t i = 0; i < count; i++) func(i);
+		return;
+	}
+
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]() {
+		for (size_t i = next++; i < count; i = next++) func(i);
+	};
+
+	std::vector<std::future<void>> tasks;
+	for (size_t w = 1; w < workers; w++)
+		tasks.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto& task : tasks) task.get();
+}
@@ -0,0 +1,322 @@
+#include "pch.h"
+#include "RayQuery.h"
+#include "Bvh.h"
+#include "Parallel.h"
+
+namespace
+{
+	inline XMVECTOR Load4(const float* p) { return XMLoadFloat4A(reinterpret_cast<const XMFLOAT4A*>(p)); }
+	inline float Lane(XMFLOAT4A const& v, unsigned int lane) { return (&v.x)[lane]; }
+
+	unsigned int LaneMask(FXMVECTOR condition)
+	{
+		uint32_t lanes[4];
+		XMStoreInt4(lanes, condition);
+		return (lanes[0] ? 1u : 0u) | (lanes[1] ? 2u : 0u) | (lanes[2] ? 4u : 0u) | (lanes[3] ? 8u : 0u);
+	}
+
+	// Per ray constants, splatted once.
+	struct RaySetup {
+		XMVECTOR ox, oy, oz;
+		XMVECTOR dx, dy, dz;
+		XMVECTOR ix, iy, iz;		// inverse direction
+		unsigned int nearPlane[3];	// slab the ray enters through: 0..2 = min, 3..5 = max
+	};
+
+	RaySetup Setup(Ray const& ray)
+	{
+		// Zero components get a huge finite inverse, so 0 * inverse never produces a NaN.
+		auto inverse = [](float d) { return d != 0.0f ? 1.0f / d : (std::signbit(d) ? -1e30f : 1e30f); };
+
+		RaySetup r;
+		r.ox = XMVectorReplicate(ray.origin.x);
+		r.oy = XMVectorReplicate(ray.origin.y);
+		r.oz = XMVectorReplicate(ray.origin.z);
+		r.dx = XMVectorReplicate(ray.direction.x);
+		r.dy = XMVectorReplicate(ray.direction.y);
+		r.dz = XMVectorReplicate(ray.direction.z);
+		r.ix = XMVectorReplicate(inverse(ray.direction.x));
+		r.iy = XMVectorReplicate(inverse(ray.direction.y));
+		r.iz = XMVectorReplicate(inverse(ray.direction.z));
+		r.nearPlane[0] = std::signbit(ray.direction.x) ? 3 : 0;
+		r.nearPlane[1] = std::signbit(ray.direction.y) ? 4 : 1;
+		r.nearPlane[2] = std::signbit(ray.direction.z) ? 5 : 2;
+		return r;
+	}
+
+	// Slab test of the four child boxes. Choosing the near and far planes from the ray
+	// direction (rather than min/max of both) also rejects the inverted empty slots.
+	unsigned int IntersectBoxes(RayBvhNode const& node, RaySetup const& r, float tMin, float tMax, XMFLOAT4A& entry)
+	{
+		const float* planes[6] = { node.minX, node.minY, node.minZ, node.maxX, node.maxY, node.maxZ };
+		auto slab = [&](unsigned int plane, FXMVECTOR origin, FXMVECTOR inverse) {
+			return XMVectorMultiply(XMVectorSubtract(Load4(planes[plane]), origin), inverse);
+		};
+		XMVECTOR nearX = slab(r.nearPlane[0], r.ox, r.ix), farX = slab((r.nearPlane[0] + 3) % 6, r.ox, r.ix);
+		XMVECTOR nearY = slab(r.nearPlane[1], r.oy, r.iy), farY = slab((r.nearPlane[1] + 3) % 6, r.oy, r.iy);
+		XMVECTOR nearZ = slab(r.nearPlane[2], r.oz, r.iz), farZ = slab((r.nearPlane[2] + 3) % 6, r.oz, r.iz);
+
+		XMVECTOR tNear = XMVectorMax(XMVectorMax(nearX, nearY), XMVectorMax(nearZ, XMVectorReplicate(tMin)));
+		XMVECTOR tFar = XMVectorMin(XMVectorMin(farX, farY), XMVectorMin(farZ, XMVectorReplicate(tMax)));
+		XMStoreFloat4A(&entry, tNear);
+		return LaneMask(XMVectorLessOrEqual(tNear, tFar));
+	}
+
+	// Moller-Trumbore on four triangles; both sides count as hits.
+	unsigned int IntersectBlock(TriangleBlock const& block, RaySetup const& r, float tMin, float tMax, XMFLOAT4A& t, XMFLOAT4A& u, XMFLOAT4A& v)
+	{
+		XMVECTOR e1x = Load4(block.e1x), e1y = Load4(block.e1y), e1z = Load4(block.e1z);
+		XMVECTOR e2x = Load4(block.e2x), e2y = Load4(block.e2y), e2z = Load4(block.e2z);
+
+		// p = d x e2, det = e1 . p
+		XMVECTOR px = XMVectorSubtract(XMVectorMultiply(r.dy, e2z), XMVectorMultiply(r.dz, e2y));
+		XMVECTOR py = XMVectorSubtract(XMVectorMultiply(r.dz, e2x), XMVectorMultiply(r.dx, e2z));
+		XMVECTOR pz = XMVectorSubtract(XMVectorMultiply(r.dx, e2y), XMVectorMultiply(r.dy, e2x));
+		XMVECTOR det = XMVectorMultiplyAdd(e1x, px, XMVectorMultiplyAdd(e1y, py, XMVectorMultiply(e1z, pz)));
+		XMVECTOR inverseDet = XMVectorReciprocal(det);
+
+		// s = o - v0, q = s x e1
+		XMVECTOR sx = XMVectorSubtract(r.ox, Load4(block.v0x));
+		XMVECTOR sy = XMVectorSubtract(r.oy, Load4(block.v0y));
+		XMVECTOR sz = XMVectorSubtract(r.oz, Load4(block.v0z));
+		XMVECTOR qx = XMVectorSubtract(XMVectorMultiply(sy, e1z), XMVectorMultiply(sz, e1y));
+		XMVECTOR qy = XMVectorSubtract(XMVectorMultiply(sz, e1x), XMVectorMultiply(sx, e1z));
+		XMVECTOR qz = XMVectorSubtract(XMVectorMultiply(sx, e1y), XMVectorMultiply(sy, e1x));
+
+		XMVECTOR uu = XMVectorMultiply(XMVectorMultiplyAdd(sx, px, XMVectorMultiplyAdd(sy, py, XMVectorMultiply(sz, pz))), inverseDet);
+		XMVECTOR vv = XMVectorMultiply(XMVectorMultiplyAdd(r.dx, qx, XMVectorMultiplyAdd(r.dy, qy, XMVectorMultiply(r.dz, qz))), inverseDet);
+		XMVECTOR tt = XMVectorMultiply(XMVectorMultiplyAdd(e2x, qx, XMVectorMultiplyAdd(e2y, qy, XMVectorMultiply(e2z, qz))), inverseDet);
+
+		// Padding triangles have zero edges, so det == 0 rejects them too.
+		XMVECTOR zero = XMVectorZero();
+		XMVECTOR hit = XMVectorGreater(XMVectorAbs(det), zero);
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(uu, zero));
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(vv, zero));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAdd(uu, vv), XMVectorReplicate(1.0f)));
+		hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(tt, XMVectorReplicate(tMin)));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(tt, XMVectorReplicate(tMax)));
+
+		XMStoreFloat4A(&t, tt);
+		XMStoreFloat4A(&u, uu);
+		XMStoreFloat4A(&v, vv);
+		return LaneMask(hit);
+	}
+
+	struct StackEntry {
+		unsigned int node;
+		float t;	// entry distance of the node's box
+	};
+
+	// Shared traversal; the any-hit query returns at the first hit it finds.
+	template <bool anyHit>
+	bool Traverse(RayBvh const& bvh, Ray const& ray, RayHit& hit)
+	{
+		hit = { ray.tMax, c_noHit, 0.0f, 0.0f };
+		if (bvh.nodes.empty()) return false;
+
+		RaySetup r = Setup(ray);
+		thread_local std::vector<StackEntry> stack;
+		stack.clear();
+		stack.push_back({ 0, ray.tMin });
+
+		while (!stack.empty())
+		{
+			StackEntry current = stack.back();
+			stack.pop_back();
+			if (current.t > hit.t) continue;
+
+			RayBvhNode const& node = bvh.nodes[current.node];
+			XMFLOAT4A entry;
+			unsigned int mask = IntersectBoxes(node, r, ray.tMin, hit.t, entry);
+
+			// Leaves are tested on the spot; inner children are pushed far to near.
+			StackEntry children[4];
+			unsigned int childCount = 0;
+			for (unsigned int lane = 0; lane < 4; lane++)
+			{
+				if (!(mask & (1u << lane))) continue;
+				if (node.blockCount[lane] == 0)
+				{
+					StackEntry child = { node.child[lane], Lane(entry, lane) };
+					unsigned int k = childCount++;
+					for (; k > 0 && children[k - 1].t < child.t; k--) children[k] = children[k - 1];
+					children[k] = child;
+					continue;
+				}
+
+				for (unsigned int b = node.child[lane]; b < node.child[lane] + node.blockCount[lane]; b++)
+				{
+					XMFLOAT4A t, u, v;
+					unsigned int hits = IntersectBlock(bvh.blocks[b], r, ray.tMin, hit.t, t, u, v);
+					for (unsigned int k = 0; k < 4; k++)
+						if ((hits & (1u << k)) && Lane(t, k) <= hit.t)
+						{
+							hit = { Lane(t, k), bvh.blocks[b].triangle[k], Lane(u, k), Lane(v, k) };
+							if (anyHit) return true;
+						}
+				}
+			}
+			for (unsigned int k = 0; k < childCount; k++) stack.push_back(children[k]);
+		}
+		return hit.triangle != c_noHit;
+	}
+}
+
+void BuildRayBvh(RayBvh& bvh, const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride)
+{
+	bvh.nodes.clear();
+	bvh.blocks.clear();
+
+	Bvh binary;
+	BuildBvh(binary, indices, indexCount, positions, positionStride, 4);
+	if (binary.nodes.empty()) return;
+
+	auto position = [&](unsigned int vertex) {
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride));
+	};
+	auto halfArea = [](BvhNode const& node) {
+		float dx = node.boundsMax.x - node.boundsMin.x, dy = node.boundsMax.y - node.boundsMin.y, dz = node.boundsMax.z - node.boundsMin.z;
+		return dx * dy + dy * dz + dz * dx;
+	};
+
+	// Each wide node takes up to four binary nodes, opening the largest interior one first.
+	std::vector<std::pair<unsigned int, unsigned int>> work = { { 0, 0 } };
+	bvh.nodes.resize(1);
+	while (!work.empty())
+	{
+		unsigned int source = work.back().first, target = work.back().second;
+		work.pop_back();
+
+		std::vector<unsigned int> children;
+		if (binary.nodes[source].IsLeaf())
+			children.push_back(source);
+		else
+			children = { binary.nodes[source].first, binary.nodes[source].first + 1 };
+		while (children.size() < 4)
+		{
+			int largest = -1;
+			for (size_t i = 0; i < children.size(); i++)
+				if (!binary.nodes[children[i]].IsLeaf() && (largest < 0 || halfArea(binary.nodes[children[i]]) > halfArea(binary.nodes[children[largest]])))
+					largest = int(i);
+			if (largest < 0) break;
+			unsigned int first = binary.nodes[children[largest]].first;
+			children[largest] = first;
+			children.push_back(first + 1);
+		}
+
+		RayBvhNode node = {};
+		for (unsigned int lane = 0; lane < 4; lane++)
+		{
+			if (lane >= children.size())
+			{
+				node.minX[lane] = node.minY[lane] = node.minZ[lane] = FLT_MAX;
+				node.maxX[lane] = node.maxY[lane] = node.maxZ[lane] = -FLT_MAX;
+				continue;
+			}
+
+			BvhNode const& child = binary.nodes[children[lane]];
+			node.minX[lane] = child.boundsMin.x;
+			node.minY[lane] = child.boundsMin.y;
+			node.minZ[lane] = child.boundsMin.z;
+			node.maxX[lane] = child.boundsMax.x;
+			node.maxY[lane] = child.boundsMax.y;
+			node.maxZ[lane] = child.boundsMax.z;
+
+			if (!child.IsLeaf())
+			{
+				node.child[lane] = (unsigned int)bvh.nodes.size();
+				bvh.nodes.emplace_back();
+				work.push_back({ children[lane], node.child[lane] });
+				continue;
+			}
+
+			node.child[lane] = (unsigned int)bvh.blocks.size();
+			node.blockCount[lane] = (child.count + 3) / 4;
+			for (unsigned int b = 0; b < node.blockCount[lane]; b++)
+			{
+				TriangleBlock block = {};
+				for (unsigned int k = 0; k < 4; k++)
+				{
+					unsigned int i = b * 4 + k;
+					block.triangle[k] = c_noHit;
+					if (i >= child.count) continue;
+
+					unsigned int triangle = binary.triangles[child.first + i];
+					XMVECTOR p0 = position(indices[triangle * 3]);
+					XMFLOAT3 v0, e1, e2;
+					XMStoreFloat3(&v0, p0);
+					XMStoreFloat3(&e1, XMVectorSubtract(position(indices[triangle * 3 + 1]), p0));
+					XMStoreFloat3(&e2, XMVectorSubtract(position(indices[triangle * 3 + 2]), p0));
+					block.v0x[k] = v0.x; block.v0y[k] = v0.y; block.v0z[k] = v0.z;
+					block.e1x[k] = e1.x; block.e1y[k] = e1.y; block.e1z[k] = e1.z;
+					block.e2x[k] = e2.x; block.e2y[k] = e2.y; block.e2z[k] = e2.z;
+					block.triangle[k] = triangle;
+				}
+				bvh.blocks.push_back(block);
+			}
+		}
+		bvh.nodes[target] = node;
+	}
+}
+
+bool IntersectClosest(RayBvh const& bvh, Ray const& ray, RayHit& hit)
+{
+	return Traverse<false>(bvh, ray, hit);
+}
+
+bool IntersectAny(RayBvh const& bvh, Ray const& ray)
+{
+	RayHit hit;
+	return Traverse<true>(bvh, ray, hit);
+}
+
+void IntersectClosest(RayBvh const& bvh, const Ray* rays, RayHit* hits, size_t rayCount)
+{
+	const size_t batchSize = 1024;
+	ParallelFor((rayCount + batchSize - 1) / batchSize, [&](size_t batch) {
+		size_t end = std::min(rayCount, (batch + 1) * batchSize);
+		for (size_t i = batch * batchSize; i < end; i++)
+			IntersectClosest(bvh, rays[i], hits[i]);
+	});
+}
+
+void IntersectAny(RayBvh const& bvh, const Ray* rays, uint8_t* occluded, size_t rayCount)
+{
+	const size_t batchSize = 1024;
+	ParallelFor((rayCount + batchSize - 1) / batchSize, [&](size_t batch) {
+		size_t end = std::min(rayCount, (batch + 1) * batchSize);
+		for (size_t i = batch * batchSize; i < end; i++)
+			occluded[i] = IntersectAny(bvh, rays[i]) ? 1 : 0;
+	});
+}
+
+bool IntersectClosestBruteForce(const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride,
+	Ray const& ray, RayHit& hit)
+{
+	auto position = [&](unsigned int vertex) {
+		return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride);
+	};
+	XMFLOAT3 const& o = ray.origin;
+	XMFLOAT3 const& d = ray.direction;
+
+	hit = { ray.tMax, c_noHit, 0.0f, 0.0f };
+	for (size_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMFLOAT3 p0 = position(indices[i]), p1 = position(indices[i + 1]), p2 = position(indices[i + 2]);
+		XMFLOAT3 e1(p1.x - p0.x, p1.y - p0.y, p1.z - p0.z);
+		XMFLOAT3 e2(p2.x - p0.x, p2.y - p0.y, p2.z - p0.z);
+		XMFLOAT3 p(d.y * e2.z - d.z * e2.y, d.z * e2.x - d.x * e2.z, d.x * e2.y - d.y * e2.x);
+		float det = e1.x * p.x + e1.y * p.y + e1.z * p.z;
+		if (det == 0.0f) continue;
+		float inverseDet = 1.0f / det;
+
+		XMFLOAT3 s(o.x - p0.x, o.y - p0.y, o.z - p0.z);
+		XMFLOAT3 q(s.y * e1.z - s.z * e1.y, s.z * e1.x - s.x * e1.z, s.x * e1.y - s.y * e1.x);
+		float u = (s.x * p.x + s.y * p.y + s.z * p.z) * inverseDet;
+		float v = (d.x * q.x + d.y * q.y + d.z * q.z) * inverseDet;
+		float t = (e2.x * q.x + e2.y * q.y + e2.z * q.z) * inverseDet;
+		if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= ray.tMin && t <= hit.t)
+			hit = { t, (unsigned int)(i / 3), u, v };
+	}
+	return hit.triangle != c_noHit;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "pch.h"
+
+using namespace DirectX;
+
+// Ray queries against the triangles of an indexed mesh.
+//
+// The acceleration structure is a 4-wide BVH collapsed from the binary SAH tree of
+// Bvh.h: every node stores the boxes of its four children side by side, so one ray is
+// tested against all of them at once, and leaves store their triangles in blocks of
+// four (vertex and two edges, component-wise) for a 4-wide Moller-Trumbore test. The
+// kernels use DirectXMath vectors, which map to SSE on x86/x64 and NEON on ARM.
+
+static const unsigned int c_noHit = ~0u;
+
+struct Ray {
+	XMFLOAT3 origin;
+	XMFLOAT3 direction;	// need not be normalized; t is measured in direction lengths
+	float tMin;
+	float tMax;
+};
+
+struct RayHit {
+	float t;
+	unsigned int triangle;	// first index / 3, or c_noHit
+	float u, v;				// barycentrics of vertices 1 and 2
+};
+
+struct alignas(16) RayBvhNode {
+	float minX[4], minY[4], minZ[4];
+	float maxX[4], maxY[4], maxZ[4];	// empty slots have min > max and are never entered
+	unsigned int child[4];		// interior child: node index; leaf child: first triangle block
+	unsigned int blockCount[4];	// triangle blocks of a leaf child, 0 for interior ones
+};
+
+struct alignas(16) TriangleBlock {
+	float v0x[4], v0y[4], v0z[4];
+	float e1x[4], e1y[4], e1z[4];
+	float e2x[4], e2y[4], e2z[4];
+	unsigned int triangle[4];	// c_noHit pads the last block of a leaf
+};
+
+struct RayBvh {
+	std::vector<RayBvhNode> nodes;	// nodes[0] is the root
+	std::vector<TriangleBlock> blocks;
+};
+
+void BuildRayBvh(RayBvh& bvh, const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride);
+
+// Closest hit along [tMin, tMax]; hit.triangle is c_noHit when nothing is hit.
+bool IntersectClosest(RayBvh const& bvh, Ray const& ray, RayHit& hit);
+// Whether anything is hit at all; stops at the first hit found.
+bool IntersectAny(RayBvh const& bvh, Ray const& ray);
+
+// Batches for tools: rays are spread over the worker tasks.
+void IntersectClosest(RayBvh const& bvh, const Ray* rays, RayHit* hits, size_t rayCount);
+void IntersectAny(RayBvh const& bvh, const Ray* rays, uint8_t* occluded, size_t rayCount);
+
+// Reference: tests every triangle in turn. Same hit rules as IntersectClosest.
+bool IntersectClosestBruteForce(const unsigned int* indices, size_t indexCount, const float* positions, size_t positionStride,
+	Ray const& ray, RayHit& hit);
@@ -0,0 +1,308 @@
+#include "pch.h"
+#include "Simplify.h"
+#include "VertexWeld.h"
+#include "VertexRemap.h"
+#include "Parallel.h"
+
+namespace
+{
+	enum VertexKind : uint8_t {
+		Manifold,	// may collapse onto any neighbour
+		Border,		// on one open border loop, collapses along it
+		Locked,		// seam, non-manifold or border junction: never moves
+	};
+
+	// Border planes are weighted up so silhouettes of open meshes hold their shape.
+	const double c_borderWeight = 10.0;
+
+	struct Point {
+		double x, y, z;
+	};
+
+	inline Point Sub(Point const& a, Point const& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	inline Point Cross(Point const& a, Point const& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+	inline double Dot(Point const& a, Point const& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+	// Sum of squared distances to a set of weighted planes: p'Ap + 2b'p + c.
+	struct Quadric {
+		double a00, a11, a22, a10, a20, a21;
+		double b0, b1, b2;
+		double c;
+		double weight;
+	};
+
+	void AddPlane(Quadric& q, Point const& n, double d, double weight)
+	{
+		q.a00 += weight * n.x * n.x;
+		q.a11 += weight * n.y * n.y;
+		q.a22 += weight * n.z * n.z;
+		q.a10 += weight * n.y * n.x;
+		q.a20 += weight * n.z * n.x;
+		q.a21 += weight * n.z * n.y;
+		q.b0 += weight * n.x * d;
+		q.b1 += weight * n.y * d;
+		q.b2 += weight * n.z * d;
+		q.c += weight * d * d;
+		q.weight += weight;
+	}
+
+	void AddQuadric(Quadric& q, Quadric const& r)
+	{
+		q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+		q.a10 += r.a10; q.a20 += r.a20; q.a21 += r.a21;
+		q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+		q.c += r.c;
+		q.weight += r.weight;
+	}
+
+	// Root of the weighted mean squared distance, i.e. a distance in mesh units.
+	float QuadricError(Quadric const& q, Point const& p)
+	{
+		double e = q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z
+			+ 2.0 * (q.a10 * p.x * p.y + q.a20 * p.x * p.z + q.a21 * p.y * p.z)
+			+ 2.0 * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+		return q.weight > 0.0 ? (float)sqrt(std::max(e, 0.0) / q.weight) : 0.0f;
+	}
+
+	struct Collapse {
+		unsigned int from;
+		unsigned int to;
+		float error;
+	};
+}
+
+size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* resultError)
+{
+	if (resultError) *resultError = 0.0f;
+	size_t count = indexCount - indexCount % 3;
+	std::copy(indices, indices + count, destination);
+	if (count == 0 || vertexCount == 0) return count;
+
+	// Positions scaled into the unit cube, so errors come out relative to the extent.
+	std::vector<Point> points(vertexCount);
+	Point boundsMin = { DBL_MAX, DBL_MAX, DBL_MAX };
+	Point boundsMax = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + i * positionStride);
+		points[i] = { p[0], p[1], p[2] };
+		boundsMin = { std::min(boundsMin.x, points[i].x), std::min(boundsMin.y, points[i].y), std::min(boundsMin.z, points[i].z) };
+		boundsMax = { std::max(boundsMax.x, points[i].x), std::max(boundsMax.y, points[i].y), std::max(boundsMax.z, points[i].z) };
+	}
+	double extent = std::max(std::max(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y), boundsMax.z - boundsMin.z);
+	double scale = extent > 0.0 ? 1.0 / extent : 1.0;
+	for (auto& p : points)
+		p = { (p.x - boundsMin.x) * scale, (p.y - boundsMin.y) * scale, (p.z - boundsMin.z) * scale };
+
+	// Vertices that share their position with another one sit on an attribute seam.
+	std::vector<VertexKind> kinds(vertexCount, Manifold);
+	{
+		WeldStream stream = { positions, positionStride, 3, 0.0f };
+		std::vector<unsigned int> positionIds(vertexCount);
+		BuildWeldRemap(positionIds.data(), &stream, 1, vertexCount, 1);
+		std::vector<unsigned int> wedges(vertexCount, 0);
+		for (unsigned int id : positionIds) wedges[id]++;
+		for (size_t i = 0; i < vertexCount; i++)
+			if (wedges[positionIds[i]] > 1) kinds[i] = Locked;
+	}
+
+	// Triangles around every vertex (first index of each), rebuilt after each pass.
+	std::vector<unsigned int> adjacencyStart(vertexCount + 1);
+	std::vector<unsigned int> adjacency;
+	auto buildAdjacency = [&]() {
+		std::fill(adjacencyStart.begin(), adjacencyStart.end(), 0);
+		for (size_t i = 0; i < count; i++) adjacencyStart[destination[i] + 1]++;
+		for (size_t v = 0; v < vertexCount; v++) adjacencyStart[v + 1] += adjacencyStart[v];
+		adjacency.resize(count);
+		std::vector<unsigned int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+		for (size_t i = 0; i < count; i++) adjacency[fill[destination[i]]++] = (unsigned int)(i - i % 3);
+	};
+
+	// Number of triangles using the directed edge a -> b.
+	auto edgeCount = [&](unsigned int a, unsigned int b) {
+		unsigned int n = 0;
+		for (unsigned int t = adjacencyStart[a]; t < adjacencyStart[a + 1]; t++)
+		{
+			const unsigned int* tri = destination + adjacency[t];
+			n += (tri[0] == a && tri[1] == b) || (tri[1] == a && tri[2] == b) || (tri[2] == a && tri[0] == b);
+		}
+		return n;
+	};
+	// Open edges have no triangle using them the other way round.
+	auto isOpen = [&](unsigned int a, unsigned int b) { return edgeCount(b, a) == 0; };
+
+	// An edge used twice in the same direction is non-manifold.
+	buildAdjacency();
+	{
+		std::vector<uint8_t> openOut(vertexCount, 0), openIn(vertexCount, 0);
+		for (size_t i = 0; i < count; i += 3)
+			for (size_t k = 0; k < 3; k++)
+			{
+				unsigned int a = destination[i + k], b = destination[i + (k + 1) % 3];
+				if (edgeCount(a, b) > 1)
+					kinds[a] = kinds[b] = Locked;
+				if (isOpen(a, b))
+				{
+					openOut[a] = (uint8_t)std::min(openOut[a] + 1, 2);
+					openIn[b] = (uint8_t)std::min(openIn[b] + 1, 2);
+				}
+			}
+		for (size_t i = 0; i < vertexCount; i++)
+			if (kinds[i] == Manifold && (openOut[i] || openIn[i]))
+				kinds[i] = openOut[i] == 1 && openIn[i] == 1 ? Border : Locked;
+	}
+
+	// Area weighted face planes, plus planes through open edges perpendicular to their face.
+	std::vector<Quadric> quadrics(vertexCount, Quadric{});
+	for (size_t i = 0; i < count; i += 3)
+	{
+		Point const& p0 = points[destination[i]];
+		Point n = Cross(Sub(points[destination[i + 1]], p0), Sub(points[destination[i + 2]], p0));
+		double length = sqrt(Dot(n, n));
+		if (length == 0.0) continue;
+		n = { n.x / length, n.y / length, n.z / length };
+		for (size_t k = 0; k < 3; k++)
+			AddPlane(quadrics[destination[i + k]], n, -Dot(n, p0), length * 0.5);
+
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int a = destination[i + k], b = destination[i + (k + 1) % 3];
+			if (!isOpen(a, b)) continue;
+			Point edge = Sub(points[b], points[a]);
+			Point side = Cross(edge, n);
+			double sideLength = sqrt(Dot(side, side));
+			if (sideLength == 0.0) continue;
+			side = { side.x / sideLength, side.y / sideLength, side.z / sideLength };
+			double weight = Dot(edge, edge) * c_borderWeight;
+			AddPlane(quadrics[a], side, -Dot(side, points[a]), weight);
+			AddPlane(quadrics[b], side, -Dot(side, points[a]), weight);
+		}
+	}
+
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<Collapse> best(vertexCount);
+	std::vector<Collapse> collapses;
+	float maxError = 0.0f;
+
+	// Collapsing from -> to must not turn any remaining triangle around from over.
+	auto flips = [&](unsigned int from, unsigned int to) {
+		for (unsigned int a = adjacencyStart[from]; a < adjacencyStart[from + 1]; a++)
+		{
+			const unsigned int* t = destination + adjacency[a];
+			if (t[0] == to || t[1] == to || t[2] == to) continue;
+
+			Point p[3], q[3];
+			for (size_t k = 0; k < 3; k++)
+			{
+				p[k] = points[t[k]];
+				q[k] = points[t[k] == from ? to : t[k]];
+			}
+			Point before = Cross(Sub(p[1], p[0]), Sub(p[2], p[0]));
+			Point after = Cross(Sub(q[1], q[0]), Sub(q[2], q[0]));
+			if (Dot(before, after) <= 0.25 * sqrt(Dot(before, before) * Dot(after, after))) return true;
+		}
+		return false;
+	};
+
+	// Each pass collapses the cheapest independent edges, then compacts the triangles.
+	while (count > targetIndexCount)
+	{
+		if (count != indexCount) buildAdjacency();
+
+		// Cheapest collapse of every vertex; interior edges are seen from one side only.
+		std::fill(best.begin(), best.end(), Collapse{ c_unusedVertex, c_unusedVertex, FLT_MAX });
+		for (size_t i = 0; i < count; i += 3)
+			for (size_t k = 0; k < 3; k++)
+			{
+				unsigned int a = destination[i + k], b = destination[i + (k + 1) % 3];
+				bool open = isOpen(a, b);
+				if (!open && a > b) continue;
+				for (unsigned int from : { a, b })
+				{
+					unsigned int to = from == a ? b : a;
+					if (kinds[from] == Locked || (kinds[from] == Border && !open)) continue;
+					Quadric q = quadrics[from];
+					AddQuadric(q, quadrics[to]);
+					float error = QuadricError(q, points[to]);
+					if (error < best[from].error) best[from] = { from, to, error };
+				}
+			}
+		collapses.clear();
+		for (Collapse const& c : best)
+			if (c.from != c_unusedVertex && c.error <= targetError) collapses.push_back(c);
+		std::sort(collapses.begin(), collapses.end(), [](Collapse const& x, Collapse const& y) { return x.error < y.error; });
+
+		for (size_t v = 0; v < vertexCount; v++) remap[v] = (unsigned int)v;
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t removable = (count - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t applied = 0;
+		for (Collapse const& c : collapses)
+		{
+			if (c.error > targetError || removed >= removable) break;
+			if (touched[c.from] || touched[c.to] || flips(c.from, c.to)) continue;
+
+			remap[c.from] = c.to;
+			AddQuadric(quadrics[c.to], quadrics[c.from]);
+			maxError = std::max(maxError, c.error);
+			applied++;
+
+			// Freeze the neighbourhood so collapses in the same pass stay independent.
+			for (unsigned int a = adjacencyStart[c.from]; a < adjacencyStart[c.from + 1]; a++)
+			{
+				const unsigned int* t = destination + adjacency[a];
+				if (t[0] == c.to || t[1] == c.to || t[2] == c.to) removed++;
+				touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+			}
+		}
+		if (applied == 0) break;
+
+		size_t kept = 0;
+		for (size_t i = 0; i < count; i += 3)
+		{
+			unsigned int a = remap[destination[i]], b = remap[destination[i + 1]], c = remap[destination[i + 2]];
+			if (a == b || b == c || c == a) continue;
+			destination[kept++] = a;
+			destination[kept++] = b;
+			destination[kept++] = c;
+		}
+		count = kept;
+	}
+
+	if (resultError) *resultError = maxError;
+	return count;
+}
+
+void BuildLodChain(std::pmr::vector<unsigned int>& lodIndices, std::vector<LodLevel>& levels,
+	const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	const LodTarget* targets, size_t targetCount)
+{
+	std::vector<std::vector<unsigned int>> results(targetCount);
+	levels.assign(targetCount, LodLevel{});
+
+	// Levels are independent of each other, so each one is a task of its own.
+	ParallelFor(targetCount, [&](size_t i) {
+		size_t targetIndexCount = size_t(double(indexCount / 3) * targets[i].ratio) * 3;
+		float error = 0.0f;
+		results[i].resize(indexCount);
+		results[i].resize(SimplifyMesh(results[i].data(), indices, indexCount, positions, vertexCount, positionStride,
+			targetIndexCount, targets[i].maxError, &error));
+		levels[i] = { targets[i].ratio, targets[i].maxError, error, 0, (unsigned int)results[i].size() };
+	});
+
+	size_t totalCount = 0;
+	for (size_t i = 0; i < targetCount; i++)
+		totalCount += results[i].size();
+
+	lodIndices.clear();
+	lodIndices.reserve(totalCount);
+	for (size_t i = 0; i < targetCount; i++)
+	{
+		levels[i].indexOffset = (unsigned int)lodIndices.size();
+		lodIndices.insert(lodIndices.end(), results[i].begin(), results[i].end());
+	}
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "pch.h"
+#include <memory_resource>
+
+// Quadric error metric simplification (Garland & Heckbert 1997) by half-edge collapse.
+//
+// A collapse moves a vertex onto one of its neighbours instead of to a new position,
+// so every level of detail is just another index list over the original vertex
+// buffer. Vertices sharing a position with another one (attribute seams) and
+// non-manifold vertices never move; open borders only collapse along themselves.
+// Errors are relative to the mesh extent: 1 is the largest side of the bounding box.
+
+// Simplifies a triangle list into destination (room for indexCount indices) until at
+// most targetIndexCount indices are left or the next collapse would exceed targetError.
+// Returns the new index count; resultError receives the largest error introduced.
+size_t SimplifyMesh(unsigned int* destination, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+struct LodTarget {
+	float ratio;	// triangles kept, relative to the full mesh
+	float maxError;	// relative error the level may not exceed
+};
+
+struct LodLevel {
+	float targetRatio;
+	float targetError;
+	float error;				// error actually introduced
+	unsigned int indexOffset;	// first index of the level in the LOD index list
+	unsigned int indexCount;
+};
+
+// Builds one level per target, each simplified from the full mesh, in parallel.
+// Their indices are appended to lodIndices in target order.
+void BuildLodChain(std::pmr::vector<unsigned int>& lodIndices, std::vector<LodLevel>& levels,
+	const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	const LodTarget* targets, size_t targetCount);
@@ -0,0 +1,56 @@
+#include "pch.h"
+#include "TextParsing.h"
+#include "Parallel.h"
+
+// Below this many bytes per chunk the thread start-up costs more than the parse.
+static const size_t c_minTextChunkBytes = 256 * 1024;
+
+size_t GetTextChunkCount(size_t bytes)
+{
+	size_t count = bytes / c_minTextChunkBytes + 1;
+	return std::min<size_t>(count, size_t(GetWorkerCount()) * 4);
+}
+
+std::vector<TextChunk> SplitTextIntoChunks(const char* begin, const char* end, size_t chunkCount)
+{
+	std::vector<TextChunk> chunks;
+	size_t size = end - begin;
+	chunkCount = std::max<size_t>(1, std::min(chunkCount, size));
+
+	// Move every nominal split point forward to the start of the next line.
+	const char* start = begin;
+	for (size_t c = 1; c <= chunkCount && start < end; c++)
+	{
+		const char* split = c == chunkCount ? end : begin + size * c / chunkCount;
+		if (split <= start) continue;
+		if (split < end) split = NextLine(split - 1, end);
+		chunks.push_back({ start, split, 0 });
+		start = split;
+	}
+
+	std::vector<size_t> newlines(chunks.size());
+	ParallelFor(chunks.size(), [&](size_t c) {
+		newlines[c] = std::count(chunks[c].begin, chunks[c].end, '\n');
+	});
+
+	size_t line = 0;
+	for (size_t c = 0; c < chunks.size(); c++)
+	{
+		chunks[c].firstLine = line;
+		line += newlines[c];
+	}
+	return chunks;
+}
+
+size_t CountTokens(const char* p, const char* end)
+{
+	size_t count = 0;
+	bool inToken = false;
+	for (; p < end; p++)
+	{
+		bool space = IsLineSpace(*p) || *p == '\n';
+		if (!space && !inToken) count++;
+		inToken = !space;
+	}
+	return count;
+}
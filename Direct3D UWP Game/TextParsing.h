@@ -0,0 +1,72 @@
+#pragma once
+#include "pch.h"
+#include <charconv>
+
+// Helpers for the multi-threaded text parsers. Everything works on an in-memory
+// [begin, end) range and uses std::from_chars, so no locale or stream state is involved.
+
+struct TextChunk {
+	const char* begin;
+	const char* end;
+	size_t firstLine;	// zero based line number of begin
+};
+
+// Splits [begin, end) into at most chunkCount pieces that start on line boundaries and
+// numbers the first line of each piece (newlines are counted in parallel).
+std::vector<TextChunk> SplitTextIntoChunks(const char* begin, const char* end, size_t chunkCount);
+
+// Picks a chunk count for a buffer of the given size: small files stay on one thread.
+size_t GetTextChunkCount(size_t bytes);
+
+inline bool IsLineSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* SkipLineSpaces(const char* p, const char* end)
+{
+	while (p < end && IsLineSpace(*p)) p++;
+	return p;
+}
+
+inline const char* SkipWhitespace(const char* p, const char* end)
+{
+	while (p < end && (IsLineSpace(*p) || *p == '\n')) p++;
+	return p;
+}
+
+// True when only spaces remain before the end of the line.
+inline bool AtLineEnd(const char* p, const char* end)
+{
+	p = SkipLineSpaces(p, end);
+	return p == end || *p == '\n';
+}
+
+// Returns the start of the line following p.
+inline const char* NextLine(const char* p, const char* end)
+{
+	const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+	return newline ? newline + 1 : end;
+}
+
+inline bool ParseFloat(const char*& p, const char* end, float& value)
+{
+	p = SkipWhitespace(p, end);
+	if (p < end && *p == '+') p++;
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+inline bool ParseUInt(const char*& p, const char* end, unsigned int& value)
+{
+	p = SkipWhitespace(p, end);
+	auto result = std::from_chars(p, end, value);
+	if (result.ec != std::errc()) return false;
+	p = result.ptr;
+	return true;
+}
+
+// Number of whitespace separated tokens in [p, end).
+size_t CountTokens(const char* p, const char* end);
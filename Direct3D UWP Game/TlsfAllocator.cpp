@@ -0,0 +1,248 @@
+#include "pch.h"
+#include "TlsfAllocator.h"
+#ifdef _WIN32
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// Index of the highest and lowest set bit; value is not zero.
+	unsigned int HighestBit(uint64_t value)
+	{
+#ifdef _WIN32
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return index;
+#else
+		return 63 - __builtin_clzll(value);
+#endif
+	}
+
+	unsigned int LowestBit(uint64_t value)
+	{
+#ifdef _WIN32
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return index;
+#else
+		return __builtin_ctzll(value);
+#endif
+	}
+
+	// Size class of a block of size granules: level 0 holds the sizes below
+	// c_tlsfSubdivisions one by one, level l > 0 the range [2^(l + 4), 2^(l + 5)) in
+	// c_tlsfSubdivisions equal lists.
+	void GetSizeClass(uint64_t size, unsigned int& level, unsigned int& list)
+	{
+		if (size < c_tlsfSubdivisions)
+		{
+			level = 0;
+			list = (unsigned int)(size);
+			return;
+		}
+		unsigned int log = HighestBit(size);
+		level = log - c_tlsfSubdivisionsLog2 + 1;
+		list = (unsigned int)(size >> (log - c_tlsfSubdivisionsLog2)) - c_tlsfSubdivisions;
+	}
+
+	// Smallest size whose class holds only blocks of at least size granules.
+	uint64_t RoundUpToSizeClass(uint64_t size)
+	{
+		if (size < c_tlsfSubdivisions)
+			return size;
+		uint64_t step = uint64_t(1) << (HighestBit(size) - c_tlsfSubdivisionsLog2);
+		return size + step - 1 < size ? size : size + step - 1;
+	}
+}
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+{
+	Reset(capacity, granularity);
+}
+
+void TlsfAllocator::Reset(uint64_t newCapacity, uint64_t newGranularity)
+{
+	granularity = std::max<uint64_t>(newGranularity, 1);
+	capacity = newCapacity / granularity * granularity;
+	blocks.clear();
+	unusedBlocks.clear();
+	levelBitmap = 0;
+	for (unsigned int level = 0; level < c_tlsfLevels; level++)
+	{
+		listBitmaps[level] = 0;
+		for (unsigned int list = 0; list < c_tlsfSubdivisions; list++)
+			freeLists[level][list] = c_none;
+	}
+	usedGranules = 0;
+	allocationCount = 0;
+	freeBlockCount = 0;
+
+	if (capacity == 0)
+		return;
+	uint32_t block = NewBlock();
+	blocks[block] = { 0, capacity / granularity, c_none, c_none, c_none, c_none, true };
+	InsertFree(block);
+}
+
+bool TlsfAllocator::Allocate(uint64_t size, TlsfAllocation& allocation)
+{
+	allocation = TlsfAllocation();
+	if (size == 0 || size > capacity)
+		return false;
+	uint64_t granules = (size + granularity - 1) / granularity;
+
+	// First non-empty list at or above the class of the rounded size: any block in it fits
+	uint32_t found = c_none;
+	unsigned int level, list;
+	GetSizeClass(RoundUpToSizeClass(granules), level, list);
+	uint32_t lists = listBitmaps[level] & (~0u << list);
+	uint64_t levels = level + 1 < 64 ? levelBitmap & (~uint64_t(0) << (level + 1)) : 0;
+	if (lists != 0 || levels != 0)
+	{
+		if (lists == 0)
+		{
+			level = LowestBit(levels);
+			lists = listBitmaps[level];
+		}
+		found = freeLists[level][LowestBit(lists)];
+	}
+	else
+	{
+		// Only the request's own class is left, where blocks may be smaller: look through it
+		GetSizeClass(granules, level, list);
+		for (uint32_t block = freeLists[level][list]; block != c_none && found == c_none; block = blocks[block].nextFree)
+			if (blocks[block].size >= granules)
+				found = block;
+		if (found == c_none)
+			return false;
+	}
+
+	RemoveFree(found);
+	blocks[found].isFree = false;
+
+	// The rest of the block goes back as a free block of its own
+	uint64_t remainder = blocks[found].size - granules;
+	if (remainder > 0)
+	{
+		uint32_t rest = NewBlock();	// may move blocks: index again below
+		Block& block = blocks[found];
+		blocks[rest] = { block.offset + granules * granularity, remainder, found, block.nextPhysical, c_none, c_none, true };
+		if (block.nextPhysical != c_none)
+			blocks[block.nextPhysical].prevPhysical = rest;
+		block.nextPhysical = rest;
+		block.size = granules;
+		InsertFree(rest);
+	}
+
+	usedGranules += granules;
+	allocationCount++;
+	allocation.offset = blocks[found].offset;
+	allocation.size = granules * granularity;
+	allocation.block = found;
+	return true;
+}
+
+void TlsfAllocator::Free(TlsfAllocation const& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+	uint32_t index = allocation.block;
+	usedGranules -= blocks[index].size;
+	allocationCount--;
+	blocks[index].isFree = true;
+
+	// Merge with the free neighbours; the merged ones give their slot back
+	uint32_t next = blocks[index].nextPhysical;
+	if (next != c_none && blocks[next].isFree)
+	{
+		RemoveFree(next);
+		blocks[index].size += blocks[next].size;
+		blocks[index].nextPhysical = blocks[next].nextPhysical;
+		if (blocks[next].nextPhysical != c_none)
+			blocks[blocks[next].nextPhysical].prevPhysical = index;
+		unusedBlocks.push_back(next);
+	}
+	uint32_t previous = blocks[index].prevPhysical;
+	if (previous != c_none && blocks[previous].isFree)
+	{
+		RemoveFree(previous);
+		blocks[previous].size += blocks[index].size;
+		blocks[previous].nextPhysical = blocks[index].nextPhysical;
+		if (blocks[index].nextPhysical != c_none)
+			blocks[blocks[index].nextPhysical].prevPhysical = previous;
+		unusedBlocks.push_back(index);
+		index = previous;
+	}
+	InsertFree(index);
+}
+
+TlsfStats TlsfAllocator::GetStats() const
+{
+	TlsfStats stats = {};
+	stats.capacity = capacity;
+	stats.usedBytes = usedGranules * granularity;
+	stats.freeBytes = capacity - stats.usedBytes;
+	stats.allocationCount = allocationCount;
+	stats.freeBlockCount = freeBlockCount;
+
+	// The largest block is in the highest non-empty list
+	if (levelBitmap != 0)
+	{
+		unsigned int level = HighestBit(levelBitmap);
+		unsigned int list = HighestBit(listBitmaps[level]);
+		for (uint32_t block = freeLists[level][list]; block != c_none; block = blocks[block].nextFree)
+			stats.largestFreeBlock = std::max(stats.largestFreeBlock, blocks[block].size * granularity);
+	}
+	stats.fragmentation = stats.freeBytes > 0 ? 1.0f - float(double(stats.largestFreeBlock) / double(stats.freeBytes)) : 0.0f;
+	return stats;
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+	if (!unusedBlocks.empty())
+	{
+		uint32_t block = unusedBlocks.back();
+		unusedBlocks.pop_back();
+		return block;
+	}
+	blocks.push_back(Block());
+	return (uint32_t)(blocks.size() - 1);
+}
+
+void TlsfAllocator::InsertFree(uint32_t index)
+{
+	Block& block = blocks[index];
+	unsigned int level, list;
+	GetSizeClass(block.size, level, list);
+	block.prevFree = c_none;
+	block.nextFree = freeLists[level][list];
+	if (block.nextFree != c_none)
+		blocks[block.nextFree].prevFree = index;
+	freeLists[level][list] = index;
+	listBitmaps[level] |= 1u << list;
+	levelBitmap |= uint64_t(1) << level;
+	freeBlockCount++;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t index)
+{
+	Block& block = blocks[index];
+	if (block.prevFree != c_none)
+		blocks[block.prevFree].nextFree = block.nextFree;
+	if (block.nextFree != c_none)
+		blocks[block.nextFree].prevFree = block.prevFree;
+
+	unsigned int level, list;
+	GetSizeClass(block.size, level, list);
+	if (freeLists[level][list] == index)
+	{
+		freeLists[level][list] = block.nextFree;
+		if (block.nextFree == c_none)
+		{
+			listBitmaps[level] &= ~(1u << list);
+			if (listBitmaps[level] == 0)
+				levelBitmap &= ~(uint64_t(1) << level);
+		}
+	}
+	freeBlockCount--;
+}
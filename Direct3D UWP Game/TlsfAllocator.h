@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit (TLSF) allocator of ranges of a block of memory it does not own.
+//
+// Only offsets are handed out, so the same allocator places resources in an ID3D12Heap
+// or anything else addressed by offset. Allocate and Free are O(1): free blocks are kept
+// in lists by size class (a power of two, split in c_tlsfSubdivisions), and two levels of
+// bitmaps find the first non-empty list that is guaranteed to fit. Freed blocks merge
+// with free neighbours at once.
+//
+// Sizes and offsets are multiples of the granularity given at construction, which is
+// also the alignment of every allocation (D3D12 places buffers on 64 KB). Not thread-safe.
+
+static const unsigned int c_tlsfSubdivisionsLog2 = 5;
+static const unsigned int c_tlsfSubdivisions = 1u << c_tlsfSubdivisionsLog2;
+static const unsigned int c_tlsfLevels = 64 - c_tlsfSubdivisionsLog2 + 1;
+
+struct TlsfAllocation {
+	uint64_t offset = 0;
+	uint64_t size = 0;	// as requested, rounded up to the granularity
+	uint32_t block = UINT32_MAX;	// UINT32_MAX: no allocation
+
+	bool IsValid() const { return block != UINT32_MAX; }
+};
+
+struct TlsfStats {
+	uint64_t capacity;
+	uint64_t usedBytes;
+	uint64_t freeBytes;
+	uint64_t largestFreeBlock;
+	size_t allocationCount;
+	size_t freeBlockCount;
+	// 0 when the free space is one block, towards 1 as it breaks into small pieces:
+	// 1 - largestFreeBlock / freeBytes
+	float fragmentation;
+};
+
+class TlsfAllocator
+{
+public:
+	explicit TlsfAllocator(uint64_t capacity = 0, uint64_t granularity = 1);
+
+	// Forgets every allocation and manages [0, capacity) again.
+	void Reset(uint64_t capacity, uint64_t granularity = 1);
+
+	// False when no free block is large enough.
+	bool Allocate(uint64_t size, TlsfAllocation& allocation);
+	void Free(TlsfAllocation const& allocation);
+
+	bool IsEmpty() const { return allocationCount == 0; }
+	uint64_t GetCapacity() const { return capacity; }
+	uint64_t GetGranularity() const { return granularity; }
+	// Computing largestFreeBlock walks one free list, the others are kept up to date.
+	TlsfStats GetStats() const;
+
+private:
+	static const uint32_t c_none = UINT32_MAX;
+
+	struct Block {
+		uint64_t offset;
+		uint64_t size;	// in granules
+		uint32_t prevPhysical;	// neighbours in memory
+		uint32_t nextPhysical;
+		uint32_t prevFree;	// neighbours in the free list of its size class
+		uint32_t nextFree;
+		bool isFree;
+	};
+
+	uint32_t NewBlock();
+	void InsertFree(uint32_t block);
+	void RemoveFree(uint32_t block);
+
+	uint64_t capacity;
+	uint64_t granularity;
+	std::vector<Block> blocks;
+	std::vector<uint32_t> unusedBlocks;	// slots of blocks that were merged away
+	uint64_t levelBitmap = 0;	// bit l: some list of level l is not empty
+	uint32_t listBitmaps[c_tlsfLevels] = {};	// bit s: list [l][s] is not empty
+	uint32_t freeLists[c_tlsfLevels][c_tlsfSubdivisions];
+	uint64_t usedGranules = 0;
+	size_t allocationCount = 0;
+	size_t freeBlockCount = 0;
+};
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "UploadEngine.h"
+
+UploadEngine::~UploadEngine()
+{
+	Release();
+}
+
+void UploadEngine::Initialize(std::unique_ptr<UploadQueue> newQueue)
+{
+	Release();
+	std::lock_guard<std::mutex> lock(mutex);
+	queue = std::move(newQueue);
+	ring.Reset(queue->GetStagingSize());
+	nextFenceValue = 1;
+	batchOpen = false;
+	stats = {};
+}
+
+void UploadEngine::Release()
+{
+	WaitIdle();
+	std::lock_guard<std::mutex> lock(mutex);
+	queue.reset();
+	ring.Reset(0);
+}
+
+UploadTicket UploadEngine::Upload(ID3D12Resource* destination, uint64_t destinationOffset, const void* data, uint64_t size)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	UploadTicket ticket;
+	if (size == 0)
+		return ticket;
+
+	// Pieces of at most half the ring, so one can be filled while the other is copied
+	uint64_t maxPiece = std::max<uint64_t>(ring.GetCapacity() / 2, c_uploadAlignment);
+	const uint8_t* source = static_cast<const uint8_t*>(data);
+	for (uint64_t done = 0; done < size;)
+	{
+		uint64_t piece = std::min(size - done, maxPiece);
+		uint64_t offset;
+		bool stalled = false;
+		for (;;)
+		{
+			ring.Retire(queue->GetCompletedValue());
+			if (ring.Allocate(piece, c_uploadAlignment, offset))
+				break;
+			if (ring.GetUsedBytes() == 0)
+				throw std::runtime_error("Upload staging ring too small"); // every batch is done and the piece still does not fit
+
+			// Full: the open batch holds part of the ring, then wait for the oldest batch
+			// with the lock released, so other threads keep flushing and copying, and retry
+			if (!stalled)
+				stats.stallCount++;
+			stalled = true;
+			FlushLocked(lock);
+			uint64_t value = queue->GetCompletedValue() + 1;
+			if (value < nextFenceValue)
+			{
+				lock.unlock();
+				queue->WaitForValue(value);
+				lock.lock();
+			}
+		}
+
+		// The copy is recorded now and the data written after the lock is released; the
+		// batch is not submitted until every such write is done
+		queue->RecordCopy(destination, destinationOffset + done, offset, piece);
+		batchOpen = true;
+		pendingWrites++;
+		ticket.fenceValue = nextFenceValue;
+		lock.unlock();
+		memcpy(queue->GetStagingData() + offset, source + done, size_t(piece));
+		lock.lock();
+		if (--pendingWrites == 0)
+			writesDone.notify_all();
+		done += piece;
+	}
+
+	stats.uploadCount++;
+	stats.bytesUploaded += size;
+	return ticket;
+}
+
+void UploadEngine::Flush()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	FlushLocked(lock);
+}
+
+void UploadEngine::FlushLocked(std::unique_lock<std::mutex>& lock)
+{
+	writesDone.wait(lock, [this]() { return pendingWrites == 0; });
+	if (!queue || !batchOpen)
+		return;
+	queue->Submit(nextFenceValue);
+	ring.FinishFrame(nextFenceValue);
+	nextFenceValue++;
+	batchOpen = false;
+	stats.batchCount++;
+}
+
+bool UploadEngine::IsComplete(UploadTicket ticket)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return ticket.fenceValue == 0 || (queue && queue->GetCompletedValue() >= ticket.fenceValue);
+}
+
+void UploadEngine::Wait(ID3D12CommandQueue* other, UploadTicket ticket)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (ticket.fenceValue == 0 || !queue)
+		return;
+	if (ticket.fenceValue >= nextFenceValue)
+		FlushLocked(lock);
+	queue->GpuWait(other, ticket.fenceValue);
+}
+
+void UploadEngine::WaitIdle()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	if (!queue)
+		return;
+	FlushLocked(lock);
+	queue->WaitForValue(nextFenceValue - 1);
+	ring.Retire(nextFenceValue - 1);
+}
+
+UploadStats UploadEngine::GetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "UploadRing.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+struct ID3D12CommandQueue;
+struct ID3D12Device;
+struct ID3D12Resource;
+
+// Buffer uploads through a dedicated copy queue.
+//
+// Upload() reserves space in a persistently mapped staging ring, records a copy into the
+// open batch and copies the data into the space at once; Flush() submits the batch,
+// which signals the next value of the queue's fence. Every upload returns the ticket of
+// its batch: IsComplete() polls it on the CPU, Wait() makes another queue wait for it on
+// the GPU, so the graphics queue can draw with a buffer as soon as its copy is submitted.
+//
+// The staging space of a batch is reused once its fence value completes. When the ring
+// is full Upload() submits the open batch and, if that is not enough, waits for the
+// oldest one; uploads larger than the ring go through it in pieces.
+//
+// Upload holds the lock only to reserve space and record the copy: the memcpy into
+// staging and the wait for a full ring run with it released, so uploads from several
+// workers fill staging at the same time. A batch is submitted once the writes into it
+// are done.
+//
+// The staging buffer lives as long as the queue, idle or not: c_uploadStagingSize of
+// UPLOAD heap is held for the whole session. Releasing it after idle frames would give
+// that memory back between reloads, but the next reload would then create and map a
+// committed buffer on the worker that records it, and a reload arrives while the game
+// is running; the budget is meant to stay fixed, so the size is the knob instead.
+//
+// The D3D side (copy queue, command lists, fence, staging buffer) sits behind
+// UploadQueue, implemented in D3D12UploadQueue.cpp; this header and UploadEngine.cpp
+// only see pointers to D3D objects, so the batching and ticket logic also builds and
+// runs against a mock queue.
+// Upload, Flush and Wait are thread-safe: meshes are uploaded from AssetLoader workers.
+// Destination buffers must be in the COMMON state; copy queues promote buffers to
+// COPY_DEST and they decay back to COMMON when the batch is done.
+
+static const uint64_t c_uploadStagingSize = uint64_t(32) << 20;
+static const uint64_t c_uploadAlignment = 16;
+
+struct UploadTicket {
+	uint64_t fenceValue = 0;	// 0: nothing to wait for
+};
+
+struct UploadStats {
+	size_t uploadCount;
+	size_t batchCount;	// submitted
+	uint64_t bytesUploaded;
+	size_t stallCount;	// times Upload had to wait for the GPU to free staging space
+};
+
+class UploadQueue
+{
+public:
+	virtual ~UploadQueue() = default;
+
+	// The staging buffer, mapped for the queue's whole life.
+	virtual uint8_t* GetStagingData() = 0;
+	virtual uint64_t GetStagingSize() const = 0;
+
+	// Adds a copy from the staging buffer to the batch being recorded.
+	virtual void RecordCopy(ID3D12Resource* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) = 0;
+	// Submits the recorded copies; the fence reaches fenceValue when they are done.
+	virtual void Submit(uint64_t fenceValue) = 0;
+
+	virtual uint64_t GetCompletedValue() = 0;
+	// Blocks the calling thread until the fence reaches fenceValue.
+	virtual void WaitForValue(uint64_t fenceValue) = 0;
+	// Makes queue wait on the GPU until the fence reaches fenceValue.
+	virtual void GpuWait(ID3D12CommandQueue* queue, uint64_t fenceValue) = 0;
+};
+
+// Copy queue, fence and a committed staging buffer of stagingSize bytes on device
+// (D3D12UploadQueue.cpp).
+std::unique_ptr<UploadQueue> CreateD3D12UploadQueue(ID3D12Device* device, uint64_t stagingSize = c_uploadStagingSize);
+
+class UploadEngine
+{
+public:
+	UploadEngine() = default;
+	~UploadEngine();
+
+	UploadEngine(UploadEngine const&) = delete;
+	UploadEngine& operator=(UploadEngine const&) = delete;
+
+	void Initialize(std::unique_ptr<UploadQueue> queue);
+	// Waits for every batch and drops the queue.
+	void Release();
+
+	UploadTicket Upload(ID3D12Resource* destination, uint64_t destinationOffset, const void* data, uint64_t size);
+	// Submits the open batch, if it holds anything. Called once per frame.
+	void Flush();
+
+	bool IsComplete(UploadTicket ticket);
+	// Submits the ticket's batch if it is still open, then makes queue wait for it.
+	void Wait(ID3D12CommandQueue* queue, UploadTicket ticket);
+	// Blocks until every submitted batch is done.
+	void WaitIdle();
+
+	UploadStats GetStats();
+
+private:
+	void FlushLocked(std::unique_lock<std::mutex>& lock);
+
+	std::mutex mutex;
+	std::unique_ptr<UploadQueue> queue;
+	UploadRing ring;
+	uint64_t nextFenceValue = 1;	// signalled by the open batch
+	bool batchOpen = false;	// the open batch holds copies
+	size_t pendingWrites = 0;	// copies recorded in the open batch whose data is still being written
+	std::condition_variable writesDone;
+	UploadStats stats = {};
+};
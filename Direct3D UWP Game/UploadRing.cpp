@@ -0,0 +1,50 @@
+#include "pch.h"
+#include "UploadRing.h"
+
+UploadRing::UploadRing(uint64_t capacity) : capacity(capacity)
+{
+}
+
+void UploadRing::Reset(uint64_t newCapacity)
+{
+	capacity = newCapacity;
+	head = 0;
+	used = 0;
+	frameBytes = 0;
+	frames.clear();
+}
+
+bool UploadRing::Allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	uint64_t start = (head + alignment - 1) & ~(alignment - 1);
+	if (start + size > capacity)
+		start = 0;	// skip to the beginning; the bytes up to the end count as padding
+	uint64_t padding = start >= head ? start - head : capacity - head + start;
+
+	// The free space is [head, tail) going round, capacity - used bytes long
+	if (size > capacity || used + padding + size > capacity)
+		return false;
+
+	offset = start;
+	head = start + size;
+	used += padding + size;
+	frameBytes += padding + size;
+	return true;
+}
+
+void UploadRing::FinishFrame(uint64_t fenceValue)
+{
+	// A frame that allocated nothing still keeps its place, so the order of the fence
+	// values stays that of the frames
+	frames.push_back({ fenceValue, frameBytes });
+	frameBytes = 0;
+}
+
+void UploadRing::Retire(uint64_t completedValue)
+{
+	while (!frames.empty() && frames.front().fenceValue <= completedValue)
+	{
+		used -= frames.front().bytes;
+		frames.pop_front();
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+// Ring sub-allocator for a persistently mapped upload buffer.
+//
+// Space is handed out from the head in allocation order and given back from the tail
+// a whole frame at a time: FinishFrame() tags everything allocated since the previous
+// call with the fence value the frame signals, and Retire() frees the frames whose
+// value the fence has reached. The CPU therefore never writes over data a frame in
+// flight is still reading, however many frames are queued.
+//
+// Only offsets are managed here, no D3D objects: the caller adds them to the buffer's
+// mapped pointer and GPU address, and passes in fence values, so the allocator runs
+// the same against a real ID3D12Fence or a simulated timeline. Not thread-safe: it
+// belongs to the thread that records the frame.
+
+class UploadRing
+{
+public:
+	explicit UploadRing(uint64_t capacity = 0);
+
+	// Forgets every allocation, e.g. after the device and its buffer were recreated.
+	void Reset(uint64_t capacity);
+
+	// Places size bytes at a multiple of alignment (a power of two). An allocation never
+	// wraps: the end of the buffer is skipped when it does not fit. Fails when the space
+	// is still held by frames in flight; Retire() and try again.
+	bool Allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+
+	// Closes the current frame: its allocations are freed once the fence reaches fenceValue.
+	void FinishFrame(uint64_t fenceValue);
+
+	// Frees the frames whose fence value is at most completedValue.
+	void Retire(uint64_t completedValue);
+
+	uint64_t GetCapacity() const { return capacity; }
+	uint64_t GetUsedBytes() const { return used; }	// alignment padding included
+	size_t GetFramesInFlight() const { return frames.size(); }
+
+private:
+	struct Frame {
+		uint64_t fenceValue;
+		uint64_t bytes;	// used by the frame, padding included
+	};
+
+	uint64_t capacity;
+	uint64_t head = 0;	// where the next allocation starts looking
+	uint64_t used = 0;	// between the oldest frame in flight and head
+	uint64_t frameBytes = 0;	// allocated since the last FinishFrame
+	std::deque<Frame> frames;
+};
@@ -0,0 +1,195 @@
+#include "pch.h"
+#include "VertexCache.h"
+
+// Forsyth's scoring parameters. The simulated cache is LRU; vertices of the last
+// triangle get a fixed score so the next pick does not simply repeat them.
+static const unsigned int c_cacheSize = 32;
+static const float c_cacheDecayPower = 1.5f;
+static const float c_lastTriangleScore = 0.75f;
+static const float c_valenceBoostScale = 2.0f;
+static const float c_valenceBoostPower = 0.5f;
+static const unsigned int c_maxValence = 32;
+
+namespace
+{
+	struct ScoreTables {
+		float cache[c_cacheSize];
+		float valence[c_maxValence + 1];
+
+		ScoreTables()
+		{
+			for (unsigned int i = 0; i < c_cacheSize; i++)
+				cache[i] = i < 3 ? c_lastTriangleScore : powf(1.0f - float(i - 3) / float(c_cacheSize - 3), c_cacheDecayPower);
+			valence[0] = 0.0f;
+			for (unsigned int i = 1; i <= c_maxValence; i++)
+				valence[i] = c_valenceBoostScale * powf(float(i), -c_valenceBoostPower);
+		}
+	};
+
+	float VertexScore(ScoreTables const& tables, int cachePosition, unsigned int activeTriangles)
+	{
+		// No triangles left to emit: the vertex must never attract a pick.
+		if (activeTriangles == 0) return -1.0f;
+
+		float score = cachePosition < 0 ? 0.0f : tables.cache[cachePosition];
+		return score + tables.valence[std::min(activeTriangles, c_maxValence)];
+	}
+}
+
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount < 3 || cacheSize == 0) return stats;
+
+	// FIFO cache: each vertex remembers when it entered, so a lookup is O(1).
+	std::vector<size_t> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	size_t time = cacheSize + 1;
+	size_t uniqueVertices = 0;
+
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (!referenced[v])
+		{
+			referenced[v] = true;
+			uniqueVertices++;
+		}
+		if (time - timestamps[v] > cacheSize)
+		{
+			timestamps[v] = time++;
+			stats.transforms++;
+		}
+	}
+
+	stats.acmr = float(stats.transforms) / float(indexCount / 3);
+	stats.atvr = uniqueVertices ? float(stats.transforms) / float(uniqueVertices) : 0.0f;
+	return stats;
+}
+
+VertexCacheStats AnalyzeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	return AnalyzeVertexCache(indices.data(), indices.size(), vertexCount, cacheSize);
+}
+
+void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	static const ScoreTables tables;
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0) return;
+
+	// destination may alias indices.
+	std::vector<unsigned int> source(indices, indices + triangleCount * 3);
+
+	// Vertex -> triangle adjacency. The first activeTriangles[v] entries of a vertex's
+	// range are the triangles still waiting to be emitted.
+	std::vector<unsigned int> activeTriangles(vertexCount, 0);
+	for (unsigned int index : source) activeTriangles[index]++;
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + activeTriangles[v];
+
+	std::vector<unsigned int> adjacency(source.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < triangleCount; t++)
+		for (size_t k = 0; k < 3; k++)
+			adjacency[fill[source[t * 3 + k]]++] = (unsigned int)t;
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = VertexScore(tables, -1, activeTriangles[v]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	size_t bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		const unsigned int* tri = &source[t * 3];
+		triangleScores[t] = vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+		if (triangleScores[t] > triangleScores[bestTriangle]) bestTriangle = t;
+	}
+
+	unsigned int cache[c_cacheSize + 3];
+	unsigned int newCache[c_cacheSize + 3];
+	size_t cacheCount = 0;
+	size_t nextCandidate = 0;
+
+	for (size_t output = 0; output < triangleCount; output++)
+	{
+		// Nothing in the cache has triangles left: restart from the next unemitted triangle.
+		if (bestTriangle == SIZE_MAX)
+		{
+			while (emitted[nextCandidate]) nextCandidate++;
+			bestTriangle = nextCandidate;
+		}
+
+		const unsigned int* tri = &source[bestTriangle * 3];
+		destination[output * 3 + 0] = tri[0];
+		destination[output * 3 + 1] = tri[1];
+		destination[output * 3 + 2] = tri[2];
+		emitted[bestTriangle] = true;
+
+		// Retire the triangle from its vertices' active lists.
+		for (size_t k = 0; k < 3; k++)
+		{
+			unsigned int v = tri[k];
+			unsigned int* list = &adjacency[offsets[v]];
+			unsigned int count = activeTriangles[v];
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (list[i] == bestTriangle)
+				{
+					std::swap(list[i], list[count - 1]);
+					activeTriangles[v]--;
+					break;
+				}
+			}
+		}
+
+		// Move the triangle's vertices to the front of the LRU cache.
+		size_t newCount = 0;
+		for (size_t k = 0; k < 3; k++)
+			if (std::find(newCache, newCache + newCount, tri[k]) == newCache + newCount)
+				newCache[newCount++] = tri[k];
+		for (size_t i = 0; i < cacheCount; i++)
+			if (std::find(newCache, newCache + newCount, cache[i]) == newCache + newCount)
+				newCache[newCount++] = cache[i];
+
+		// Rescore everything that was touched, including the vertices pushed out.
+		for (size_t i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			cachePosition[v] = i < c_cacheSize ? int(i) : -1;
+			vertexScores[v] = VertexScore(tables, cachePosition[v], activeTriangles[v]);
+		}
+
+		bestTriangle = SIZE_MAX;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < newCount; i++)
+		{
+			unsigned int v = newCache[i];
+			const unsigned int* list = &adjacency[offsets[v]];
+			for (unsigned int j = 0; j < activeTriangles[v]; j++)
+			{
+				unsigned int t = list[j];
+				const unsigned int* candidate = &source[t * 3];
+				triangleScores[t] = vertexScores[candidate[0]] + vertexScores[candidate[1]] + vertexScores[candidate[2]];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		cacheCount = std::min<size_t>(newCount, c_cacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+	}
+}
+
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount)
+{
+	OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "pch.h"
+
+// Post-transform vertex cache tools for triangle lists. They only look at indices, so
+// they run anywhere (tools, tests) without a device.
+
+struct VertexCacheStats {
+	unsigned int transforms;	// vertex shader invocations (cache misses)
+	float acmr;					// average cache miss ratio: transforms per triangle (0.5 .. 3)
+	float atvr;					// average transform to vertex ratio: transforms per referenced vertex (1 is optimal)
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries over the index stream.
+VertexCacheStats AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize = 16);
+VertexCacheStats AnalyzeVertexCache(std::vector<unsigned int> const& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+// Reorders triangles for vertex cache reuse (Tom Forsyth, "Linear-Speed Vertex Cache
+// Optimisation"). destination may alias indices. Every index must be < vertexCount.
+void OptimizeVertexCache(unsigned int* destination, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+void OptimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "VertexLayout.h"
+
+unsigned int GetElementSize(VertexElementFormat format)
+{
+	switch (format)
+	{
+	case VertexElementFormat::Float3: return 12;
+	case VertexElementFormat::Float4: return 16;
+	case VertexElementFormat::Unorm16x4: return 8;
+	case VertexElementFormat::Snorm16x2: return 4;
+	case VertexElementFormat::Unorm8x4: return 4;
+	}
+	return 0;
+}
+
+namespace
+{
+	struct ElementSource {
+		const char* semantic;
+		VertexElementFormat format;
+		unsigned int slot;
+	};
+
+	std::vector<VertexElement> Build(std::initializer_list<ElementSource> sources)
+	{
+		std::vector<VertexElement> layout;
+		unsigned int offsets[c_maxVertexSlots] = {};
+		for (auto const& source : sources)
+		{
+			layout.push_back({ source.semantic, source.format, source.slot, offsets[source.slot] });
+			offsets[source.slot] += GetElementSize(source.format);
+		}
+		return layout;
+	}
+}
+
+std::vector<VertexElement> GetVertexLayout(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Packed:
+		return Build({
+			{ "POSITION", VertexElementFormat::Unorm16x4, 0 },
+			{ "NORMAL", VertexElementFormat::Snorm16x2, 0 },
+			{ "COLOR", VertexElementFormat::Unorm8x4, 0 },
+		});
+	case VertexFormat::Split:
+		return Build({
+			{ "POSITION", VertexElementFormat::Float3, 0 },
+			{ "COLOR", VertexElementFormat::Float4, 1 },
+			{ "NORMAL", VertexElementFormat::Float3, 1 },
+		});
+	case VertexFormat::PackedSplit:
+		return Build({
+			{ "POSITION", VertexElementFormat::Unorm16x4, 0 },
+			{ "NORMAL", VertexElementFormat::Snorm16x2, 1 },
+			{ "COLOR", VertexElementFormat::Unorm8x4, 1 },
+		});
+	case VertexFormat::Float:
+	default:
+		return Build({
+			{ "POSITION", VertexElementFormat::Float3, 0 },
+			{ "COLOR", VertexElementFormat::Float4, 0 },
+			{ "NORMAL", VertexElementFormat::Float3, 0 },
+		});
+	}
+}
+
+unsigned int GetVertexStride(VertexFormat format, unsigned int slot)
+{
+	unsigned int stride = 0;
+	for (auto const& element : GetVertexLayout(format))
+		if (element.slot == slot)
+			stride = std::max(stride, element.offset + GetElementSize(element.format));
+	return stride;
+}
+
+unsigned int GetVertexSlotCount(VertexFormat format)
+{
+	unsigned int count = 0;
+	for (auto const& element : GetVertexLayout(format))
+		count = std::max(count, element.slot + 1);
+	return count;
+}
+
+VertexFormat GetInterleavedFormat(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Split: return VertexFormat::Float;
+	case VertexFormat::PackedSplit: return VertexFormat::Packed;
+	default: return format;
+	}
+}
+
+std::vector<VertexElement> GetPositionLayout(VertexFormat format)
+{
+	std::vector<VertexElement> layout;
+	for (auto const& element : GetVertexLayout(format))
+		if (strcmp(element.semantic, "POSITION") == 0)
+			layout.push_back(element);
+	return layout;
+}
+
+void SplitVertexStreams(const void* interleaved, size_t vertexCount, VertexFormat format,
+	std::pmr::vector<uint8_t>& buffer, unsigned int offsets[c_maxVertexSlots])
+{
+	VertexFormat sourceFormat = GetInterleavedFormat(format);
+	std::vector<VertexElement> sourceLayout = GetVertexLayout(sourceFormat);
+	unsigned int sourceStride = GetVertexStride(sourceFormat);
+	unsigned int slotCount = GetVertexSlotCount(format);
+
+	size_t size = 0;
+	for (unsigned int slot = 0; slot < slotCount; slot++)
+	{
+		offsets[slot] = (unsigned int)size;
+		size += vertexCount * GetVertexStride(format, slot);
+		size = (size + c_vertexStreamAlignment - 1) & ~size_t(c_vertexStreamAlignment - 1);
+	}
+	buffer.assign(size, 0);
+
+	const uint8_t* source = static_cast<const uint8_t*>(interleaved);
+	for (auto const& element : GetVertexLayout(format))
+	{
+		auto match = std::find_if(sourceLayout.begin(), sourceLayout.end(),
+			[&](VertexElement const& e) { return strcmp(e.semantic, element.semantic) == 0; });
+		if (match == sourceLayout.end()) continue;
+
+		unsigned int elementSize = GetElementSize(element.format);
+		unsigned int stride = GetVertexStride(format, element.slot);
+		uint8_t* dest = buffer.data() + offsets[element.slot] + element.offset;
+		const uint8_t* src = source + match->offset;
+		for (size_t i = 0; i < vertexCount; i++)
+			memcpy(dest + i * stride, src + i * sourceStride, elementSize);
+	}
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "pch.h"
+#include <memory_resource>
+
+// Device independent description of the vertex formats a Mesh can produce. Game
+// translates it into D3D12 input layouts; keeping it free of D3D types lets the
+// layouts be checked without a device.
+
+static const unsigned int c_maxVertexSlots = 4;
+
+enum class VertexFormat {
+	Float,	// Vertex: float3 position, float4 colour, float3 normal (40 bytes)
+	Packed,	// PackedVertex: unorm16x4 position, snorm16x2 octahedral normal, unorm8x4 colour (16 bytes)
+	// Same elements with the position alone in slot 0 and the attributes in slot 1, so
+	// position-only passes (depth prepass, shadows) bind slot 0 and fetch nothing else.
+	Split,			// float3 position | float4 colour, float3 normal (12 + 28 bytes)
+	PackedSplit,	// unorm16x4 position | snorm16x2 normal, unorm8x4 colour (8 + 8 bytes)
+};
+
+enum class VertexElementFormat {
+	Float3,
+	Float4,
+	Unorm16x4,
+	Snorm16x2,
+	Unorm8x4,
+};
+
+struct VertexElement {
+	const char* semantic;
+	VertexElementFormat format;
+	unsigned int slot;		// input assembler slot
+	unsigned int offset;	// byte offset inside the slot's vertex
+};
+
+unsigned int GetElementSize(VertexElementFormat format);
+
+// Elements of the format, with offsets laid out tightly per slot.
+std::vector<VertexElement> GetVertexLayout(VertexFormat format);
+
+// Bytes per vertex in the given slot.
+unsigned int GetVertexStride(VertexFormat format, unsigned int slot = 0);
+
+// Number of input slots the format uses.
+unsigned int GetVertexSlotCount(VertexFormat format);
+
+// Single stream format holding the same elements (Split -> Float, PackedSplit -> Packed).
+VertexFormat GetInterleavedFormat(VertexFormat format);
+
+// Elements a position-only pass needs; for split formats they all live in slot 0.
+std::vector<VertexElement> GetPositionLayout(VertexFormat format);
+
+// Streams of a multi-slot vertex buffer are stored back to back, each starting on
+// this boundary.
+static const unsigned int c_vertexStreamAlignment = 16;
+
+// Copies vertexCount vertices laid out as GetInterleavedFormat(format) into the slot
+// streams of format, stored back to back in buffer. offsets receives where each slot
+// starts (GetVertexSlotCount(format) entries). Elements are matched by semantic.
+void SplitVertexStreams(const void* interleaved, size_t vertexCount, VertexFormat format,
+	std::pmr::vector<uint8_t>& buffer, unsigned int offsets[c_maxVertexSlots]);
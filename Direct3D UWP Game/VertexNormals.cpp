@@ -0,0 +1,93 @@
+#include "pch.h"
+#include "VertexNormals.h"
+#include "Parallel.h"
+
+namespace
+{
+	// Below this many triangles per block the extra buffers cost more than they save.
+	const size_t c_minTrianglesPerBlock = 16 * 1024;
+
+	struct NormalAccumulator {
+		unsigned int first = ~0u;	// vertex range [first, last] the block touches
+		unsigned int last = 0;
+		std::vector<XMFLOAT3> sums;	// sums[v - first]
+	};
+}
+
+void GenerateVertexNormals(float* normals, size_t normalStride, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride, size_t vertexCount, NormalWeighting weighting, unsigned int blockCount)
+{
+	auto position = [&](unsigned int vertex) {
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + vertex * positionStride));
+	};
+
+	size_t triangleCount = indexCount / 3;
+	if (blockCount == 0)
+		blockCount = (unsigned int)(std::max<size_t>(1, std::min<size_t>(GetWorkerCount(), triangleCount / c_minTrianglesPerBlock)));
+	std::vector<NormalAccumulator> accumulators(blockCount);
+
+	ParallelFor(blockCount, [&](size_t b) {
+		size_t begin = triangleCount * b / blockCount, end = triangleCount * (b + 1) / blockCount;
+		NormalAccumulator& accumulator = accumulators[b];
+		for (size_t i = begin * 3; i < end * 3; i++)
+			if (indices[i] < vertexCount)
+			{
+				accumulator.first = std::min(accumulator.first, indices[i]);
+				accumulator.last = std::max(accumulator.last, indices[i]);
+			}
+		if (accumulator.first > accumulator.last) return;
+		accumulator.sums.assign(accumulator.last - accumulator.first + 1, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+		for (size_t t = begin; t < end; t++)
+		{
+			const unsigned int* corner = indices + t * 3;
+			if (corner[0] >= vertexCount || corner[1] >= vertexCount || corner[2] >= vertexCount) continue;
+
+			XMVECTOR p[3] = { position(corner[0]), position(corner[1]), position(corner[2]) };
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p[1], p[0]), XMVectorSubtract(p[2], p[0]));
+			XMVECTOR weights = XMVectorReplicate(1.0f);
+			if (weighting == NormalWeighting::Angle)
+			{
+				// Corner angles from the unit edge directions.
+				XMVECTOR e01 = XMVector3Normalize(XMVectorSubtract(p[1], p[0]));
+				XMVECTOR e12 = XMVector3Normalize(XMVectorSubtract(p[2], p[1]));
+				XMVECTOR e20 = XMVector3Normalize(XMVectorSubtract(p[0], p[2]));
+				XMVECTOR cosines = XMVectorSet(
+					-XMVectorGetX(XMVector3Dot(e01, e20)),
+					-XMVectorGetX(XMVector3Dot(e12, e01)),
+					-XMVectorGetX(XMVector3Dot(e20, e12)), 0.0f);
+				weights = XMVectorACos(XMVectorClamp(cosines, XMVectorReplicate(-1.0f), XMVectorReplicate(1.0f)));
+				normal = XMVector3Normalize(normal);
+			}
+
+			XMFLOAT4 w;
+			XMStoreFloat4(&w, weights);
+			const float cornerWeight[3] = { w.x, w.y, w.z };
+			for (size_t k = 0; k < 3; k++)
+			{
+				XMFLOAT3& sum = accumulator.sums[corner[k] - accumulator.first];
+				XMStoreFloat3(&sum, XMVectorMultiplyAdd(normal, XMVectorReplicate(cornerWeight[k]), XMLoadFloat3(&sum)));
+			}
+		}
+	});
+
+	// Sum the blocks that reach each vertex and normalize.
+	const size_t vertexBlockSize = 64 * 1024;
+	ParallelFor((vertexCount + vertexBlockSize - 1) / vertexBlockSize, [&](size_t block) {
+		unsigned int begin = (unsigned int)(block * vertexBlockSize);
+		unsigned int end = (unsigned int)(std::min(vertexCount, (block + 1) * vertexBlockSize));
+		for (unsigned int v = begin; v < end; v++)
+		{
+			XMVECTOR sum = XMVectorZero();
+			for (NormalAccumulator const& accumulator : accumulators)
+				if (v >= accumulator.first && v <= accumulator.last)
+					sum = XMVectorAdd(sum, XMLoadFloat3(&accumulator.sums[v - accumulator.first]));
+
+			// Degenerate sums (no triangle, or faces cancelling out) stay zero instead of NaN.
+			XMVECTOR lengthSq = XMVector3LengthSq(sum);
+			XMVECTOR normal = XMVectorSelect(XMVectorZero(), XMVectorMultiply(sum, XMVectorReciprocalSqrt(lengthSq)),
+				XMVectorGreater(lengthSq, XMVectorZero()));
+			XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(reinterpret_cast<uint8_t*>(normals) + v * normalStride), normal);
+		}
+	});
+}
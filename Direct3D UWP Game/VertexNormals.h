@@ -0,0 +1,24 @@
+#pragma once
+#include "pch.h"
+
+using namespace DirectX;
+
+// Vertex normals generated from the triangles, for meshes that come without them.
+//
+// Every triangle adds its normal to its three vertices. The triangles are split into one
+// block per worker and each block accumulates into a buffer of its own, covering only the
+// vertex range it touches (tight once the vertices are in first-use order), so no two
+// tasks ever write the same float. The buffers are then summed per vertex block and
+// normalized in a second parallel pass.
+
+enum class NormalWeighting {
+	Area,	// unnormalized face normal: large triangles count more
+	Angle,	// unit face normal times the corner angle: independent of how faces are split
+};
+
+// Writes one unit normal per vertex at normals + i * normalStride. Vertices no valid
+// triangle uses get (0, 0, 0); triangles with an index past vertexCount are skipped.
+// blockCount 0 picks one from the worker count and the triangle count.
+void GenerateVertexNormals(float* normals, size_t normalStride, const unsigned int* indices, size_t indexCount,
+	const float* positions, size_t positionStride, size_t vertexCount, NormalWeighting weighting = NormalWeighting::Angle,
+	unsigned int blockCount = 0);
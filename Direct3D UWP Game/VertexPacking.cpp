@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "VertexPacking.h"
+
+PositionQuantization GetPositionQuantization(XMFLOAT3 const& boundsMin, XMFLOAT3 const& boundsMax)
+{
+	PositionQuantization quantization;
+	quantization.offset = boundsMin;
+	quantization.scale = XMFLOAT3(boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z);
+	return quantization;
+}
+
+uint16_t EncodeUnorm16(float value)
+{
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return (uint16_t)(value * 65535.0f + 0.5f);
+}
+
+int16_t EncodeSnorm16(float value)
+{
+	value = std::min(std::max(value, -1.0f), 1.0f);
+	return (int16_t)floorf(value * 32767.0f + 0.5f);
+}
+
+uint8_t EncodeUnorm8(float value)
+{
+	value = std::min(std::max(value, 0.0f), 1.0f);
+	return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+// Decoding follows the D3D conversion rules, so CPU and GPU agree exactly.
+float DecodeUnorm16(uint16_t value)
+{
+	return float(value) / 65535.0f;
+}
+
+float DecodeSnorm16(int16_t value)
+{
+	return std::max(float(value) / 32767.0f, -1.0f);
+}
+
+float DecodeUnorm8(uint8_t value)
+{
+	return float(value) / 255.0f;
+}
+
+void EncodeOctahedral(XMFLOAT3 const& normal, int16_t encoded[2])
+{
+	float l1 = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (l1 == 0.0f)
+	{
+		encoded[0] = 0;
+		encoded[1] = 0;
+		return;
+	}
+
+	float x = normal.x / l1;
+	float y = normal.y / l1;
+	if (normal.z < 0.0f)
+	{
+		// Fold the lower hemisphere over the diagonals.
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	encoded[0] = EncodeSnorm16(x);
+	encoded[1] = EncodeSnorm16(y);
+}
+
+XMFLOAT3 DecodeOctahedral(const int16_t encoded[2])
+{
+	float x = DecodeSnorm16(encoded[0]);
+	float y = DecodeSnorm16(encoded[1]);
+	float z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f)
+	{
+		float fx = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float fy = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	float length = sqrtf(x * x + y * y + z * z);
+	return XMFLOAT3(x / length, y / length, z / length);
+}
+
+PackedVertex PackVertex(XMFLOAT3 const& pos, XMFLOAT3 const& normal, XMFLOAT4 const& col, PositionQuantization const& quantization)
+{
+	auto relative = [](float value, float offset, float scale) { return scale > 0.0f ? (value - offset) / scale : 0.0f; };
+
+	PackedVertex packed;
+	packed.pos[0] = EncodeUnorm16(relative(pos.x, quantization.offset.x, quantization.scale.x));
+	packed.pos[1] = EncodeUnorm16(relative(pos.y, quantization.offset.y, quantization.scale.y));
+	packed.pos[2] = EncodeUnorm16(relative(pos.z, quantization.offset.z, quantization.scale.z));
+	packed.pos[3] = 65535;
+	EncodeOctahedral(normal, packed.normal);
+	packed.col[0] = EncodeUnorm8(col.x);
+	packed.col[1] = EncodeUnorm8(col.y);
+	packed.col[2] = EncodeUnorm8(col.z);
+	packed.col[3] = EncodeUnorm8(col.w);
+	return packed;
+}
+
+void UnpackVertex(PackedVertex const& packed, PositionQuantization const& quantization, XMFLOAT3& pos, XMFLOAT3& normal, XMFLOAT4& col)
+{
+	pos.x = quantization.offset.x + DecodeUnorm16(packed.pos[0]) * quantization.scale.x;
+	pos.y = quantization.offset.y + DecodeUnorm16(packed.pos[1]) * quantization.scale.y;
+	pos.z = quantization.offset.z + DecodeUnorm16(packed.pos[2]) * quantization.scale.z;
+	normal = DecodeOctahedral(packed.normal);
+	col = XMFLOAT4(DecodeUnorm8(packed.col[0]), DecodeUnorm8(packed.col[1]), DecodeUnorm8(packed.col[2]), DecodeUnorm8(packed.col[3]));
+}
+
+XMFLOAT3 GetPositionErrorBound(PositionQuantization const& quantization)
+{
+	// Half a step, plus the float rounding of offset + unorm * scale.
+	const float halfStep = 0.5f / 65535.0f;
+	auto bound = [halfStep](float offset, float scale) { return scale * halfStep + FLT_EPSILON * (fabsf(offset) + scale); };
+	return XMFLOAT3(bound(quantization.offset.x, quantization.scale.x), bound(quantization.offset.y, quantization.scale.y), bound(quantization.offset.z, quantization.scale.z));
+}
+
+float GetNormalErrorBound()
+{
+	// Half a step on each octahedron axis moves the (unnormalized) point by at most
+	// sqrt(2)/2 steps; the octahedron surface is at least 1/sqrt(3) from the origin.
+	// Unfolding the lower hemisphere can stretch that displacement up to twice.
+	const float step = 1.0f / 32767.0f;
+	return atanf(0.5f * sqrtf(2.0f) * step * sqrtf(3.0f)) * 2.0f;
+}
+
+float GetColorErrorBound()
+{
+	// Half a step, plus the float rounding of the scale and the decode division.
+	return 0.5f / 255.0f + FLT_EPSILON;
+}
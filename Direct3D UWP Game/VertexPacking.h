@@ -0,0 +1,55 @@
+#pragma once
+#include "pch.h"
+
+using namespace DirectX;
+
+// Compressed vertex (VertexFormat::Packed), 16 bytes instead of 40:
+//   position	unorm16x4	relative to the mesh bounds, w unused
+//   normal		snorm16x2	octahedral encoding
+//   colour		unorm8x4
+struct PackedVertex {
+	uint16_t pos[4];
+	int16_t normal[2];
+	uint8_t col[4];
+};
+
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must match the Packed input layout");
+
+// Maps unorm16 positions back to object space: pos = offset + unorm * scale. The
+// vertex shader receives both through the constant buffer.
+struct PositionQuantization {
+	XMFLOAT3 offset;
+	XMFLOAT3 scale;
+};
+
+PositionQuantization GetPositionQuantization(XMFLOAT3 const& boundsMin, XMFLOAT3 const& boundsMax);
+
+uint16_t EncodeUnorm16(float value);
+int16_t EncodeSnorm16(float value);
+uint8_t EncodeUnorm8(float value);
+float DecodeUnorm16(uint16_t value);
+float DecodeSnorm16(int16_t value);
+float DecodeUnorm8(uint8_t value);
+
+// Octahedral normal encoding (Meyer et al. 2010). The input need not be normalized.
+void EncodeOctahedral(XMFLOAT3 const& normal, int16_t encoded[2]);
+XMFLOAT3 DecodeOctahedral(const int16_t encoded[2]);
+
+PackedVertex PackVertex(XMFLOAT3 const& pos, XMFLOAT3 const& normal, XMFLOAT4 const& col, PositionQuantization const& quantization);
+void UnpackVertex(PackedVertex const& packed, PositionQuantization const& quantization, XMFLOAT3& pos, XMFLOAT3& normal, XMFLOAT4& col);
+
+// Worst case errors the encodings guarantee: half a quantization step per position
+// axis and per colour channel, and the angle of half a snorm16 step on the octahedron.
+XMFLOAT3 GetPositionErrorBound(PositionQuantization const& quantization);
+float GetNormalErrorBound();	// radians
+float GetColorErrorBound();
+
+// Measured result of packing a mesh: vertex buffer sizes and the largest errors seen.
+struct VertexPackingReport {
+	size_t vertexCount;
+	size_t floatBytes;
+	size_t packedBytes;
+	XMFLOAT3 maxPositionError;
+	float maxNormalError;	// radians
+	float maxColorError;
+};
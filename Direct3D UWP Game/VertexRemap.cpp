@@ -0,0 +1,35 @@
+#include "pch.h"
+#include "VertexRemap.h"
+
+size_t BuildVertexFetchRemap(unsigned int* remap, const unsigned int* indices, size_t indexCount, size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, c_unusedVertex);
+
+	unsigned int next = 0;
+	for (size_t i = 0; i < indexCount; i++)
+	{
+		unsigned int v = indices[i];
+		if (remap[v] == c_unusedVertex)
+			remap[v] = next++;
+	}
+	return next;
+}
+
+std::vector<unsigned int> BuildVertexFetchRemap(std::vector<unsigned int> const& indices, size_t vertexCount, size_t* newVertexCount)
+{
+	std::vector<unsigned int> remap(vertexCount);
+	size_t count = BuildVertexFetchRemap(remap.data(), indices.data(), indices.size(), vertexCount);
+	if (newVertexCount) *newVertexCount = count;
+	return remap;
+}
+
+void RemapIndices(unsigned int* destination, const unsigned int* indices, size_t indexCount, const unsigned int* remap)
+{
+	for (size_t i = 0; i < indexCount; i++)
+		destination[i] = remap[indices[i]];
+}
+
+void RemapIndices(std::vector<unsigned int>& indices, std::vector<unsigned int> const& remap)
+{
+	RemapIndices(indices.data(), indices.data(), indices.size(), remap.data());
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "pch.h"
+
+// Vertex remap tables: remap[oldIndex] = newIndex, or c_unusedVertex for vertices
+// that are dropped. The same table can be applied to the index buffer and to any
+// number of per-vertex streams so they stay in step.
+
+static const unsigned int c_unusedVertex = ~0u;
+
+// Orders vertices by first use in the index stream (run it after the vertex cache
+// pass) and drops the ones no triangle references. Returns the new vertex count.
+size_t BuildVertexFetchRemap(unsigned int* remap, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+std::vector<unsigned int> BuildVertexFetchRemap(std::vector<unsigned int> const& indices, size_t vertexCount, size_t* newVertexCount = nullptr);
+
+// Rewrites indices through the table. destination may alias indices.
+void RemapIndices(unsigned int* destination, const unsigned int* indices, size_t indexCount, const unsigned int* remap);
+void RemapIndices(std::vector<unsigned int>& indices, std::vector<unsigned int> const& remap);
+
+// Scatters a vertex stream into its new order. destination must hold the new vertex
+// count and must not alias vertices.
+template <typename T>
+void RemapVertices(T* destination, const T* vertices, size_t vertexCount, const unsigned int* remap)
+{
+	for (size_t i = 0; i < vertexCount; i++)
+		if (remap[i] != c_unusedVertex)
+			destination[remap[i]] = vertices[i];
+}
+
+template <typename T, typename Allocator>
+void RemapVertices(std::vector<T, Allocator>& vertices, std::vector<unsigned int> const& remap, size_t newVertexCount)
+{
+	std::vector<T, Allocator> result(newVertexCount, T(), vertices.get_allocator());
+	RemapVertices(result.data(), vertices.data(), std::min(vertices.size(), remap.size()), remap.data());
+	vertices.swap(result);
+}
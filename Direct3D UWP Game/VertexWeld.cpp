@@ -0,0 +1,115 @@
+#include "pch.h"
+#include "VertexWeld.h"
+#include "Parallel.h"
+
+namespace
+{
+	inline int64_t Quantize(float value, float epsilon)
+	{
+		if (epsilon > 0.0f)
+			return (int64_t)floor(double(value) / epsilon + 0.5);
+
+		// Exact comparison, with +0 and -0 treated as equal.
+		uint32_t bits;
+		float normalized = value == 0.0f ? 0.0f : value;
+		memcpy(&bits, &normalized, sizeof(bits));
+		return bits;
+	}
+
+	inline float Component(WeldStream const& stream, size_t vertex, unsigned int component)
+	{
+		float value;
+		memcpy(&value, static_cast<const uint8_t*>(stream.data) + vertex * stream.stride + component * sizeof(float), sizeof(float));
+		return value;
+	}
+
+	inline uint64_t Mix(uint64_t hash, int64_t value)
+	{
+		hash = (hash ^ uint64_t(value)) * 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 32);
+	}
+
+	uint64_t HashStream(WeldStream const& stream, size_t vertex, uint64_t hash)
+	{
+		for (unsigned int c = 0; c < stream.components; c++)
+			hash = Mix(hash, Quantize(Component(stream, vertex, c), stream.epsilon));
+		return hash;
+	}
+
+	bool SameCell(const WeldStream* streams, size_t streamCount, size_t a, size_t b)
+	{
+		for (size_t s = 0; s < streamCount; s++)
+			for (unsigned int c = 0; c < streams[s].components; c++)
+				if (Quantize(Component(streams[s], a, c), streams[s].epsilon) != Quantize(Component(streams[s], b, c), streams[s].epsilon))
+					return false;
+		return true;
+	}
+}
+
+size_t BuildWeldRemap(unsigned int* remap, const WeldStream* streams, size_t streamCount, size_t vertexCount, unsigned int partitionCount)
+{
+	if (vertexCount == 0) return 0;
+	if (streamCount == 0)
+	{
+		for (size_t i = 0; i < vertexCount; i++) remap[i] = (unsigned int)i;
+		return vertexCount;
+	}
+	if (partitionCount == 0) partitionCount = GetWorkerCount() * 8;
+
+	// remap temporarily holds the partition of every vertex.
+	const size_t blockSize = 64 * 1024;
+	ParallelFor((vertexCount + blockSize - 1) / blockSize, [&](size_t block) {
+		size_t end = std::min(vertexCount, (block + 1) * blockSize);
+		for (size_t i = block * blockSize; i < end; i++)
+			remap[i] = (unsigned int)(HashStream(streams[0], i, 0) % partitionCount);
+	});
+
+	// Stable counting sort of the vertices by partition.
+	std::vector<size_t> starts(partitionCount + 1, 0);
+	for (size_t i = 0; i < vertexCount; i++) starts[remap[i] + 1]++;
+	for (size_t p = 0; p < partitionCount; p++) starts[p + 1] += starts[p];
+	std::vector<unsigned int> order(vertexCount);
+	{
+		std::vector<size_t> fill(starts.begin(), starts.end() - 1);
+		for (size_t i = 0; i < vertexCount; i++) order[fill[remap[i]]++] = (unsigned int)i;
+	}
+
+	// Weld every partition: remap[i] becomes the first vertex with the same quantized key.
+	ParallelFor(partitionCount, [&](size_t p) {
+		size_t count = starts[p + 1] - starts[p];
+		if (count == 0) return;
+
+		size_t capacity = 1;
+		while (capacity < count * 2) capacity *= 2;
+		std::vector<unsigned int> table(capacity, ~0u);
+
+		for (size_t k = starts[p]; k < starts[p + 1]; k++)
+		{
+			unsigned int v = order[k];
+			uint64_t hash = 0;
+			for (size_t s = 0; s < streamCount; s++) hash = HashStream(streams[s], v, hash);
+
+			// Linear probing; the table is at most half full.
+			for (size_t slot = hash & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+			{
+				if (table[slot] == ~0u)
+				{
+					table[slot] = v;
+					remap[v] = v;
+					break;
+				}
+				if (SameCell(streams, streamCount, table[slot], v))
+				{
+					remap[v] = table[slot];
+					break;
+				}
+			}
+		}
+	});
+
+	// Number the representatives in order; they always precede their duplicates.
+	unsigned int next = 0;
+	for (size_t i = 0; i < vertexCount; i++)
+		remap[i] = remap[i] == i ? next++ : remap[remap[i]];
+	return next;
+}
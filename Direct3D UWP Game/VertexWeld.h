@@ -0,0 +1,22 @@
+#pragma once
+#include "pch.h"
+
+// Vertex welding: merges vertices whose attributes quantize to the same grid cell.
+//
+// Each attribute stream is quantized with its own epsilon (0 compares exact bits) and
+// the quantized vertices are hashed into open-addressing tables. Vertices are first
+// spread over partitions by a hash of their quantized position; identical vertices
+// always land in the same partition, so partitions are welded independently, in
+// parallel, each with a table sized for its own vertices only.
+
+struct WeldStream {
+	const void* data;		// first component of vertex 0
+	size_t stride;			// bytes between consecutive vertices
+	unsigned int components;	// floats per vertex
+	float epsilon;			// quantization step
+};
+
+// Writes remap[i] = new index of vertex i (see VertexRemap.h): unique vertices keep
+// their first-occurrence order. streams[0] is the position stream used to partition.
+// Returns the number of unique vertices. partitionCount 0 picks one from the worker count.
+size_t BuildWeldRemap(unsigned int* remap, const WeldStream* streams, size_t streamCount, size_t vertexCount, unsigned int partitionCount = 0);
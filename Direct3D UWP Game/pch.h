@@ -8,6 +8,7 @@
 // Use the C++ standard templated min/max
 #define NOMINMAX
 
+#ifdef _WIN32
 #include <wrl/client.h>
 #include <wrl/event.h>
 
@@ -18,14 +19,27 @@
 #include <DirectXColors.h>
 
 #include "d3dx12.h"
+#else
+// Outside Windows only the modules that do not touch D3D are built (the tests in
+// Tests/), with the DirectXMath subset of Tests/Support.
+#include <DirectXMath.h>
+#include <DirectXColors.h>
+#endif
 
 #include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <exception>
 #include <fstream>
 #include <future>
 #include <memory>
 #include <stdexcept>
+#include <string>
+#include <vector>
 
+#ifdef _WIN32
 #ifdef _DEBUG
 #include <dxgidebug.h>
 #endif
@@ -51,3 +65,4 @@ namespace DX
         }
     }
 }
+#endif
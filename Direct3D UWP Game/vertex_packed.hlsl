@@ -0,0 +1,25 @@
+cbuffer cb : register(b0)
+{
+	float4x4 transform;
+	float4x4 normaltransform;
+	float4 positionoffset;
+	float4 positionscale;
+}
+
+// Octahedral normal decode, the inverse of EncodeOctahedral in VertexPacking.cpp.
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e.xy, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+		n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+	return normalize(n);
+}
+
+void VS(float4 pos : POSITION, float2 normal : NORMAL, float4 color : COLOR,
+	out float4 opos : SV_POSITION, out float4 ocolor : COLOR, out float4 onormal : NORMAL)
+{
+	float3 p = positionoffset.xyz + pos.xyz * positionscale.xyz;
+	opos = mul(float4(p, 1.0f), transform);
+	onormal = mul(float4(DecodeOctahedral(normal), 0.0f), normaltransform);
+	ocolor = color;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "pch.h"
+#include "AssetLoader.h"
+#include "Parallel.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Background loading (AssetLoader.h), headless: many meshes loaded at once come out the
+// same as loaded one after the other, failures end in Failed, and the wall-clock time
+// of both ways is printed.
+
+namespace
+{
+	bool SameMesh(Mesh const& a, Mesh const& b)
+	{
+		return a.GetVertexCount() == b.GetVertexCount() && a.GetIndexCount() == b.GetIndexCount() &&
+			std::memcmp(a.GetVertexData(), b.GetVertexData(), a.GetVertexCount() * sizeof(Vertex)) == 0 &&
+			std::memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexCount() * sizeof(unsigned int)) == 0;
+	}
+}
+
+int main()
+{
+	const unsigned int meshCount = 32;
+	std::vector<std::string> fileNames;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		fileNames.push_back(GetTempFile("AssetLoaderTests_" + std::to_string(i) + ".dat"));
+		CHECK(WriteTextMesh(fileNames.back(), MakeSphere(60 + i, 120, 0.01f, i + 1)));
+	}
+	auto prepare = [](Mesh& mesh) { mesh.GenerateLods({ { 0.5f, 0.01f } }); };
+
+	// One after the other on this thread
+	Stopwatch sequentialTime;
+	std::vector<std::unique_ptr<Mesh>> sequential;
+	for (std::string const& fileName : fileNames)
+	{
+		sequential.push_back(std::make_unique<Mesh>(fileName));
+		prepare(*sequential.back());
+	}
+	double sequentialSeconds = sequentialTime.GetSeconds();
+
+	// All at once on the loader
+	Stopwatch concurrentTime;
+	AssetLoader loader;
+	std::vector<LoadHandle<Mesh>> handles;
+	for (std::string const& fileName : fileNames)
+		handles.push_back(loader.LoadMesh(fileName, prepare));
+	loader.WaitIdle();
+	double concurrentSeconds = concurrentTime.GetSeconds();
+
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		CHECK(handles[i].GetState() == LoadState::Ready);
+		CHECK(handles[i].IsReady() && SameMesh(*handles[i].Get(), *sequential[i]));
+		CHECK(handles[i].IsReady() && handles[i].Get()->GetLodCount() == 2);
+	}
+	std::printf("%u meshes: sequential %.3f s, %u workers %.3f s (%.2fx)\n", meshCount, sequentialSeconds,
+		GetWorkerCount(), concurrentSeconds, sequentialSeconds / concurrentSeconds);
+
+	// Failures: a missing file, a job that throws, a job that returns nothing
+	LoadHandle<Mesh> missing = loader.LoadMesh(GetTempFile("AssetLoaderTests_missing.dat"));
+	LoadHandle<Mesh> throws = loader.Load<Mesh>([]() -> std::unique_ptr<Mesh> { throw std::runtime_error("load failed"); });
+	LoadHandle<int> empty = loader.Load<int>([]() { return std::unique_ptr<int>(); });
+	CHECK(missing.Wait() == LoadState::Failed && missing.Get() == nullptr);
+	CHECK(throws.Wait() == LoadState::Failed);
+	CHECK(empty.Wait() == LoadState::Failed);
+	CHECK(!LoadHandle<int>().IsValid() && LoadHandle<int>().Wait() == LoadState::Failed);
+
+	// A loader destroyed with jobs still queued finishes the running one and drops the
+	// rest; their handles stay Pending
+	LoadHandle<int> running;
+	std::vector<LoadHandle<int>> dropped;
+	{
+		std::atomic<bool> started{ false };
+		AssetLoader single(1);
+		running = single.Load<int>([&started]() {
+			started = true;
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			return std::make_unique<int>(1);
+		});
+		while (!started) std::this_thread::yield();
+		for (int i = 0; i < 8; i++)
+			dropped.push_back(single.Load<int>([i]() { return std::make_unique<int>(i); }));
+	}
+	CHECK(running.IsReady() && *running.Get() == 1);
+	for (LoadHandle<int> const& handle : dropped)
+		CHECK(handle.GetState() == LoadState::Pending && handle.Get() == nullptr);
+
+	for (std::string const& fileName : fileNames)
+		std::remove(fileName.c_str());
+	return TestResult();
+}
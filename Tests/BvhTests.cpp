@@ -0,0 +1,103 @@
+#include "pch.h"
+#include "Bvh.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Bounding volume hierarchy (Bvh.h): a build covers every triangle once with tight
+// boxes, and after the mesh deforms RefitBvh gives the same tight boxes a fresh build
+// would have, while UpdateBvh rebuilds once the refitted tree has degraded too far.
+
+namespace
+{
+	bool SameFloat3(XMFLOAT3 const& a, XMFLOAT3 const& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+
+	// Every node's box is exactly the box of its triangles (leaves) or of its children,
+	// and every triangle is in exactly one leaf
+	void CheckTight(Bvh const& bvh, SyntheticMesh const& mesh)
+	{
+		std::vector<unsigned int> seen(mesh.indices.size() / 3, 0);
+		for (BvhNode const& node : bvh.nodes)
+		{
+			XMFLOAT3 boundsMin(FLT_MAX, FLT_MAX, FLT_MAX), boundsMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+			auto grow = [&](XMFLOAT3 const& low, XMFLOAT3 const& high) {
+				boundsMin = XMFLOAT3(std::min(boundsMin.x, low.x), std::min(boundsMin.y, low.y), std::min(boundsMin.z, low.z));
+				boundsMax = XMFLOAT3(std::max(boundsMax.x, high.x), std::max(boundsMax.y, high.y), std::max(boundsMax.z, high.z));
+			};
+			if (node.IsLeaf())
+				for (unsigned int i = node.first; i < node.first + node.count; i++)
+				{
+					unsigned int triangle = bvh.triangles[i];
+					seen[triangle]++;
+					for (size_t k = 0; k < 3; k++)
+					{
+						XMFLOAT3 const& p = mesh.positions[mesh.indices[triangle * 3 + k]];
+						grow(p, p);
+					}
+				}
+			else
+				for (unsigned int child = node.first; child < node.first + 2; child++)
+					grow(bvh.nodes[child].boundsMin, bvh.nodes[child].boundsMax);
+			CHECK(SameFloat3(node.boundsMin, boundsMin) && SameFloat3(node.boundsMax, boundsMax));
+		}
+		CHECK(std::all_of(seen.begin(), seen.end(), [](unsigned int count) { return count == 1; }));
+	}
+
+	// Moves every vertex along its normal by a wave of the given amplitude
+	void Deform(SyntheticMesh& mesh, SyntheticMesh const& rest, float amplitude, float phase)
+	{
+		for (size_t i = 0; i < mesh.positions.size(); i++)
+		{
+			XMFLOAT3 const& p = rest.positions[i];
+			XMFLOAT3 const& n = rest.normals[i];
+			float offset = amplitude * std::sin(6.0f * p.y + phase) * std::cos(4.0f * p.x);
+			mesh.positions[i] = XMFLOAT3(p.x + n.x * offset, p.y + n.y * offset, p.z + n.z * offset);
+		}
+	}
+}
+
+int main()
+{
+	SyntheticMesh rest = MakeSphere(80, 160, 0.01f);
+	SyntheticMesh mesh = rest;
+	const float* positions = &mesh.positions.data()->x;
+
+	Bvh bvh;
+	BuildBvh(bvh, mesh.indices, positions, sizeof(XMFLOAT3));
+	CheckTight(bvh, mesh);
+	BvhStats stats = GetBvhStats(bvh);
+	CHECK(stats.leafCount * 2 - 1 == stats.nodeCount);
+	CHECK(bvh.buildSahCost == stats.sahCost);
+
+	// Refit after a deformation: same tight boxes as a fresh build of the deformed mesh,
+	// the same root box, and the cost it reports is the one GetBvhStats measures
+	Deform(mesh, rest, 0.05f, 0.0f);
+	float refitCost = RefitBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3));
+	CheckTight(bvh, mesh);
+	Bvh fresh;
+	BuildBvh(fresh, mesh.indices, positions, sizeof(XMFLOAT3));
+	CHECK(SameFloat3(bvh.nodes[0].boundsMin, fresh.nodes[0].boundsMin) && SameFloat3(bvh.nodes[0].boundsMax, fresh.nodes[0].boundsMax));
+	CHECK(std::fabs(refitCost - GetBvhStats(bvh).sahCost) <= 1e-3f * refitCost);
+	std::printf("refit cost %.2f, fresh build %.2f, first build %.2f\n", refitCost, fresh.buildSahCost, bvh.buildSahCost);
+
+	// A mild deformation keeps the tree
+	Deform(mesh, rest, 0.02f, 1.0f);
+	CHECK(!UpdateBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3)));
+	CheckTight(bvh, mesh);
+
+	// Shuffled vertices wreck the spatial order of the tree: it is rebuilt
+	std::mt19937 random(4);
+	std::shuffle(mesh.positions.begin(), mesh.positions.end(), random);
+	positions = &mesh.positions.data()->x;
+	float shuffledCost = RefitBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3));
+	CHECK(shuffledCost > bvh.buildSahCost * c_bvhRebuildCostRatio);
+	CHECK(UpdateBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3)));
+	CheckTight(bvh, mesh);
+	CHECK(bvh.buildSahCost == GetBvhStats(bvh).sahCost && bvh.buildSahCost < shuffledCost);
+
+	// Indices that no longer match the tree: rebuilt as well
+	std::vector<unsigned int> fewer(mesh.indices.begin(), mesh.indices.end() - 300);
+	CHECK(UpdateBvh(bvh, fewer.data(), fewer.size(), positions, sizeof(XMFLOAT3)));
+	CHECK(bvh.triangles.size() == fewer.size() / 3);
+
+	return TestResult();
+}
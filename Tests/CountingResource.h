@@ -0,0 +1,35 @@
+#pragma once
+#include <atomic>
+#include <memory_resource>
+
+// Memory resource that passes everything to upstream and counts it, to see how often
+// a load goes to the heap.
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource()) : upstream(upstream) {}
+
+	size_t GetAllocationCount() const { return allocations; }
+	size_t GetLiveBytes() const { return liveBytes; }
+	void ResetCount() { allocations = 0; }
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		allocations++;
+		liveBytes += bytes;
+		return upstream->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* pointer, size_t bytes, size_t alignment) override
+	{
+		liveBytes -= bytes;
+		upstream->deallocate(pointer, bytes, alignment);
+	}
+
+	bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override { return this == &other; }
+
+	std::pmr::memory_resource* upstream;
+	std::atomic<size_t> allocations{ 0 };
+	std::atomic<size_t> liveBytes{ 0 };
+};
@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "DeferredRelease.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+// Deferred release queue (DeferredRelease.h) on fake fence values: nothing is destroyed
+// before the fence reaches the value it was released with, everything is destroyed once
+// it has, and releases from several threads at once all arrive.
+
+namespace
+{
+	// Stands in for a GPU object: counts its destructions per fence value
+	struct Tracked {
+		std::shared_ptr<std::atomic<int>> destroyed;
+		uint64_t fenceValue;
+		uint64_t* completed;	// the fake fence, to check destruction happens after it
+		bool* early;
+
+		Tracked(std::shared_ptr<std::atomic<int>> destroyed, uint64_t fenceValue, uint64_t* completed, bool* early) :
+			destroyed(std::move(destroyed)), fenceValue(fenceValue), completed(completed), early(early)
+		{
+		}
+		Tracked(Tracked&& other) noexcept :
+			destroyed(std::move(other.destroyed)), fenceValue(other.fenceValue), completed(other.completed), early(other.early)
+		{
+		}
+		Tracked(Tracked const&) = delete;
+
+		~Tracked()
+		{
+			if (destroyed == nullptr)
+				return;	// moved from
+			if (*completed < fenceValue)
+				*early = true;
+			(*destroyed)++;
+		}
+	};
+}
+
+int main()
+{
+	// Objects go when the fence reaches their value, whatever order they were released in
+	{
+		auto destroyed = std::make_shared<std::atomic<int>>(0);
+		uint64_t completed = 0;
+		bool early = false;
+		DeferredReleaseQueue queue;
+		queue.Release(Tracked(destroyed, 3, &completed, &early), 3);
+		queue.Release(Tracked(destroyed, 1, &completed, &early), 1);
+		queue.Release(Tracked(destroyed, 2, &completed, &early), 2);
+		CHECK(queue.GetPendingCount() == 3 && *destroyed == 0);
+
+		CHECK(queue.Collect(completed) == 0);
+		completed = 1;
+		CHECK(queue.Collect(completed) == 1 && *destroyed == 1);
+		completed = 3;
+		CHECK(queue.Collect(completed) == 2 && *destroyed == 3);
+		CHECK(queue.GetPendingCount() == 0);
+		CHECK(!early);
+	}
+
+	// Flush and the destructor destroy everything, as when the device is lost
+	{
+		auto destroyed = std::make_shared<std::atomic<int>>(0);
+		uint64_t completed = UINT64_MAX;
+		bool early = false;
+		{
+			DeferredReleaseQueue queue;
+			queue.Release(Tracked(destroyed, 10, &completed, &early), 10);
+			queue.Flush();
+			CHECK(*destroyed == 1 && queue.GetPendingCount() == 0);
+			queue.Release(Tracked(destroyed, 20, &completed, &early), 20);
+		}
+		CHECK(*destroyed == 2);
+	}
+
+	// Copies of lvalues and move-only objects
+	{
+		auto shared = std::make_shared<int>(5);
+		DeferredReleaseQueue queue;
+		queue.Release(shared, 1);
+		queue.Release(std::make_unique<int>(6), 1);
+		CHECK(shared.use_count() == 2);
+		queue.Collect(1);
+		CHECK(shared.use_count() == 1);
+	}
+
+	// Several threads release while the owner collects every "frame", as AssetLoader
+	// workers do while the main thread renders
+	{
+		const int c_threads = 4;
+		const int c_releasesPerThread = 20000;
+		auto destroyed = std::make_shared<std::atomic<int>>(0);
+		std::atomic<uint64_t> submitted{ 0 };	// fence value of the last submission
+		uint64_t completed = 0;
+		bool early = false;
+		DeferredReleaseQueue queue;
+
+		std::vector<std::thread> threads;
+		std::atomic<int> running{ c_threads };
+		for (int t = 0; t < c_threads; t++)
+			threads.emplace_back([&]() {
+				for (int i = 0; i < c_releasesPerThread; i++)
+				{
+					// Released with a value the fence has not reached: the next submission
+					uint64_t fenceValue = submitted.load() + 1;
+					queue.Release(Tracked(destroyed, fenceValue, &completed, &early), fenceValue);
+				}
+				running--;
+			});
+
+		// The owner: submits, lets the GPU lag two frames behind, collects
+		while (running > 0)
+		{
+			uint64_t value = submitted.fetch_add(1) + 1;
+			completed = value > 2 ? value - 2 : 0;
+			queue.Collect(completed);
+			std::this_thread::yield();
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+
+		CHECK(queue.GetPendingCount() + size_t(destroyed->load()) == size_t(c_threads * c_releasesPerThread));
+		completed = submitted + 1;
+		queue.Collect(completed);
+		CHECK(*destroyed == c_threads * c_releasesPerThread);
+		CHECK(queue.GetPendingCount() == 0);
+		CHECK(!early);
+	}
+
+	return TestResult();
+}
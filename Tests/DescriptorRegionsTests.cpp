@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "DescriptorRegions.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <random>
+#include <thread>
+
+// Descriptor heap regions (DescriptorRegions.h): persistent ranges stay inside their
+// region and never share a descriptor, transient tables come from the region behind it
+// and are not handed out again before the fence passes the frame that used them.
+
+namespace
+{
+	const uint32_t c_persistentCount = 1024;
+	const uint32_t c_transientCount = 256;
+}
+
+int main()
+{
+	// Persistent region: random allocations and frees, every descriptor owned at most once
+	{
+		DescriptorRegions regions;
+		regions.Reset(c_persistentCount, c_transientCount);
+		std::mt19937 random(5);
+		std::vector<char> owned(c_persistentCount, 0);
+		struct Live {
+			uint32_t index;
+			uint32_t count;
+			TlsfAllocation allocation;
+		};
+		std::vector<Live> live;
+		bool outside = false;
+		bool shared = false;
+
+		for (int i = 0; i < 100000; i++)
+		{
+			if (live.empty() || random() % 2 == 0)
+			{
+				Live range = { 0, 1 + uint32_t(random() % 8), TlsfAllocation() };
+				if (!regions.AllocatePersistent(range.count, range.index, range.allocation))
+					continue;
+				if (range.index + range.count > c_persistentCount)
+					outside = true;
+				for (uint32_t k = 0; k < range.count && !outside; k++)
+				{
+					shared = shared || owned[range.index + k];
+					owned[range.index + k] = 1;
+				}
+				live.push_back(range);
+			}
+			else
+			{
+				size_t j = random() % live.size();
+				for (uint32_t k = 0; k < live[j].count; k++)
+					owned[live[j].index + k] = 0;
+				regions.FreePersistent(live[j].allocation);
+				live[j] = live.back();
+				live.pop_back();
+			}
+		}
+		CHECK(!outside && !shared);
+		CHECK(regions.GetStats().persistentUsed > 0);
+		for (Live const& range : live)
+			regions.FreePersistent(range.allocation);
+		DescriptorStats stats = regions.GetStats();
+		CHECK(stats.persistentUsed == 0 && stats.fragmentation == 0.0f);
+		CHECK(stats.persistentCapacity == c_persistentCount && stats.transientCapacity == c_transientCount);
+
+		uint32_t index;
+		TlsfAllocation allocation;
+		CHECK(regions.AllocatePersistent(c_persistentCount, index, allocation) && index == 0);
+		CHECK(!regions.AllocatePersistent(1, index, allocation));	// never spills into the ring
+	}
+
+	// Transient region on a fake fence timeline, the GPU up to two frames behind: a
+	// descriptor is reused only once the frame that last used it has completed
+	{
+		DescriptorRegions regions;
+		regions.Reset(c_persistentCount, c_transientCount);
+		std::mt19937 random(7);
+		std::vector<uint64_t> lastFrame(c_transientCount, 0);
+		uint64_t completed = 0;
+		size_t stalls = 0;
+		bool outside = false;
+		bool early = false;
+
+		for (uint64_t frame = 1; frame < 20000; frame++)
+		{
+			for (int table = int(random() % 6); table > 0; table--)
+			{
+				uint32_t count = 1 + uint32_t(random() % 30);
+				uint32_t index;
+				while (!regions.AllocateTransient(count, index))
+				{
+					stalls++;
+					regions.Retire(++completed);
+				}
+				if (index < c_persistentCount || index + count > c_persistentCount + c_transientCount)
+				{
+					outside = true;
+					continue;
+				}
+				for (uint32_t k = 0; k < count; k++)
+				{
+					uint64_t& last = lastFrame[index - c_persistentCount + k];
+					early = early || (last != 0 && last > completed);	// this frame's own tables included
+					last = frame;
+				}
+			}
+			regions.FinishFrame(frame);
+			if (frame >= completed + 3)
+			{
+				completed = frame - 2;
+				regions.Retire(completed);
+			}
+		}
+		CHECK(!outside && !early);
+		CHECK(stalls > 0);
+
+		uint32_t index;
+		CHECK(!regions.AllocateTransient(0, index));
+		regions.Retire(UINT64_MAX);
+		CHECK(regions.GetStats().framesInFlight == 0 && regions.GetStats().transientUsed == 0);
+	}
+
+	// A heap with no ring, such as the CPU-only staging heap, has no transient tables
+	{
+		DescriptorRegions regions;
+		regions.Reset(64, 0);
+		uint32_t index;
+		TlsfAllocation allocation;
+		CHECK(regions.AllocatePersistent(4, index, allocation));
+		CHECK(!regions.AllocateTransient(1, index));
+	}
+
+	// Workers allocating and freeing at once
+	{
+		DescriptorRegions regions;
+		regions.Reset(4096, 0);
+		std::vector<std::atomic<int>> owned(4096);
+		std::atomic<bool> shared{ false };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+			threads.emplace_back([&, t]() {
+				std::mt19937 random(t);
+				struct Live {
+					uint32_t index;
+					uint32_t count;
+					TlsfAllocation allocation;
+				};
+				std::vector<Live> live;
+				auto release = [&](Live const& range) {
+					for (uint32_t k = 0; k < range.count; k++)
+						owned[range.index + k] = 0;
+					regions.FreePersistent(range.allocation);
+				};
+				for (int i = 0; i < 50000; i++)
+				{
+					if (live.size() < 50 && random() % 2 == 0)
+					{
+						Live range = { 0, 1 + uint32_t(random() % 4), TlsfAllocation() };
+						if (!regions.AllocatePersistent(range.count, range.index, range.allocation))
+							continue;
+						for (uint32_t k = 0; k < range.count; k++)
+							if (owned[range.index + k].exchange(1) != 0)
+								shared = true;
+						live.push_back(range);
+					}
+					else if (!live.empty())
+					{
+						release(live.back());
+						live.pop_back();
+					}
+				}
+				for (Live const& range : live)
+					release(range);
+			});
+		for (std::thread& thread : threads)
+			thread.join();
+		CHECK(!shared);
+		CHECK(regions.GetStats().persistentUsed == 0);
+	}
+
+	return TestResult();
+}
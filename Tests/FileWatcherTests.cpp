@@ -0,0 +1,137 @@
+#include "pch.h"
+#include "FileWatcher.h"
+#include "TestHarness.h"
+
+// Hot reload change detection (FileWatcher.h) on a fake clock: files are not reported
+// for existing, a change is reported once it has settled, polls inside pollInterval do
+// nothing, and a file deleted and written again is reported when it is back.
+
+namespace
+{
+	using namespace std::chrono;
+
+	const FileWatchClock::duration c_pollInterval = milliseconds(250);
+	const FileWatchClock::duration c_settleTime = milliseconds(200);
+
+	void WriteFile(std::string const& fileName, std::string const& contents)
+	{
+		std::ofstream(fileName, std::ios::binary | std::ios::trunc) << contents;
+	}
+
+	// Write times are set by hand so the test does not depend on the file system's
+	// timestamp resolution
+	void SetWriteTime(std::string const& fileName, int secondsFromBase)
+	{
+		static const std::filesystem::file_time_type base = std::filesystem::last_write_time(fileName);
+		std::filesystem::last_write_time(fileName, base + seconds(secondsFromBase));
+	}
+
+	std::vector<unsigned int> Poll(FileWatcher& watcher, FileWatchClock::time_point now)
+	{
+		std::vector<unsigned int> changed;
+		size_t count = watcher.Poll(changed, now);
+		CHECK(count == changed.size());
+		return changed;
+	}
+}
+
+int main()
+{
+	std::string meshFile = GetTempFile("FileWatcherTests_mesh.dat");
+	std::string shaderFile = GetTempFile("FileWatcherTests_vertex.hlsl");
+	std::string missingFile = GetTempFile("FileWatcherTests_missing.hlsl");
+	WriteFile(meshFile, "mesh 1");
+	WriteFile(shaderFile, "shader 1");
+	std::remove(missingFile.c_str());
+	SetWriteTime(meshFile, 0);
+	SetWriteTime(shaderFile, 0);
+
+	FileWatcher watcher(c_pollInterval, c_settleTime);
+	unsigned int mesh = watcher.Watch(meshFile);
+	unsigned int shader = watcher.Watch(shaderFile);
+	unsigned int missing = watcher.Watch(missingFile);
+	CHECK(mesh != shader && shader != missing);
+	CHECK(watcher.GetPath(shader) == shaderFile);
+
+	// Baseline: files that exist, or not, when they are watched are not changes
+	FileWatchClock::time_point now = FileWatchClock::time_point() + hours(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+
+	// A new write time is seen at the next poll and reported once it has settled
+	SetWriteTime(meshFile, 10);
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += c_pollInterval;	// past settleTime too
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ mesh });
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());	// reported once only
+
+	// Same write time, different size: still a change
+	WriteFile(shaderFile, "shader 2, longer");
+	SetWriteTime(shaderFile, 0);
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ shader });
+
+	// A file that keeps changing is not reported until it stops
+	SetWriteTime(meshFile, 20);
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	SetWriteTime(meshFile, 21);
+	now += c_pollInterval;
+	CHECK(Poll(watcher, now).empty());
+	now += c_pollInterval;
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ mesh });
+
+	// Rate limit: polls inside pollInterval do not look at the disk, even when the
+	// change has long settled; the first poll after it reports it
+	SetWriteTime(meshFile, 30);
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());	// the change is seen here
+	FileWatchClock::time_point seen = now;
+	now += seconds(1);
+	CHECK(Poll(watcher, seen + c_pollInterval - milliseconds(1)).empty());
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ mesh });
+	SetWriteTime(meshFile, 31);
+	CHECK(Poll(watcher, now + milliseconds(10)).empty());
+	CHECK(Poll(watcher, now + c_pollInterval - milliseconds(1)).empty());
+	now += c_pollInterval;
+	CHECK(Poll(watcher, now).empty());	// first look at the disk since the write
+	now += c_pollInterval;
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ mesh });
+
+	// Deleted: nothing to reload. Written again: reported once it has settled
+	std::remove(shaderFile.c_str());
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	WriteFile(shaderFile, "shader 3");
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ shader });
+
+	// A file missing at Watch is reported when it appears
+	WriteFile(missingFile, "new");
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK(Poll(watcher, now) == std::vector<unsigned int>{ missing });
+
+	// Changes to several files settle and are reported in the same poll, in id order
+	SetWriteTime(meshFile, 40);
+	WriteFile(missingFile, "newer contents");
+	now += seconds(1);
+	CHECK(Poll(watcher, now).empty());
+	now += seconds(1);
+	CHECK((Poll(watcher, now) == std::vector<unsigned int>{ mesh, missing }));
+
+	std::remove(meshFile.c_str());
+	std::remove(shaderFile.c_str());
+	std::remove(missingFile.c_str());
+	return TestResult();
+}
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "CountingResource.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <thread>
+
+// Geometry arena (GeometryArena.h): allocations are aligned and disjoint, Reset frees
+// them all while keeping the chunks, and a second load after Reset goes to the heap
+// no more.
+
+namespace
+{
+	struct Block {
+		uint8_t* data;
+		size_t size;
+	};
+
+	// Fills every block with its own pattern and checks none was overwritten by another
+	bool Disjoint(std::vector<Block> const& blocks)
+	{
+		for (size_t b = 0; b < blocks.size(); b++)
+			std::memset(blocks[b].data, int(b & 0xFF), blocks[b].size);
+		for (size_t b = 0; b < blocks.size(); b++)
+			for (size_t i = 0; i < blocks[b].size; i++)
+				if (blocks[b].data[i] != uint8_t(b & 0xFF))
+					return false;
+		return true;
+	}
+
+	std::vector<Block> AllocateMany(GeometryArena& arena, unsigned int count, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<Block> blocks;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			size_t size = 1 + random() % 5000;
+			size_t alignment = size_t(1) << (random() % 8);
+			uint8_t* data = static_cast<uint8_t*>(arena.allocate(size, alignment));
+			CHECK(reinterpret_cast<uintptr_t>(data) % alignment == 0);
+			blocks.push_back({ data, size });
+		}
+		return blocks;
+	}
+}
+
+int main()
+{
+	CountingResource upstream;
+	{
+		GeometryArena arena(64 * 1024, &upstream);
+
+		// Aligned, disjoint, counted
+		std::vector<Block> blocks = AllocateMany(arena, 2000, 1);
+		CHECK(Disjoint(blocks));
+		GeometryArenaStats stats = arena.GetStats();
+		CHECK(stats.allocationCount == 2000);
+		CHECK(stats.chunkCount == stats.upstreamAllocations && stats.chunkCount == upstream.GetAllocationCount());
+		CHECK(stats.bytesAllocated <= stats.bytesReserved && stats.bytesReserved == upstream.GetLiveBytes());
+
+		// Only the most recent allocation gives its space back
+		void* last = arena.allocate(100, 16);
+		size_t before = arena.GetStats().bytesAllocated;
+		arena.deallocate(last, 100, 16);
+		CHECK(arena.GetStats().bytesAllocated == before - 100);
+		CHECK(arena.allocate(100, 16) == last);
+		arena.deallocate(blocks[0].data, blocks[0].size, 1);
+		CHECK(arena.GetStats().bytesAllocated == before);
+
+		// Larger than a chunk: a chunk of its own
+		void* large = arena.allocate(200 * 1024, 64);
+		CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0);
+		CHECK(arena.GetStats().upstreamAllocations == stats.upstreamAllocations + 1);
+
+		// Reset: nothing allocated, chunks kept, the same sequence reuses them exactly
+		size_t upstreamBefore = arena.GetStats().upstreamAllocations;
+		arena.Reset();
+		stats = arena.GetStats();
+		CHECK(stats.allocationCount == 0 && stats.bytesAllocated == 0);
+		CHECK(stats.chunkCount == upstreamBefore);
+		std::vector<Block> again = AllocateMany(arena, 2000, 1);
+		CHECK(again[0].data == blocks[0].data);
+		CHECK(Disjoint(again));
+		CHECK(arena.GetStats().upstreamAllocations == upstreamBefore);
+
+		// Several threads at once, as AssetLoader workers do
+		arena.Reset();
+		std::vector<Block> perThread[4];
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < 4; t++)
+			threads.emplace_back([&arena, &perThread, t]() { perThread[t] = AllocateMany(arena, 500, 10 + t); });
+		for (std::thread& thread : threads)
+			thread.join();
+		std::vector<Block> all;
+		for (auto const& list : perThread)
+			all.insert(all.end(), list.begin(), list.end());
+		CHECK(Disjoint(all));
+		CHECK(arena.GetStats().allocationCount == 2000);
+
+		// Release hands every chunk back
+		arena.Release();
+		CHECK(arena.GetStats().chunkCount == 0 && upstream.GetLiveBytes() == 0);
+	}
+
+	// Meshes: a level loaded, dropped with Reset and loaded again needs no new chunks
+	std::string fileName = GetTempFile("GeometryArenaTests.dat");
+	CHECK(WriteTextMesh(fileName, MakeSphere(100, 200, 0.01f)));
+	{
+		GeometryArena arena(size_t(4) << 20, &upstream);
+		std::vector<unsigned int> vertexCounts;
+		size_t chunks[2] = {};
+		for (int pass = 0; pass < 2; pass++)
+		{
+			{
+				std::vector<std::unique_ptr<Mesh>> level;
+				for (int i = 0; i < 4; i++)
+					level.push_back(std::make_unique<Mesh>(fileName, &arena));
+				for (auto const& mesh : level)
+					vertexCounts.push_back(mesh->GetVertexCount());
+				CHECK(arena.GetStats().allocationCount > 0);
+			}
+			chunks[pass] = arena.GetStats().upstreamAllocations;
+			arena.Reset();
+		}
+		CHECK(chunks[0] > 0 && chunks[1] == chunks[0]);
+		CHECK(std::all_of(vertexCounts.begin(), vertexCounts.end(), [&](unsigned int count) { return count == vertexCounts[0] && count > 0; }));
+	}
+	CHECK(upstream.GetLiveBytes() == 0);
+	std::remove(fileName.c_str());
+
+	return TestResult();
+}
@@ -0,0 +1,128 @@
+#include "pch.h"
+#include "IndexBuffer.h"
+#include "TestHarness.h"
+
+// Index buffer width selection (IndexBuffer.h): every range rebuilt as baseVertex plus
+// its 16-bit indices gives back the original 32-bit indices, the ranges cover the list
+// in order, and meshes that cannot be split in few enough windows keep 32-bit indices.
+
+namespace
+{
+	// Strip-like list (i, i + 1, i + 2) over vertexCount vertices: every triangle is local,
+	// so only the window size forces a split
+	std::vector<unsigned int> MakeStrip(unsigned int vertexCount)
+	{
+		std::vector<unsigned int> indices;
+		for (unsigned int i = 0; i + 2 < vertexCount; i++)
+		{
+			unsigned int triangle[3] = { i, i + 1, i + 2 };
+			indices.insert(indices.end(), triangle, triangle + 3);
+		}
+		return indices;
+	}
+
+	// The ranges tile [0, indexCount) in order and each one, drawn with its baseVertex,
+	// references exactly the original vertices
+	bool Rebuilds(std::vector<unsigned int> const& indices, std::pmr::vector<uint16_t> const& indices16,
+		std::vector<IndexRange> const& ranges, unsigned int firstIndex = 0)
+	{
+		unsigned int next = firstIndex;
+		for (IndexRange const& range : ranges)
+		{
+			if (range.startIndex != next || range.indexCount == 0 || range.indexCount % 3 != 0 || range.baseVertex < 0)
+				return false;
+			for (unsigned int i = range.startIndex; i < range.startIndex + range.indexCount; i++)
+				if ((unsigned int)(range.baseVertex) + indices16[i] != indices[i - firstIndex])
+					return false;
+			next += range.indexCount;
+		}
+		return next == firstIndex + indices.size();
+	}
+}
+
+int main()
+{
+	std::pmr::vector<uint16_t> indices16;
+	std::vector<IndexRange> ranges;
+
+	// Exactly 65536 vertices: one 16-bit range, the last vertex index 65535 included
+	{
+		std::vector<unsigned int> indices = MakeStrip(65536);
+		CHECK(indices.back() == 65535);
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), 65536, indices16, ranges) == IndexFormat::Uint16);
+		CHECK(ranges.size() == 1 && ranges[0].baseVertex == 0);
+		CHECK(Rebuilds(indices, indices16, ranges));
+	}
+
+	// 65537 vertices: the triangle that reaches vertex 65536 opens a second range
+	{
+		std::vector<unsigned int> indices = MakeStrip(65537);
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), 65537, indices16, ranges) == IndexFormat::Uint16);
+		CHECK(ranges.size() == 2);
+		CHECK(ranges[1].baseVertex > 0);
+		CHECK(Rebuilds(indices, indices16, ranges));
+	}
+
+	// A large mesh of local triangles splits in several windows
+	{
+		std::vector<unsigned int> indices = MakeStrip(1000000);
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), 1000000, indices16, ranges) == IndexFormat::Uint16);
+		CHECK(ranges.size() >= 1000000 / 65536);
+		CHECK(ranges.size() < c_maxIndexRanges);
+		CHECK(Rebuilds(indices, indices16, ranges));
+	}
+
+	// A triangle wider than a window cannot be drawn from any base: 32-bit fallback
+	{
+		std::vector<unsigned int> indices = MakeStrip(70000);
+		indices.insert(indices.end(), { 0, 1, 69999 });
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), 70000, indices16, ranges) == IndexFormat::Uint32);
+		CHECK(indices16.empty());
+		CHECK(ranges.size() == 1 && ranges[0].startIndex == 0 && ranges[0].indexCount == indices.size() && ranges[0].baseVertex == 0);
+	}
+
+	// Triangles jumping between the two ends of the mesh need a range each: past
+	// c_maxIndexRanges the split is not worth it and the indices stay 32-bit
+	{
+		const unsigned int vertexCount = 200000;
+		std::vector<unsigned int> indices;
+		for (unsigned int i = 0; i < 2 * c_maxIndexRanges; i++)
+		{
+			unsigned int v = (i % 2 == 0) ? i : vertexCount - 3 - i;
+			indices.insert(indices.end(), { v, v + 1, v + 2 });
+		}
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), vertexCount, indices16, ranges) == IndexFormat::Uint32);
+		CHECK(indices16.empty() && ranges.size() == 1);
+
+		// Just under the limit still splits
+		indices.resize(3 * (c_maxIndexRanges - 1));
+		CHECK(BuildIndexBuffer(indices.data(), indices.size(), vertexCount, indices16, ranges) == IndexFormat::Uint16);
+		CHECK(ranges.size() == c_maxIndexRanges - 1);
+		CHECK(Rebuilds(indices, indices16, ranges));
+	}
+
+	// Several lists share one buffer: each list's ranges start where the previous ended
+	// and rebuild that list; one list needing 32-bit indices takes all of them along
+	{
+		std::vector<unsigned int> lod0 = MakeStrip(100000);
+		std::vector<unsigned int> lod1 = MakeStrip(30000);
+		IndexList lists[2] = { { lod0.data(), lod0.size() }, { lod1.data(), lod1.size() } };
+		std::pmr::vector<unsigned int> indices32;
+		std::vector<std::vector<IndexRange>> listRanges;
+		CHECK(BuildIndexBuffer(lists, 2, 100000, indices16, indices32, listRanges) == IndexFormat::Uint16);
+		CHECK(indices32.empty() && listRanges.size() == 2);
+		CHECK(indices16.size() == lod0.size() + lod1.size());
+		CHECK(Rebuilds(lod0, indices16, listRanges[0]));
+		CHECK(Rebuilds(lod1, indices16, listRanges[1], (unsigned int)lod0.size()));
+
+		lod1.insert(lod1.end(), { 0, 1, 99999 });
+		lists[1] = { lod1.data(), lod1.size() };
+		CHECK(BuildIndexBuffer(lists, 2, 100000, indices16, indices32, listRanges) == IndexFormat::Uint32);
+		CHECK(indices16.empty() && indices32.size() == lod0.size() + lod1.size());
+		CHECK(listRanges[0].size() == 1 && listRanges[0][0].startIndex == 0 && listRanges[0][0].indexCount == lod0.size());
+		CHECK(listRanges[1].size() == 1 && listRanges[1][0].startIndex == lod0.size() && listRanges[1][0].indexCount == lod1.size());
+		CHECK(std::equal(lod1.begin(), lod1.end(), indices32.begin() + lod0.size()));
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,421 @@
+#include "pch.h"
+#include "Bvh.h"
+#include "CountingResource.h"
+#include "GeometryArena.h"
+#include "Mesh.h"
+#include "MeshImport.h"
+#include "Parallel.h"
+#include "RayQuery.h"
+#include "SyntheticMeshes.h"
+#include "VertexNormals.h"
+#include "VertexWeld.h"
+#include "TestHarness.h"
+#include <functional>
+
+// Times of the CPU side mesh pipeline on generated meshes. Sizes and seeds are fixed,
+// so runs on the same machine are comparable.
+//
+//   MeshBenchmark [--quick] [section...]
+//
+// --quick uses small meshes (ctest runs it that way to keep every section working);
+// naming sections runs only those.
+
+namespace
+{
+	bool quick = false;
+
+	// Full size, or the quick one
+	unsigned int Size(unsigned int full, unsigned int small) { return quick ? small : full; }
+
+	double Megabytes(uint64_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+	uint64_t GetFileSize(std::string const& fileName) { return std::filesystem::file_size(fileName); }
+
+	// Best of a few runs of what, in seconds
+	double Time(std::function<void()> const& what, int runs = 3)
+	{
+		double best = 1e30;
+		for (int run = 0; run < (quick ? 1 : runs); run++)
+		{
+			Stopwatch stopwatch;
+			what();
+			best = std::min(best, stopwatch.GetSeconds());
+		}
+		return best;
+	}
+
+	// Text mesh.dat against the cooked binary container: parsing plus load time
+	// processing, against mapping the cooked result.
+	void BenchmarkLoad()
+	{
+		unsigned int rings = Size(1000, 50), segments = Size(2000, 100);
+		std::string textFile = GetTempFile("bench_load.dat");
+		std::string binaryFile = GetTempFile("bench_load.mshb");
+		WriteTextMesh(textFile, MakeSphere(rings, segments, 0.01f));
+		ConvertTextMeshToBinary(textFile, binaryFile);
+
+		unsigned int vertexCount = 0;
+		double parse = Time([&]() { Mesh mesh; mesh.readFile(textFile); vertexCount = mesh.GetVertexCount(); });
+		double text = Time([&]() { Mesh mesh(textFile); });
+		double binary = Time([&]() { Mesh mesh(binaryFile); });
+		std::printf("load: %u vertices, text %.1f MB, binary %.1f MB\n", vertexCount, Megabytes(GetFileSize(textFile)), Megabytes(GetFileSize(binaryFile)));
+		std::printf("  text, parse only      %8.3f s\n", parse);
+		std::printf("  text, with processing %8.3f s\n", text);
+		std::printf("  binary, mapped        %8.3f s  (%.0fx)\n", binary, text / std::max(binary, 1e-9));
+
+		std::remove(textFile.c_str());
+		std::remove(binaryFile.c_str());
+	}
+
+	// The chunked parallel parser of the text layout on a 10M-vertex mesh.dat
+	void BenchmarkText()
+	{
+		unsigned int rings = Size(2500, 100), segments = Size(4000, 100);
+		std::string textFile = GetTempFile("bench_text.dat");
+		WriteTextMesh(textFile, MakeSphere(rings, segments, 0.01f));
+		uint64_t bytes = GetFileSize(textFile);
+
+		unsigned int vertexCount = 0, indexCount = 0;
+		double parse = Time([&]() {
+			Mesh mesh;
+			mesh.readFile(textFile);
+			vertexCount = mesh.GetVertexCount();
+			indexCount = mesh.GetIndexCount();
+		});
+		std::printf("text: %u vertices, %u indices, %.1f MB\n", vertexCount, indexCount, Megabytes(bytes));
+		std::printf("  parse %8.3f s  %.0f MB/s\n", parse, Megabytes(bytes) / parse);
+
+		std::remove(textFile.c_str());
+	}
+
+	// Vertices of every triangle corner of mesh, the way exporters split them
+	std::vector<Vertex> ExpandCorners(SyntheticMesh const& mesh)
+	{
+		std::vector<Vertex> vertices;
+		vertices.reserve(mesh.indices.size());
+		for (unsigned int index : mesh.indices)
+			vertices.push_back({ mesh.positions[index], XMFLOAT4(1.0f, 0.5f, 0.25f, 1.0f), mesh.normals[index] });
+		return vertices;
+	}
+
+	// Welding one vertex per corner back to shared vertices, in one partition and in
+	// as many as the workers pick
+	void BenchmarkWeld()
+	{
+		std::vector<Vertex> vertices = ExpandCorners(MakeSphere(Size(1000, 40), Size(1000, 40)));
+		WeldStream streams[] = {
+			{ &vertices.data()->pos, sizeof(Vertex), 3, 1e-5f },
+			{ &vertices.data()->normal, sizeof(Vertex), 3, 1e-3f },
+			{ &vertices.data()->col, sizeof(Vertex), 4, 1.0f / 512.0f },
+		};
+		std::vector<unsigned int> remap(vertices.size());
+
+		size_t unique = 0;
+		double single = Time([&]() { unique = BuildWeldRemap(remap.data(), streams, std::size(streams), vertices.size(), 1); });
+		double partitioned = Time([&]() { BuildWeldRemap(remap.data(), streams, std::size(streams), vertices.size()); });
+		std::printf("weld: %zu vertices to %zu\n", vertices.size(), unique);
+		std::printf("  1 partition   %8.3f s  %.1f M vertices/s\n", single, vertices.size() / single / 1e6);
+		std::printf("  partitioned   %8.3f s  %.1f M vertices/s\n", partitioned, vertices.size() / partitioned / 1e6);
+	}
+
+	// Normals generated from the triangles, angle and area weighted, in one block and in
+	// as many as the workers pick
+	void BenchmarkNormals()
+	{
+		SyntheticMesh mesh = MakeSphere(Size(1000, 50), Size(2000, 100), 0.01f);
+		std::vector<XMFLOAT3> normals(mesh.positions.size());
+		size_t triangleCount = mesh.indices.size() / 3;
+		auto generate = [&](NormalWeighting weighting, unsigned int blockCount) {
+			return Time([&]() {
+				GenerateVertexNormals(&normals[0].x, sizeof(XMFLOAT3), mesh.indices.data(), mesh.indices.size(),
+					&mesh.positions[0].x, sizeof(XMFLOAT3), mesh.positions.size(), weighting, blockCount);
+			});
+		};
+
+		std::printf("normals: %zu triangles, %zu vertices\n", triangleCount, mesh.positions.size());
+		for (NormalWeighting weighting : { NormalWeighting::Angle, NormalWeighting::Area })
+		{
+			const char* name = weighting == NormalWeighting::Angle ? "angle" : "area";
+			double single = generate(weighting, 1);
+			double blocks = generate(weighting, 0);
+			std::printf("  %-5s 1 block   %8.3f s  %.1f M triangles/s\n", name, single, triangleCount / single / 1e6);
+			std::printf("  %-5s blocks    %8.3f s  %.1f M triangles/s\n", name, blocks, triangleCount / blocks / 1e6);
+		}
+	}
+
+	// Box reduction, vectorized and scalar, and the full box plus sphere, over positions
+	// strided in Vertex like the mesh keeps them
+	void BenchmarkBounds()
+	{
+		size_t count = Size(20000000, 200000);
+		std::vector<Vertex> vertices(count);
+		std::mt19937 random(7);
+		std::normal_distribution<float> coordinate(0.0f, 10.0f);
+		for (Vertex& vertex : vertices)
+			vertex.pos = XMFLOAT3(coordinate(random), coordinate(random), coordinate(random));
+		const float* positions = &vertices.data()->pos.x;
+		double bytes = double(count) * sizeof(Vertex);
+
+		XMFLOAT3 boxMin, boxMax, scalarMin, scalarMax;
+		MeshBounds bounds;
+		double vector = Time([&]() { ComputeAabb(boxMin, boxMax, positions, sizeof(Vertex), count); });
+		double scalar = Time([&]() { ComputeAabbScalar(scalarMin, scalarMax, positions, sizeof(Vertex), count); });
+		double full = Time([&]() { bounds = ComputeMeshBounds(positions, sizeof(Vertex), count); });
+		bool same = std::memcmp(&boxMin, &scalarMin, sizeof(boxMin)) == 0 && std::memcmp(&boxMax, &scalarMax, sizeof(boxMax)) == 0;
+		std::printf("bounds: %zu vertices (%.0f MB), sphere radius %.2f, box %s\n", count, Megabytes(uint64_t(bytes)),
+			bounds.sphereRadius, same ? "matches the scalar one" : "DIFFERS from the scalar one");
+		std::printf("  box, DirectXMath  %8.4f s  %.2f GB/s\n", vector, bytes / vector / 1e9);
+		std::printf("  box, scalar       %8.4f s  %.2f GB/s\n", scalar, bytes / scalar / 1e9);
+		std::printf("  box and sphere    %8.4f s  %.2f GB/s\n", full, bytes / full / 1e9);
+	}
+
+	// mesh as an OBJ file with shared position and normal indices
+	std::string WriteObj(SyntheticMesh const& mesh)
+	{
+		std::string text;
+		char line[128];
+		for (XMFLOAT3 const& position : mesh.positions)
+			text.append(line, std::snprintf(line, sizeof(line), "v %.7g %.7g %.7g\n", position.x, position.y, position.z));
+		for (XMFLOAT3 const& normal : mesh.normals)
+			text.append(line, std::snprintf(line, sizeof(line), "vn %.7g %.7g %.7g\n", normal.x, normal.y, normal.z));
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			unsigned int a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+			text.append(line, std::snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n", a, a, b, b, c, c));
+		}
+		return text;
+	}
+
+	// mesh as a PLY file, ASCII or binary little endian, with float positions and normals
+	std::string WritePly(SyntheticMesh const& mesh, bool binary)
+	{
+		std::string text;
+		char line[128];
+		text.append(line, std::snprintf(line, sizeof(line), "ply\nformat %s 1.0\nelement vertex %zu\n",
+			binary ? "binary_little_endian" : "ascii", mesh.positions.size()));
+		text += "property float x\nproperty float y\nproperty float z\nproperty float nx\nproperty float ny\nproperty float nz\n";
+		text.append(line, std::snprintf(line, sizeof(line), "element face %zu\n", mesh.indices.size() / 3));
+		text += "property list uchar int vertex_indices\nend_header\n";
+		for (size_t i = 0; i < mesh.positions.size(); i++)
+		{
+			XMFLOAT3 const& p = mesh.positions[i];
+			XMFLOAT3 const& n = mesh.normals[i];
+			if (binary)
+			{
+				float values[] = { p.x, p.y, p.z, n.x, n.y, n.z };
+				text.append(reinterpret_cast<const char*>(values), sizeof(values));
+			}
+			else
+				text.append(line, std::snprintf(line, sizeof(line), "%.7g %.7g %.7g %.7g %.7g %.7g\n", p.x, p.y, p.z, n.x, n.y, n.z));
+		}
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			if (binary)
+			{
+				text += char(3);
+				text.append(reinterpret_cast<const char*>(&mesh.indices[i]), 3 * sizeof(unsigned int));
+			}
+			else
+				text.append(line, std::snprintf(line, sizeof(line), "3 %u %u %u\n", mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]));
+		}
+		return text;
+	}
+
+	// The OBJ and PLY importers over files already in memory, as Mesh maps them
+	void BenchmarkImport()
+	{
+		SyntheticMesh mesh = MakeSphere(Size(1000, 50), Size(1000, 50), 0.01f);
+		struct {
+			const char* name;
+			std::string data;
+			bool (*import)(const char*, const char*, XMFLOAT4 const&, std::pmr::vector<Vertex>&, std::pmr::vector<unsigned int>&, bool&);
+		} files[] = {
+			{ "OBJ", WriteObj(mesh), ImportObj },
+			{ "PLY ascii", WritePly(mesh, false), ImportPly },
+			{ "PLY binary", WritePly(mesh, true), ImportPly },
+		};
+
+		std::printf("import: %zu vertices, %zu triangles\n", mesh.positions.size(), mesh.indices.size() / 3);
+		for (auto const& file : files)
+		{
+			std::pmr::vector<Vertex> vertices;
+			std::pmr::vector<unsigned int> indices;
+			bool hasNormals = false, imported = false;
+			double seconds = Time([&]() {
+				imported = file.import(file.data.data(), file.data.data() + file.data.size(), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), vertices, indices, hasNormals);
+			});
+			bool complete = imported && hasNormals && indices.size() == mesh.indices.size();
+			std::printf("  %-10s %7.1f MB %8.3f s  %.0f MB/s%s\n", file.name, Megabytes(file.data.size()), seconds,
+				Megabytes(file.data.size()) / seconds, complete ? "" : "  FAILED");
+		}
+	}
+
+	// Binned SAH build on a smooth mesh and on a triangle soup: build rate and the
+	// quality of the tree it gives
+	void BenchmarkBvh()
+	{
+		struct {
+			const char* name;
+			SyntheticMesh mesh;
+		} meshes[] = {
+			{ "sphere", MakeSphere(Size(1000, 50), Size(1000, 50), 0.01f) },
+			{ "soup", MakeTriangleSoup(Size(1000000, 5000)) },
+		};
+
+		for (auto const& entry : meshes)
+		{
+			size_t triangleCount = entry.mesh.indices.size() / 3;
+			Bvh bvh;
+			double seconds = Time([&]() { BuildBvh(bvh, entry.mesh.indices, &entry.mesh.positions.data()->x, sizeof(XMFLOAT3)); });
+			BvhStats stats = GetBvhStats(bvh);
+			std::printf("bvh %s: %zu triangles, %zu nodes, depth %u, %.2f triangles per leaf, SAH cost %.1f\n", entry.name,
+				triangleCount, stats.nodeCount, stats.maxDepth, stats.averageLeafSize, stats.sahCost);
+			std::printf("  build %8.3f s  %.1f M triangles/s\n", seconds, triangleCount / seconds / 1e6);
+		}
+	}
+
+	// Closest and any hit queries against the 4-wide BVH, one ray at a time and in
+	// batches, with brute force over every triangle for scale
+	void BenchmarkRays()
+	{
+		SyntheticMesh mesh = MakeSphere(Size(1000, 50), Size(1000, 50), 0.01f);
+		const float* positions = &mesh.positions.data()->x;
+		RayBvh bvh;
+		double build = Time([&]() { BuildRayBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3)); }, 1);
+
+		// From a shell around the sphere towards points inside it: most rays hit
+		std::vector<Ray> rays(Size(1000000, 10000));
+		std::mt19937 random(9);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		for (Ray& ray : rays)
+		{
+			ray.origin = XMFLOAT3(unit(random) * 3.0f, unit(random) * 3.0f, unit(random) * 3.0f);
+			ray.direction = XMFLOAT3(unit(random) * 0.8f - ray.origin.x, unit(random) * 0.8f - ray.origin.y, unit(random) * 0.8f - ray.origin.z);
+			ray.tMin = 0.0f;
+			ray.tMax = FLT_MAX;
+		}
+
+		std::vector<RayHit> hits(rays.size());
+		std::vector<uint8_t> occluded(rays.size());
+		double single = Time([&]() { for (size_t i = 0; i < rays.size(); i++) IntersectClosest(bvh, rays[i], hits[i]); });
+		double closest = Time([&]() { IntersectClosest(bvh, rays.data(), hits.data(), rays.size()); });
+		double any = Time([&]() { IntersectAny(bvh, rays.data(), occluded.data(), rays.size()); });
+		size_t bruteCount = 20;
+		double brute = Time([&]() {
+			RayHit hit;
+			for (size_t i = 0; i < bruteCount; i++)
+				IntersectClosestBruteForce(mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3), rays[i], hit);
+		}, 1);
+		size_t hitCount = std::count_if(hits.begin(), hits.end(), [](RayHit const& hit) { return hit.triangle != c_noHit; });
+
+		std::printf("rays: %zu triangles, %zu rays, %zu hit, BVH built in %.3f s\n", mesh.indices.size() / 3, rays.size(), hitCount, build);
+		std::printf("  closest, one by one  %8.3f s  %.2f M rays/s\n", single, rays.size() / single / 1e6);
+		std::printf("  closest, batch       %8.3f s  %.2f M rays/s\n", closest, rays.size() / closest / 1e6);
+		std::printf("  any, batch           %8.3f s  %.2f M rays/s\n", any, rays.size() / any / 1e6);
+		std::printf("  brute force          %8.3f s  %.0f rays/s\n", brute, bruteCount / brute);
+	}
+
+	// Refitting a BVH after the mesh deforms against building it again: time, and the
+	// SAH cost each gives
+	void BenchmarkRefit()
+	{
+		SyntheticMesh rest = MakeSphere(Size(1000, 50), Size(1000, 50), 0.01f);
+		SyntheticMesh mesh = rest;
+		const float* positions = &mesh.positions.data()->x;
+		Bvh bvh, fresh;
+		BuildBvh(bvh, mesh.indices, positions, sizeof(XMFLOAT3));
+		float buildCost = bvh.buildSahCost;
+
+		// A wave along the normals, like a skinned or simulated surface
+		for (size_t i = 0; i < mesh.positions.size(); i++)
+		{
+			XMFLOAT3 const& p = rest.positions[i];
+			XMFLOAT3 const& n = rest.normals[i];
+			float offset = 0.05f * std::sin(6.0f * p.y) * std::cos(4.0f * p.x);
+			mesh.positions[i] = XMFLOAT3(p.x + n.x * offset, p.y + n.y * offset, p.z + n.z * offset);
+		}
+
+		float refitCost = 0.0f;
+		double refit = Time([&]() { refitCost = RefitBvh(bvh, mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3)); });
+		double rebuild = Time([&]() { BuildBvh(fresh, mesh.indices, positions, sizeof(XMFLOAT3)); });
+		std::printf("refit: %zu triangles, SAH cost %.1f at build\n", mesh.indices.size() / 3, buildCost);
+		std::printf("  refit    %8.3f s  SAH cost %.1f\n", refit, refitCost);
+		std::printf("  rebuild  %8.3f s  SAH cost %.1f  (refit %.0fx faster)\n", rebuild, fresh.buildSahCost, rebuild / std::max(refit, 1e-9));
+	}
+
+	// Loading a level of meshes with every buffer from the heap, against from a
+	// GeometryArena: heap allocations and time, and again after Reset
+	void BenchmarkArena()
+	{
+		unsigned int meshCount = Size(16, 4);
+		std::vector<std::string> fileNames;
+		for (unsigned int i = 0; i < meshCount; i++)
+		{
+			fileNames.push_back(GetTempFile("bench_arena_" + std::to_string(i) + ".dat"));
+			WriteTextMesh(fileNames.back(), MakeSphere(Size(300, 30) + i, Size(400, 40), 0.01f, i + 1));
+		}
+		auto loadLevel = [&](std::pmr::memory_resource* resource) {
+			std::vector<std::unique_ptr<Mesh>> level;
+			for (std::string const& fileName : fileNames)
+				level.push_back(std::make_unique<Mesh>(fileName, resource));
+		};
+
+		CountingResource heap;
+		double heapTime = Time([&]() { heap.ResetCount(); loadLevel(&heap); });
+		size_t heapAllocations = heap.GetAllocationCount();
+
+		CountingResource arenaHeap;
+		GeometryArena arena(size_t(16) << 20, &arenaHeap);
+		Stopwatch first;
+		loadLevel(&arena);
+		double arenaFirst = first.GetSeconds();
+		size_t arenaAllocations = arena.GetStats().allocationCount;
+		size_t firstChunks = arenaHeap.GetAllocationCount();
+		arena.Reset();
+		double arenaReused = Time([&]() { loadLevel(&arena); arena.Reset(); });
+
+		std::printf("arena: %u meshes\n", meshCount);
+		std::printf("  heap            %8.3f s  %zu heap allocations\n", heapTime, heapAllocations);
+		std::printf("  arena, first    %8.3f s  %zu heap allocations (%zu from the arena)\n", arenaFirst, firstChunks, arenaAllocations);
+		std::printf("  arena, reused   %8.3f s  %zu heap allocations\n", arenaReused, arenaHeap.GetAllocationCount() - firstChunks);
+
+		for (std::string const& fileName : fileNames)
+			std::remove(fileName.c_str());
+	}
+
+	struct Section {
+		const char* name;
+		void (*run)();
+	};
+
+	const Section c_sections[] = {
+		{ "load", BenchmarkLoad },
+		{ "text", BenchmarkText },
+		{ "weld", BenchmarkWeld },
+		{ "normals", BenchmarkNormals },
+		{ "bounds", BenchmarkBounds },
+		{ "import", BenchmarkImport },
+		{ "bvh", BenchmarkBvh },
+		{ "rays", BenchmarkRays },
+		{ "refit", BenchmarkRefit },
+		{ "arena", BenchmarkArena },
+	};
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> names;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--quick")
+			quick = true;
+		else
+			names.push_back(argv[i]);
+	}
+
+	std::printf("%u worker threads%s\n", GetWorkerCount(), quick ? ", quick sizes" : "");
+	for (Section const& section : c_sections)
+		if (names.empty() || std::find(names.begin(), names.end(), section.name) != names.end())
+			section.run();
+	return 0;
+}
@@ -0,0 +1,140 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "MeshBounds.h"
+#include "MeshFile.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <random>
+
+// Mesh bounds (MeshBounds.h): the box is exactly the min and max of the positions, the
+// sphere holds every position, and a version 1 .mshb, whose header has no bounds, gets
+// them computed from its vertices on load.
+
+namespace
+{
+	// Brute force box and containment, in double
+	bool BoundsHold(MeshBounds const& bounds, const XMFLOAT3* positions, size_t stride, size_t count)
+	{
+		auto at = [&](size_t i) { return *reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + i * stride); };
+		XMFLOAT3 low = at(0), high = at(0);
+		double radius = bounds.sphereRadius;
+		bool inside = true;
+		for (size_t i = 0; i < count; i++)
+		{
+			XMFLOAT3 p = at(i);
+			low = XMFLOAT3(std::min(low.x, p.x), std::min(low.y, p.y), std::min(low.z, p.z));
+			high = XMFLOAT3(std::max(high.x, p.x), std::max(high.y, p.y), std::max(high.z, p.z));
+			double dx = double(p.x) - bounds.sphereCenter.x, dy = double(p.y) - bounds.sphereCenter.y, dz = double(p.z) - bounds.sphereCenter.z;
+			inside = inside && std::sqrt(dx * dx + dy * dy + dz * dz) <= radius * (1.0 + 1e-5) + 1e-6;
+		}
+		bool tight = std::memcmp(&low, &bounds.boundsMin, sizeof(low)) == 0 && std::memcmp(&high, &bounds.boundsMax, sizeof(high)) == 0;
+
+		// Never worse than the sphere around the box centre
+		double ex = double(high.x) - low.x, ey = double(high.y) - low.y, ez = double(high.z) - low.z;
+		bool small = radius <= 0.5 * std::sqrt(ex * ex + ey * ey + ez * ez) * (1.0 + 1e-5) + 1e-6;
+		return tight && inside && small;
+	}
+
+	// Copy of a cooked file with the header patched by edit
+	std::string WritePatched(std::string const& source, std::string const& name, void (*edit)(MeshFileHeader&))
+	{
+		std::ifstream in(source, std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		edit(*reinterpret_cast<MeshFileHeader*>(bytes.data()));
+		std::string fileName = GetTempFile(name);
+		std::ofstream(fileName, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+		return fileName;
+	}
+
+	bool SameBounds(MeshBounds const& a, MeshBounds const& b)
+	{
+		return std::memcmp(&a, &b, sizeof(MeshBounds)) == 0;
+	}
+}
+
+int main()
+{
+	// Random clouds of every small size and a few large ones, offset and stretched so no
+	// axis looks like another, packed and strided in Vertex
+	{
+		std::mt19937 random(3);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		bool holds = true;
+		bool sameBox = true;
+		for (size_t count : { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 33, 1000, 65537, 300001 })
+		{
+			std::vector<Vertex> vertices(count);
+			for (Vertex& v : vertices)
+				v.pos = XMFLOAT3(100.0f + unit(random) * 3.0f, -20.0f + unit(random) * 0.5f, unit(random) * 40.0f);
+			std::vector<XMFLOAT3> positions(count);
+			for (size_t i = 0; i < count; i++)
+				positions[i] = vertices[i].pos;
+
+			MeshBounds strided = ComputeMeshBounds(&vertices[0].pos.x, sizeof(Vertex), count);
+			MeshBounds packed = ComputeMeshBounds(&positions[0].x, sizeof(XMFLOAT3), count);
+			holds = holds && BoundsHold(strided, &vertices[0].pos, sizeof(Vertex), count) && SameBounds(strided, packed);
+
+			XMFLOAT3 low, high, scalarLow, scalarHigh;
+			ComputeAabb(low, high, &positions[0].x, sizeof(XMFLOAT3), count);
+			ComputeAabbScalar(scalarLow, scalarHigh, &positions[0].x, sizeof(XMFLOAT3), count);
+			sameBox = sameBox && std::memcmp(&low, &scalarLow, sizeof(low)) == 0 && std::memcmp(&high, &scalarHigh, sizeof(high)) == 0;
+		}
+		CHECK(holds);
+		CHECK(sameBox);
+	}
+
+	// Meshes: a noisy sphere, whose bounding sphere is close to the unit one, and a soup
+	{
+		SyntheticMesh sphere = MakeSphere(100, 150, 0.02f);
+		MeshBounds bounds = ComputeMeshBounds(&sphere.positions[0].x, sizeof(XMFLOAT3), sphere.positions.size());
+		CHECK(BoundsHold(bounds, sphere.positions.data(), sizeof(XMFLOAT3), sphere.positions.size()));
+		CHECK(bounds.sphereRadius < 1.03f);
+
+		SyntheticMesh soup = MakeTriangleSoup(20000);
+		bounds = ComputeMeshBounds(&soup.positions[0].x, sizeof(XMFLOAT3), soup.positions.size());
+		CHECK(BoundsHold(bounds, soup.positions.data(), sizeof(XMFLOAT3), soup.positions.size()));
+	}
+
+	// All the points in one place: a point sphere; no points: all zero
+	{
+		std::vector<XMFLOAT3> same(100, XMFLOAT3(1.5f, -2.0f, 3.0f));
+		MeshBounds bounds = ComputeMeshBounds(&same[0].x, sizeof(XMFLOAT3), same.size());
+		CHECK(bounds.sphereRadius == 0.0f && BoundsHold(bounds, same.data(), sizeof(XMFLOAT3), same.size()));
+		MeshBounds empty = ComputeMeshBounds(nullptr, sizeof(XMFLOAT3), 0);
+		CHECK(SameBounds(empty, MeshBounds{}));
+	}
+
+	// .mshb: version 2 serves the bounds of its header as they are; version 1 has none
+	// there, so whatever the bytes say the bounds come from the mapped vertices
+	{
+		std::string textFile = GetTempFile("MeshBoundsTests.dat");
+		std::string binaryFile = GetTempFile("MeshBoundsTests.mshb");
+		CHECK(WriteTextMesh(textFile, MakeSphere(30, 40, 0.05f)));
+		CHECK(ConvertTextMeshToBinary(textFile, binaryFile));
+		Mesh text(textFile);
+		CHECK(BoundsHold(text.GetBounds(), &text.GetVertexData()->pos, sizeof(Vertex), text.GetVertexCount()));
+
+		std::string v2File = WritePatched(binaryFile, "MeshBoundsTests_v2.mshb", [](MeshFileHeader& header) {
+			header.bounds.boundsMin = XMFLOAT3(-7.0f, -7.0f, -7.0f);
+			header.bounds.sphereRadius = 1234.0f;
+		});
+		Mesh v2(v2File);
+		CHECK(v2.IsMapped());
+		CHECK(v2.GetBounds().sphereRadius == 1234.0f);
+
+		std::string v1File = WritePatched(binaryFile, "MeshBoundsTests_v1.mshb", [](MeshFileHeader& header) {
+			header.version = 1;
+			header.bounds.boundsMin = XMFLOAT3(-7.0f, -7.0f, -7.0f);
+			header.bounds.sphereRadius = 1234.0f;
+		});
+		Mesh v1(v1File);
+		CHECK(v1.IsMapped() && v1.GetVertexCount() == text.GetVertexCount());
+		CHECK(SameBounds(v1.GetBounds(), text.GetBounds()));
+		CHECK(BoundsHold(v1.GetBounds(), &v1.GetVertexData()->pos, sizeof(Vertex), v1.GetVertexCount()));
+
+		for (std::string const& fileName : { textFile, binaryFile, v1File, v2File })
+			std::remove(fileName.c_str());
+	}
+
+	return TestResult();
+}
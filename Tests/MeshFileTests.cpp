@@ -0,0 +1,91 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Binary mesh container (MeshFile.h): cooked files load mapped and match the text
+// mesh they came from; files with the magic but unusable contents are rejected.
+
+namespace
+{
+	bool SameVertices(Mesh const& a, Mesh const& b)
+	{
+		return a.GetVertexCount() == b.GetVertexCount() &&
+			std::memcmp(a.GetVertexData(), b.GetVertexData(), a.GetVertexCount() * sizeof(Vertex)) == 0;
+	}
+
+	bool SameIndices(Mesh const& a, Mesh const& b)
+	{
+		return a.GetIndexCount() == b.GetIndexCount() &&
+			std::memcmp(a.GetIndexData(), b.GetIndexData(), a.GetIndexCount() * sizeof(unsigned int)) == 0;
+	}
+
+	// Copy of the cooked file with the header patched by edit, or cut to size bytes
+	std::string WriteCorrupted(std::string const& source, std::string const& name, void (*edit)(MeshFileHeader&), size_t size = SIZE_MAX)
+	{
+		std::ifstream in(source, std::ios::binary);
+		std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if (edit != nullptr)
+			edit(*reinterpret_cast<MeshFileHeader*>(bytes.data()));
+		bytes.resize(std::min(size, bytes.size()));
+		std::string fileName = GetTempFile(name);
+		std::ofstream(fileName, std::ios::binary | std::ios::trunc).write(bytes.data(), bytes.size());
+		return fileName;
+	}
+
+	bool Throws(std::string const& fileName)
+	{
+		try
+		{
+			Mesh mesh(fileName);
+		}
+		catch (std::exception const&)
+		{
+			return true;
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	std::string textFile = GetTempFile("MeshFileTests.dat");
+	std::string binaryFile = GetTempFile("MeshFileTests.mshb");
+	CHECK(WriteTextMesh(textFile, MakeSphere(40, 60, 0.05f)));
+
+	// Round trip: the cooked mesh is mapped and identical to the processed text mesh
+	Mesh text(textFile);
+	CHECK(text.GetVertexCount() > 0 && text.GetIndexCount() == 40 * 60 * 6);
+	CHECK(!text.IsMapped());
+	CHECK(ConvertTextMeshToBinary(textFile, binaryFile));
+	CHECK(IsBinaryMeshFile(binaryFile));
+	CHECK(!IsBinaryMeshFile(textFile));
+
+	Mesh binary(binaryFile);
+	CHECK(binary.IsMapped());
+	CHECK(SameVertices(text, binary));
+	CHECK(SameIndices(text, binary));
+	CHECK(binary.GetBounds().sphereRadius == text.GetBounds().sphereRadius);
+	CHECK(binary.GetIndexRanges().size() == text.GetIndexRanges().size());
+	CHECK(uintptr_t(binary.GetVertexData()) % c_meshFileAlignment == 0);
+
+	// Right magic, wrong contents: an error, never an empty mesh
+	CHECK(Throws(WriteCorrupted(binaryFile, "version.mshb", [](MeshFileHeader& header) { header.version = c_meshFileVersion + 1; })));
+	CHECK(Throws(WriteCorrupted(binaryFile, "stride.mshb", [](MeshFileHeader& header) { header.vertexStride = sizeof(Vertex) + 4; })));
+	CHECK(Throws(WriteCorrupted(binaryFile, "count.mshb", [](MeshFileHeader& header) { header.indexCount *= 2; })));
+	CHECK(Throws(WriteCorrupted(binaryFile, "truncated.mshb", nullptr, sizeof(MeshFileHeader) + 100)));
+	CHECK(Throws(WriteCorrupted(binaryFile, "header.mshb", nullptr, 8)));
+	CHECK(!Throws(WriteCorrupted(binaryFile, "copy.mshb", nullptr)));
+
+	// Levels the mesh does not have have no ranges
+	CHECK(!text.GetIndexRanges(0).empty());
+	CHECK(text.GetIndexRanges(text.GetLodCount() + 5).empty());
+	Mesh missing(GetTempFile("does_not_exist.dat"));
+	CHECK(missing.GetVertexCount() == 0);
+	for (IndexRange const& range : missing.GetIndexRanges())
+		CHECK(range.indexCount == 0);
+
+	std::remove(textFile.c_str());
+	std::remove(binaryFile.c_str());
+	return TestResult();
+}
@@ -0,0 +1,258 @@
+#include "pch.h"
+#include "MeshImport.h"
+#include "TestHarness.h"
+
+// OBJ and PLY importers (MeshImport.h) on small files written inline: OBJ polygons are
+// fanned, every corner form and negative references resolve to the right vertex and
+// references outside the file are refused; PLY reads the same mesh from ASCII, binary
+// little endian and big endian bodies, with uchar colours scaled to [0, 1].
+
+namespace
+{
+	const XMFLOAT4 c_defaultColor(0.25f, 0.5f, 0.75f, 1.0f);
+
+	struct Imported {
+		bool ok = false;
+		bool hasNormals = false;
+		std::pmr::vector<Vertex> vertices;
+		std::pmr::vector<unsigned int> indices;
+	};
+
+	Imported Import(std::string const& text, MeshFileType type)
+	{
+		Imported imported;
+		const char* begin = text.data();
+		const char* end = begin + text.size();
+		imported.ok = type == MeshFileType::Obj
+			? ImportObj(begin, end, c_defaultColor, imported.vertices, imported.indices, imported.hasNormals)
+			: ImportPly(begin, end, c_defaultColor, imported.vertices, imported.indices, imported.hasNormals);
+		return imported;
+	}
+
+	bool Equal(XMFLOAT3 const& a, XMFLOAT3 const& b) { return a.x == b.x && a.y == b.y && a.z == b.z; }
+	bool Equal(XMFLOAT4 const& a, XMFLOAT4 const& b) { return a.x == b.x && a.y == b.y && a.z == b.z && a.w == b.w; }
+
+	bool SameIndices(Imported const& imported, std::vector<unsigned int> const& expected)
+	{
+		return std::equal(imported.indices.begin(), imported.indices.end(), expected.begin(), expected.end());
+	}
+
+	// Corner by corner, the position and normal each index of the triangles points at
+	bool CornersAre(Imported const& imported, std::vector<XMFLOAT3> const& positions, std::vector<XMFLOAT3> const& normals)
+	{
+		if (imported.indices.size() != positions.size())
+			return false;
+		for (size_t k = 0; k < positions.size(); k++)
+		{
+			Vertex const& v = imported.vertices[imported.indices[k]];
+			if (!Equal(v.pos, positions[k]) || (!normals.empty() && !Equal(v.normal, normals[k])))
+				return false;
+		}
+		return true;
+	}
+
+	template <typename T>
+	void Put(std::string& bytes, T value, bool bigEndian)
+	{
+		char raw[sizeof(T)];
+		std::memcpy(raw, &value, sizeof(T));
+		if (bigEndian)
+			std::reverse(raw, raw + sizeof(T));
+		bytes.append(raw, sizeof(T));
+	}
+
+	// Five vertices with normals and colours, a quad and a triangle
+	struct PlyVertex {
+		float x, y, z, nx, ny, nz;
+		uint8_t red, green, blue;
+	};
+	const PlyVertex c_plyVertices[] = {
+		{ 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 255, 0, 0 },
+		{ 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0, 255, 0 },
+		{ 1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0, 0, 255 },
+		{ 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 128, 64, 0 },
+		{ 2.0f, 0.5f, -0.25f, 1.0f, 0.0f, 0.0f, 1, 2, 3 },
+	};
+	const std::vector<unsigned int> c_plyFaces[] = { { 0, 1, 2, 3 }, { 1, 4, 2 } };
+
+	std::string MakePlyHeader(const char* format)
+	{
+		return std::string("ply\nformat ") + format + " 1.0\ncomment written by MeshImportTests\n"
+			"element vertex 5\nproperty float x\nproperty float y\nproperty float z\n"
+			"property float nx\nproperty float ny\nproperty float nz\n"
+			"property uchar red\nproperty uchar green\nproperty uchar blue\n"
+			"element face 2\nproperty list uchar int vertex_indices\nend_header\n";
+	}
+
+	std::string MakePlyAscii()
+	{
+		std::string text = MakePlyHeader("ascii");
+		char line[256];
+		for (PlyVertex const& v : c_plyVertices)
+			text += std::string(line, std::snprintf(line, sizeof(line), "%g %g %g %g %g %g %u %u %u\n",
+				v.x, v.y, v.z, v.nx, v.ny, v.nz, v.red, v.green, v.blue));
+		for (auto const& face : c_plyFaces)
+		{
+			text += std::to_string(face.size());
+			for (unsigned int index : face)
+				text += " " + std::to_string(index);
+			text += "\n";
+		}
+		return text;
+	}
+
+	std::string MakePlyBinary(bool bigEndian)
+	{
+		std::string bytes = MakePlyHeader(bigEndian ? "binary_big_endian" : "binary_little_endian");
+		for (PlyVertex const& v : c_plyVertices)
+		{
+			for (float value : { v.x, v.y, v.z, v.nx, v.ny, v.nz })
+				Put(bytes, value, bigEndian);
+			for (uint8_t value : { v.red, v.green, v.blue })
+				Put(bytes, value, bigEndian);
+		}
+		for (auto const& face : c_plyFaces)
+		{
+			Put(bytes, uint8_t(face.size()), bigEndian);
+			for (unsigned int index : face)
+				Put(bytes, int32_t(index), bigEndian);
+		}
+		return bytes;
+	}
+}
+
+int main()
+{
+	const XMFLOAT3 p0(0.0f, 0.0f, 0.0f), p1(1.0f, 0.0f, 0.0f), p2(1.0f, 1.0f, 0.0f), p3(0.0f, 1.0f, 0.0f), p4(2.0f, 0.5f, 0.0f);
+
+	// OBJ quad and pentagon of plain v corners: fanned around their first corner, one
+	// vertex per position, no normals, the default colour
+	{
+		Imported obj = Import(
+			"# quad and pentagon\n"
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nv 2 0.5 0\n"
+			"vt 0 0\n"
+			"g polygons\n"
+			"f 1 2 3 4\n"
+			"f 1 2 5 3 4\n", MeshFileType::Obj);
+		CHECK(obj.ok && !obj.hasNormals);
+		CHECK(obj.vertices.size() == 5);
+		CHECK(SameIndices(obj, { 0, 1, 2, 0, 2, 3, 0, 1, 4, 0, 4, 2, 0, 2, 3 }));
+		CHECK(Equal(obj.vertices[4].pos, p4) && Equal(obj.vertices[4].col, c_defaultColor));
+	}
+
+	// v//vn numbered like the positions: one vertex per position, normals kept
+	{
+		Imported obj = Import(
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\n"
+			"vn 0 0 1\nvn 0 1 0\nvn 1 0 0\n"
+			"f 1//1 2//2 3//3\n", MeshFileType::Obj);
+		CHECK(obj.ok && obj.hasNormals);
+		CHECK(obj.vertices.size() == 3);
+		CHECK(SameIndices(obj, { 0, 1, 2 }));
+		CHECK(Equal(obj.vertices[1].normal, XMFLOAT3(0.0f, 1.0f, 0.0f)));
+	}
+
+	// v/vt/vn with normals numbered apart from the positions: every corner gets its own
+	// position and normal
+	{
+		Imported obj = Import(
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+			"vt 0 0\nvt 1 0\nvt 1 1\n"
+			"vn 0 0 1\nvn 0 0 -1\n"
+			"f 1/1/1 2/2/1 3/3/1 4/1/1\n"
+			"f 3/3/2 2/2/2 1/1/2\n", MeshFileType::Obj);
+		const XMFLOAT3 up(0.0f, 0.0f, 1.0f), down(0.0f, 0.0f, -1.0f);
+		CHECK(obj.ok && obj.hasNormals);
+		CHECK(CornersAre(obj, { p0, p1, p2, p0, p2, p3, p2, p1, p0 }, { up, up, up, up, up, up, down, down, down }));
+	}
+
+	// v/vt corners or a corner without a normal: no normals for the mesh
+	{
+		Imported obj = Import("v 0 0 0\nv 1 0 0\nv 1 1 0\nvt 0 0\nvn 0 0 1\nf 1/1 2/1 3/1\n", MeshFileType::Obj);
+		CHECK(obj.ok && !obj.hasNormals);
+		obj = Import("v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1//1 2//1 3\n", MeshFileType::Obj);
+		CHECK(obj.ok && !obj.hasNormals);
+		CHECK(CornersAre(obj, { p0, p1, p2 }, {}));
+	}
+
+	// Negative references count back from the last element defined so far, for
+	// positions and normals alike; colours after the position are read
+	{
+		Imported obj = Import(
+			"v 0 0 0 1 0 0\nv 1 0 0 0 1 0\nv 1 1 0 0 0 1\n"
+			"vn 0 0 1\n"
+			"f -3//-1 -2//-1 -1//-1\n"
+			"v 0 1 0\nv 2 0.5 0\n"
+			"vn 0 0 -1\n"
+			"f -5//-1 -1//-1 -2//-2\n", MeshFileType::Obj);
+		const XMFLOAT3 up(0.0f, 0.0f, 1.0f), down(0.0f, 0.0f, -1.0f);
+		CHECK(obj.ok && obj.hasNormals);
+		CHECK(CornersAre(obj, { p0, p1, p2, p0, p4, p3 }, { up, up, up, down, down, up }));
+		CHECK(Equal(obj.vertices[obj.indices[1]].col, XMFLOAT4(0.0f, 1.0f, 0.0f, 1.0f)));
+	}
+
+	// References outside the file, or to elements not defined yet, are refused
+	{
+		const char* broken[] = {
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 2 4\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nf 0 1 2\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nf -4 -2 -1\n",
+			"v 0 0 0\nv 1 0 0\nf 1 2 3\nv 1 1 0\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1//1 2//2 3//1\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nvn 0 0 1\nf 1//-2 2//1 3//1\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nf 1 x 3\n",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\n",	// no faces
+		};
+		for (const char* text : broken)
+			CHECK(!Import(text, MeshFileType::Obj).ok);
+	}
+
+	// PLY: the ASCII file is read as written, uchar colours divided by 255, opaque
+	Imported ascii = Import(MakePlyAscii(), MeshFileType::Ply);
+	{
+		CHECK(ascii.ok && ascii.hasNormals);
+		CHECK(ascii.vertices.size() == std::size(c_plyVertices));
+		CHECK(SameIndices(ascii, { 0, 1, 2, 0, 2, 3, 1, 4, 2 }));
+		bool same = true;
+		for (size_t i = 0; i < std::size(c_plyVertices); i++)
+		{
+			PlyVertex const& v = c_plyVertices[i];
+			Vertex const& imported = ascii.vertices[i];
+			same = same && Equal(imported.pos, XMFLOAT3(v.x, v.y, v.z)) && Equal(imported.normal, XMFLOAT3(v.nx, v.ny, v.nz)) &&
+				std::fabs(imported.col.x - v.red / 255.0f) < 1e-6f && std::fabs(imported.col.y - v.green / 255.0f) < 1e-6f &&
+				std::fabs(imported.col.z - v.blue / 255.0f) < 1e-6f && imported.col.w == 1.0f;
+		}
+		CHECK(same);
+		CHECK(ascii.vertices[0].col.x == 1.0f && ascii.vertices[1].col.x == 0.0f);
+	}
+
+	// Binary little and big endian bodies give exactly the ASCII mesh
+	for (bool bigEndian : { false, true })
+	{
+		Imported binary = Import(MakePlyBinary(bigEndian), MeshFileType::Ply);
+		CHECK(binary.ok && binary.hasNormals);
+		CHECK(binary.indices == ascii.indices);
+		CHECK(binary.vertices.size() == ascii.vertices.size() &&
+			std::memcmp(binary.vertices.data(), ascii.vertices.data(), ascii.vertices.size() * sizeof(Vertex)) == 0);
+
+		// Truncated bodies are refused
+		std::string truncated = MakePlyBinary(bigEndian);
+		truncated.resize(truncated.size() - 2);
+		CHECK(!Import(truncated, MeshFileType::Ply).ok);
+	}
+
+	// PLY faces naming a vertex past the end, and files without positions, are refused
+	{
+		std::string text = MakePlyAscii();
+		text.replace(text.rfind("3 1 4 2"), 7, "3 1 5 2");
+		CHECK(!Import(text, MeshFileType::Ply).ok);
+
+		std::string noZ = MakePlyAscii();
+		noZ.replace(noZ.find("property float z"), 16, "property float w");
+		CHECK(!Import(noZ, MeshFileType::Ply).ok);
+		CHECK(!Import("ply\nformat ascii 1.0\nelement vertex 1\nproperty float x\n", MeshFileType::Ply).ok);
+	}
+
+	return TestResult();
+}
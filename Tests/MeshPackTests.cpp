@@ -0,0 +1,157 @@
+#include "pch.h"
+#include "MeshPack.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Mesh packs (MeshPack.h): thousands of meshes packed into shared buffers draw exactly
+// the triangles and vertices they drew on their own, through both index widths, and a
+// written pack reads back identical.
+
+namespace
+{
+	std::unique_ptr<Mesh> MakeMesh(SyntheticMesh const& source, VertexFormat format)
+	{
+		// No file: the geometry is filled in and the GPU copies built by SetVertexFormat
+		auto mesh = std::make_unique<Mesh>(std::string());
+		for (size_t i = 0; i < source.positions.size(); i++)
+			mesh->vertices.push_back({ source.positions[i], XMFLOAT4(0.2f, 0.4f, 0.6f, 1.0f), source.normals[i] });
+		mesh->indices.assign(source.indices.begin(), source.indices.end());
+		mesh->SetVertexFormat(format);
+		return mesh;
+	}
+
+	// Index i of a buffer of either width
+	unsigned int GetIndex(IndexBufferView const& buffer, size_t i)
+	{
+		return buffer.format == IndexFormat::Uint16 ? buffer.As<uint16_t>()[i] : buffer.As<unsigned int>()[i];
+	}
+
+	// Vertices the draws of a level reference, relative to the mesh's first vertex
+	template <typename Ranges>
+	std::vector<unsigned int> Resolve(IndexBufferView const& buffer, Ranges const& ranges, unsigned int baseVertex)
+	{
+		std::vector<unsigned int> resolved;
+		for (IndexRange const& range : ranges)
+			for (unsigned int i = range.startIndex; i < range.startIndex + range.indexCount; i++)
+				resolved.push_back(GetIndex(buffer, i) + range.baseVertex - baseVertex);
+		return resolved;
+	}
+
+	// Every range of every level moved by the mesh's baseVertex and startIndex, drawing
+	// the same triangles over the same vertex bytes as the mesh itself
+	void CheckPack(MeshPack const& pack, std::vector<std::unique_ptr<Mesh>> const& meshes, MeshPackOptions const& options)
+	{
+		CHECK(pack.meshes.size() == meshes.size());
+		IndexBufferView buffer = pack.GetIndexBuffer();
+		size_t badRanges = 0, badTriangles = 0, badVertices = 0;
+		for (size_t m = 0; m < meshes.size() && m < pack.meshes.size(); m++)
+		{
+			Mesh const& mesh = *meshes[m];
+			PackedMesh const& packed = pack.meshes[m];
+			CHECK(packed.baseVertex % options.vertexAlignment == 0);
+			CHECK(packed.startIndex * buffer.GetStride() % options.indexAlignment == 0);
+			CHECK(packed.vertexCount == mesh.GetVertexCount() && packed.levelCount == mesh.GetLodCount());
+
+			for (unsigned int level = 0; level < mesh.GetLodCount(); level++)
+			{
+				std::vector<IndexRange> const& own = mesh.GetIndexRanges(level);
+				IndexRangeList moved = pack.GetIndexRanges(m, level);
+				CHECK(moved.count == own.size());
+				for (size_t r = 0; r < own.size() && r < moved.count; r++)
+					badRanges += moved.ranges[r].startIndex != own[r].startIndex + packed.startIndex ||
+						moved.ranges[r].baseVertex != own[r].baseVertex + int(packed.baseVertex) ||
+						moved.ranges[r].indexCount != own[r].indexCount;
+				badTriangles += Resolve(buffer, moved, packed.baseVertex) != Resolve(mesh.GetIndexBuffer(), own, 0);
+			}
+
+			const uint8_t* source = static_cast<const uint8_t*>(mesh.GetVertexBufferData());
+			for (unsigned int slot = 0; slot < pack.GetVertexSlotCount(); slot++)
+			{
+				unsigned int stride = pack.GetVertexStride(slot);
+				badVertices += std::memcmp(pack.vertexData.data() + pack.vertexStreamOffsets[slot] + size_t(packed.baseVertex) * stride,
+					source + mesh.GetVertexStreamOffset(slot), size_t(packed.vertexCount) * stride) != 0;
+			}
+		}
+		CHECK(badRanges == 0);
+		CHECK(badTriangles == 0);
+		CHECK(badVertices == 0);
+	}
+
+	template <typename T>
+	bool SameTable(std::vector<T> const& a, std::vector<T> const& b)
+	{
+		return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+	}
+
+	void CheckRoundTrip(MeshPack const& pack, std::string const& name)
+	{
+		std::string fileName = GetTempFile(name);
+		MeshPack read;
+		CHECK(WriteMeshPack(pack, fileName));
+		CHECK(ReadMeshPack(read, fileName));
+		CHECK(read.vertexFormat == pack.vertexFormat && read.indexFormat == pack.indexFormat && read.vertexCount == pack.vertexCount);
+		CHECK(std::equal(std::begin(read.vertexStreamOffsets), std::end(read.vertexStreamOffsets), std::begin(pack.vertexStreamOffsets)));
+		CHECK(SameTable(read.meshes, pack.meshes) && SameTable(read.levels, pack.levels) && SameTable(read.ranges, pack.ranges));
+		CHECK(SameTable(read.vertexData, pack.vertexData));
+		CHECK(SameTable(read.indices16, pack.indices16) && SameTable(read.indices32, pack.indices32));
+		std::remove(fileName.c_str());
+	}
+}
+
+int main()
+{
+	// Thousands of small meshes of different sizes, every hundredth with levels of detail
+	const unsigned int meshCount = 3000;
+	std::vector<std::unique_ptr<Mesh>> meshes;
+	for (unsigned int i = 0; i < meshCount; i++)
+	{
+		meshes.push_back(MakeMesh(MakeSphere(3 + i % 13, 4 + i % 17, 0.01f, i + 1), VertexFormat::Float));
+		if (i % 100 == 0)
+			meshes.back()->GenerateLods({ { 0.5f, 0.05f }, { 0.25f, 0.05f } });
+	}
+	MeshPackOptions options;
+	options.vertexAlignment = 4;
+	options.indexAlignment = 16;
+
+	MeshPack pack;
+	std::vector<Mesh const*> views;
+	for (auto const& mesh : meshes)
+		views.push_back(mesh.get());
+	CHECK(PackMeshes(pack, views, options));
+	CHECK(pack.indexFormat == IndexFormat::Uint16);
+	CheckPack(pack, meshes, options);
+	CheckRoundTrip(pack, "MeshPackTests_16.mpak");
+
+	// A mesh whose indices cannot be split into 16-bit ranges widens the whole pack;
+	// a large sphere that needs several 16-bit ranges makes sure their baseVertex survives
+	SyntheticMesh scattered = MakeSphere(300, 300);
+	std::mt19937 random(12);
+	std::shuffle(scattered.indices.begin(), scattered.indices.end(), random);
+	meshes.push_back(MakeMesh(scattered, VertexFormat::Float));
+	CHECK(meshes.back()->GetIndexFormat() == IndexFormat::Uint32);
+	meshes.push_back(MakeMesh(MakeSphere(400, 400), VertexFormat::Float));
+	CHECK(meshes.back()->GetIndexFormat() == IndexFormat::Uint16 && meshes.back()->GetIndexRanges().size() > 1);
+	std::swap(meshes[10], meshes[meshes.size() - 2]);
+
+	views.clear();
+	for (auto const& mesh : meshes)
+		views.push_back(mesh.get());
+	CHECK(PackMeshes(pack, views, options));
+	CHECK(pack.indexFormat == IndexFormat::Uint32 && pack.indices16.empty());
+	CheckPack(pack, meshes, options);
+	CheckRoundTrip(pack, "MeshPackTests_32.mpak");
+
+	// Split streams: every stream of every mesh lands at the same baseVertex
+	for (auto const& mesh : meshes)
+		mesh->SetVertexFormat(VertexFormat::PackedSplit);
+	CHECK(PackMeshes(pack, views, options));
+	CHECK(pack.GetVertexSlotCount() == 2);
+	CheckPack(pack, meshes, options);
+	CheckRoundTrip(pack, "MeshPackTests_split.mpak");
+
+	// Mixed vertex formats cannot share a buffer
+	meshes[0]->SetVertexFormat(VertexFormat::Float);
+	CHECK(!PackMeshes(pack, views, options) && pack.meshes.empty());
+
+	return TestResult();
+}
@@ -0,0 +1,184 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <random>
+
+// Meshlets (Meshlet.h): the clusters partition the triangle list, every triangle in
+// exactly one of them, and culling never drops a meshlet that a brute force test over
+// its triangles would keep.
+
+namespace
+{
+	// Every triangle in exactly one meshlet, in index buffer order, with local indices
+	// that lead back to the original vertices and lists within the meshlet limits
+	void CheckPartition(std::vector<Meshlet> const& meshlets, const unsigned int* meshletVertices, const uint8_t* meshletTriangles,
+		const unsigned int* indices, size_t indexCount)
+	{
+		std::vector<unsigned int> owners(indexCount / 3, 0);
+		for (Meshlet const& meshlet : meshlets)
+		{
+			CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= c_meshletMaxTriangles);
+			CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= c_meshletMaxVertices);
+			const unsigned int* vertices = meshletVertices + meshlet.vertexOffset;
+			std::vector<unsigned int> sorted(vertices, vertices + meshlet.vertexCount);
+			std::sort(sorted.begin(), sorted.end());
+			CHECK(std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end());
+
+			for (unsigned int t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount && t < owners.size(); t++)
+			{
+				owners[t]++;
+				for (size_t k = 0; k < 3; k++)
+				{
+					uint8_t local = meshletTriangles[t * 3 + k];
+					CHECK(local < meshlet.vertexCount && vertices[local] == indices[t * 3 + k]);
+				}
+			}
+		}
+		CHECK(std::all_of(owners.begin(), owners.end(), [](unsigned int owner) { return owner == 1; }));
+		for (size_t m = 1; m < meshlets.size(); m++)
+			CHECK(meshlets[m].triangleOffset == meshlets[m - 1].triangleOffset + meshlets[m - 1].triangleCount);
+	}
+
+	XMFLOAT3 Sub(XMFLOAT3 const& a, XMFLOAT3 const& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+	float Dot(XMFLOAT3 const& a, XMFLOAT3 const& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	XMFLOAT3 Cross(XMFLOAT3 const& a, XMFLOAT3 const& b) { return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x); }
+
+	// Brute force: does any triangle of the meshlet face the camera?
+	bool AnyTriangleFacing(Mesh const& mesh, Meshlet const& meshlet, XMFLOAT3 const& camera)
+	{
+		const Vertex* vertices = mesh.GetVertexData();
+		const unsigned int* indices = mesh.GetIndexData();
+		for (unsigned int t = meshlet.triangleOffset; t < meshlet.triangleOffset + meshlet.triangleCount; t++)
+		{
+			XMFLOAT3 const& p0 = vertices[indices[t * 3]].pos;
+			XMFLOAT3 n = Cross(Sub(vertices[indices[t * 3 + 1]].pos, p0), Sub(vertices[indices[t * 3 + 2]].pos, p0));
+			if (Dot(n, Sub(camera, p0)) > 0.0f)
+				return true;
+		}
+		return false;
+	}
+
+	// Brute force: is any vertex of the meshlet inside all the frustum planes at once
+	// for each plane, i.e. not all of them behind a single plane?
+	bool AnyPlaneRejectsAll(Mesh const& mesh, Meshlet const& meshlet, const unsigned int* meshletVertices, MeshletView const& view)
+	{
+		for (XMFLOAT4 const& plane : view.planes)
+		{
+			bool allOutside = true;
+			for (unsigned int i = 0; i < meshlet.vertexCount && allOutside; i++)
+			{
+				XMFLOAT3 const& p = mesh.GetVertexData()[meshletVertices[meshlet.vertexOffset + i]].pos;
+				allOutside = plane.x * p.x + plane.y * p.y + plane.z * p.z + plane.w < 0.0f;
+			}
+			if (allOutside)
+				return true;
+		}
+		return false;
+	}
+
+	// Left handed perspective (D3D clip space) of a camera at position looking down +z
+	XMFLOAT4X4 GetViewProjection(XMFLOAT3 const& position, float fovY, float nearZ, float farZ)
+	{
+		float ys = 1.0f / std::tan(fovY * 0.5f), xs = ys;
+		float a = farZ / (farZ - nearZ), b = -nearZ * a;
+		XMFLOAT4X4 m = {};
+		m.m[0][0] = xs;
+		m.m[1][1] = ys;
+		m.m[2][2] = a;
+		m.m[2][3] = 1.0f;
+		// Translation by -position folded in: row 3 = -position * projection + (0, 0, b, 0)
+		m.m[3][0] = -position.x * xs;
+		m.m[3][1] = -position.y * ys;
+		m.m[3][2] = -position.z * a + b;
+		m.m[3][3] = -position.z;
+		return m;
+	}
+}
+
+int main()
+{
+	// Worst case for the vertex limit: no triangle shares a vertex
+	SyntheticMesh soup = MakeTriangleSoup(5000, 11);
+	std::vector<Meshlet> soupMeshlets;
+	std::pmr::vector<unsigned int> soupVertices;
+	std::pmr::vector<uint8_t> soupTriangles;
+	BuildMeshlets(soupMeshlets, soupVertices, soupTriangles, soup.indices.data(), soup.indices.size(), soup.positions.size());
+	CheckPartition(soupMeshlets, soupVertices.data(), soupTriangles.data(), soup.indices.data(), soup.indices.size());
+	CHECK(soupMeshlets.size() == (5000 + c_meshletMaxVertices / 3 - 1) / (c_meshletMaxVertices / 3));
+
+	// A processed sphere, the way the renderer gets it
+	std::string fileName = GetTempFile("MeshletTests.dat");
+	CHECK(WriteTextMesh(fileName, MakeSphere(60, 120, 0.02f)));
+	Mesh mesh(fileName);
+	std::remove(fileName.c_str());
+	std::vector<Meshlet> const& meshlets = mesh.GetMeshlets();
+	std::vector<MeshletBounds> const& bounds = mesh.GetMeshletBounds();
+	const unsigned int* meshletVertices = mesh.GetMeshletVertices().data();
+	CHECK(!meshlets.empty() && bounds.size() == meshlets.size());
+	CheckPartition(meshlets, meshletVertices, mesh.GetMeshletTriangles().data(), mesh.GetIndexData(), mesh.GetIndexCount());
+
+	// Bounding spheres hold their vertices
+	for (size_t m = 0; m < meshlets.size(); m++)
+		for (unsigned int i = 0; i < meshlets[m].vertexCount; i++)
+		{
+			XMFLOAT3 d = Sub(mesh.GetVertexData()[meshletVertices[meshlets[m].vertexOffset + i]].pos, bounds[m].center);
+			CHECK(std::sqrt(Dot(d, d)) <= bounds[m].radius * 1.0001f);
+		}
+
+	// Cone culling from cameras all around, with a frustum that holds everything:
+	// a culled meshlet has no triangle facing the camera
+	std::mt19937 random(5);
+	std::normal_distribution<float> gaussian;
+	MeshletView everything;
+	const XMFLOAT3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	for (int p = 0; p < 6; p++)
+		everything.planes[p] = XMFLOAT4(axes[p].x, axes[p].y, axes[p].z, 1e6f);
+	size_t backFacing = 0, coneCulled = 0;
+	for (int c = 0; c < 200; c++)
+	{
+		XMFLOAT3 direction(gaussian(random), gaussian(random), gaussian(random));
+		float distance = 1.2f + 20.0f * float(c) / 200.0f;
+		float scale = distance / std::sqrt(Dot(direction, direction));
+		everything.cameraPosition = XMFLOAT3(direction.x * scale, direction.y * scale, direction.z * scale);
+		for (size_t m = 0; m < meshlets.size(); m++)
+		{
+			bool facing = AnyTriangleFacing(mesh, meshlets[m], everything.cameraPosition);
+			bool visible = IsMeshletVisible(bounds[m], everything);
+			CHECK(visible || !facing);
+			backFacing += !facing;
+			coneCulled += !visible;
+		}
+	}
+	std::printf("cone culling: %zu of %zu back facing meshlets culled\n", coneCulled, backFacing);
+	CHECK(coneCulled > backFacing / 4);
+
+	// Frustum culling: a culled meshlet has all its vertices behind one plane, and the
+	// draw list holds exactly the visible meshlets
+	XMFLOAT3 camera(0.3f, -0.2f, -2.5f);
+	MeshletView view = GetMeshletView(GetViewProjection(camera, 0.6f, 0.1f, 100.0f), camera);
+	size_t visibleTriangles = 0, frustumCulled = 0;
+	for (size_t m = 0; m < meshlets.size(); m++)
+	{
+		if (!IsSphereVisible(bounds[m].center, bounds[m].radius, view))
+		{
+			CHECK(AnyPlaneRejectsAll(mesh, meshlets[m], meshletVertices, view));
+			frustumCulled++;
+		}
+		bool visible = IsMeshletVisible(bounds[m], view);
+		CHECK(visible || !AnyTriangleFacing(mesh, meshlets[m], camera) || !IsSphereVisible(bounds[m].center, bounds[m].radius, view));
+		if (visible)
+			visibleTriangles += meshlets[m].triangleCount;
+	}
+	std::printf("frustum culling: %zu of %zu meshlets outside\n", frustumCulled, meshlets.size());
+	CHECK(frustumCulled > 0 && frustumCulled < meshlets.size());
+
+	std::vector<IndexRange> draws;
+	CullMeshlets(draws, meshlets.data(), bounds.data(), meshlets.size(), view, mesh.GetIndexRanges());
+	size_t drawnIndices = 0;
+	for (IndexRange const& draw : draws)
+		drawnIndices += draw.indexCount;
+	CHECK(drawnIndices == visibleTriangles * 3);
+
+	return TestResult();
+}
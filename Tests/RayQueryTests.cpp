@@ -0,0 +1,126 @@
+#include "pch.h"
+#include "RayQuery.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Ray queries (RayQuery.h): the 4-wide BVH finds the same closest hit as testing every
+// triangle, any-hit agrees with it, and the batch calls match the single ray ones.
+
+namespace
+{
+	std::vector<Ray> MakeRays(size_t count, float tMax, uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::vector<Ray> rays(count);
+		for (Ray& ray : rays)
+		{
+			// From a box around the unit sphere and cube towards a point near the middle,
+			// so most rays hit and some pass by
+			ray.origin = XMFLOAT3(unit(random) * 3.0f, unit(random) * 3.0f, unit(random) * 3.0f);
+			XMFLOAT3 target(0.5f + unit(random) * 0.8f, unit(random) * 0.8f, unit(random) * 0.8f);
+			ray.direction = XMFLOAT3(target.x - ray.origin.x, target.y - ray.origin.y, target.z - ray.origin.z);
+			ray.tMin = 0.0f;
+			ray.tMax = tMax;
+		}
+		return rays;
+	}
+
+	// The 4-wide kernel rounds differently from the scalar reference, so hits agree to a
+	// tolerance, and a ray through an edge may hit either triangle or, on the border of
+	// the mesh, miss. Barycentrics of small triangles seen from afar lose the most.
+	const float c_distanceTolerance = 1e-5f;
+	const float c_barycentricTolerance = 1e-3f;
+
+	bool OnEdge(RayHit const* hit)
+	{
+		return hit != nullptr && std::min({ hit->u, hit->v, 1.0f - hit->u - hit->v }) <= c_barycentricTolerance;
+	}
+
+	bool SameHit(RayHit const* hit, RayHit const* expected)
+	{
+		if (hit == nullptr || expected == nullptr)
+			return hit == expected || OnEdge(hit) || OnEdge(expected);
+		if (std::fabs(hit->t - expected->t) > c_distanceTolerance * std::max(expected->t, 1.0f))
+			return OnEdge(hit->t < expected->t ? hit : expected);
+		if (hit->triangle != expected->triangle)
+			return OnEdge(hit) && OnEdge(expected);
+		return std::fabs(hit->u - expected->u) <= c_barycentricTolerance && std::fabs(hit->v - expected->v) <= c_barycentricTolerance;
+	}
+
+	// Closest hits of the BVH against brute force for every ray; returns the hit count
+	size_t CheckClosest(SyntheticMesh const& mesh, RayBvh const& bvh, std::vector<Ray> const& rays)
+	{
+		const float* positions = &mesh.positions.data()->x;
+		size_t hits = 0, mismatches = 0;
+		for (Ray const& ray : rays)
+		{
+			RayHit expected, hit;
+			bool expectedHit = IntersectClosestBruteForce(mesh.indices.data(), mesh.indices.size(), positions, sizeof(XMFLOAT3), ray, expected);
+			bool found = IntersectClosest(bvh, ray, hit);
+			hits += found;
+			mismatches += !SameHit(found ? &hit : nullptr, expectedHit ? &expected : nullptr);
+			CHECK(IntersectAny(bvh, ray) == expectedHit);
+		}
+		CHECK(mismatches == 0);
+		return hits;
+	}
+}
+
+int main()
+{
+	struct {
+		const char* name;
+		SyntheticMesh mesh;
+	} meshes[] = {
+		{ "sphere", MakeSphere(60, 120, 0.02f) },
+		{ "soup", MakeTriangleSoup(20000, 3) },
+	};
+
+	for (auto const& entry : meshes)
+	{
+		SyntheticMesh const& mesh = entry.mesh;
+		RayBvh bvh;
+		BuildRayBvh(bvh, mesh.indices.data(), mesh.indices.size(), &mesh.positions.data()->x, sizeof(XMFLOAT3));
+		CHECK(!bvh.nodes.empty());
+
+		// Every triangle in exactly one block slot
+		std::vector<unsigned int> seen(mesh.indices.size() / 3, 0);
+		for (TriangleBlock const& block : bvh.blocks)
+			for (unsigned int triangle : block.triangle)
+				if (triangle != c_noHit)
+					seen[triangle]++;
+		CHECK(std::all_of(seen.begin(), seen.end(), [](unsigned int count) { return count == 1; }));
+
+		std::vector<Ray> rays = MakeRays(4000, FLT_MAX, 7);
+		size_t hits = CheckClosest(mesh, bvh, rays);
+		std::printf("%s: %zu of %zu rays hit\n", entry.name, hits, rays.size());
+		CHECK(hits > rays.size() / 4 && hits < rays.size());
+
+		// Short rays: tMax cuts hits off the same way in both
+		CheckClosest(mesh, bvh, MakeRays(2000, 0.3f, 8));
+
+		// Batches give what the single ray calls give
+		std::vector<RayHit> batchHits(rays.size());
+		std::vector<uint8_t> occluded(rays.size());
+		IntersectClosest(bvh, rays.data(), batchHits.data(), rays.size());
+		IntersectAny(bvh, rays.data(), occluded.data(), rays.size());
+		for (size_t i = 0; i < rays.size(); i++)
+		{
+			RayHit hit;
+			bool found = IntersectClosest(bvh, rays[i], hit);
+			CHECK(batchHits[i].triangle == hit.triangle && (!found || batchHits[i].t == hit.t));
+			CHECK(bool(occluded[i]) == found);
+		}
+	}
+
+	// Empty mesh: nothing is hit
+	RayBvh empty;
+	BuildRayBvh(empty, nullptr, 0, nullptr, sizeof(XMFLOAT3));
+	RayHit hit;
+	Ray ray = { XMFLOAT3(0.0f, 0.0f, -5.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 0.0f, FLT_MAX };
+	CHECK(!IntersectClosest(empty, ray, hit) && hit.triangle == c_noHit);
+	CHECK(!IntersectAny(empty, ray));
+
+	return TestResult();
+}
@@ -0,0 +1,139 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Levels of detail (Simplify.h): every level stores an error no larger than its target
+// and keeps no more triangles than its ratio allows, and the surface it leaves stays
+// within reach of the stored error.
+
+namespace
+{
+	struct Vec {
+		double x, y, z;
+	};
+
+	Vec Sub(Vec a, Vec b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+	double Dot(Vec a, Vec b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+	Vec Mad(Vec a, Vec b, double s) { return { a.x + b.x * s, a.y + b.y * s, a.z + b.z * s }; }
+
+	// Distance from p to the triangle abc (Ericson, Real-Time Collision Detection 5.1.5)
+	double DistanceToTriangle(Vec p, Vec a, Vec b, Vec c)
+	{
+		Vec ab = Sub(b, a), ac = Sub(c, a), ap = Sub(p, a);
+		double d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		Vec closest;
+		if (d1 <= 0 && d2 <= 0)
+			closest = a;
+		else
+		{
+			Vec bp = Sub(p, b);
+			double d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+			Vec cp = Sub(p, c);
+			double d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+			double vc = d1 * d4 - d3 * d2, vb = d5 * d2 - d1 * d6, va = d3 * d6 - d5 * d4;
+			if (d3 >= 0 && d4 <= d3)
+				closest = b;
+			else if (d6 >= 0 && d5 <= d6)
+				closest = c;
+			else if (vc <= 0 && d1 >= 0 && d3 <= 0)
+				closest = Mad(a, ab, d1 / (d1 - d3));
+			else if (vb <= 0 && d2 >= 0 && d6 <= 0)
+				closest = Mad(a, ac, d2 / (d2 - d6));
+			else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+				closest = Mad(b, Sub(c, b), (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+			else
+			{
+				double denominator = 1.0 / (va + vb + vc);
+				closest = Mad(Mad(a, ab, vb * denominator), ac, vc * denominator);
+			}
+		}
+		Vec d = Sub(p, closest);
+		return std::sqrt(Dot(d, d));
+	}
+
+	// Largest distance from a vertex of the full mesh to the simplified surface, brute force
+	double GetSurfaceDistance(Mesh const& mesh, const unsigned int* indices, size_t indexCount)
+	{
+		const Vertex* vertices = mesh.GetVertexData();
+		auto point = [&](unsigned int i) { return Vec{ vertices[i].pos.x, vertices[i].pos.y, vertices[i].pos.z }; };
+		double largest = 0.0;
+		for (unsigned int v = 0; v < mesh.GetVertexCount(); v++)
+		{
+			double nearest = DBL_MAX;
+			for (size_t i = 0; i < indexCount; i += 3)
+				nearest = std::min(nearest, DistanceToTriangle(point(v), point(indices[i]), point(indices[i + 1]), point(indices[i + 2])));
+			largest = std::max(largest, nearest);
+		}
+		return largest;
+	}
+
+	double GetExtent(Mesh const& mesh)
+	{
+		MeshBounds const& bounds = mesh.GetBounds();
+		return std::max<double>({ bounds.boundsMax.x - bounds.boundsMin.x, bounds.boundsMax.y - bounds.boundsMin.y, bounds.boundsMax.z - bounds.boundsMin.z });
+	}
+
+	bool ValidTriangles(const unsigned int* indices, size_t indexCount, unsigned int vertexCount)
+	{
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			unsigned int a = indices[i], b = indices[i + 1], c = indices[i + 2];
+			if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || c == a)
+				return false;
+		}
+		return indexCount % 3 == 0;
+	}
+}
+
+int main()
+{
+	std::string fileName = GetTempFile("SimplifyTests.dat");
+	CHECK(WriteTextMesh(fileName, MakeSphere(40, 80, 0.01f)));
+	Mesh mesh(fileName);
+	std::remove(fileName.c_str());
+	size_t triangleCount = mesh.GetIndexCount() / 3;
+	double extent = GetExtent(mesh);
+
+	// Loose errors: the ratio is what stops each level
+	std::vector<LodTarget> targets = { { 0.5f, 0.05f }, { 0.25f, 0.05f }, { 0.125f, 0.05f } };
+	mesh.GenerateLods(targets);
+	CHECK(mesh.GetLodCount() == 1 + targets.size());
+	float previousError = 0.0f;
+	for (unsigned int level = 1; level < mesh.GetLodCount(); level++)
+	{
+		LodLevel lod = mesh.GetLod(level);
+		LodTarget const& target = targets[level - 1];
+		size_t lodTriangles = lod.indexCount / 3;
+		double surface = GetSurfaceDistance(mesh, mesh.GetLodIndexData(level), lod.indexCount) / extent;
+		std::printf("level %u: %zu of %zu triangles (%.3f, target %.3f), error %g (target %g), surface distance %g\n",
+			level, lodTriangles, triangleCount, double(lodTriangles) / triangleCount, target.ratio, lod.error, target.maxError, surface);
+
+		CHECK(lod.targetRatio == target.ratio && lod.targetError == target.maxError);
+		CHECK(lod.error <= target.maxError);
+		CHECK(lodTriangles <= size_t(triangleCount * target.ratio));
+		CHECK(lodTriangles >= size_t(triangleCount * target.ratio * 0.9));
+		CHECK(lod.error >= previousError);
+		CHECK(ValidTriangles(mesh.GetLodIndexData(level), lod.indexCount, mesh.GetVertexCount()));
+		// The stored error is a mean over planes, not a maximum, but the surface cannot
+		// drift far from it
+		CHECK(surface <= 4.0 * lod.error + 1e-6);
+		previousError = lod.error;
+	}
+
+	// Tight errors: the error is what stops each level, and the ratio is not reached
+	float tightError = mesh.GetLod(1).error * 0.25f;
+	mesh.GenerateLods({ { 0.125f, tightError } });
+	LodLevel tight = mesh.GetLod(1);
+	std::printf("tight: %u triangles, error %g (target %g)\n", tight.indexCount / 3, tight.error, tightError);
+	CHECK(tight.error <= tightError);
+	CHECK(tight.indexCount / 3 > size_t(triangleCount * 0.125f));
+	CHECK(tight.indexCount < mesh.GetIndexCount());
+	CHECK(ValidTriangles(mesh.GetLodIndexData(1), tight.indexCount, mesh.GetVertexCount()));
+
+	// A zero error target removes nothing from a curved surface
+	mesh.GenerateLods({ { 0.5f, 0.0f } });
+	CHECK(mesh.GetLod(1).error == 0.0f);
+
+	return TestResult();
+}
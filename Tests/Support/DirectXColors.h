@@ -0,0 +1,15 @@
+#pragma once
+#include "DirectXMath.h"
+
+// The DirectX::Colors the mesh modules use; values as in DirectXColors.h.
+
+namespace DirectX
+{
+	namespace Colors
+	{
+		static const XMVECTORF32 Coral = { { { 1.000000000f, 0.498039246f, 0.313725501f, 1.000000000f } } };
+		static const XMVECTORF32 Red = { { { 1.000000000f, 0.000000000f, 0.000000000f, 1.000000000f } } };
+		static const XMVECTORF32 Green = { { { 0.000000000f, 0.501960814f, 0.000000000f, 1.000000000f } } };
+		static const XMVECTORF32 Blue = { { { 0.000000000f, 0.000000000f, 1.000000000f, 1.000000000f } } };
+	}
+}
@@ -0,0 +1,180 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Scalar stand-in for the part of DirectXMath the mesh modules use, so they build and
+// run on Linux for the tests. Same names and semantics; no SIMD, so it is only meant
+// for correctness, not for the absolute numbers of the benchmark on Windows.
+
+#define XM_CALLCONV
+#define XM_PI 3.141592654f
+#define XM_2PI 6.283185307f
+
+namespace DirectX
+{
+	struct XMVECTOR {
+		float v[4];
+	};
+	using FXMVECTOR = XMVECTOR;
+	using GXMVECTOR = XMVECTOR;
+	using HXMVECTOR = XMVECTOR;
+	using CXMVECTOR = const XMVECTOR&;
+
+	struct XMVECTORF32 {
+		union {
+			float f[4];
+			XMVECTOR v;
+		};
+		operator XMVECTOR() const { return v; }
+		operator const float*() const { return f; }
+	};
+
+	struct XMFLOAT2 {
+		float x, y;
+		XMFLOAT2() = default;
+		constexpr XMFLOAT2(float x, float y) : x(x), y(y) {}
+	};
+
+	struct XMFLOAT3 {
+		float x, y, z;
+		XMFLOAT3() = default;
+		constexpr XMFLOAT3(float x, float y, float z) : x(x), y(y), z(z) {}
+	};
+
+	struct XMFLOAT4 {
+		float x, y, z, w;
+		XMFLOAT4() = default;
+		constexpr XMFLOAT4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+		explicit XMFLOAT4(const float* p) : x(p[0]), y(p[1]), z(p[2]), w(p[3]) {}
+	};
+
+	struct alignas(16) XMFLOAT4A : XMFLOAT4 {
+		using XMFLOAT4::XMFLOAT4;
+		XMFLOAT4A() = default;
+	};
+
+	struct XMFLOAT4X4 {
+		float m[4][4];
+	};
+
+	struct XMMATRIX {
+		XMVECTOR r[4];
+	};
+
+	namespace Internal
+	{
+		template <typename Op>
+		XMVECTOR Map(XMVECTOR a, Op op)
+		{
+			XMVECTOR r;
+			for (int i = 0; i < 4; i++) r.v[i] = op(a.v[i]);
+			return r;
+		}
+
+		template <typename Op>
+		XMVECTOR Map(XMVECTOR a, XMVECTOR b, Op op)
+		{
+			XMVECTOR r;
+			for (int i = 0; i < 4; i++) r.v[i] = op(a.v[i], b.v[i]);
+			return r;
+		}
+
+		inline uint32_t Bits(float f) { uint32_t u; std::memcpy(&u, &f, 4); return u; }
+		inline float Float(uint32_t u) { float f; std::memcpy(&f, &u, 4); return f; }
+		inline float Mask(bool b) { return Float(b ? 0xFFFFFFFFu : 0u); }
+	}
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return XMVECTOR{ { x, y, z, w } }; }
+	inline XMVECTOR XMVectorReplicate(float s) { return XMVECTOR{ { s, s, s, s } }; }
+	inline XMVECTOR XMVectorZero() { return XMVectorReplicate(0.0f); }
+	inline XMVECTOR XMVectorTrueInt() { return XMVectorReplicate(Internal::Float(0xFFFFFFFFu)); }
+	inline XMVECTOR XMVectorFalseInt() { return XMVectorZero(); }
+	inline XMVECTOR XMVectorSplatInfinity() { return XMVectorReplicate(INFINITY); }
+	inline XMVECTOR XMVectorSplatX(XMVECTOR a) { return XMVectorReplicate(a.v[0]); }
+	inline XMVECTOR XMVectorSplatY(XMVECTOR a) { return XMVectorReplicate(a.v[1]); }
+	inline XMVECTOR XMVectorSplatZ(XMVECTOR a) { return XMVectorReplicate(a.v[2]); }
+	inline XMVECTOR XMVectorSplatW(XMVECTOR a) { return XMVectorReplicate(a.v[3]); }
+	inline float XMVectorGetX(XMVECTOR a) { return a.v[0]; }
+	inline float XMVectorGetY(XMVECTOR a) { return a.v[1]; }
+	inline float XMVectorGetZ(XMVECTOR a) { return a.v[2]; }
+	inline float XMVectorGetW(XMVECTOR a) { return a.v[3]; }
+	inline uint32_t XMVectorGetIntX(XMVECTOR a) { return Internal::Bits(a.v[0]); }
+	inline void XMVectorGetIntAddr(uint32_t* p, XMVECTOR a) { std::memcpy(p, a.v, 16); }
+
+	inline XMVECTOR XMVectorAdd(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return x + y; }); }
+	inline XMVECTOR XMVectorSubtract(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return x - y; }); }
+	inline XMVECTOR XMVectorMultiply(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return x * y; }); }
+	inline XMVECTOR XMVectorDivide(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return x / y; }); }
+	inline XMVECTOR XMVectorMin(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return std::min(x, y); }); }
+	inline XMVECTOR XMVectorMax(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return std::max(x, y); }); }
+	inline XMVECTOR XMVectorMultiplyAdd(XMVECTOR a, XMVECTOR b, XMVECTOR c) { return XMVectorAdd(XMVectorMultiply(a, b), c); }
+	inline XMVECTOR XMVectorScale(XMVECTOR a, float s) { return XMVectorMultiply(a, XMVectorReplicate(s)); }
+	inline XMVECTOR XMVectorAbs(XMVECTOR a) { return Internal::Map(a, [](float x) { return std::fabs(x); }); }
+	inline XMVECTOR XMVectorNegate(XMVECTOR a) { return Internal::Map(a, [](float x) { return -x; }); }
+	inline XMVECTOR XMVectorReciprocal(XMVECTOR a) { return Internal::Map(a, [](float x) { return 1.0f / x; }); }
+	inline XMVECTOR XMVectorSqrt(XMVECTOR a) { return Internal::Map(a, [](float x) { return std::sqrt(x); }); }
+	inline XMVECTOR XMVectorReciprocalSqrt(XMVECTOR a) { return Internal::Map(a, [](float x) { return 1.0f / std::sqrt(x); }); }
+	inline XMVECTOR XMVectorACos(XMVECTOR a) { return Internal::Map(a, [](float x) { return std::acos(x); }); }
+	inline XMVECTOR XMVectorClamp(XMVECTOR a, XMVECTOR low, XMVECTOR high) { return XMVectorMin(XMVectorMax(a, low), high); }
+
+	inline XMVECTOR XMVectorLess(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return Internal::Mask(x < y); }); }
+	inline XMVECTOR XMVectorLessOrEqual(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return Internal::Mask(x <= y); }); }
+	inline XMVECTOR XMVectorGreater(XMVECTOR a, XMVECTOR b) { return XMVectorLess(b, a); }
+	inline XMVECTOR XMVectorGreaterOrEqual(XMVECTOR a, XMVECTOR b) { return XMVectorLessOrEqual(b, a); }
+	inline XMVECTOR XMVectorAndInt(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return Internal::Float(Internal::Bits(x) & Internal::Bits(y)); }); }
+	inline XMVECTOR XMVectorOrInt(XMVECTOR a, XMVECTOR b) { return Internal::Map(a, b, [](float x, float y) { return Internal::Float(Internal::Bits(x) | Internal::Bits(y)); }); }
+	// Bits of b where the control is set, of a elsewhere (controls are all-ones or zero)
+	inline XMVECTOR XMVectorSelect(XMVECTOR a, XMVECTOR b, XMVECTOR control)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; i++) r.v[i] = Internal::Bits(control.v[i]) ? b.v[i] : a.v[i];
+		return r;
+	}
+
+	inline XMVECTOR XMVector3Dot(XMVECTOR a, XMVECTOR b) { return XMVectorReplicate(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+	inline XMVECTOR XMVector3Cross(XMVECTOR a, XMVECTOR b)
+	{
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+	inline XMVECTOR XMVector3LengthSq(XMVECTOR a) { return XMVector3Dot(a, a); }
+	inline XMVECTOR XMVector3Length(XMVECTOR a) { return XMVectorSqrt(XMVector3LengthSq(a)); }
+	inline XMVECTOR XMVector3Normalize(XMVECTOR a)
+	{
+		float length = XMVectorGetX(XMVector3Length(a));
+		return length > 0.0f ? XMVectorScale(a, 1.0f / length) : XMVectorZero();
+	}
+
+	inline XMVECTOR XMVector3Transform(XMVECTOR v, XMMATRIX const& m)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; i++) r.v[i] = v.v[0] * m.r[0].v[i] + v.v[1] * m.r[1].v[i] + v.v[2] * m.r[2].v[i] + m.r[3].v[i];
+		return r;
+	}
+	inline XMVECTOR XMVector3TransformNormal(XMVECTOR v, XMMATRIX const& m)
+	{
+		XMVECTOR r;
+		for (int i = 0; i < 4; i++) r.v[i] = v.v[0] * m.r[0].v[i] + v.v[1] * m.r[1].v[i] + v.v[2] * m.r[2].v[i];
+		return r;
+	}
+	inline XMVECTOR XMVector3TransformCoord(XMVECTOR v, XMMATRIX const& m)
+	{
+		XMVECTOR r = XMVector3Transform(v, m);
+		return XMVectorScale(r, 1.0f / r.v[3]);
+	}
+	inline XMMATRIX XMMatrixIdentity()
+	{
+		XMMATRIX m = {};
+		for (int i = 0; i < 4; i++) m.r[i].v[i] = 1.0f;
+		return m;
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* p) { return XMVectorSet(p->x, p->y, p->z, 0.0f); }
+	inline XMVECTOR XMLoadFloat4(const XMFLOAT4* p) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+	inline XMVECTOR XMLoadFloat4A(const XMFLOAT4A* p) { return XMVectorSet(p->x, p->y, p->z, p->w); }
+	inline void XMStoreFloat3(XMFLOAT3* p, XMVECTOR a) { p->x = a.v[0]; p->y = a.v[1]; p->z = a.v[2]; }
+	inline void XMStoreFloat4(XMFLOAT4* p, XMVECTOR a) { p->x = a.v[0]; p->y = a.v[1]; p->z = a.v[2]; p->w = a.v[3]; }
+	inline void XMStoreFloat4A(XMFLOAT4A* p, XMVECTOR a) { XMStoreFloat4(p, a); }
+	inline void XMStoreInt4(uint32_t* p, XMVECTOR a) { std::memcpy(p, a.v, 16); }
+}
@@ -0,0 +1,78 @@
+#include "pch.h"
+#include "SyntheticMeshes.h"
+#include <cstdio>
+
+using namespace DirectX;
+
+SyntheticMesh MakeSphere(unsigned int rings, unsigned int segments, float noise, uint32_t seed)
+{
+	SyntheticMesh mesh;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> offset(-noise, noise);
+
+	// (rings + 1) rows of (segments + 1) vertices: the seam and the poles are duplicated
+	for (unsigned int ring = 0; ring <= rings; ring++)
+	{
+		float theta = XM_PI * ring / rings;
+		for (unsigned int segment = 0; segment <= segments; segment++)
+		{
+			float phi = XM_2PI * segment / segments;
+			XMFLOAT3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			float radius = 1.0f + (noise > 0.0f ? offset(random) : 0.0f);
+			mesh.positions.push_back(XMFLOAT3(normal.x * radius, normal.y * radius, normal.z * radius));
+			mesh.normals.push_back(normal);
+		}
+	}
+
+	for (unsigned int ring = 0; ring < rings; ring++)
+		for (unsigned int segment = 0; segment < segments; segment++)
+		{
+			unsigned int a = ring * (segments + 1) + segment;
+			unsigned int b = a + segments + 1;
+			mesh.indices.insert(mesh.indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+		}
+	return mesh;
+}
+
+SyntheticMesh MakeTriangleSoup(unsigned int triangleCount, uint32_t seed)
+{
+	SyntheticMesh mesh;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::uniform_real_distribution<float> edge(-0.02f, 0.02f);
+
+	for (unsigned int triangle = 0; triangle < triangleCount; triangle++)
+	{
+		XMFLOAT3 center(unit(random), unit(random), unit(random));
+		XMVECTOR corners[3];
+		for (int corner = 0; corner < 3; corner++)
+		{
+			corners[corner] = XMVectorSet(center.x + edge(random), center.y + edge(random), center.z + edge(random), 0.0f);
+			XMFLOAT3 position;
+			XMStoreFloat3(&position, corners[corner]);
+			mesh.positions.push_back(position);
+			mesh.indices.push_back((unsigned int)(mesh.indices.size()));
+		}
+		XMFLOAT3 normal;
+		XMStoreFloat3(&normal, XMVector3Normalize(XMVector3Cross(XMVectorSubtract(corners[1], corners[0]), XMVectorSubtract(corners[2], corners[0]))));
+		mesh.normals.insert(mesh.normals.end(), 3, normal);
+	}
+	return mesh;
+}
+
+bool WriteTextMesh(std::string const& fileName, SyntheticMesh const& mesh)
+{
+	FILE* file = std::fopen(fileName.c_str(), "wb");
+	if (file == nullptr)
+		return false;
+
+	std::fprintf(file, "%zu\n", mesh.positions.size());
+	for (XMFLOAT3 const& position : mesh.positions)
+		std::fprintf(file, "%.9g %.9g %.9g\n", position.x, position.y, position.z);
+	for (XMFLOAT3 const& normal : mesh.normals)
+		std::fprintf(file, "%.9g %.9g %.9g\n", normal.x, normal.y, normal.z);
+	std::fprintf(file, "%zu\n", mesh.indices.size());
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		std::fprintf(file, "%u %u %u\n", mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]);
+	return std::fclose(file) == 0;
+}
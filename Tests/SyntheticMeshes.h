@@ -0,0 +1,24 @@
+#pragma once
+#include "pch.h"
+#include <random>
+
+// Generated meshes of any size for the tests and the benchmark. Everything is seeded,
+// so the same arguments give the same mesh on every run and platform.
+
+struct SyntheticMesh {
+	std::vector<DirectX::XMFLOAT3> positions;
+	std::vector<DirectX::XMFLOAT3> normals;
+	std::vector<unsigned int> indices;
+};
+
+// Unit sphere of rings x segments quads, two triangles each. With noise > 0 every
+// vertex is moved along its normal by up to noise, so the surface is not smooth.
+SyntheticMesh MakeSphere(unsigned int rings, unsigned int segments, float noise = 0.0f, uint32_t seed = 1);
+
+// Triangles of random size and orientation scattered in the unit cube, none sharing
+// vertices: the worst case for spatial structures.
+SyntheticMesh MakeTriangleSoup(unsigned int triangleCount, uint32_t seed = 1);
+
+// Writes the mesh in the text mesh.dat layout: vertex count, positions, normals,
+// index count, one triangle per line.
+bool WriteTextMesh(std::string const& fileName, SyntheticMesh const& mesh);
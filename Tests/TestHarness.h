@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+// Checks for the test executables: a failed CHECK prints where and carries on, and
+// main returns TestResult() so ctest sees the failure.
+
+inline int& GetFailureCount()
+{
+	static int count = 0;
+	return count;
+}
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			GetFailureCount()++; \
+		} \
+	} while (0)
+
+inline int TestResult()
+{
+	if (GetFailureCount() > 0)
+		std::printf("%d checks failed\n", GetFailureCount());
+	return GetFailureCount() > 0 ? 1 : 0;
+}
+
+class Stopwatch
+{
+public:
+	Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+	double GetSeconds() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+// A file in the system temporary directory, named after the test so runs in parallel
+// do not collide.
+inline std::string GetTempFile(std::string const& name)
+{
+	return (std::filesystem::temp_directory_path() / ("GameTests_" + name)).string();
+}
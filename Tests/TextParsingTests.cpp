@@ -0,0 +1,165 @@
+#include "pch.h"
+#include "MeshImport.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// mesh.dat parsers (MeshImport.h): the parallel line parser, at every chunk count, and
+// the serial token fallback read the same vertices, indices and normals flag from files
+// with CRLF line endings, without normals or with trailing whitespace, and both reject
+// files that are broken whatever their layout.
+
+namespace
+{
+	const XMFLOAT4 c_defaultColor(0.25f, 0.5f, 0.75f, 1.0f);
+
+	struct TextLayout {
+		const char* newline;
+		const char* trailing;	// before every newline
+		bool normals;
+	};
+
+	std::string MakeText(SyntheticMesh const& mesh, TextLayout const& layout)
+	{
+		std::string text;
+		char line[128];
+		auto add = [&](int length) { text.append(line, length).append(layout.trailing).append(layout.newline); };
+		add(std::snprintf(line, sizeof(line), "%zu", mesh.positions.size()));
+		for (XMFLOAT3 const& p : mesh.positions)
+			add(std::snprintf(line, sizeof(line), "%.9g %.9g %.9g", p.x, p.y, p.z));
+		if (layout.normals)
+			for (XMFLOAT3 const& n : mesh.normals)
+				add(std::snprintf(line, sizeof(line), "%.9g %.9g %.9g", n.x, n.y, n.z));
+		add(std::snprintf(line, sizeof(line), "%zu", mesh.indices.size()));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+			add(std::snprintf(line, sizeof(line), "%u %u %u", mesh.indices[i], mesh.indices[i + 1], mesh.indices[i + 2]));
+		return text;
+	}
+
+	struct Parsed {
+		bool ok = false;
+		bool hasNormals = false;
+		std::pmr::vector<Vertex> vertices;
+		std::pmr::vector<unsigned int> indices;
+
+		bool operator==(Parsed const& other) const
+		{
+			return ok == other.ok && hasNormals == other.hasNormals && indices == other.indices &&
+				vertices.size() == other.vertices.size() &&
+				std::memcmp(vertices.data(), other.vertices.data(), vertices.size() * sizeof(Vertex)) == 0;
+		}
+	};
+
+	Parsed ParseLines(std::string const& text, size_t chunkCount)
+	{
+		Parsed parsed;
+		parsed.ok = ImportTextLines(text.data(), text.data() + text.size(), c_defaultColor, parsed.vertices, parsed.indices, parsed.hasNormals, chunkCount);
+		return parsed;
+	}
+
+	Parsed ParseTokens(std::string const& text)
+	{
+		Parsed parsed;
+		parsed.ok = ImportTextTokens(text.data(), text.data() + text.size(), c_defaultColor, parsed.vertices, parsed.indices, parsed.hasNormals);
+		return parsed;
+	}
+
+	// What the file holds, as both parsers must read it
+	bool Matches(Parsed const& parsed, SyntheticMesh const& mesh, bool normals)
+	{
+		if (!parsed.ok || parsed.hasNormals != normals || parsed.vertices.size() != mesh.positions.size() ||
+			!std::equal(mesh.indices.begin(), mesh.indices.end(), parsed.indices.begin(), parsed.indices.end()))
+			return false;
+		for (size_t i = 0; i < parsed.vertices.size(); i++)
+		{
+			Vertex const& v = parsed.vertices[i];
+			XMFLOAT3 normal = normals ? mesh.normals[i] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+			if (std::memcmp(&v.pos, &mesh.positions[i], sizeof(XMFLOAT3)) != 0 || std::memcmp(&v.normal, &normal, sizeof(XMFLOAT3)) != 0 ||
+				std::memcmp(&v.col, &c_defaultColor, sizeof(XMFLOAT4)) != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	// Every layout, with the line parser split in 1 to 64 chunks: the nominal split
+	// points fall in the middle of position, normal, count and index records alike
+	{
+		SyntheticMesh mesh = MakeSphere(6, 8, 0.01f);
+		const TextLayout layouts[] = {
+			{ "\n", "", true },
+			{ "\r\n", "", true },
+			{ "\n", "", false },
+			{ "\r\n", "", false },
+			{ "\n", " \t ", true },
+			{ "\r\n", "\t", false },
+		};
+		for (TextLayout const& layout : layouts)
+		{
+			std::string text = MakeText(mesh, layout);
+			Parsed tokens = ParseTokens(text);
+			CHECK(Matches(tokens, mesh, layout.normals));
+			bool same = true;
+			for (size_t chunkCount = 1; chunkCount <= 64; chunkCount++)
+				same = same && ParseLines(text, chunkCount) == tokens;
+			CHECK(same);
+			CHECK(ParseLines(text, 0) == tokens);
+
+			// A blank line at the end changes nothing
+			text += layout.newline;
+			CHECK(ParseTokens(text) == tokens);
+			CHECK(ParseLines(text, 7) == tokens);
+		}
+	}
+
+	// A larger file, split by the parser itself
+	{
+		SyntheticMesh mesh = MakeSphere(200, 300, 0.01f);
+		std::string text = MakeText(mesh, { "\r\n", " ", true });
+		Parsed lines = ParseLines(text, 0);
+		CHECK(Matches(lines, mesh, true));
+		CHECK(lines == ParseTokens(text));
+	}
+
+	// Broken whatever the layout: both parsers refuse, at every chunk count
+	{
+		SyntheticMesh mesh = MakeSphere(4, 6);
+		std::string text = MakeText(mesh, { "\n", "", true });
+		size_t indexCountLine = 0;	// start of line 2n + 1
+		for (size_t line = 0; line < 2 * mesh.positions.size() + 1; line++)
+			indexCountLine = text.find('\n', indexCountLine) + 1;
+		std::vector<std::string> broken = {
+			"",
+			"\n\n",
+			"x\n1 2 3\n",
+			text.substr(0, text.size() / 2),	// cut in the middle of the vertices
+			text.substr(0, text.size() - 4),	// last index missing
+			text.substr(0, indexCountLine),	// no index count
+		};
+		std::string word = text;
+		word.replace(word.find('\n') + 1, 1, "q");	// a letter in the first position
+		broken.push_back(word);
+		std::string moreIndices = text;
+		moreIndices.replace(indexCountLine, std::to_string(mesh.indices.size()).size(), std::to_string(mesh.indices.size() + 3));
+		broken.push_back(moreIndices);
+
+		for (std::string const& file : broken)
+		{
+			CHECK(!ParseTokens(file).ok);
+			bool refused = true;
+			for (size_t chunkCount = 1; chunkCount <= 16; chunkCount++)
+				refused = refused && !ParseLines(file, chunkCount).ok;
+			CHECK(refused);
+		}
+
+		// Through Mesh, a broken file leaves an empty mesh
+		std::string fileName = GetTempFile("TextParsingTests_broken.dat");
+		std::ofstream(fileName, std::ios::binary) << moreIndices;
+		Mesh loaded(fileName);
+		CHECK(loaded.GetVertexCount() == 0 && loaded.GetIndexCount() == 0);
+		std::remove(fileName.c_str());
+	}
+
+	return TestResult();
+}
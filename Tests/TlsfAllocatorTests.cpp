@@ -0,0 +1,193 @@
+#include "pch.h"
+#include "TlsfAllocator.h"
+#include "TestHarness.h"
+#include <map>
+#include <random>
+
+// TLSF allocator (TlsfAllocator.h) against a plain model of the allocations: ranges are
+// aligned and disjoint, free neighbours merge at once, an allocation fails only when no
+// gap is large enough, and the statistics match the gaps of the model.
+
+namespace
+{
+	// offset -> size of every live allocation, and the gaps between them
+	struct Model {
+		uint64_t capacity = 0;
+		std::map<uint64_t, uint64_t> allocations;
+
+		std::vector<uint64_t> GetGaps() const
+		{
+			std::vector<uint64_t> gaps;
+			uint64_t end = 0;
+			for (auto const& allocation : allocations)
+			{
+				if (allocation.first > end)
+					gaps.push_back(allocation.first - end);
+				end = allocation.first + allocation.second;
+			}
+			if (capacity > end)
+				gaps.push_back(capacity - end);
+			return gaps;
+		}
+
+		bool Fits(uint64_t offset, uint64_t size) const
+		{
+			if (offset + size > capacity)
+				return false;
+			auto next = allocations.lower_bound(offset);
+			if (next != allocations.end() && next->first < offset + size)
+				return false;
+			if (next != allocations.begin() && std::prev(next)->first + std::prev(next)->second > offset)
+				return false;
+			return true;
+		}
+	};
+
+	bool StatsMatch(TlsfAllocator const& allocator, Model const& model)
+	{
+		TlsfStats stats = allocator.GetStats();
+		std::vector<uint64_t> gaps = model.GetGaps();
+		uint64_t used = 0;
+		for (auto const& allocation : model.allocations)
+			used += allocation.second;
+		uint64_t largest = gaps.empty() ? 0 : *std::max_element(gaps.begin(), gaps.end());
+
+		// Free blocks merge with their neighbours at once, so they are exactly the gaps
+		return stats.capacity == model.capacity && stats.usedBytes == used &&
+			stats.freeBytes == model.capacity - used && stats.allocationCount == model.allocations.size() &&
+			stats.freeBlockCount == gaps.size() && stats.largestFreeBlock == largest &&
+			allocator.IsEmpty() == model.allocations.empty();
+	}
+
+	// Random allocations and frees in a random order; sizes in granules up to maxGranules
+	void RunRandom(uint64_t capacity, uint64_t granularity, uint64_t maxGranules, uint32_t seed, int steps)
+	{
+		TlsfAllocator allocator(capacity, granularity);
+		Model model;
+		model.capacity = allocator.GetCapacity();
+		std::vector<TlsfAllocation> live;
+		std::mt19937 random(seed);
+		std::uniform_int_distribution<uint64_t> size(1, maxGranules * granularity);
+		bool wrong = false;
+		bool failedWithRoom = false;
+		size_t failures = 0;
+
+		for (int step = 0; step < steps; step++)
+		{
+			// Lean towards allocating until the space is mostly used, then churn
+			bool allocate = live.empty() || random() % 100 < (step < steps / 2 ? 60u : 50u);
+			if (allocate)
+			{
+				uint64_t bytes = size(random);
+				uint64_t rounded = (bytes + granularity - 1) / granularity * granularity;
+				TlsfAllocation allocation;
+				if (allocator.Allocate(bytes, allocation))
+				{
+					if (allocation.size != rounded || allocation.offset % granularity != 0 || !model.Fits(allocation.offset, allocation.size))
+						wrong = true;
+					model.allocations[allocation.offset] = allocation.size;
+					live.push_back(allocation);
+				}
+				else
+				{
+					failures++;
+					for (uint64_t gap : model.GetGaps())
+						if (gap >= rounded)
+							failedWithRoom = true;
+				}
+			}
+			else
+			{
+				size_t index = random() % live.size();
+				allocator.Free(live[index]);
+				model.allocations.erase(live[index].offset);
+				live[index] = live.back();
+				live.pop_back();
+			}
+			if (step % 64 == 0 && !StatsMatch(allocator, model))
+				wrong = true;
+		}
+		CHECK(!wrong);
+		CHECK(!failedWithRoom);
+		CHECK(failures > 0);	// the space did run out at some point
+		CHECK(StatsMatch(allocator, model));
+
+		// Everything freed: one block again, however it was split
+		for (TlsfAllocation const& allocation : live)
+			allocator.Free(allocation);
+		TlsfStats stats = allocator.GetStats();
+		CHECK(allocator.IsEmpty());
+		CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == allocator.GetCapacity());
+		CHECK(stats.fragmentation == 0.0f);
+	}
+}
+
+int main()
+{
+	// Granularity: sizes round up, offsets are multiples, the capacity is cut down to one
+	{
+		TlsfAllocator allocator(1000, 64);
+		CHECK(allocator.GetCapacity() == 960 && allocator.GetGranularity() == 64);
+		TlsfAllocation a, b, c;
+		CHECK(allocator.Allocate(1, a) && a.offset == 0 && a.size == 64);
+		CHECK(allocator.Allocate(65, b) && b.offset == 64 && b.size == 128);
+		CHECK(!allocator.Allocate(0, c) && !c.IsValid());
+		CHECK(!allocator.Allocate(961, c));
+		CHECK(allocator.Allocate(960 - 192, c) && c.offset == 192);
+		CHECK(!allocator.Allocate(1, c) && !c.IsValid());
+		allocator.Free(TlsfAllocation());	// no allocation: nothing happens
+		CHECK(allocator.GetStats().allocationCount == 3);
+	}
+
+	// Freed neighbours merge on both sides
+	{
+		TlsfAllocator allocator(4096, 1);
+		TlsfAllocation blocks[4];
+		for (TlsfAllocation& block : blocks)
+			CHECK(allocator.Allocate(1024, block));
+		allocator.Free(blocks[0]);
+		allocator.Free(blocks[2]);
+		TlsfStats stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 2 && stats.largestFreeBlock == 1024);
+		CHECK(stats.fragmentation == 0.5f);
+
+		TlsfAllocation large;
+		CHECK(!allocator.Allocate(2048, large));
+		allocator.Free(blocks[1]);
+		stats = allocator.GetStats();
+		CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == 3072 && stats.fragmentation == 0.0f);
+		CHECK(allocator.Allocate(3072, large) && large.offset == 0);
+	}
+
+	// A request between the sizes of a class only gets a block of its class if one fits
+	{
+		TlsfAllocator allocator(100, 1);
+		TlsfAllocation a, b, c, d;
+		CHECK(allocator.Allocate(40, a) && allocator.Allocate(1, b) && allocator.Allocate(41, c));
+		allocator.Free(a);	// a free block of 40, and 18 at the end
+		CHECK(allocator.Allocate(39, d) && d.offset == 0);
+		allocator.Free(d);
+		CHECK(!allocator.Allocate(41, d));
+		CHECK(allocator.Allocate(18, d) && d.offset == 82);
+	}
+
+	// Reset drops every allocation
+	{
+		TlsfAllocator allocator(1 << 20, 256);
+		TlsfAllocation allocation;
+		CHECK(allocator.Allocate(5000, allocation));
+		allocator.Reset(1 << 16, 4096);
+		CHECK(allocator.IsEmpty() && allocator.GetCapacity() == 1 << 16 && allocator.GetGranularity() == 4096);
+		CHECK(allocator.Allocate(1 << 16, allocation) && allocation.offset == 0);
+		allocator.Reset(0);
+		CHECK(!allocator.Allocate(1, allocation));
+	}
+
+	// Small ranges, where level 0 holds sizes one by one, and the GpuHeapAllocator case:
+	// a 64 MB heap placed on 64 KB with buffers of up to 4 MB
+	RunRandom(4000, 1, 100, 1, 20000);
+	RunRandom(uint64_t(64) << 20, 64 * 1024, 64, 2, 20000);
+	RunRandom(uint64_t(1) << 40, 1, uint64_t(1) << 34, 3, 5000);
+
+	return TestResult();
+}
@@ -0,0 +1,278 @@
+#include "pch.h"
+#include "UploadEngine.h"
+#include "TestHarness.h"
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <random>
+#include <thread>
+
+// Upload engine (UploadEngine.h) on a mock UploadQueue: the destination "resources" are
+// byte vectors and the GPU runs a batch only when the fence is waited on, reading the
+// staging buffer at that moment. Data overwritten in staging before its batch ran would
+// therefore show up in the destination.
+
+namespace
+{
+	class MockUploadQueue : public UploadQueue
+	{
+	public:
+		explicit MockUploadQueue(uint64_t stagingSize) : staging(size_t(stagingSize)) {}
+
+		// Fake resource pointers, each standing for one destination vector
+		ID3D12Resource* AddTarget(std::vector<uint8_t>* target)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			ID3D12Resource* resource = reinterpret_cast<ID3D12Resource*>(uintptr_t(targets.size() + 1) * 64);
+			targets[resource] = target;
+			return resource;
+		}
+
+		uint8_t* GetStagingData() override { return staging.data(); }
+		uint64_t GetStagingSize() const override { return staging.size(); }
+
+		void RecordCopy(ID3D12Resource* destination, uint64_t destinationOffset, uint64_t stagingOffset, uint64_t size) override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			open.push_back({ destination, destinationOffset, stagingOffset, size });
+		}
+
+		void Submit(uint64_t fenceValue) override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!batches.empty() && fenceValue != batches.back().fenceValue + 1)
+				outOfOrder = true;
+			batches.push_back({ fenceValue, std::move(open) });
+			open.clear();
+		}
+
+		uint64_t GetCompletedValue() override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			return completed;
+		}
+
+		void WaitForValue(uint64_t fenceValue) override
+		{
+			{
+				std::unique_lock<std::mutex> lock(gateMutex);
+				blockedWaits++;
+				gateChanged.wait(lock, [this]() { return !holdWaits; });
+				blockedWaits--;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			cpuWaits++;
+			Complete(fenceValue);
+		}
+
+		void GpuWait(ID3D12CommandQueue*, uint64_t fenceValue) override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			gpuWaits.push_back(fenceValue);
+			if (fenceValue > GetSubmittedValue())
+				waitedUnsubmitted = true;
+		}
+
+		// While held, WaitForValue blocks before the fence moves, as on a busy GPU
+		void HoldWaits(bool hold)
+		{
+			std::lock_guard<std::mutex> lock(gateMutex);
+			holdWaits = hold;
+			gateChanged.notify_all();
+		}
+
+		uint64_t GetSubmittedValue() const { return batches.empty() ? 0 : batches.back().fenceValue; }
+		bool HasOpenCopies() const { return !open.empty(); }
+
+		size_t cpuWaits = 0;
+		std::vector<uint64_t> gpuWaits;
+		bool outOfOrder = false;
+		bool waitedUnsubmitted = false;	// a GPU wait on a value no batch signals yet
+		std::atomic<int> blockedWaits{ 0 };
+
+	private:
+		struct Copy {
+			ID3D12Resource* destination;
+			uint64_t destinationOffset;
+			uint64_t stagingOffset;
+			uint64_t size;
+		};
+
+		struct Batch {
+			uint64_t fenceValue;
+			std::vector<Copy> copies;
+		};
+
+		// Runs the submitted batches up to fenceValue, copying from staging as it is now
+		void Complete(uint64_t fenceValue)
+		{
+			for (Batch const& batch : batches)
+				if (batch.fenceValue > completed && batch.fenceValue <= fenceValue)
+					for (Copy const& copy : batch.copies)
+						std::memcpy(targets[copy.destination]->data() + copy.destinationOffset, staging.data() + copy.stagingOffset, size_t(copy.size));
+			completed = std::max(completed, std::min(fenceValue, GetSubmittedValue()));
+		}
+
+		std::mutex mutex;
+		std::vector<uint8_t> staging;
+		std::map<ID3D12Resource*, std::vector<uint8_t>*> targets;
+		std::vector<Copy> open;
+		std::vector<Batch> batches;
+		uint64_t completed = 0;
+
+		std::mutex gateMutex;
+		std::condition_variable gateChanged;
+		bool holdWaits = false;
+	};
+
+	std::vector<uint8_t> RandomBytes(size_t size, std::mt19937& random)
+	{
+		std::vector<uint8_t> bytes(size);
+		for (uint8_t& byte : bytes)
+			byte = uint8_t(random());
+		return bytes;
+	}
+}
+
+int main()
+{
+	// Uploads of all sizes through a 64 KB ring, some larger than the whole ring: the
+	// engine has to submit and wait for staging space, and nothing is overwritten early
+	{
+		std::mt19937 random(3);
+		MockUploadQueue* queue = new MockUploadQueue(64 * 1024);
+		UploadEngine engine;
+		engine.Initialize(std::unique_ptr<UploadQueue>(queue));
+
+		std::vector<std::vector<uint8_t>> sources, destinations(200);
+		std::vector<UploadTicket> tickets;
+		for (int i = 0; i < 200; i++)
+		{
+			size_t size = 1 + random() % (i % 10 == 0 ? 200000 : 3000);
+			sources.push_back(RandomBytes(size, random));
+			destinations[i].assign(size, 0);
+			tickets.push_back(engine.Upload(queue->AddTarget(&destinations[i]), 0, sources[i].data(), size));
+			if (i % 7 == 6)
+				engine.Flush();
+		}
+		for (size_t i = 1; i < tickets.size(); i++)
+			CHECK(tickets[i].fenceValue >= tickets[i - 1].fenceValue && tickets[i].fenceValue > 0);
+
+		// The last ticket's batch is still open: Wait submits it before the GPU waits on it
+		CHECK(!engine.IsComplete(tickets.back()));
+		engine.Wait(nullptr, tickets.back());
+		CHECK(!queue->HasOpenCopies());
+		CHECK(queue->gpuWaits.size() == 1 && queue->gpuWaits[0] == tickets.back().fenceValue);
+		CHECK(!queue->waitedUnsubmitted);
+
+		engine.WaitIdle();
+		bool same = true;
+		for (int i = 0; i < 200; i++)
+			same = same && destinations[i] == sources[i] && engine.IsComplete(tickets[i]);
+		CHECK(same);
+		CHECK(!queue->outOfOrder);
+
+		UploadStats stats = engine.GetStats();
+		CHECK(stats.uploadCount == 200);
+		CHECK(stats.stallCount > 0 && queue->cpuWaits > 0);
+		CHECK(stats.batchCount == queue->GetSubmittedValue());
+		uint64_t bytes = 0;
+		for (std::vector<uint8_t> const& source : sources)
+			bytes += source.size();
+		CHECK(stats.bytesUploaded == bytes);
+	}
+
+	// Empty uploads and default tickets need no waiting; Flush with nothing recorded submits nothing
+	{
+		MockUploadQueue* queue = new MockUploadQueue(4096);
+		UploadEngine engine;
+		engine.Initialize(std::unique_ptr<UploadQueue>(queue));
+		std::vector<uint8_t> destination(16);
+		UploadTicket ticket = engine.Upload(queue->AddTarget(&destination), 0, nullptr, 0);
+		CHECK(ticket.fenceValue == 0 && engine.IsComplete(ticket));
+		CHECK(engine.IsComplete(UploadTicket()));
+		engine.Wait(nullptr, ticket);
+		CHECK(queue->gpuWaits.empty());
+		engine.Flush();
+		CHECK(engine.GetStats().batchCount == 0 && queue->GetSubmittedValue() == 0);
+
+		// A batch that is already submitted is not submitted again by Wait
+		uint8_t data[16] = { 1, 2, 3 };
+		ticket = engine.Upload(queue->AddTarget(&destination), 0, data, sizeof(data));
+		engine.Flush();
+		engine.Wait(nullptr, ticket);
+		CHECK(engine.GetStats().batchCount == 1);
+		engine.WaitIdle();	// the batch writes into destination, which goes before the engine
+	}
+
+	// Several workers upload while the main thread flushes every "frame"
+	{
+		const int c_meshes = 64;
+		const size_t c_meshSize = 50000;
+		MockUploadQueue* queue = new MockUploadQueue(1 << 20);
+		UploadEngine engine;
+		engine.Initialize(std::unique_ptr<UploadQueue>(queue));
+
+		std::vector<std::vector<uint8_t>> sources(c_meshes), destinations(c_meshes);
+		std::vector<ID3D12Resource*> resources(c_meshes);
+		for (int i = 0; i < c_meshes; i++)
+		{
+			sources[i].assign(c_meshSize, uint8_t(i + 1));
+			destinations[i].assign(c_meshSize, 0);
+			resources[i] = queue->AddTarget(&destinations[i]);
+		}
+
+		std::atomic<int> running{ 4 };
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; t++)
+			threads.emplace_back([&, t]() {
+				for (int i = t; i < c_meshes; i += 4)
+					engine.Upload(resources[i], 0, sources[i].data(), c_meshSize);
+				running--;
+			});
+		while (running > 0)
+		{
+			engine.Flush();
+			std::this_thread::yield();
+		}
+		for (std::thread& thread : threads)
+			thread.join();
+		engine.WaitIdle();
+
+		bool same = true;
+		for (int i = 0; i < c_meshes; i++)
+			same = same && destinations[i] == sources[i];
+		CHECK(same);
+		CHECK(!queue->outOfOrder);
+		CHECK(engine.GetStats().uploadCount == c_meshes);
+	}
+
+	// A worker waiting for staging space does not hold the engine: while it is blocked in
+	// the fence wait the main thread flushes, polls and reads the stats, and once the GPU
+	// moves on the worker finishes with every byte in place
+	{
+		std::mt19937 random(5);
+		MockUploadQueue* queue = new MockUploadQueue(64 * 1024);
+		UploadEngine engine;
+		engine.Initialize(std::unique_ptr<UploadQueue>(queue));
+		std::vector<uint8_t> source = RandomBytes(300000, random), destination(source.size());
+		ID3D12Resource* resource = queue->AddTarget(&destination);
+
+		queue->HoldWaits(true);
+		UploadTicket ticket;
+		std::thread worker([&]() { ticket = engine.Upload(resource, 0, source.data(), source.size()); });
+		while (queue->blockedWaits == 0)
+			std::this_thread::yield();
+		engine.Flush();
+		CHECK(engine.GetStats().stallCount == 1);
+		CHECK(!engine.IsComplete(UploadTicket{ 1 }));
+		queue->HoldWaits(false);
+		worker.join();
+
+		engine.WaitIdle();
+		CHECK(engine.IsComplete(ticket) && destination == source);
+		CHECK(!queue->outOfOrder);
+	}
+
+	return TestResult();
+}
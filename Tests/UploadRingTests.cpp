@@ -0,0 +1,158 @@
+#include "pch.h"
+#include "UploadRing.h"
+#include "TestHarness.h"
+#include <random>
+
+// Upload ring (UploadRing.h) driven by fake fence values: allocations are aligned and
+// never overlap what a frame in flight still reads, and space comes back only once the
+// fence has passed the frame that used it.
+
+namespace
+{
+	struct Range {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct FrameRanges {
+		uint64_t fenceValue;
+		std::vector<Range> ranges;
+	};
+
+	bool Overlaps(Range const& a, Range const& b)
+	{
+		return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+	}
+
+	bool OverlapsAny(Range const& range, std::deque<FrameRanges> const& frames, std::vector<Range> const& current)
+	{
+		for (FrameRanges const& frame : frames)
+			for (Range const& other : frame.ranges)
+				if (Overlaps(range, other))
+					return true;
+		for (Range const& other : current)
+			if (Overlaps(range, other))
+				return true;
+		return false;
+	}
+}
+
+int main()
+{
+	// Alignment, and the end of the buffer is skipped rather than wrapped over
+	{
+		UploadRing ring(1024);
+		uint64_t offset = 0;
+		CHECK(ring.Allocate(100, 1, offset) && offset == 0);
+		CHECK(ring.Allocate(16, 256, offset) && offset == 256);
+		CHECK(ring.GetUsedBytes() == 272);
+		CHECK(ring.Allocate(500, 256, offset) && offset == 512);
+		CHECK(!ring.Allocate(200, 256, offset));	// would wrap onto this frame's own data
+		CHECK(!ring.Allocate(2048, 1, offset));
+		ring.FinishFrame(1);
+		CHECK(ring.GetFramesInFlight() == 1);
+
+		// The frame is still in flight until the fence reaches 1
+		ring.Retire(0);
+		CHECK(!ring.Allocate(200, 256, offset));
+		ring.Retire(1);
+		CHECK(ring.GetFramesInFlight() == 0 && ring.GetUsedBytes() == 0);
+		CHECK(ring.Allocate(200, 256, offset) && offset == 0);	// the 12 bytes left at the end were skipped
+	}
+
+	// Empty frames keep their place in the fence order
+	{
+		UploadRing ring(256);
+		uint64_t offset = 0;
+		CHECK(ring.Allocate(128, 1, offset));
+		ring.FinishFrame(1);
+		ring.FinishFrame(2);
+		CHECK(ring.Allocate(128, 1, offset));
+		ring.FinishFrame(3);
+		CHECK(ring.GetFramesInFlight() == 3);
+		ring.Retire(2);
+		CHECK(ring.GetFramesInFlight() == 1 && ring.GetUsedBytes() == 128);
+		CHECK(ring.Allocate(128, 1, offset) && offset == 0);
+	}
+
+	// Reset forgets frames in flight, e.g. after the device was lost
+	{
+		UploadRing ring(512);
+		uint64_t offset = 0;
+		CHECK(ring.Allocate(500, 1, offset));
+		ring.FinishFrame(7);
+		ring.Reset(4096);
+		CHECK(ring.GetCapacity() == 4096 && ring.GetUsedBytes() == 0 && ring.GetFramesInFlight() == 0);
+		CHECK(ring.Allocate(4096, 256, offset) && offset == 0);
+	}
+
+	// Simulated timeline: the GPU completes frames up to three behind the CPU, and a frame
+	// that cannot allocate waits for the oldest one, as the game waits on its fence
+	{
+		UploadRing ring(64 * 1024);
+		std::mt19937 random(5);
+		std::uniform_int_distribution<uint64_t> size(1, 6000);
+		std::uniform_int_distribution<int> alignmentShift(0, 8);
+		std::uniform_int_distribution<int> allocations(0, 12);
+		std::uniform_int_distribution<int> lag(0, 3);
+
+		std::deque<FrameRanges> inFlight;
+		uint64_t nextFence = 1;
+		uint64_t completed = 0;
+		size_t waits = 0;
+		bool overlapped = false;
+		bool misaligned = false;
+
+		for (int frame = 0; frame < 2000; frame++)
+		{
+			std::vector<Range> current;
+			for (int a = allocations(random); a > 0; a--)
+			{
+				uint64_t bytes = size(random);
+				uint64_t alignment = uint64_t(1) << alignmentShift(random);
+				uint64_t offset = 0;
+				bool placed = true;
+				while (!ring.Allocate(bytes, alignment, offset))
+				{
+					if (inFlight.empty())
+					{
+						placed = false;	// the current frame alone fills the ring: skip it
+						break;
+					}
+					completed = inFlight.front().fenceValue;
+					inFlight.pop_front();
+					ring.Retire(completed);
+					waits++;
+				}
+				if (!placed)
+					continue;
+				Range range = { offset, bytes };
+				if (offset % alignment != 0 || offset + bytes > ring.GetCapacity())
+					misaligned = true;
+				if (OverlapsAny(range, inFlight, current))
+					overlapped = true;
+				current.push_back(range);
+			}
+
+			ring.FinishFrame(nextFence);
+			inFlight.push_back({ nextFence, std::move(current) });
+			nextFence++;
+
+			// The GPU catches up to somewhere between now and three frames ago
+			uint64_t reached = nextFence - 1 - std::min<uint64_t>(nextFence - 1, lag(random));
+			while (!inFlight.empty() && inFlight.front().fenceValue <= reached)
+				inFlight.pop_front();
+			completed = std::max(completed, reached);
+			ring.Retire(completed);
+			CHECK(ring.GetFramesInFlight() == inFlight.size());
+		}
+		CHECK(!overlapped);
+		CHECK(!misaligned);
+		CHECK(waits > 0);	// the ring did fill up and had to wait on the fence
+
+		ring.Retire(nextFence);
+		CHECK(ring.GetUsedBytes() == 0 && ring.GetFramesInFlight() == 0);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,120 @@
+#include "pch.h"
+#include "VertexCache.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+// Vertex cache tools (VertexCache.h): the FIFO simulator gives the miss counts worked
+// out by hand, and the optimizer returns the same triangles with the same winding in an
+// order that brings a shuffled grid's ACMR down and keeps an optimized one where it is.
+
+namespace
+{
+	// Grid of width x height quads over (width + 1) x (height + 1) vertices, rows in order
+	std::vector<unsigned int> MakeGrid(unsigned int width, unsigned int height)
+	{
+		std::vector<unsigned int> indices;
+		for (unsigned int y = 0; y < height; y++)
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned int v = y * (width + 1) + x;
+				unsigned int quad[6] = { v, v + width + 1, v + 1, v + 1, v + width + 1, v + width + 2 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		return indices;
+	}
+
+	void ShuffleTriangles(std::vector<unsigned int>& indices, uint32_t seed)
+	{
+		std::vector<std::array<unsigned int, 3>> triangles(indices.size() / 3);
+		std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(unsigned int));
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+		std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(unsigned int));
+	}
+
+	// Triangles rotated to start at their smallest index, so the same triangle with the
+	// same winding compares equal wherever the optimizer started it, then sorted
+	std::vector<std::array<unsigned int, 3>> CanonicalTriangles(std::vector<unsigned int> const& indices)
+	{
+		std::vector<std::array<unsigned int, 3>> triangles;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<unsigned int, 3> t = { indices[i], indices[i + 1], indices[i + 2] };
+			std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+			triangles.push_back(t);
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+}
+
+int main()
+{
+	// FIFO simulator on a strip of four triangles over six vertices: every vertex is
+	// transformed once, 6 transforms / 4 triangles
+	{
+		std::vector<unsigned int> strip = { 0, 1, 2, 1, 3, 2, 2, 3, 4, 3, 5, 4 };
+		VertexCacheStats stats = AnalyzeVertexCache(strip, 6);
+		CHECK(stats.transforms == 6);
+		CHECK(stats.acmr == 1.5f);
+		CHECK(stats.atvr == 1.0f);
+	}
+
+	// Fan of three triangles on a 3-entry FIFO: 0 1 2 miss, 0 2 hit, 3 misses and pushes
+	// 0 out, so 0 misses again and pushes 1 out, 3 hits, 4 misses. 6 transforms for 3
+	// triangles and 5 vertices (an LRU cache would have kept 0: 5 transforms)
+	{
+		std::vector<unsigned int> fan = { 0, 1, 2, 0, 2, 3, 0, 3, 4 };
+		VertexCacheStats stats = AnalyzeVertexCache(fan, 5, 3);
+		CHECK(stats.transforms == 6);
+		CHECK(stats.acmr == 2.0f);
+		CHECK(stats.atvr == 1.2f);
+
+		// A cache that holds the whole fan misses each vertex once
+		stats = AnalyzeVertexCache(fan, 5, 16);
+		CHECK(stats.transforms == 5);
+
+		// No triangles: nothing to report
+		stats = AnalyzeVertexCache(fan.data(), 2, 5);
+		CHECK(stats.transforms == 0 && stats.acmr == 0.0f);
+	}
+
+	// Shuffled grid: the optimized order holds the same triangles with the same winding,
+	// and misses far less than the shuffled one
+	{
+		const unsigned int width = 100, height = 100;
+		size_t vertexCount = (width + 1) * (height + 1);
+		std::vector<unsigned int> indices = MakeGrid(width, height);
+		ShuffleTriangles(indices, 3);
+		VertexCacheStats shuffled = AnalyzeVertexCache(indices, vertexCount);
+
+		std::vector<unsigned int> optimized = indices;
+		OptimizeVertexCache(optimized, vertexCount);
+		VertexCacheStats stats = AnalyzeVertexCache(optimized, vertexCount);
+		CHECK(optimized.size() == indices.size());
+		CHECK(CanonicalTriangles(optimized) == CanonicalTriangles(indices));
+		CHECK(shuffled.acmr > 2.5f);
+		CHECK(stats.acmr < 0.7f);
+		CHECK(stats.atvr < 1.35f);
+
+		// Optimizing again does not make it worse
+		std::vector<unsigned int> again = optimized;
+		OptimizeVertexCache(again, vertexCount);
+		CHECK(CanonicalTriangles(again) == CanonicalTriangles(indices));
+		CHECK(AnalyzeVertexCache(again, vertexCount).acmr <= stats.acmr + 0.01f);
+
+		// Neither does optimizing the grid in row order, already decent for a 16-entry cache
+		std::vector<unsigned int> rows = MakeGrid(width, height);
+		VertexCacheStats rowStats = AnalyzeVertexCache(rows, vertexCount);
+		OptimizeVertexCache(rows, vertexCount);
+		CHECK(AnalyzeVertexCache(rows, vertexCount).acmr <= rowStats.acmr);
+
+		// The pointer overload with separate destination matches the in-place one
+		std::vector<unsigned int> destination(indices.size());
+		OptimizeVertexCache(destination.data(), indices.data(), indices.size(), vertexCount);
+		CHECK(destination == optimized);
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,152 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "VertexLayout.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <random>
+
+// Vertex layouts (VertexLayout.h): element offsets, slots and strides of every format
+// match the vertex structs they describe, and the split streams hold, byte for byte,
+// the elements of the interleaved vertices they were made from.
+
+namespace
+{
+	struct ExpectedElement {
+		const char* semantic;
+		VertexElementFormat format;
+		unsigned int slot;
+		unsigned int offset;
+	};
+
+	bool SameLayout(std::vector<VertexElement> const& layout, std::vector<ExpectedElement> const& expected)
+	{
+		if (layout.size() != expected.size())
+			return false;
+		for (size_t i = 0; i < layout.size(); i++)
+			if (std::strcmp(layout[i].semantic, expected[i].semantic) != 0 || layout[i].format != expected[i].format ||
+				layout[i].slot != expected[i].slot || layout[i].offset != expected[i].offset)
+				return false;
+		return true;
+	}
+
+	// Every element of every vertex in the streams equals the same-semantic element of
+	// the interleaved vertex, and the streams hold nothing else
+	bool StreamsMatch(const uint8_t* interleaved, size_t vertexCount, VertexFormat format,
+		std::pmr::vector<uint8_t> const& buffer, unsigned int const offsets[c_maxVertexSlots])
+	{
+		VertexFormat sourceFormat = GetInterleavedFormat(format);
+		std::vector<VertexElement> sourceLayout = GetVertexLayout(sourceFormat);
+		unsigned int sourceStride = GetVertexStride(sourceFormat);
+		unsigned int slotBytes = 0;
+		for (unsigned int slot = 0; slot < GetVertexSlotCount(format); slot++)
+		{
+			slotBytes += GetVertexStride(format, slot);
+			if (offsets[slot] % c_vertexStreamAlignment != 0 || offsets[slot] + vertexCount * GetVertexStride(format, slot) > buffer.size())
+				return false;
+		}
+		if (slotBytes != sourceStride)
+			return false;
+
+		for (VertexElement const& element : GetVertexLayout(format))
+		{
+			auto source = std::find_if(sourceLayout.begin(), sourceLayout.end(),
+				[&](VertexElement const& e) { return std::strcmp(e.semantic, element.semantic) == 0; });
+			if (source == sourceLayout.end() || source->format != element.format)
+				return false;
+			unsigned int stride = GetVertexStride(format, element.slot);
+			for (size_t i = 0; i < vertexCount; i++)
+				if (std::memcmp(buffer.data() + offsets[element.slot] + i * stride + element.offset,
+					interleaved + i * sourceStride + source->offset, GetElementSize(element.format)) != 0)
+					return false;
+		}
+		return true;
+	}
+}
+
+int main()
+{
+	using F = VertexElementFormat;
+
+	// Layouts, element by element, against the structs the CPU writes
+	CHECK(SameLayout(GetVertexLayout(VertexFormat::Float), {
+		{ "POSITION", F::Float3, 0, (unsigned int)offsetof(Vertex, pos) },
+		{ "COLOR", F::Float4, 0, (unsigned int)offsetof(Vertex, col) },
+		{ "NORMAL", F::Float3, 0, (unsigned int)offsetof(Vertex, normal) } }));
+	CHECK(SameLayout(GetVertexLayout(VertexFormat::Packed), {
+		{ "POSITION", F::Unorm16x4, 0, (unsigned int)offsetof(PackedVertex, pos) },
+		{ "NORMAL", F::Snorm16x2, 0, (unsigned int)offsetof(PackedVertex, normal) },
+		{ "COLOR", F::Unorm8x4, 0, (unsigned int)offsetof(PackedVertex, col) } }));
+	CHECK(SameLayout(GetVertexLayout(VertexFormat::Split), {
+		{ "POSITION", F::Float3, 0, 0 },
+		{ "COLOR", F::Float4, 1, 0 },
+		{ "NORMAL", F::Float3, 1, 16 } }));
+	CHECK(SameLayout(GetVertexLayout(VertexFormat::PackedSplit), {
+		{ "POSITION", F::Unorm16x4, 0, 0 },
+		{ "NORMAL", F::Snorm16x2, 1, 0 },
+		{ "COLOR", F::Unorm8x4, 1, 4 } }));
+
+	// Strides and slots
+	CHECK(GetVertexStride(VertexFormat::Float) == sizeof(Vertex) && GetVertexStride(VertexFormat::Float, 1) == 0);
+	CHECK(GetVertexStride(VertexFormat::Packed) == sizeof(PackedVertex));
+	CHECK(GetVertexStride(VertexFormat::Split, 0) == 12 && GetVertexStride(VertexFormat::Split, 1) == 28);
+	CHECK(GetVertexStride(VertexFormat::PackedSplit, 0) == 8 && GetVertexStride(VertexFormat::PackedSplit, 1) == 8);
+	CHECK(GetVertexSlotCount(VertexFormat::Float) == 1 && GetVertexSlotCount(VertexFormat::Packed) == 1);
+	CHECK(GetVertexSlotCount(VertexFormat::Split) == 2 && GetVertexSlotCount(VertexFormat::PackedSplit) == 2);
+	CHECK(GetInterleavedFormat(VertexFormat::Split) == VertexFormat::Float);
+	CHECK(GetInterleavedFormat(VertexFormat::PackedSplit) == VertexFormat::Packed);
+	CHECK(GetInterleavedFormat(VertexFormat::Float) == VertexFormat::Float);
+	CHECK(GetInterleavedFormat(VertexFormat::Packed) == VertexFormat::Packed);
+
+	// Position-only layouts: the position alone, in slot 0 at offset 0
+	CHECK(SameLayout(GetPositionLayout(VertexFormat::Float), { { "POSITION", F::Float3, 0, 0 } }));
+	CHECK(SameLayout(GetPositionLayout(VertexFormat::Packed), { { "POSITION", F::Unorm16x4, 0, 0 } }));
+	CHECK(SameLayout(GetPositionLayout(VertexFormat::Split), { { "POSITION", F::Float3, 0, 0 } }));
+	CHECK(SameLayout(GetPositionLayout(VertexFormat::PackedSplit), { { "POSITION", F::Unorm16x4, 0, 0 } }));
+
+	// Split of random bytes, for every format and for vertex counts that leave the first
+	// stream off the alignment
+	std::mt19937 random(11);
+	for (VertexFormat format : { VertexFormat::Float, VertexFormat::Packed, VertexFormat::Split, VertexFormat::PackedSplit })
+		for (size_t vertexCount : { size_t(0), size_t(1), size_t(3), size_t(1001) })
+		{
+			std::vector<uint8_t> interleaved(vertexCount * GetVertexStride(GetInterleavedFormat(format)));
+			for (uint8_t& byte : interleaved)
+				byte = uint8_t(random());
+			std::pmr::vector<uint8_t> buffer;
+			unsigned int offsets[c_maxVertexSlots] = {};
+			SplitVertexStreams(interleaved.data(), vertexCount, format, buffer, offsets);
+			CHECK(StreamsMatch(interleaved.data(), vertexCount, format, buffer, offsets));
+			if (GetVertexSlotCount(format) == 1)
+				CHECK(std::equal(interleaved.begin(), interleaved.end(), buffer.begin()));
+		}
+
+	// A mesh in each split format hands out the streams of its interleaved vertices:
+	// position stream plus attribute stream give back the Float and Packed vertices
+	SyntheticMesh sphere = MakeSphere(20, 30, 0.05f);
+	auto makeMesh = [&](VertexFormat format) {
+		auto mesh = std::make_unique<Mesh>(std::string());
+		for (size_t i = 0; i < sphere.positions.size(); i++)
+			mesh->vertices.push_back({ sphere.positions[i], XMFLOAT4(0.1f * (i % 10), 0.5f, 0.25f, 1.0f), sphere.normals[i] });
+		mesh->indices.assign(sphere.indices.begin(), sphere.indices.end());
+		mesh->SetVertexFormat(format);
+		return mesh;
+	};
+	for (VertexFormat format : { VertexFormat::Split, VertexFormat::PackedSplit })
+	{
+		std::unique_ptr<Mesh> interleaved = makeMesh(GetInterleavedFormat(format));
+		std::unique_ptr<Mesh> split = makeMesh(format);
+		size_t vertexCount = split->GetVertexCount();
+		CHECK(split->GetVertexSlotCount() == 2 && interleaved->GetVertexSlotCount() == 1);
+		CHECK(split->GetVertexStride(0) + split->GetVertexStride(1) == interleaved->GetVertexStride());
+		CHECK(split->GetVertexStreamSize(0) == vertexCount * split->GetVertexStride(0));
+		CHECK(split->GetVertexStreamSize(1) == vertexCount * split->GetVertexStride(1));
+
+		const uint8_t* streams = static_cast<const uint8_t*>(split->GetVertexBufferData());
+		std::pmr::vector<uint8_t> buffer(streams, streams + split->GetVertexStreamOffset(1) + split->GetVertexStreamSize(1));
+		unsigned int offsets[c_maxVertexSlots] = { split->GetVertexStreamOffset(0), split->GetVertexStreamOffset(1) };
+		CHECK(offsets[0] == 0 && offsets[1] >= split->GetVertexStreamSize(0));
+		CHECK(StreamsMatch(static_cast<const uint8_t*>(interleaved->GetVertexBufferData()), vertexCount, format, buffer, offsets));
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,133 @@
+#include "pch.h"
+#include "VertexNormals.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+
+// Generated vertex normals (VertexNormals.h): angle and area weighting give the normals
+// worked out by hand at a cube corner, degenerate triangles add nothing, vertices no
+// triangle uses stay zero, and splitting the triangles in blocks changes nothing but
+// the rounding.
+
+namespace
+{
+	bool Near(XMFLOAT3 const& a, XMFLOAT3 const& b, float tolerance = 1e-5f)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+	}
+
+	XMFLOAT3 Normalized(float x, float y, float z)
+	{
+		float length = std::sqrt(x * x + y * y + z * z);
+		return XMFLOAT3(x / length, y / length, z / length);
+	}
+
+	std::vector<XMFLOAT3> Generate(std::vector<XMFLOAT3> const& positions, std::vector<unsigned int> const& indices,
+		NormalWeighting weighting, unsigned int blockCount = 0)
+	{
+		std::vector<XMFLOAT3> normals(positions.size(), XMFLOAT3(9.0f, 9.0f, 9.0f));
+		GenerateVertexNormals(&normals[0].x, sizeof(XMFLOAT3), indices.data(), indices.size(),
+			&positions[0].x, sizeof(XMFLOAT3), positions.size(), weighting, blockCount);
+		return normals;
+	}
+}
+
+int main()
+{
+	// Corner of the unit cube at the origin, outward faces -x, -y, -z. The z face is split
+	// through the corner (two triangles of 45 degrees and area 1/2 there), the x and y
+	// faces across it (one triangle of 90 degrees and area 1/2). Angle weighting sees 90
+	// degrees of every face; area weighting counts the z face twice.
+	{
+		enum { O, X, Y, Z, XY, YZ, XZ, Far, Unused, VertexCount };
+		std::vector<XMFLOAT3> positions(VertexCount);
+		positions[O] = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		positions[X] = XMFLOAT3(1.0f, 0.0f, 0.0f);
+		positions[Y] = XMFLOAT3(0.0f, 1.0f, 0.0f);
+		positions[Z] = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		positions[XY] = XMFLOAT3(1.0f, 1.0f, 0.0f);
+		positions[YZ] = XMFLOAT3(0.0f, 1.0f, 1.0f);
+		positions[XZ] = XMFLOAT3(1.0f, 0.0f, 1.0f);
+		positions[Far] = XMFLOAT3(2.0f, 0.0f, 0.0f);
+		positions[Unused] = XMFLOAT3(5.0f, 5.0f, 5.0f);
+		std::vector<unsigned int> indices = {
+			O, Y, XY, O, XY, X,		// z = 0
+			O, Z, Y, Y, Z, YZ,		// x = 0
+			O, X, Z, X, XZ, Z,		// y = 0
+		};
+
+		std::vector<XMFLOAT3> angle = Generate(positions, indices, NormalWeighting::Angle);
+		CHECK(Near(angle[O], Normalized(-1.0f, -1.0f, -1.0f)));
+		CHECK(Near(angle[XY], XMFLOAT3(0.0f, 0.0f, -1.0f)));
+		CHECK(Near(angle[YZ], XMFLOAT3(-1.0f, 0.0f, 0.0f)));
+		CHECK(Near(angle[XZ], XMFLOAT3(0.0f, -1.0f, 0.0f)));
+		CHECK(Near(angle[Y], Normalized(-1.0f, 0.0f, -1.0f)));	// 90 degrees of z, 90 of x
+
+		std::vector<XMFLOAT3> area = Generate(positions, indices, NormalWeighting::Area);
+		CHECK(Near(area[O], Normalized(-1.0f, -1.0f, -2.0f)));
+		CHECK(Near(area[XY], XMFLOAT3(0.0f, 0.0f, -1.0f)));
+		CHECK(Near(area[Y], Normalized(-2.0f, 0.0f, -1.0f)));	// both x triangles touch Y
+
+		// Vertices no triangle uses are written as zero, over whatever was there
+		CHECK(Near(angle[Far], XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f) && Near(angle[Unused], XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f));
+		CHECK(Near(area[Unused], XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f));
+
+		// Degenerate triangles (a repeated corner, three points on a line) and triangles
+		// with an index past the vertices add nothing: the same normals, Far still zero
+		std::vector<unsigned int> degenerate = indices;
+		degenerate.insert(degenerate.end(), { O, O, X, O, X, Far, X, Far, X, O, X, 100 });
+		for (NormalWeighting weighting : { NormalWeighting::Angle, NormalWeighting::Area })
+		{
+			std::vector<XMFLOAT3> clean = Generate(positions, indices, weighting);
+			std::vector<XMFLOAT3> normals = Generate(positions, degenerate, weighting);
+			bool same = true;
+			for (size_t v = 0; v < normals.size(); v++)
+				same = same && Near(normals[v], clean[v]);
+			CHECK(same);
+			CHECK(Near(normals[Far], XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f));
+		}
+	}
+
+	// Two triangles facing away from each other on the same vertices cancel out: zero, not NaN
+	{
+		std::vector<XMFLOAT3> positions = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) };
+		std::vector<XMFLOAT3> normals = Generate(positions, { 0, 1, 2, 0, 2, 1 }, NormalWeighting::Angle);
+		CHECK(Near(normals[0], XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f));
+	}
+
+	// A sphere large enough for many blocks: one block and any number of blocks give the
+	// same normals up to rounding. Away from the pole rows, where the duplicated pole
+	// vertices make degenerate triangles, every normal is unit length and radial, all on
+	// the same side of the surface.
+	{
+		const unsigned int rings = 200, segments = 400;
+		SyntheticMesh sphere = MakeSphere(rings, segments);
+		for (NormalWeighting weighting : { NormalWeighting::Angle, NormalWeighting::Area })
+		{
+			std::vector<XMFLOAT3> single = Generate(sphere.positions, sphere.indices, weighting, 1);
+			bool same = true;
+			for (unsigned int blockCount : { 0u, 3u, 8u, 64u })
+			{
+				std::vector<XMFLOAT3> blocks = Generate(sphere.positions, sphere.indices, weighting, blockCount);
+				for (size_t v = 0; v < blocks.size(); v++)
+					same = same && Near(blocks[v], single[v]);
+			}
+			CHECK(same);
+
+			bool unit = true;
+			float lowest = 1.0f, highest = -1.0f;
+			for (size_t v = segments + 1; v < single.size() - (segments + 1); v++)
+			{
+				XMFLOAT3 const& n = single[v];
+				XMFLOAT3 const& p = sphere.positions[v];
+				unit = unit && std::fabs(n.x * n.x + n.y * n.y + n.z * n.z - 1.0f) < 1e-4f;
+				float cosine = (n.x * p.x + n.y * p.y + n.z * p.z) / std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+				lowest = std::min(lowest, cosine);
+				highest = std::max(highest, cosine);
+			}
+			CHECK(unit);
+			CHECK(lowest > 0.999f || highest < -0.999f);
+		}
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,119 @@
+#include "pch.h"
+#include "VertexPacking.h"
+#include "TestHarness.h"
+#include <random>
+
+// Packed vertex round trip (VertexPacking.h): unorm16 positions and octahedral normals
+// come back within the error bounds the module advertises, for random values and for
+// the values on the edges of each encoding.
+
+namespace
+{
+	// Angle between two unit vectors, accurate near zero unlike acos of the dot product
+	double Angle(XMFLOAT3 const& a, XMFLOAT3 const& b)
+	{
+		double cx = double(a.y) * b.z - double(a.z) * b.y;
+		double cy = double(a.z) * b.x - double(a.x) * b.z;
+		double cz = double(a.x) * b.y - double(a.y) * b.x;
+		double dot = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+		return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot);
+	}
+
+	XMFLOAT3 Normalized(XMFLOAT3 const& v)
+	{
+		float length = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+		return XMFLOAT3(v.x / length, v.y / length, v.z / length);
+	}
+}
+
+int main()
+{
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::normal_distribution<float> gaussian;
+
+	// Scalar encodings: exact at the ends, clamped outside, half a step inside
+	CHECK(EncodeUnorm16(0.0f) == 0 && EncodeUnorm16(1.0f) == 65535);
+	CHECK(EncodeUnorm16(-3.0f) == 0 && EncodeUnorm16(7.0f) == 65535);
+	CHECK(EncodeSnorm16(-1.0f) == -32767 && EncodeSnorm16(1.0f) == 32767 && EncodeSnorm16(0.0f) == 0);
+	CHECK(DecodeSnorm16(-32768) == -1.0f);
+	for (int i = 0; i < 100000; i++)
+	{
+		float value = unit(random);
+		CHECK(std::fabs(DecodeUnorm16(EncodeUnorm16(value)) - value) <= 0.5f / 65535.0f + FLT_EPSILON);
+	}
+
+	// Positions: every axis within GetPositionErrorBound, on a box away from the origin
+	// so the offset matters
+	XMFLOAT3 boundsMin(-130.0f, 2.5f, 1000.0f), boundsMax(70.0f, 3.0f, 1400.0f);
+	PositionQuantization quantization = GetPositionQuantization(boundsMin, boundsMax);
+	XMFLOAT3 positionBound = GetPositionErrorBound(quantization);
+	XMFLOAT3 maxPositionError(0.0f, 0.0f, 0.0f);
+	float maxNormalError = 0.0f, maxColorError = 0.0f;
+	for (int i = 0; i < 200000; i++)
+	{
+		XMFLOAT3 pos(boundsMin.x + unit(random) * (boundsMax.x - boundsMin.x),
+			boundsMin.y + unit(random) * (boundsMax.y - boundsMin.y),
+			boundsMin.z + unit(random) * (boundsMax.z - boundsMin.z));
+		if (i < 8)
+			pos = XMFLOAT3(i & 1 ? boundsMax.x : boundsMin.x, i & 2 ? boundsMax.y : boundsMin.y, i & 4 ? boundsMax.z : boundsMin.z);
+		XMFLOAT3 normal = Normalized(XMFLOAT3(gaussian(random), gaussian(random), gaussian(random)));
+		XMFLOAT4 col(unit(random), unit(random), unit(random), unit(random));
+
+		XMFLOAT3 unpackedPos, unpackedNormal;
+		XMFLOAT4 unpackedCol;
+		UnpackVertex(PackVertex(pos, normal, col, quantization), quantization, unpackedPos, unpackedNormal, unpackedCol);
+		maxPositionError.x = std::max(maxPositionError.x, std::fabs(unpackedPos.x - pos.x));
+		maxPositionError.y = std::max(maxPositionError.y, std::fabs(unpackedPos.y - pos.y));
+		maxPositionError.z = std::max(maxPositionError.z, std::fabs(unpackedPos.z - pos.z));
+		maxNormalError = std::max(maxNormalError, float(Angle(normal, unpackedNormal)));
+		maxColorError = std::max({ maxColorError, std::fabs(unpackedCol.x - col.x), std::fabs(unpackedCol.y - col.y),
+			std::fabs(unpackedCol.z - col.z), std::fabs(unpackedCol.w - col.w) });
+	}
+	CHECK(maxPositionError.x <= positionBound.x);
+	CHECK(maxPositionError.y <= positionBound.y);
+	CHECK(maxPositionError.z <= positionBound.z);
+	CHECK(maxColorError <= GetColorErrorBound());
+	std::printf("position error %g %g %g (bound %g %g %g), colour %g (bound %g)\n", maxPositionError.x, maxPositionError.y,
+		maxPositionError.z, positionBound.x, positionBound.y, positionBound.z, maxColorError, GetColorErrorBound());
+
+	// Normals: the axes, the octahedron edges and the folded lower hemisphere, where
+	// the encoding is worst, on top of the random ones above
+	const float s = std::sqrt(0.5f);
+	const XMFLOAT3 edges[] = {
+		{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+		{ s, s, 0 }, { -s, s, 0 }, { s, -s, 0 }, { -s, -s, 0 }, { s, 0, -s }, { 0, -s, -s },
+	};
+	for (XMFLOAT3 const& normal : edges)
+	{
+		int16_t encoded[2];
+		EncodeOctahedral(normal, encoded);
+		maxNormalError = std::max(maxNormalError, float(Angle(normal, DecodeOctahedral(encoded))));
+	}
+	for (int i = 0; i < 200000; i++)
+	{
+		XMFLOAT3 normal = Normalized(XMFLOAT3(gaussian(random), gaussian(random), -std::fabs(gaussian(random)) * 0.01f));
+		int16_t encoded[2];
+		EncodeOctahedral(normal, encoded);
+		maxNormalError = std::max(maxNormalError, float(Angle(normal, DecodeOctahedral(encoded))));
+	}
+	CHECK(maxNormalError <= GetNormalErrorBound());
+	std::printf("normal error %g rad (bound %g)\n", maxNormalError, GetNormalErrorBound());
+
+	// Unnormalized and zero normals: the direction survives, zero does not produce NaN
+	int16_t encoded[2];
+	EncodeOctahedral(XMFLOAT3(0.0f, 30.0f, -40.0f), encoded);
+	CHECK(Angle(DecodeOctahedral(encoded), XMFLOAT3(0.0f, 0.6f, -0.8f)) <= GetNormalErrorBound());
+	EncodeOctahedral(XMFLOAT3(0.0f, 0.0f, 0.0f), encoded);
+	XMFLOAT3 zero = DecodeOctahedral(encoded);
+	CHECK(zero.x == zero.x && zero.y == zero.y && zero.z == zero.z);
+
+	// A flat box: the zero-size axis decodes to the offset exactly
+	PositionQuantization flat = GetPositionQuantization(XMFLOAT3(0.0f, 5.0f, 0.0f), XMFLOAT3(1.0f, 5.0f, 1.0f));
+	XMFLOAT3 pos, normal;
+	XMFLOAT4 col;
+	UnpackVertex(PackVertex(XMFLOAT3(0.25f, 5.0f, 0.75f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT4(), flat), flat, pos, normal, col);
+	CHECK(pos.y == 5.0f);
+
+	return TestResult();
+}
@@ -0,0 +1,125 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "VertexRemap.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <algorithm>
+#include <random>
+
+// Vertex fetch remap (VertexRemap.h): vertices come out in the order the index stream
+// first uses them, the ones no triangle uses are dropped, and the remapped indices over
+// the remapped vertices draw exactly the triangles of the original mesh, in order.
+
+namespace
+{
+	// The new indices name every vertex in [0, count) and first use them in that order
+	template <typename Indices>
+	bool InFirstUseOrder(Indices const& indices, size_t count)
+	{
+		unsigned int next = 0;
+		for (unsigned int index : indices)
+		{
+			if (index > next || index >= count)
+				return false;
+			if (index == next)
+				next++;
+		}
+		return next == count;
+	}
+
+	// Triangle by triangle, corner by corner, the same vertex values
+	template <typename Vertices, typename Indices>
+	bool SameTriangles(Vertices const& vertices, Indices const& indices, Vertices const& newVertices, Indices const& newIndices)
+	{
+		if (indices.size() != newIndices.size())
+			return false;
+		for (size_t i = 0; i < indices.size(); i++)
+			if (newIndices[i] >= newVertices.size() || std::memcmp(&vertices[indices[i]], &newVertices[newIndices[i]], sizeof(vertices[0])) != 0)
+				return false;
+		return true;
+	}
+}
+
+int main()
+{
+	// By hand: vertices 2 and 5 are unused, the rest are numbered by first use
+	{
+		std::vector<unsigned int> indices = { 4, 1, 6, 6, 1, 0, 3, 4, 0 };
+		size_t newVertexCount = 0;
+		std::vector<unsigned int> remap = BuildVertexFetchRemap(indices, 7, &newVertexCount);
+		CHECK(newVertexCount == 5);
+		CHECK((remap == std::vector<unsigned int>{ 3, 1, c_unusedVertex, 4, 0, c_unusedVertex, 2 }));
+
+		std::vector<unsigned int> remapped = indices;
+		RemapIndices(remapped, remap);
+		CHECK((remapped == std::vector<unsigned int>{ 0, 1, 2, 2, 1, 3, 4, 0, 3 }));
+
+		std::vector<int> values = { 10, 11, 12, 13, 14, 15, 16 };
+		RemapVertices(values, remap, newVertexCount);
+		CHECK((values == std::vector<int>{ 14, 11, 16, 10, 13 }));
+	}
+
+	// Shuffled sphere with unused vertices mixed in: first-use order, the right count,
+	// the same triangles
+	{
+		SyntheticMesh sphere = MakeSphere(60, 90, 0.01f);
+		std::mt19937 random(9);
+		size_t usedCount = sphere.positions.size();
+		std::vector<XMFLOAT3> vertices = sphere.positions;
+		for (size_t i = 0; i < usedCount / 3; i++)
+			vertices.push_back(XMFLOAT3(100.0f + i, 0.0f, 0.0f));
+		std::vector<unsigned int> order(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = (unsigned int)(i);
+		std::shuffle(order.begin(), order.end(), random);
+		std::vector<XMFLOAT3> shuffled(vertices.size());
+		for (size_t i = 0; i < order.size(); i++)
+			shuffled[order[i]] = vertices[i];
+		std::vector<unsigned int> indices = sphere.indices;
+		for (unsigned int& index : indices)
+			index = order[index];
+
+		size_t newVertexCount = 0;
+		std::vector<unsigned int> remap = BuildVertexFetchRemap(indices, shuffled.size(), &newVertexCount);
+		CHECK(newVertexCount == usedCount);
+		size_t dropped = std::count(remap.begin(), remap.end(), c_unusedVertex);
+		CHECK(dropped == shuffled.size() - usedCount);
+
+		std::vector<unsigned int> newIndices(indices.size());
+		RemapIndices(newIndices.data(), indices.data(), indices.size(), remap.data());
+		std::vector<XMFLOAT3> newVertices = shuffled;
+		RemapVertices(newVertices, remap, newVertexCount);
+		CHECK(newVertices.size() == usedCount);
+		CHECK(InFirstUseOrder(newIndices, newVertexCount));
+		CHECK(SameTriangles(shuffled, indices, newVertices, newIndices));
+		bool noUnused = true;
+		for (XMFLOAT3 const& v : newVertices)
+			noUnused = noUnused && v.x < 100.0f;
+		CHECK(noUnused);
+
+		// Remapping in place gives the same indices
+		RemapIndices(indices.data(), indices.data(), indices.size(), remap.data());
+		CHECK(indices == newIndices);
+	}
+
+	// Mesh::OptimizeVertexFetch applies the same table to its vertices and its indices
+	{
+		SyntheticMesh sphere = MakeSphere(30, 40, 0.01f);
+		auto mesh = std::make_unique<Mesh>(std::string());
+		for (size_t i = 0; i < sphere.positions.size(); i++)
+			mesh->vertices.push_back({ sphere.positions[i], XMFLOAT4(0.01f * (i % 100), 0.5f, 0.25f, 1.0f), sphere.normals[i] });
+		mesh->vertices.push_back({ XMFLOAT3(7.0f, 7.0f, 7.0f), XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT3(0.0f, 1.0f, 0.0f) });
+		std::reverse(sphere.indices.begin(), sphere.indices.end());	// first use far from vertex order
+		mesh->indices.assign(sphere.indices.begin(), sphere.indices.end());
+		std::pmr::vector<Vertex> vertices = mesh->vertices;
+		std::pmr::vector<unsigned int> indices = mesh->indices;
+
+		std::vector<unsigned int> remap = mesh->OptimizeVertexFetch();
+		CHECK(remap.size() == vertices.size() && remap.back() == c_unusedVertex);
+		CHECK(mesh->GetVertexCount() == vertices.size() - 1);
+		CHECK(InFirstUseOrder(mesh->indices, mesh->GetVertexCount()));
+		CHECK(SameTriangles(vertices, indices, mesh->vertices, mesh->indices));
+	}
+
+	return TestResult();
+}
@@ -0,0 +1,135 @@
+#include "pch.h"
+#include "Mesh.h"
+#include "VertexWeld.h"
+#include "SyntheticMeshes.h"
+#include "TestHarness.h"
+#include <random>
+#include <set>
+#include <tuple>
+
+// Vertex welding (VertexWeld.h, Mesh::WeldVertices): vertices closer than epsilon to the
+// same grid point merge, vertices more than epsilon apart in position or in normal stay
+// separate whatever the grid, and the indices are rewritten to draw the same triangles.
+
+namespace
+{
+	const float c_positionEpsilon = 1e-3f;
+	const float c_normalEpsilon = 1e-2f;
+
+	float Snap(float value, float epsilon)
+	{
+		return float(std::floor(double(value) / epsilon + 0.5) * epsilon);
+	}
+
+	std::unique_ptr<Mesh> MakeMesh(std::vector<Vertex> const& vertices, std::vector<unsigned int> const& indices)
+	{
+		auto mesh = std::make_unique<Mesh>(std::string());
+		mesh->vertices.assign(vertices.begin(), vertices.end());
+		mesh->indices.assign(indices.begin(), indices.end());
+		return mesh;
+	}
+
+	Vertex MakeVertex(float x, float y, float z, float nx = 0.0f, float ny = 1.0f, float nz = 0.0f)
+	{
+		return { XMFLOAT3(x, y, z), XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f), XMFLOAT3(nx, ny, nz) };
+	}
+}
+
+int main()
+{
+	// One stream by hand: 0.3 epsilon from the same grid point merges, 1.01 epsilon apart
+	// does not, and the representatives keep their first-occurrence order
+	{
+		const float e = c_positionEpsilon;
+		float positions[][3] = {
+			{ 1.0f, 2.0f, 3.0f },
+			{ 5.0f, 5.0f, 5.0f },
+			{ 1.0f + 0.3f * e, 2.0f - 0.3f * e, 3.0f },
+			{ 1.0f + 1.01f * e, 2.0f, 3.0f },
+			{ 5.0f, 5.0f, 5.0f + 0.2f * e },
+			{ 1.0f, 2.0f, 3.0f - 1.01f * e },
+		};
+		WeldStream stream = { positions, sizeof(positions[0]), 3, e };
+		unsigned int remap[6];
+		CHECK(BuildWeldRemap(remap, &stream, 1, 6) == 4);
+		CHECK(remap[0] == 0 && remap[1] == 1 && remap[2] == 0 && remap[3] == 2 && remap[4] == 1 && remap[5] == 3);
+
+		// Epsilon 0 compares exact bits, -0 and +0 alike
+		float exact[][3] = { { 0.0f, 1.0f, 2.0f }, { -0.0f, 1.0f, 2.0f }, { 0.0f, 1.0f, std::nextafter(2.0f, 3.0f) } };
+		WeldStream exactStream = { exact, sizeof(exact[0]), 3, 0.0f };
+		CHECK(BuildWeldRemap(remap, &exactStream, 1, 3) == 2);
+		CHECK(remap[0] == 0 && remap[1] == 0 && remap[2] == 1);
+	}
+
+	// Just beyond epsilon, in position or in normal: no merge. Just within, around the
+	// same grid point: merge, and the triangles point at the survivors
+	{
+		const float e = c_positionEpsilon, n = c_normalEpsilon;
+		std::vector<Vertex> vertices = {
+			MakeVertex(0.0f, 0.0f, 0.0f),
+			MakeVertex(1.0f, 0.0f, 0.0f),
+			MakeVertex(0.0f, 0.0f, 1.0f),
+			MakeVertex(1.0f + 1.01f * e, 0.0f, 0.0f),	// beyond in position
+			MakeVertex(0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.01f * n),	// beyond in normal
+			MakeVertex(0.4f * e, -0.4f * e, 0.0f, 0.4f * n, 1.0f, 0.0f),	// within
+		};
+		std::unique_ptr<Mesh> mesh = MakeMesh(vertices, { 0, 1, 2, 5, 3, 4 });
+		std::vector<unsigned int> remap = mesh->WeldVertices(c_positionEpsilon, c_normalEpsilon);
+		CHECK(mesh->GetVertexCount() == 5);
+		CHECK((remap == std::vector<unsigned int>{ 0, 1, 2, 3, 4, 0 }));
+		CHECK((std::vector<unsigned int>(mesh->indices.begin(), mesh->indices.end()) == std::vector<unsigned int>{ 0, 1, 2, 0, 3, 4 }));
+
+		// Colour merges within a 1/512 step as well, and splits past it
+		vertices[5] = vertices[0];
+		vertices[5].col.x += 1.01f / 512.0f;
+		mesh = MakeMesh(vertices, { 0, 1, 2, 5, 3, 4 });
+		mesh->WeldVertices(c_positionEpsilon, c_normalEpsilon);
+		CHECK(mesh->GetVertexCount() == 6);
+	}
+
+	// A sphere split into one vertex per corner, as exporters write it, with every copy
+	// moved by up to 0.3 epsilon around the grid point of its original: the copies of a
+	// vertex merge back, vertices of distinct grid points do not, and every corner of the
+	// welded mesh is within reach of the corner it replaced
+	{
+		SyntheticMesh sphere = MakeSphere(40, 60, 0.01f);
+		std::mt19937 random(13);
+		std::uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+		std::vector<Vertex> corners;
+		std::set<std::tuple<float, float, float, float, float, float>> cells;
+		for (unsigned int index : sphere.indices)
+		{
+			XMFLOAT3 p = sphere.positions[index], normal = sphere.normals[index];
+			p = XMFLOAT3(Snap(p.x, c_positionEpsilon), Snap(p.y, c_positionEpsilon), Snap(p.z, c_positionEpsilon));
+			normal = XMFLOAT3(Snap(normal.x, c_normalEpsilon), Snap(normal.y, c_normalEpsilon), Snap(normal.z, c_normalEpsilon));
+			cells.insert(std::make_tuple(p.x, p.y, p.z, normal.x, normal.y, normal.z));
+			corners.push_back(MakeVertex(
+				p.x + jitter(random) * c_positionEpsilon, p.y + jitter(random) * c_positionEpsilon, p.z + jitter(random) * c_positionEpsilon,
+				normal.x + jitter(random) * c_normalEpsilon, normal.y + jitter(random) * c_normalEpsilon, normal.z + jitter(random) * c_normalEpsilon));
+		}
+		std::vector<unsigned int> cornerIndices(corners.size());
+		for (size_t i = 0; i < cornerIndices.size(); i++)
+			cornerIndices[i] = (unsigned int)(i);
+
+		std::unique_ptr<Mesh> mesh = MakeMesh(corners, cornerIndices);
+		std::vector<unsigned int> remap = mesh->WeldVertices(c_positionEpsilon, c_normalEpsilon);
+		CHECK(mesh->GetVertexCount() == cells.size());
+		CHECK(mesh->GetVertexCount() < sphere.positions.size());	// seam and poles merged too
+		CHECK(mesh->indices.size() == cornerIndices.size());
+
+		bool rewritten = true;
+		bool close = true;
+		for (size_t i = 0; i < mesh->indices.size(); i++)
+		{
+			rewritten = rewritten && mesh->indices[i] == remap[i];
+			XMFLOAT3 const& a = corners[i].pos;
+			XMFLOAT3 const& b = mesh->vertices[mesh->indices[i]].pos;
+			close = close && std::fabs(a.x - b.x) < c_positionEpsilon && std::fabs(a.y - b.y) < c_positionEpsilon &&
+				std::fabs(a.z - b.z) < c_positionEpsilon;
+		}
+		CHECK(rewritten && close);
+		CHECK(mesh->HasValidIndices());
+	}
+
+	return TestResult();
+}